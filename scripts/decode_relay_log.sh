@@ -0,0 +1,43 @@
+#!/bin/sh
+# Capture dictionary logs from the relay over RTT and decode them on the host.
+#
+# usage: scripts/decode_relay_log.sh [build dir] [device]
+#   build dir : west build directory (default: build)
+#   device    : J-Link device name (default: NRF52840_XXAA)
+#
+# The firmware must be built with overlay-log-dictionary.conf.
+# Stop the capture with Ctrl+C, the log is decoded afterwards (the script
+# itself keeps running: only the logger gets the SIGINT).
+
+BUILD_DIR=${1:-build}
+DEVICE=${2:-NRF52840_XXAA}
+DICT="$BUILD_DIR/central_and_peripheral_hr/zephyr/log_dictionary.json"
+RAW=relay_log.bin
+
+if [ -z "$ZEPHYR_BASE" ]; then
+    echo "ZEPHYR_BASE is not set" >&2
+    exit 1
+fi
+
+if [ ! -f "$DICT" ]; then
+    # non-sysbuild build directory
+    DICT="$BUILD_DIR/zephyr/log_dictionary.json"
+fi
+
+if [ ! -f "$DICT" ]; then
+    echo "log_dictionary.json not found in $BUILD_DIR" >&2
+    exit 1
+fi
+
+# A handler (not an ignore) is reset to the default in the child, so Ctrl+C
+# still stops JLinkRTTLogger but no longer ends this script.
+trap ':' INT
+JLinkRTTLogger -Device "$DEVICE" -If SWD -Speed 4000 -RTTChannel 0 "$RAW"
+trap - INT
+
+if [ ! -s "$RAW" ]; then
+    echo "nothing captured in $RAW" >&2
+    exit 1
+fi
+
+python3 "$ZEPHYR_BASE/scripts/logging/dictionary/log_parser.py" "$DICT" "$RAW"
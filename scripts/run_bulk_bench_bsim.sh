@@ -0,0 +1,50 @@
+#!/bin/sh
+# Compare L2CAP CoC and GATT throughput between two relays in BabbleSim.
+#
+# usage: scripts/run_bulk_bench_bsim.sh <relay exe> <hub exe> <node exe> [seconds]
+#   relay exe : relay built for nrf52_bsim with overlay-bulk-bench-bsim.conf
+#   hub exe   : SLIMHUB (or any central that connects to the relay) for nrf52_bsim
+#   node exe  : DE&N node for nrf52_bsim
+#   seconds   : simulated time (default: 60)
+#
+# Devices: 0 = hub, 1 = upper relay, 2 = lower relay, 3 = node, chained as in
+# scripts/run_chain_bsim.sh. When relay 1 has opened the bulk channel to
+# relay 2 it sends CONFIG_RELAY_BULK_BENCH_BYTES over the channel and then
+# over GATT write without response, and logs both.
+
+RELAY=${1:?relay exe}
+HUB=${2:?hub exe}
+NODE=${3:?node exe}
+SECONDS_SIM=${4:-60}
+SIM_ID=relay_bulk_$$
+OUT=${SIM_ID}_logs
+
+if [ -z "$BSIM_OUT_PATH" ]; then
+    echo "BSIM_OUT_PATH is not set" >&2
+    exit 1
+fi
+
+mkdir -p "$OUT"
+ATT=$(realpath "$OUT")/bulk_att.txt
+cat > "$ATT" <<EOT
+0 1 : 60
+1 0 : 60
+1 2 : 60
+2 1 : 60
+2 3 : 60
+3 2 : 60
+EOT
+
+"$HUB" -s="$SIM_ID" -d=0 > "$OUT/hub.log" 2>&1 &
+"$RELAY" -s="$SIM_ID" -d=1 > "$OUT/relay1.log" 2>&1 &
+"$RELAY" -s="$SIM_ID" -d=2 > "$OUT/relay2.log" 2>&1 &
+"$NODE" -s="$SIM_ID" -d=3 > "$OUT/node.log" 2>&1 &
+
+(cd "$BSIM_OUT_PATH/bin" && ./bs_2G4_phy_v1 -s="$SIM_ID" -D=4 -sim_length="${SECONDS_SIM}e6" \
+    -channel=multiatt -argschannel -at=100 -file="$ATT")
+wait
+
+echo "logs in $OUT"
+# "[BULK] bench N B: CoC N ms (N kbit/s), GATT N ms (N kbit/s), xN.NN"
+grep -h "\[BULK\]" "$OUT/relay1.log" "$OUT/relay2.log"
+grep -q "\[BULK\] bench .* GATT .* kbit/s" "$OUT/relay1.log"
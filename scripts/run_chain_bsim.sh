@@ -0,0 +1,53 @@
+#!/bin/sh
+# Run a hub <- relay <- relay <- node chain in BabbleSim and check that the
+# node data reached the hub through both relays.
+#
+# usage: scripts/run_chain_bsim.sh <relay exe> <hub exe> <node exe> [seconds]
+#   relay exe : relay built for nrf52_bsim with overlay-chain-bsim.conf
+#   hub exe   : SLIMHUB (or any central that subscribes to the relay) for nrf52_bsim
+#   node exe  : DE&N node for nrf52_bsim
+#   seconds   : simulated time (default: 60)
+#
+# Devices: 0 = hub, 1 = upper relay, 2 = lower relay, 3 = node.
+# The multiatt channel only lets neighbours hear each other (60 dB), every
+# other pair is 100 dB apart (below the relay's -95 dBm connect threshold),
+# so relay 1 has to reach the node through relay 2.
+
+RELAY=${1:?relay exe}
+HUB=${2:?hub exe}
+NODE=${3:?node exe}
+SECONDS_SIM=${4:-60}
+SIM_ID=relay_chain_$$
+OUT=${SIM_ID}_logs
+
+if [ -z "$BSIM_OUT_PATH" ]; then
+    echo "BSIM_OUT_PATH is not set" >&2
+    exit 1
+fi
+
+mkdir -p "$OUT"
+ATT=$(realpath "$OUT")/chain_att.txt
+cat > "$ATT" <<EOF
+0 1 : 60
+1 0 : 60
+1 2 : 60
+2 1 : 60
+2 3 : 60
+3 2 : 60
+EOF
+
+"$HUB" -s="$SIM_ID" -d=0 > "$OUT/hub.log" 2>&1 &
+"$RELAY" -s="$SIM_ID" -d=1 > "$OUT/relay1.log" 2>&1 &
+"$RELAY" -s="$SIM_ID" -d=2 > "$OUT/relay2.log" 2>&1 &
+"$NODE" -s="$SIM_ID" -d=3 > "$OUT/node.log" 2>&1 &
+
+(cd "$BSIM_OUT_PATH/bin" && ./bs_2G4_phy_v1 -s="$SIM_ID" -D=4 -sim_length="${SECONDS_SIM}e6" \
+    -channel=multiatt -argschannel -at=100 -file="$ATT")
+wait
+
+echo "logs in $OUT"
+# relay 2 frames the node data, relay 1 unwraps it and logs the hop latency
+# every 256 frames ("[CHAIN] link N below: ...")
+grep -h "\[CHAIN\]" "$OUT/relay2.log" "$OUT/relay1.log"
+grep -q "\[CHAIN\] upstream is a relay" "$OUT/relay2.log" &&
+    grep -q "\[CHAIN\] node 1 relay hop(s) below" "$OUT/relay1.log"
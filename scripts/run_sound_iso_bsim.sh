@@ -0,0 +1,39 @@
+#!/bin/sh
+# Run hub <- relay <- node with raw sound over CIS in BabbleSim and check
+# that the relay forwards the node SDUs to the hub.
+#
+# usage: scripts/run_sound_iso_bsim.sh <relay build dir> <hub exe> <node exe> [seconds]
+#   relay build dir : relay built for nrf5340bsim/nrf5340/cpuapp with overlay-sound-iso.conf
+#                     and sound-iso-netcore.conf (sysbuild, both cores in zephyr/zephyr.exe)
+#   hub exe         : SLIMHUB (or any central that creates a CIS to the relay)
+#   node exe        : DE&N node that accepts a CIS and sends raw sound SDUs
+#   seconds         : simulated time (default: 30)
+#
+# Devices: 0 = hub, 1 = relay, 2 = node.
+
+RELAY=${1:?relay build dir}/zephyr/zephyr.exe
+HUB=${2:?hub exe}
+NODE=${3:?node exe}
+SECONDS_SIM=${4:-30}
+SIM_ID=relay_sound_iso_$$
+OUT=${SIM_ID}_logs
+
+if [ -z "$BSIM_OUT_PATH" ]; then
+    echo "BSIM_OUT_PATH is not set" >&2
+    exit 1
+fi
+
+mkdir -p "$OUT"
+
+"$HUB" -s="$SIM_ID" -d=0 > "$OUT/hub.log" 2>&1 &
+"$RELAY" -s="$SIM_ID" -d=1 > "$OUT/relay.log" 2>&1 &
+"$NODE" -s="$SIM_ID" -d=2 > "$OUT/node.log" 2>&1 &
+
+(cd "$BSIM_OUT_PATH/bin" && ./bs_2G4_phy_v1 -s="$SIM_ID" -D=3 -sim_length="${SECONDS_SIM}e6")
+wait
+
+echo "logs in $OUT"
+# "[ISO] rx N lost N err N -> fwd N drop N, latency node + relay (max) + hub us"
+# every CONFIG_RELAY_SOUND_ISO_REPORT_S
+grep -h "\[ISO\]" "$OUT/relay.log"
+grep "\[ISO\] rx" "$OUT/relay.log" | tail -1 | grep -q -- "-> fwd [1-9]"
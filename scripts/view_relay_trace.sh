@@ -0,0 +1,30 @@
+#!/bin/sh
+# Capture a CTF trace from the relay and print the relay timeline.
+#
+# usage: scripts/view_relay_trace.sh <trace dir> [serial port]
+#   trace dir   : directory for the CTF stream + metadata (created)
+#   serial port : capture from the UART backend first (e.g. /dev/ttyACM0),
+#                 stop with Ctrl+C. Leave it out when the stream file is
+#                 already there (native_sim: zephyr.exe -trace-file=<trace dir>/channel0_0).
+#
+# The firmware must be built with overlay-tracing.conf.
+# Open the same directory in Trace Compass for the graphical timeline.
+
+TRACE_DIR=${1:?trace dir}
+PORT=$2
+
+if [ -z "$ZEPHYR_BASE" ]; then
+    echo "ZEPHYR_BASE is not set" >&2
+    exit 1
+fi
+
+mkdir -p "$TRACE_DIR"
+cp "$ZEPHYR_BASE/subsys/tracing/ctf/tsdl/metadata" "$TRACE_DIR/"
+
+if [ -n "$PORT" ]; then
+    python3 "$ZEPHYR_BASE/scripts/tracing/trace_capture_uart.py" -d "$PORT" -b 1000000 \
+        -o "$TRACE_DIR/channel0_0"
+fi
+
+# relay trace points + work queue / thread switches around them
+babeltrace2 "$TRACE_DIR" | grep -E "named_event|k_work|thread_switched"
@@ -8,6 +8,7 @@
 
 /* BLUETOOTH HEADERS */
 #include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/gap.h>
 #include <zephyr/bluetooth/hci.h>
 #include <zephyr/bluetooth/hci_vs.h>
 #include <zephyr/bluetooth/conn.h>
@@ -25,6 +26,7 @@
 #include <zephyr/sys/util.h>
 #include <soc.h>
 #include <errno.h>
+#include <string.h>
 
 /* ZEPHYR LOGGING HEADERS */
 #include <zephyr/logging/log.h>
@@ -39,10 +41,32 @@
 // #include "peripheral_service.h"
 // #include "env_service.h"
 // #include "sound_service.h"
+#include "grideye_service.h"
+#include "grideye_relay.h"
 // #include "ubinos_service.h"
 
 #include "relay_stub_service.h"
 #include "inference_service.h"
+#include "relay_segment.h"
+#include "file_transfer.h"
+#include "model_update_proxy.h"
+#include "feature_relay.h"
+#include "relay_workq.h"
+#include "relay_stats.h"
+#include "radio_airtime.h"
+#include "relay_trace.h"
+#include "node_time_sync.h"
+#include "relay_liveness.h"
+#include "relay_security.h"
+#include "gatt_proxy.h"
+#include "node_write.h"
+#include "relay_chain.h"
+#include "sound_iso.h"
+#include "relay_bulk.h"
+#include "sound_service.h"
+#include "node_stream.h"
+#include "room_device.h"
+#include "tx_power.h"
 
 
 #define MAX_SUBS 24
@@ -54,6 +78,7 @@ static void reset_work_handler(struct k_work *work);
 static void adv_restart_work_handler(struct k_work *work);
 static void scan_restart_work_handler(struct k_work *work);
 static void initiate_timeout_work_handler(struct k_work *work);
+static void adv_tx_power_work_handler(struct k_work *work);
 
 static void adv_start_safe(int delay_ms);
 static void adv_stop_safe(void);
@@ -63,23 +88,26 @@ static void scan_device_found(const bt_addr_le_t *addr, int8_t rssi, uint8_t typ
 static int start_discovery(struct bt_conn *conn);
 static uint8_t discover_func(struct bt_conn *conn, const struct bt_gatt_attr *attr, struct bt_gatt_discover_params *params);
 static bool ad_parse_cb (struct bt_data * data, void *user_data);
-static int hci_vs_write_adv_tx_power(int8_t tx_dbm);
-static int hci_vs_read_adv_tx_power(int8_t *out_dbm);
 static uint8_t generic_notify_cb(struct bt_conn *conn, struct bt_gatt_subscribe_params *params, const void *data, uint16_t length);
 static void connected(struct bt_conn *conn, uint8_t err);
 static void disconnected(struct bt_conn *conn, uint8_t reason);
+static void mtu_exchange_cb(struct bt_conn *conn, uint8_t att_err, struct bt_gatt_exchange_params *params);
 
 static struct bt_gatt_discover_params discover_params;
+static struct bt_gatt_exchange_params mtu_params;
 
 K_WORK_DELAYABLE_DEFINE(adv_restart_work, adv_restart_work_handler);
 K_WORK_DELAYABLE_DEFINE(scan_restart_work, scan_restart_work_handler);
 K_WORK_DELAYABLE_DEFINE(reset_work, reset_work_handler);
 K_WORK_DELAYABLE_DEFINE(initiating_timeout_work, initiate_timeout_work_handler);
+K_WORK_DEFINE(adv_tx_power_work, adv_tx_power_work_handler);
 
 /* GLOBAL PARAMETER DEFINITIONS */
 static uint32_t adv_backoff_ms = 200;
 static uint32_t scan_backoff_ms = 200;
 static uint32_t initiate_start_ms = 0;
+static uint32_t discovery_start_ms;
+static bool node_connected_once;
 #define BACKOFF_CAP 2000
 
 static atomic_t adv_on;
@@ -88,14 +116,43 @@ static atomic_t initiating;
 
 static struct bt_gatt_subscribe_params subs[MAX_SUBS];
 static size_t subs_cnt;
-static uint16_t h_remote_rawdata;
-static uint16_t h_remote_seq_result;
-static uint16_t h_remote_debug_string;
+/* subs[i] 의 handler. notification 은 params - subs 로 바로 찾는다 (NULL: 등록 안 된 characteristic) */
+static struct node_stream *subs_stream[MAX_SUBS];
+
+/* node stream stall 복구 단계 (reset_work) */
+enum stall_step
+{
+    STALL_NONE,
+    STALL_CCC,          /* 구독한 CCC 를 다시 쓴다 */
+    STALL_REDISCOVER,   /* handle 이 바뀌었을 수 있으니 다시 discover */
+    STALL_DISCONNECT,   /* 끊고 scan 부터 다시 */
+};
+static const char *const stall_step_str[] = { "none", "ccc rewrite", "rediscover", "disconnect" };
+
+static struct
+{
+    enum stall_step step;
+    uint32_t mask;              /* 감지 당시 멈춘 stream */
+    uint32_t detect_ms;
+    uint32_t step_ms;
+} stall;
+
+static bool rediscovering;
+static atomic_t ccc_write_busy;
+static struct bt_gatt_write_params ccc_write_params;
+static size_t ccc_write_idx;
+static const uint16_t ccc_notify_val = BT_GATT_CCC_NOTIFY;
+
+#if defined(CONFIG_RELAY_SEG_DOWNSTREAM)
+static struct relay_seg_rx seq_result_rx;
+static struct relay_seg_rx debug_string_rx;
+#endif
 
 struct adv_match_ctx
 {
     bool name_match;
     char found_name[20];    // BT_GAP_MAX_NAME_LEN
+    struct relay_chain_peer peer;   /* scan response 의 chain service data */
 };
 static struct bt_conn *central_conn;
 static struct bt_conn *central_pending;
@@ -116,15 +173,58 @@ static struct bt_conn *peripheral_conn;
 #define BLE_DEVICE_NAME CONFIG_BT_DEVICE_NAME
 #define BLE_DEVICE_NAME_LEN (sizeof(BLE_DEVICE_NAME) - 1)
 
-static const struct bt_data adv_data[] = {
+/* flags (3 byte) 를 빼고 31 byte adv data 에 들어가는 이름 길이 */
+#define BLE_ADV_NAME_MAX    (BT_GAP_ADV_MAX_ADV_DATA_LEN - 3 - 2)
+#define ADV_DATA_NAME_IDX   1
+
+/* hub 가 저장한 이름이 있으면 device_conf_store 가 바꾼다 (ble_relay_adv_name_set) */
+static char adv_name[BLE_ADV_NAME_MAX] = BLE_DEVICE_NAME;
+static struct bt_data adv_data[] = {
     BT_DATA_BYTES(BT_DATA_FLAGS, (BT_LE_AD_GENERAL | BT_LE_AD_NO_BREDR)),
-    BT_DATA(BT_DATA_NAME_COMPLETE, BLE_DEVICE_NAME, BLE_DEVICE_NAME_LEN),
+    BT_DATA(BT_DATA_NAME_COMPLETE, adv_name, BLE_DEVICE_NAME_LEN),
+};
+#if defined(CONFIG_RELAY_CHAIN)
+/* base UUID 목록 (18 byte) 과 chain service data (27 byte) 는 31 byte 에 같이 안 들어가서
+ * chain 을 쓰면 service data 만 싣는다 (ble_relay_adv_chain_set)
+ */
+static struct relay_chain_adv chain_adv = {
+    .uuid = { BT_UUID_RELAY_CHAIN_SERVICE_VAL },
+    .info.node_hops = RELAY_CHAIN_NO_NODE,
+};
+static const struct bt_data scan_rsp_data[] = {
+    BT_DATA(BT_DATA_SVC_DATA128, &chain_adv, sizeof(chain_adv)),
 };
+#else
 static const struct bt_data scan_rsp_data[] = {
     BT_DATA_BYTES(BT_DATA_UUID128_ALL, BT_UUID_BASE_SERVICE_VAL),
 };
+#endif
+/* BT_LE_ADV_CONN: 100 ~ 150 ms, controller 가 0 ~ 10 ms 랜덤 지연을 더한다 */
+#define BLE_ADV_INTERVAL_US (BT_GAP_ADV_FAST_INT_MIN_2 * 625U + 5000U)
+
+static uint16_t ad_data_len(const struct bt_data *ad, size_t count)
+{
+    uint16_t len = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        len += 2 + ad[i].data_len;
+    }
+    return len;
+}
 
 /* BLE COMMON FUNCTION, PARAMETERS */
+static void scan_state_set(bool on)
+{
+    atomic_set(&scan_on, on);
+    radio_airtime_scan(on);
+}
+
+static void adv_state_set(bool on)
+{
+    atomic_set(&adv_on, on);
+    radio_airtime_adv(on);
+}
+
 BT_CONN_CB_DEFINE(conn_callbacks) = {
     .connected = connected,
     .disconnected = disconnected,
@@ -133,6 +233,8 @@ BT_CONN_CB_DEFINE(conn_callbacks) = {
 /* KERNEL WORK HANDLERS */
 static void scan_restart_work_handler(struct  k_work *work)
 {
+    RELAY_TRACE("rly_work", RELAY_TRACE_WORK_SCAN_RESTART, 0);
+
     if (atomic_get(&scan_on) == 1) {
         return;
     }
@@ -141,23 +243,23 @@ static void scan_restart_work_handler(struct  k_work *work)
     int err = bt_le_scan_start(BLE_SCAN_ACTIVE_SLOW, scan_device_found);
 
     if (err == -EALREADY) {
-        atomic_set(&scan_on, 1);
+        scan_state_set(true);
         scan_backoff_ms = 200;
         return;
     }
 
     if (err == -EBUSY) {
         scan_backoff_ms = MIN(scan_backoff_ms * 2, BACKOFF_CAP);
-        k_work_reschedule(&scan_restart_work, K_MSEC(scan_backoff_ms));
+        k_work_reschedule_for_queue(&relay_link_workq, &scan_restart_work, K_MSEC(scan_backoff_ms));
         return;
     }
 
     if (!err) {
-        atomic_set(&scan_on, 1);
+        scan_state_set(true);
         scan_backoff_ms = 200;
     } else {
         LOG_WRN("[SCAN] bt_le_scan_start failed (err %d), retry", err);
-        k_work_reschedule(&scan_restart_work, K_MSEC(300));
+        k_work_reschedule_for_queue(&relay_link_workq, &scan_restart_work, K_MSEC(300));
     }
 }
 
@@ -165,6 +267,8 @@ static void adv_restart_work_handler(struct k_work *work)
 {
     int err = 0;
 
+    RELAY_TRACE("rly_work", RELAY_TRACE_WORK_ADV_RESTART, 0);
+
     if (atomic_get(&adv_on)) {
         return;
     }
@@ -178,7 +282,7 @@ static void adv_restart_work_handler(struct k_work *work)
                           ARRAY_SIZE(scan_rsp_data));
     if (err == -EALREADY) {
         LOG_INF("[ADV] adv already on");
-        atomic_set(&adv_on, 1);
+        adv_state_set(true);
         adv_backoff_ms = 200;
         return;
     }
@@ -186,35 +290,47 @@ static void adv_restart_work_handler(struct k_work *work)
     if (err == -EBUSY) {
         LOG_WRN("[ADV] adv start busy, backoff %d ms", adv_backoff_ms);
         adv_backoff_ms = MIN(adv_backoff_ms * 2, BACKOFF_CAP);
-        k_work_reschedule(&adv_restart_work, K_MSEC(adv_backoff_ms));
+        k_work_reschedule_for_queue(&relay_link_workq, &adv_restart_work, K_MSEC(adv_backoff_ms));
         return;
     }
 
     if (!err) {
-        atomic_set(&adv_on, 1);
+        adv_state_set(true);
         adv_backoff_ms = 200;
         scan_start_safe(1000);
 
-        err = hci_vs_write_adv_tx_power(20);
-        if (err == 0) {
-            int8_t eff;
-            if (hci_vs_read_adv_tx_power(&eff) == 0) {
-                LOG_INF("[HCI] ADV TX set=20 dBm, effective=%d dBm%s",
-                        eff, (eff > 8) ? "  <-- FEM-updated" : "");
-            } else {
-                LOG_ERR("[HCI] READ adv TX failed");
-            }
+        /* HCI vendor command 는 sync 라서 link 제어 queue 밖에서 */
+        k_work_submit_to_queue(&relay_hci_workq, &adv_tx_power_work);
+    } else {
+        LOG_WRN("[ADV] bt_le_adv_start failed (err %d), retry", err);
+        k_work_reschedule_for_queue(&relay_link_workq, &adv_restart_work, K_MSEC(300));
+    }
+}
+
+static void adv_tx_power_work_handler(struct k_work *work)
+{
+    int err;
+
+    RELAY_TRACE("rly_work", RELAY_TRACE_WORK_ADV_TX_POWER, 0);
+    err = tx_power_write(BT_HCI_VS_LL_HANDLE_TYPE_ADV, 0, CONFIG_RELAY_ADV_TX_POWER_DBM);
+
+    if (err == 0) {
+        int8_t eff;
+        if (tx_power_read(BT_HCI_VS_LL_HANDLE_TYPE_ADV, 0, &eff) == 0) {
+            LOG_INF("[HCI] ADV TX set=%d dBm, effective=%d dBm%s",
+                    CONFIG_RELAY_ADV_TX_POWER_DBM, eff, (eff > 8) ? "  <-- FEM-updated" : "");
         } else {
-            LOG_ERR("[HCI] WRITE adv TX(20) failed (%d)", err);
+            LOG_ERR("[HCI] READ adv TX failed");
         }
     } else {
-        LOG_WRN("[ADV] bt_le_adv_start failed (err %d), retry", err);
-        k_work_reschedule(&adv_restart_work, K_MSEC(300));
+        LOG_ERR("[HCI] WRITE adv TX(%d) failed (%d)", CONFIG_RELAY_ADV_TX_POWER_DBM, err);
     }
 }
 
 static void initiate_timeout_work_handler(struct k_work *work)
 {
+    RELAY_TRACE("rly_work", RELAY_TRACE_WORK_INITIATE_TIMEOUT, 0);
+
     if (atomic_get(&initiating) == 1) {
         LOG_WRN("[INITIATE] create timeout -> cancel");
         bt_le_create_conn_cancel();
@@ -231,7 +347,7 @@ static void initiate_timeout_work_handler(struct k_work *work)
 /* FUNCTION DEFINITIONS */
 static void scan_start_safe(int delay_ms)
 {
-    k_work_reschedule(&scan_restart_work, K_MSEC(delay_ms));
+    k_work_reschedule_for_queue(&relay_link_workq, &scan_restart_work, K_MSEC(delay_ms));
 }
 
 static void scan_stop_safe(void)
@@ -239,12 +355,12 @@ static void scan_stop_safe(void)
     int err = bt_le_scan_stop();
 
     if (err == -EALREADY) {
-        atomic_set(&scan_on, 0);
+        scan_state_set(false);
         return;
     }
 
     if (!err) {
-        atomic_set(&scan_on, 0);
+        scan_state_set(false);
     } else {
         LOG_WRN("[SCAN] bt_le_scan_stop failed (err %d)", err);
     }
@@ -252,7 +368,7 @@ static void scan_stop_safe(void)
 
 static void adv_start_safe(int delay_ms)
 {
-    k_work_reschedule(&adv_restart_work, K_MSEC(delay_ms));
+    k_work_reschedule_for_queue(&relay_link_workq, &adv_restart_work, K_MSEC(delay_ms));
 }
 
 static void adv_stop_safe(void)
@@ -260,75 +376,166 @@ static void adv_stop_safe(void)
     int err = bt_le_adv_stop();
 
     if (err == -EALREADY) {
-        atomic_set(&adv_on, 0);
+        adv_state_set(false);
         return;
     }
 
     if (!err) {
-        atomic_set(&adv_on, 0);
+        adv_state_set(false);
     } else {
         LOG_WRN("[ADV] bt_le_adv_stop failed (err %d)", err);
     }
 }
 
-static int hci_vs_write_adv_tx_power(int8_t tx_dbm)
+/* scan 결과 하나로 node / relay 에 연결 시작 */
+static void central_connect(const bt_addr_le_t *addr, const char *label)
+{
+    char addr_str[BT_ADDR_LE_STR_LEN];
+    struct bt_conn *tmp_conn = NULL;
+    int err;
+
+    bt_addr_le_to_str(addr, addr_str, sizeof(addr_str));
+
+    scan_stop_safe();
+    atomic_set(&initiating, 1);
+    initiate_start_ms = k_uptime_get_32();
+    // k_work_reschedule_for_queue(&relay_link_workq, &initiating_timeout_work, K_SECONDS(10));
+
+    relay_stats_event(RELAY_STATS_CONN_ATTEMPT);
+    err = bt_conn_le_create(addr,
+                            BT_CONN_LE_CREATE_CONN,
+                            BT_LE_CONN_PARAM_DEFAULT,
+                            &tmp_conn);
+    if (err) 
+    {
+        relay_stats_event(RELAY_STATS_CONN_FAIL);
+        LOG_WRN("[DEVICE FOUND] Create connection to %s failed (err %d)", addr_str, err);
+        if (tmp_conn) 
+        {
+            bt_conn_unref(tmp_conn);
+        }
+        atomic_set(&initiating, 0);
+        scan_start_safe(300);
+        return;
+    }
+    else 
+    {
+        central_pending = bt_conn_ref(tmp_conn);
+        bt_conn_unref(tmp_conn);
+        LOG_INF("[DEVICE FOUND] Creating connection to %s | [%s]", addr_str, label);
+    }
+}
+
+#if defined(CONFIG_RELAY_ROOM_DEVICES)
+int ble_relay_central_create(const bt_addr_le_t *addr, struct bt_conn **conn)
 {
-    struct bt_hci_cp_vs_write_tx_power_level *cp;
-    struct net_buf *buf, *rsp = NULL;
+    int err;
 
-    buf = bt_hci_cmd_create(BT_HCI_OP_VS_WRITE_TX_POWER_LEVEL, sizeof(*cp));
-    if (!buf) {
-        return -ENOMEM;
+    if (central_pending || atomic_set(&initiating, 1)) {
+        return -EBUSY;
     }
 
-    cp = net_buf_add(buf, sizeof(*cp));
-    cp->handle_type    = BT_HCI_VS_LL_HANDLE_TYPE_ADV; /* 광고 세트 */
-    cp->handle         = sys_cpu_to_le16(0);           /* set #0 (legacy adv) */
-    cp->tx_power_level = tx_dbm;
+    scan_stop_safe();
+    initiate_start_ms = k_uptime_get_32();
 
-    int err = bt_hci_cmd_send_sync(BT_HCI_OP_VS_WRITE_TX_POWER_LEVEL, buf, &rsp);
-    if (rsp) {
-        net_buf_unref(rsp);
+    err = bt_conn_le_create(addr, BT_CONN_LE_CREATE_CONN, BT_LE_CONN_PARAM_DEFAULT, conn);
+    if (err) {
+        atomic_set(&initiating, 0);
+        scan_start_safe(300);
     }
     return err;
 }
+#endif
 
-static int hci_vs_read_adv_tx_power(int8_t *out_dbm)
+#if defined(CONFIG_RELAY_CHAIN)
+/* CONFIG_RELAY_CHAIN_SELECT_MS 동안 본 node / relay 중 가장 좋은 연결 대상 */
+static struct
 {
-    struct bt_hci_cp_vs_read_tx_power_level *cp;
-    struct bt_hci_rp_vs_read_tx_power_level *rp;
-    struct net_buf *buf, *rsp = NULL;
+    bool valid;
+    bt_addr_le_t addr;
+    int8_t rssi;
+    int16_t score;
+    struct relay_chain_peer peer;
+} chain_best;
+static struct k_spinlock chain_best_lock;
+
+static void chain_select_work_handler(struct k_work *work);
+K_WORK_DELAYABLE_DEFINE(chain_select_work, chain_select_work_handler);
+
+static void chain_candidate(const bt_addr_le_t *addr, int8_t rssi, const struct relay_chain_peer *peer)
+{
+    int16_t score = relay_chain_score(peer, rssi);
+    k_spinlock_key_t key;
+
+    if (score == INT16_MIN) {
+        return;
+    }
+    /* hub 자리의 relay 를 아래로도 연결하면 바로 loop */
+    if (peripheral_conn && bt_addr_le_eq(addr, bt_conn_get_dst(peripheral_conn))) {
+        return;
+    }
 
-    buf = bt_hci_cmd_create(BT_HCI_OP_VS_READ_TX_POWER_LEVEL, sizeof(*cp));
-    if (!buf) {
-        return -ENOMEM;
+    key = k_spin_lock(&chain_best_lock);
+    if (!chain_best.valid || score > chain_best.score ||
+        bt_addr_le_eq(addr, &chain_best.addr)) {
+        chain_best.valid = true;
+        bt_addr_le_copy(&chain_best.addr, addr);
+        chain_best.rssi = rssi;
+        chain_best.score = score;
+        chain_best.peer = *peer;
     }
+    k_spin_unlock(&chain_best_lock, key);
 
-    cp = net_buf_add(buf, sizeof(*cp));
-    cp->handle_type = BT_HCI_VS_LL_HANDLE_TYPE_ADV;
-    cp->handle      = sys_cpu_to_le16(0);
+    /* 첫 후보에서 창을 연다. 이미 돌고 있으면 그대로 */
+    k_work_schedule_for_queue(&relay_link_workq, &chain_select_work,
+                              K_MSEC(CONFIG_RELAY_CHAIN_SELECT_MS));
+}
 
-    int err = bt_hci_cmd_send_sync(BT_HCI_OP_VS_READ_TX_POWER_LEVEL, buf, &rsp);
-    if (err) {
-        return err;
+static void chain_select_work_handler(struct k_work *work)
+{
+    char label[32];
+    bt_addr_le_t addr;
+    struct relay_chain_peer peer;
+    int8_t rssi;
+    int16_t score;
+    bool valid;
+    k_spinlock_key_t key = k_spin_lock(&chain_best_lock);
+
+    valid = chain_best.valid;
+    bt_addr_le_copy(&addr, &chain_best.addr);
+    peer = chain_best.peer;
+    rssi = chain_best.rssi;
+    score = chain_best.score;
+    chain_best.valid = false;
+    k_spin_unlock(&chain_best_lock, key);
+
+    if (!valid || central_pending || central_conn || atomic_get(&initiating)) {
+        return;
     }
 
-    rp = (void *)rsp->data;
-    *out_dbm = (int8_t)rp->tx_power_level;
-    net_buf_unref(rsp);
-    return 0;
+    if (peer.relay) {
+        snprintk(label, sizeof(label), "relay %08x, node +%u", peer.id, peer.node_hops + 1);
+    } else {
+        snprintk(label, sizeof(label), "DE&N");
+    }
+    LOG_INF("[MATCH] %s (RSSI %d, score %d)", label, rssi, score);
+    relay_stats_event(RELAY_STATS_SCAN_MATCH);
+    central_connect(&addr, label);
 }
+#endif
 
 /** @brief SCAN result callback function. */
 static void scan_device_found(const bt_addr_le_t *addr, int8_t rssi, uint8_t type, struct net_buf_simple *ad)
 {
     char addr_str[BT_ADDR_LE_STR_LEN];
-    int err;
 
-    if (central_pending || central_conn) {
+    if (central_pending || atomic_get(&initiating)) {
+        return;
+    }
+    /* node 와 연결돼 있으면 빈 room device slot 이 있을 때만 */
+    if (central_conn && !room_device_wanted()) {
         return;
     }
-    struct bt_conn *tmp_conn = NULL;
 
     /* Connect only with connectable adv/scan rsp packet */
     if (type != BT_GAP_ADV_TYPE_ADV_IND &&
@@ -348,7 +555,12 @@ static void scan_device_found(const bt_addr_le_t *addr, int8_t rssi, uint8_t typ
         bt_data_parse(ad, ad_parse_cb, &ctx);
     }
 
-    if (!ctx.name_match) {
+    if (!ctx.name_match && !ctx.peer.relay) {
+        /* 방 안의 button / PAAR / Ubinos 장치 (room_device.h) */
+        room_device_scan(addr, rssi, type, ad);
+        return;
+    }
+    if (central_conn) {
         return;
     }
 
@@ -357,34 +569,15 @@ static void scan_device_found(const bt_addr_le_t *addr, int8_t rssi, uint8_t typ
         return;
     }
 
+#if defined(CONFIG_RELAY_CHAIN)
+    /* node 와 relay 를 link 품질과 hop 수로 비교해서 고른다 */
+    LOG_DBG("[MATCH] %s from %s (RSSI %d)", ctx.peer.relay ? "relay" : ctx.found_name, addr_str, rssi);
+    chain_candidate(addr, rssi, &ctx.peer);
+#else
     LOG_INF("[MATCH] name=\"%s\" from %s (RSSI %d)", ctx.found_name, addr_str, rssi);
-
-    scan_stop_safe();
-    atomic_set(&initiating, 1);
-    initiate_start_ms = k_uptime_get_32();
-    // k_work_reschedule(&initiating_timeout_work, K_SECONDS(10));
-
-    err = bt_conn_le_create(addr,
-                            BT_CONN_LE_CREATE_CONN,
-                            BT_LE_CONN_PARAM_DEFAULT,
-                            &tmp_conn);
-    if (err) 
-    {
-        LOG_WRN("[DEVICE FOUND] Create connection to %s failed (err %d)", addr_str, err);
-        if (tmp_conn) 
-        {
-            bt_conn_unref(tmp_conn);
-        }
-        atomic_set(&initiating, 0);
-        scan_start_safe(300);
-        return;
-    }
-    else 
-    {
-        central_pending = bt_conn_ref(tmp_conn);
-        bt_conn_unref(tmp_conn);
-        LOG_INF("[DEVICE FOUND] Creating connection to %s | [%s]", addr_str, ctx.found_name);
-    }
+    relay_stats_event(RELAY_STATS_SCAN_MATCH);
+    central_connect(addr, ctx.found_name);
+#endif
 }
 
 static bool ad_parse_cb (struct bt_data * data, void *user_data)
@@ -406,12 +599,83 @@ static bool ad_parse_cb (struct bt_data * data, void *user_data)
         }
         break;
     }
+#if defined(CONFIG_RELAY_CHAIN)
+    case BT_DATA_SVC_DATA128:
+        relay_chain_adv_parse(data->data, data->data_len, &ctx->peer);
+        break;
+#endif
     default:
         break;
     }
     return true;
 }
 
+/* ----------------- stall recovery ----------------- */
+
+static bool subs_find(uint16_t value_handle)
+{
+    for (size_t i = 0; i < subs_cnt; i++) {
+        if (subs[i].value_handle == value_handle) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static uint32_t ccc_write_mask;
+
+static void ccc_write_next(struct bt_conn *conn);
+
+static void ccc_write_cb(struct bt_conn *conn, uint8_t att_err, struct bt_gatt_write_params *params)
+{
+    if (att_err) {
+        LOG_WRN("[STALL] CCC 0x%04x rewrite failed (att_err 0x%02x)", params->handle, att_err);
+    } else {
+        LOG_INF("[STALL] CCC 0x%04x rewritten", params->handle);
+    }
+    ccc_write_next(conn);
+}
+
+/* subs[ccc_write_idx..] 중 멈춘 stream 의 CCC 를 하나씩 (write request 는 한 번에 하나) */
+static void ccc_write_next(struct bt_conn *conn)
+{
+    while (ccc_write_idx < subs_cnt) {
+        const struct node_stream *ns = subs_stream[ccc_write_idx];
+        struct bt_gatt_subscribe_params *sub = &subs[ccc_write_idx++];
+        int err;
+
+        if (!sub->value_handle || !ns || ns->stream >= RELAY_STREAM_COUNT ||
+            !(ccc_write_mask & BIT(ns->stream))) {
+            continue;
+        }
+
+        ccc_write_params.func   = ccc_write_cb;
+        ccc_write_params.handle = sub->ccc_handle;
+        ccc_write_params.offset = 0;
+        ccc_write_params.data   = &ccc_notify_val;
+        ccc_write_params.length = sizeof(ccc_notify_val);
+
+        err = bt_gatt_write(conn, &ccc_write_params);
+        if (!err) {
+            return;
+        }
+        LOG_WRN("[STALL] CCC 0x%04x write request failed (err %d)", sub->ccc_handle, err);
+    }
+
+    atomic_clear(&ccc_write_busy);
+}
+
+/* bt_gatt_subscribe() 는 이미 구독 중이면 CCC 를 다시 쓰지 않으므로 직접 쓴다 */
+static void ccc_rewrite_start(struct bt_conn *conn, uint32_t mask)
+{
+    if (!conn || atomic_set(&ccc_write_busy, 1)) {
+        return;
+    }
+    ccc_write_mask = mask;
+    ccc_write_idx = 0;
+    ccc_write_next(conn);
+}
+
 static uint8_t discover_func(struct bt_conn *conn,
                              const struct bt_gatt_attr *attr,
                              struct bt_gatt_discover_params *params)
@@ -419,7 +683,29 @@ static uint8_t discover_func(struct bt_conn *conn,
     /* 1) 탐색 종료 조건 */
     if (!attr) {
         LOG_INF("[DISCOVER] type %u complete", params->type);
+        relay_stats_discovery_done(k_uptime_get_32() - discovery_start_ms);
         memset(params, 0, sizeof(*params));   /* 이 discover 작업은 끝 */
+        if (rediscovering) {
+            /* 기존 구독은 그대로 두었으니 멈춘 stream 의 CCC 만 다시 쓴다 */
+            rediscovering = false;
+            ccc_rewrite_start(conn, stall.mask);
+        }
+#if defined(CONFIG_RELAY_NODE_TIME_SYNC)
+        /* subscribe 가 끝났으니 node 시계를 맞춘다 */
+        node_time_sync_start(conn);
+#endif
+        /* hub -> node write 전달 시작 */
+        node_write_node_ready(conn);
+        /* relay 가 구현하지 않은 나머지 service 는 그대로 복사 */
+        gatt_proxy_node_ready(conn);
+        /* 아래가 relay 이면 node 까지 hop 수는 CHAIN_INFO 로 온다 */
+        relay_chain_child_ready(node_stream_value_handle(RELAY_STREAM_CHAIN) != 0);
+        /* raw sound 는 GATT 가 아니라 CIS 로 */
+        sound_iso_node_ready(conn);
+        /* 큰 전송은 node 가 받아 주면 L2CAP CoC 로 */
+        relay_bulk_node_ready(conn);
+        k_work_reschedule_for_queue(&relay_link_workq, &reset_work,
+                                    K_MSEC(CONFIG_RELAY_LIVENESS_CHECK_MS));
         return BT_GATT_ITER_STOP;
     }
 
@@ -432,26 +718,28 @@ static uint8_t discover_func(struct bt_conn *conn,
         LOG_DBG("[DISCOVER] char decl=0x%04x val=0x%04x props=0x%02x",
                 decl_handle, value_handle, chrc->properties);
 
-        /* 2-1) Notify 지원하는 Characteristic 인가? */
-        if (chrc->properties & BT_GATT_CHRC_NOTIFY) {
+        /* relay 서비스 중 node 값을 cache 해서 읽어주는 characteristic 이 있으면 연결 */
+        gatt_proxy_node_chrc(chrc->uuid, value_handle);
+        /* hub 가 relay 에 쓴 값을 node 로 전달할 특성 */
+        node_write_node_chrc(chrc->uuid, value_handle, chrc->properties);
+
+        /* 2-1) relay 가 처리하는 characteristic 인가? (NODE_STREAM_DEFINE) */
+        struct node_stream *ns = node_stream_discovered(conn, chrc->uuid, value_handle, chrc->properties);
+
+        if (ns && ns->no_subscribe) {
+            return BT_GATT_ITER_CONTINUE;
+        }
+#if defined(CONFIG_RELAY_GATT_PROXY)
+        /* relay 가 처리하지 않는 값은 hub 가 원할 때 gatt_proxy 가 구독한다 */
+        if (!ns) {
+            return BT_GATT_ITER_CONTINUE;
+        }
+#endif
 
-            if (chrc->properties & BT_GATT_CHRC_NOTIFY)
-            {
-                if (!bt_uuid_cmp(chrc->uuid, BT_UUID_CHRC_INFERENCE_RAWDATA))
-                {
-                    h_remote_rawdata = value_handle;
-                    LOG_INF("[DISCOVER] found INFERENCE_RAWDATA char at 0x%04x", value_handle);
-                }
-                else if (!bt_uuid_cmp(chrc->uuid, BT_UUID_CHRC_INFERENCE_SEQ_ANAL_RESULT))
-                {
-                    h_remote_seq_result = value_handle;
-                    LOG_INF("[DISCOVER] found INFERENCE_SEQ_ANAL_RESULT char at 0x%04x", value_handle);
-                }
-                else if (!bt_uuid_cmp(chrc->uuid, BT_UUID_CHRC_INFERENCE_DEBUG_STRING))
-                {
-                    h_remote_debug_string = value_handle;
-                    LOG_INF("[DISCOVER] found INFERENCE_DEBUG_STRING char at 0x%04x", value_handle);
-                }
+        /* 2-2) Notify 지원하는 Characteristic 만 구독 */
+        if (chrc->properties & BT_GATT_CHRC_NOTIFY) {
+            if (rediscovering && subs_find(value_handle)) {
+                return BT_GATT_ITER_CONTINUE;
             }
 
             if (subs_cnt >= MAX_SUBS) {
@@ -467,6 +755,8 @@ static uint8_t discover_func(struct bt_conn *conn,
             sub->value_handle = value_handle;
             sub->value        = BT_GATT_CCC_NOTIFY;
             sub->notify       = generic_notify_cb;
+            /* bond 된 node 라도 끊기면 stack 이 구독을 버리게 한다 (disconnected() 에서 subs 를 비우므로) */
+            atomic_set_bit(sub->flags, BT_GATT_SUBSCRIBE_FLAG_VOLATILE);
 
             int err = bt_gatt_subscribe(conn, sub);
             if (err && err != -EALREADY) {
@@ -476,6 +766,7 @@ static uint8_t discover_func(struct bt_conn *conn,
             } else {
                 LOG_INF("[DISCOVER] subscribed: val=0x%04x ccc=0x%04x (idx=%u)",
                         sub->value_handle, sub->ccc_handle, (unsigned)subs_cnt);
+                subs_stream[subs_cnt] = ns;
                 subs_cnt++;
             }
         }
@@ -494,6 +785,7 @@ static int start_discovery(struct bt_conn *conn)
     int err;
 
     memset(&discover_params, 0, sizeof(discover_params));
+    discovery_start_ms = k_uptime_get_32();
 
     /* 서비스 UUID를 모른다는 가정 → ATT 전체 범위에서
      * 모든 Characteristic 을 한 번 훑는다.
@@ -514,12 +806,223 @@ static int start_discovery(struct bt_conn *conn)
     return 0;
 }
 
+/* 연결 중 주기적으로 (CONFIG_RELAY_LIVENESS_CHECK_MS) node stream 이 멈췄는지 보고,
+ * 멈췄으면 CCC rewrite -> rediscover -> disconnect 순으로 한 단계씩 올린다.
+ * 각 단계는 CONFIG_RELAY_LIVENESS_STEP_TIMEOUT_MS 동안 data 가 다시 오기를 기다린다.
+ */
+static void reset_work_handler(struct k_work *work)
+{
+    uint32_t now = k_uptime_get_32();
+    uint32_t stalled;
+    int err;
+
+    if (!central_conn) {
+        return;
+    }
+
+    stalled = relay_liveness_stalled(now);
+    RELAY_TRACE("rly_work", RELAY_TRACE_WORK_RESET, stall.step);
+
+    if (!stalled) {
+        if (stall.step != STALL_NONE) {
+            LOG_INF("[STALL] streams 0x%02x recovered by %s, outage %u ms (step %u ms)",
+                    stall.mask, stall_step_str[stall.step], now - stall.detect_ms,
+                    now - stall.step_ms);
+            relay_stats_event(RELAY_STATS_STALL_RECOVERED);
+            stall.step = STALL_NONE;
+        }
+        goto out;
+    }
+
+    if (stall.step == STALL_NONE) {
+        stall.mask = stalled;
+        stall.detect_ms = now;
+        for (int i = 0; i < RELAY_STREAM_COUNT; i++) {
+            if (stalled & BIT(i)) {
+                LOG_WRN("[STALL] stream %d silent (expected every %u ms)", i,
+                        relay_liveness_expected_ms(i));
+            }
+        }
+        relay_stats_event(RELAY_STATS_NODE_STALL);
+    } else if (now - stall.step_ms < CONFIG_RELAY_LIVENESS_STEP_TIMEOUT_MS) {
+        goto out;
+    } else if (stall.step == STALL_DISCONNECT) {
+        /* disconnect 가 아직 안 끝남. disconnected() 에서 정리된다 */
+        LOG_WRN("[STALL] still connected %u ms after disconnect", now - stall.step_ms);
+        goto out;
+    }
+
+    stall.mask |= stalled;
+    stall.step++;
+    stall.step_ms = now;
+    LOG_WRN("[STALL] streams 0x%02x, %u ms since detection -> %s",
+            stall.mask, now - stall.detect_ms, stall_step_str[stall.step]);
+
+    switch (stall.step) {
+    case STALL_CCC:
+        ccc_rewrite_start(central_conn, stall.mask);
+        break;
+    case STALL_REDISCOVER:
+        if (discover_params.func) {
+            /* discovery 가 아직 진행 중 */
+            break;
+        }
+        rediscovering = true;
+        err = start_discovery(central_conn);
+        if (err) {
+            rediscovering = false;
+        }
+        break;
+    case STALL_DISCONNECT:
+    default:
+        err = bt_conn_disconnect(central_conn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
+        if (err) {
+            LOG_WRN("[STALL] disconnect failed (err %d)", err);
+        }
+        break;
+    }
+
+out:
+    k_work_reschedule_for_queue(&relay_link_workq, &reset_work, K_MSEC(CONFIG_RELAY_LIVENESS_CHECK_MS));
+}
+
+#if defined(CONFIG_RELAY_SEG_DOWNSTREAM)
+/* node 에서 재조립된 payload 를 hub 링크 MTU 에 맞게 다시 segment 해서 보낸다 */
+static void seq_result_reassembled(struct relay_seg_rx *rx, const uint8_t *data, uint16_t len)
+{
+    int err = bt_inference_seq_anal_result_send((char *)data, len);
+
+    relay_stats_rx(RELAY_STREAM_SEQ_RESULT);
+    relay_stats_tx(RELAY_STREAM_SEQ_RESULT, err);
+    if (err && err != -EACCES) {
+        LOG_WRN("[RELAY] INFERENCE_SEQ_ANAL_RESULT send failed (err %d)", err);
+    }
+}
+
+static void debug_string_reassembled(struct relay_seg_rx *rx, const uint8_t *data, uint16_t len)
+{
+    int err = bt_inference_debug_string_send((char *)data, len);
+
+    relay_stats_rx(RELAY_STREAM_DEBUG_STRING);
+    relay_stats_tx(RELAY_STREAM_DEBUG_STRING, err);
+    if (err && err != -EACCES) {
+        LOG_WRN("[RELAY] INFERENCE_DEBUG_STRING send failed (err %d)", err);
+    }
+}
+#endif
+
+/* ----------------- inference streams ----------------- */
+
+static int rawdata_notify(const void *data, uint16_t len)
+{
+    int err;
+
+    if (len != INFERENCE_RESULT_PACKET_SIZE) {
+        LOG_WRN("[NOTIFY] INFERENCE_RAWDATA len=%u, expected %u", len, INFERENCE_RESULT_PACKET_SIZE);
+        return -EBADMSG;
+    }
+
+    err = bt_inference_rawdata_send((uint8_t *)data);
+    relay_stats_rx(RELAY_STREAM_RAWDATA);
+    relay_stats_tx(RELAY_STREAM_RAWDATA, err);
+    if (err && err != -EACCES)
+    {
+        LOG_WRN("[RELAY] INFERENCE_RAWDATA send failed (err %d)", err);
+    }
+    return err;
+}
+
+static int seq_result_notify(const void *data, uint16_t len)
+{
+    int err;
+
+#if defined(CONFIG_RELAY_SEG_DOWNSTREAM)
+    /* 완성된 message 는 seq_result_reassembled() 에서 센다 */
+    err = relay_seg_rx_feed(&seq_result_rx, data, len);
+    if (err) {
+        relay_stats_tx(RELAY_STREAM_SEQ_RESULT, err);
+    }
+    if (err == -EINVAL) {
+        err = -EBADMSG;     /* segment header 가 깨짐 */
+    }
+#else
+    err = bt_inference_seq_anal_result_send((char *)data, len);
+    relay_stats_rx(RELAY_STREAM_SEQ_RESULT);
+    relay_stats_tx(RELAY_STREAM_SEQ_RESULT, err);
+#endif
+    if (err && err != -EACCES)
+    {
+        LOG_WRN("[RELAY] INFERENCE_SEQ_ANAL_RESULT send failed (err %d)", err);
+    }
+    return err;
+}
+
+static int debug_string_notify(const void *data, uint16_t len)
+{
+    int err;
+
+#if defined(CONFIG_RELAY_SEG_DOWNSTREAM)
+    err = relay_seg_rx_feed(&debug_string_rx, data, len);
+    if (err) {
+        relay_stats_tx(RELAY_STREAM_DEBUG_STRING, err);
+    }
+    if (err == -EINVAL) {
+        err = -EBADMSG;
+    }
+#else
+    err = bt_inference_debug_string_send((char *)data, len);
+    relay_stats_rx(RELAY_STREAM_DEBUG_STRING);
+    relay_stats_tx(RELAY_STREAM_DEBUG_STRING, err);
+#endif
+    if (err && err != -EACCES)
+    {
+        LOG_WRN("[RELAY] INFERENCE_DEBUG_STRING send failed (err %d)", err);
+    }
+    return err;
+}
+
+NODE_STREAM_DEFINE(inference_rawdata, BT_UUID_CHRC_INFERENCE_RAWDATA, RELAY_STREAM_RAWDATA,
+                   .notify = rawdata_notify);
+NODE_STREAM_DEFINE(inference_seq_result, BT_UUID_CHRC_INFERENCE_SEQ_ANAL_RESULT, RELAY_STREAM_SEQ_RESULT,
+                   .notify = seq_result_notify);
+NODE_STREAM_DEFINE(inference_debug_string, BT_UUID_CHRC_INFERENCE_DEBUG_STRING, RELAY_STREAM_DEBUG_STRING,
+                   .notify = debug_string_notify);
+
+#if defined(CONFIG_RELAY_NOTIFY_LATENCY_PROBE)
+static struct
+{
+    uint32_t cnt;
+    uint64_t sum_cyc;
+    uint32_t max_cyc;
+} notify_probe;
+
+static void notify_probe_record(uint32_t start_cyc)
+{
+    uint32_t cyc = k_cycle_get_32() - start_cyc;
+
+    notify_probe.cnt++;
+    notify_probe.sum_cyc += cyc;
+    notify_probe.max_cyc = MAX(notify_probe.max_cyc, cyc);
+
+    if (notify_probe.cnt >= CONFIG_RELAY_NOTIFY_LATENCY_PROBE_WINDOW) {
+        LOG_INF("[PROBE] notify cb avg %u ns, max %u ns (%u notifications)",
+                (uint32_t)k_cyc_to_ns_floor64(notify_probe.sum_cyc / notify_probe.cnt),
+                (uint32_t)k_cyc_to_ns_floor64(notify_probe.max_cyc),
+                notify_probe.cnt);
+        memset(&notify_probe, 0, sizeof(notify_probe));
+    }
+}
+#endif
+
 static uint8_t generic_notify_cb(struct bt_conn *conn,
                                  struct bt_gatt_subscribe_params *params,
                                  const void *data,
                                  uint16_t length)
 {
     int err = 0;
+#if defined(CONFIG_RELAY_NOTIFY_LATENCY_PROBE)
+    uint32_t start_cyc = k_cycle_get_32();
+#endif
     if (!data) {
         LOG_INF("[NOTIFY] Unsubscribed from handle %u", params->value_handle);
         params->value_handle = 0;
@@ -527,32 +1030,19 @@ static uint8_t generic_notify_cb(struct bt_conn *conn,
     }
 
     uint16_t handle = params->value_handle;
-    if (handle == h_remote_rawdata && length == INFERENCE_RESULT_PACKET_SIZE)
-    {
-        err = bt_inference_rawdata_send((uint8_t *)data);
-        if (err)
-        {
-            LOG_WRN("[RELAY] INFERENCE_RAWDATA send failed (err %d)", err);
-        }
-    }
-    else if (handle == h_remote_seq_result)
-    {
-        // int err = bt_inference_seq_result_send((uint8_t *)data, length);
-        if (err)
-        {
-            LOG_WRN("[RELAY] INFERENCE_SEQ_ANAL_RESULT send failed (err %d)", err);
-        }
-    }
-    else if (handle == h_remote_debug_string)
-    {
-        err = bt_inference_debug_string_send((uint8_t *)data, length);
-        if (err)
-        {
-            LOG_WRN("[RELAY] INFERENCE_DEBUG_STRING send failed (err %d)", err);
+    RELAY_TRACE("rly_rx", handle, length);
+    radio_airtime_pdu(RADIO_LINK_NODE, length);
+
+    /* 구독할 때 정해 둔 slot -> handler, handle 비교 없이 바로 */
+    const struct node_stream *ns = subs_stream[params - subs];
+
+    if (ns) {
+        err = ns->notify(data, length);
+        /* 깨진 packet 은 stream 이 살아 있다는 근거가 아니다 */
+        if (err != -EBADMSG) {
+            relay_liveness_rx(ns->stream);
         }
-    }
-    else 
-    {
+    } else {
         LOG_WRN("[NOTIFY] Unknown handle=0x%04x len=%u", handle, length);
     }
 
@@ -570,9 +1060,19 @@ static uint8_t generic_notify_cb(struct bt_conn *conn,
 
     // LOG_INF("%s", buf);
 
+#if defined(CONFIG_RELAY_NOTIFY_LATENCY_PROBE)
+    notify_probe_record(start_cyc);
+#endif
+    RELAY_TRACE("rly_rx_done", handle, err);
     return BT_GATT_ITER_CONTINUE;
 }
 
+static void mtu_exchange_cb(struct bt_conn *conn, uint8_t att_err,
+                            struct bt_gatt_exchange_params *params)
+{
+    LOG_INF("[MTU] exchange %s, mtu=%u", att_err ? "failed" : "done", bt_gatt_get_mtu(conn));
+}
+
 static void connected(struct bt_conn *conn, uint8_t conn_err)
 {
     int err = 0;
@@ -581,6 +1081,18 @@ static void connected(struct bt_conn *conn, uint8_t conn_err)
 
     bt_addr_le_to_str(bt_conn_get_dst(conn), addr, sizeof(addr));
     bt_conn_get_info(conn, &info);
+    RELAY_TRACE("rly_conn", info.role, conn_err);
+
+    /* room device link 는 room_device.c 가 처리. node 를 찾는 scan 은 계속 */
+    if (info.role == BT_CONN_ROLE_CENTRAL && room_device_connected(conn, conn_err)) {
+        atomic_set(&initiating, 0);
+        scan_state_set(false);
+        /* node 가 이미 있고 room slot 도 다 찼으면 scan 할 이유가 없다 */
+        if (!central_conn || room_device_wanted()) {
+            scan_start_safe(300);
+        }
+        return;
+    }
 
     /* connection failed */
     if (conn_err) {
@@ -588,6 +1100,7 @@ static void connected(struct bt_conn *conn, uint8_t conn_err)
         if (info.role == BT_CONN_ROLE_CENTRAL) {
             /* CENTRAL: DEAN node 연결 실패 */
             LOG_WRN("[CONNECTED] Failed to connect to peripheral %s (err %u)", addr, conn_err);
+            relay_stats_event(RELAY_STATS_CONN_FAIL);
 
             if (central_pending == conn) {
                 bt_conn_unref(central_pending);
@@ -595,7 +1108,7 @@ static void connected(struct bt_conn *conn, uint8_t conn_err)
             }
 
             atomic_set(&initiating, 0);
-            atomic_set(&scan_on, 0);
+            scan_state_set(false);
             scan_start_safe(300);
             return;
         }
@@ -609,7 +1122,7 @@ static void connected(struct bt_conn *conn, uint8_t conn_err)
             }
 
             /* 광고 다시 */
-            atomic_set(&adv_on, 0);
+            adv_state_set(false);
             adv_start_safe(300);
             return;
         }
@@ -630,6 +1143,25 @@ static void connected(struct bt_conn *conn, uint8_t conn_err)
                 central_conn = bt_conn_ref(conn);
             }
 
+            if (node_connected_once) {
+                relay_stats_event(RELAY_STATS_NODE_RECONNECT);
+            }
+            node_connected_once = true;
+            relay_liveness_reset();
+
+            /* seq result / debug string 이 한 notification 에 최대한 많이 실리도록 */
+            mtu_params.func = mtu_exchange_cb;
+            err = bt_gatt_exchange_mtu(central_conn, &mtu_params);
+            if (err && err != -EALREADY) {
+                LOG_WRN("[CONNECTED] MTU exchange request failed (err %d)", err);
+            }
+
+            /* grideye pixel stream (64 notification x 10 fps) 을 위해 2M PHY 요청 */
+            err = bt_conn_le_phy_update(central_conn, BT_CONN_LE_PHY_PARAM_2M);
+            if (err) {
+                LOG_WRN("[CONNECTED] 2M PHY request failed (err %d)", err);
+            }
+
             err = start_discovery(central_conn);
             if (err) {
                 LOG_WRN("[CONNECTED] start discovery error : %d", err);
@@ -641,6 +1173,12 @@ static void connected(struct bt_conn *conn, uint8_t conn_err)
 
             atomic_set(&initiating, 0);
             LOG_INF("[CONNECTED] New peripheral device connected : %s", addr);
+
+            /* 빈 room device slot 이 있으면 node 와 연결된 뒤에도 scan */
+            if (room_device_wanted()) {
+                scan_state_set(false);
+                scan_start_safe(1000);
+            }
         }
         else if (info.role == BT_CONN_ROLE_PERIPHERAL) {
             /* relay node 가 PERIPHERAL 로서 SLIMHUB 에 붙은 상황 */
@@ -650,7 +1188,8 @@ static void connected(struct bt_conn *conn, uint8_t conn_err)
             }
 
             LOG_INF("[CONNECTED] Connection established as PERIPHERAL with central %s", addr);
-            atomic_set(&adv_on, 0);
+            relay_stats_event(RELAY_STATS_HUB_CONNECT);
+            adv_state_set(false);
         }
     }
 
@@ -683,11 +1222,13 @@ static void disconnected(struct bt_conn *conn, uint8_t reason)
     }
 
     bt_addr_le_to_str(info.le.dst, addr, sizeof(addr));
+    RELAY_TRACE("rly_disconn", info.role, reason);
 
     if (info.role == BT_CONN_ROLE_PERIPHERAL) {
         /* relay node 가 PERIPHERAL 로서 SLIMHUB 에 붙어 있던 연결이 끊어진 경우 */
         LOG_INF("[DISCONNECTED] Central %s disconnected (reason %u) -> restart advertising",
                 addr, reason);
+        relay_stats_event(RELAY_STATS_HUB_DISCONNECT);
 
         if (peripheral_conn == conn) {
             bt_conn_unref(peripheral_conn);
@@ -695,14 +1236,23 @@ static void disconnected(struct bt_conn *conn, uint8_t reason)
         }
 
         /* 필요하면 inference_svr 의 notify enable 플래그들 초기화 (옵션) */
+        file_transfer_link_lost();
 
-        atomic_set(&adv_on, 0);
+        adv_state_set(false);
         adv_start_safe(300);
     }
+    else if (info.role == BT_CONN_ROLE_CENTRAL && room_device_disconnected(conn, reason)) {
+        /* room device 가 끊어짐: 다시 찾는다 (slot 이 비었으므로 room_device_wanted()) */
+        if (!central_conn || room_device_wanted()) {
+            scan_state_set(false);
+            scan_start_safe(300);
+        }
+    }
     else if (info.role == BT_CONN_ROLE_CENTRAL) {
         /* relay node 가 CENTRAL 로서 DEAN node 에 붙어 있던 연결이 끊어진 경우 */
         LOG_INF("[DISCONNECTED] Peripheral %s disconnected (reason %u) -> restart scanning",
                 addr, reason);
+        relay_stats_event(RELAY_STATS_NODE_DISCONNECT);
 
         if (central_conn == conn) {
             bt_conn_unref(central_conn);
@@ -715,11 +1265,38 @@ static void disconnected(struct bt_conn *conn, uint8_t reason)
 
         atomic_set(&initiating, 0);
 
+        /* model update / feature / grideye ... : 각 stream 의 lost() */
+        node_stream_lost();
+#if defined(CONFIG_RELAY_NODE_TIME_SYNC)
+        node_time_sync_node_lost(conn);
+#endif
+        gatt_proxy_node_lost();
+        node_write_node_lost();
+        relay_chain_child_lost();
+        sound_iso_node_lost();
+        relay_bulk_node_lost();
+
         /* 구독 정보도 새 연결을 위해 정리 */
         memset(subs, 0, sizeof(subs));
+        memset(subs_stream, 0, sizeof(subs_stream));
         subs_cnt = 0;
 
-        atomic_set(&scan_on, 0);
+        k_work_cancel_delayable(&reset_work);
+        if (stall.step != STALL_NONE) {
+            LOG_INF("[STALL] streams 0x%02x: link closed after %s, outage %u ms so far",
+                    stall.mask, stall_step_str[stall.step], k_uptime_get_32() - stall.detect_ms);
+        }
+        memset(&stall, 0, sizeof(stall));
+        rediscovering = false;
+        atomic_clear(&ccc_write_busy);
+        relay_liveness_reset();
+
+#if defined(CONFIG_RELAY_SEG_DOWNSTREAM)
+        relay_seg_rx_reset(&seq_result_rx);
+        relay_seg_rx_reset(&debug_string_rx);
+#endif
+
+        scan_state_set(false);
         scan_start_safe(300);
     } else {
         LOG_INF("[DISCONNECTED] Disconnected from %s (reason %u), unknown role=%d",
@@ -735,10 +1312,116 @@ static void disconnected(struct bt_conn *conn, uint8_t reason)
 
 
 /* External Called function*/
+struct bt_conn *ble_relay_hub_conn(void)
+{
+    return peripheral_conn;
+}
+
+/* advertising 중이면 바뀐 adv / scan response data 를 바로 반영 */
+static void adv_data_update(void)
+{
+    int err;
+
+    if (atomic_get(&adv_on)) {
+        err = bt_le_adv_update_data(adv_data, ARRAY_SIZE(adv_data),
+                                    scan_rsp_data, ARRAY_SIZE(scan_rsp_data));
+        if (err) {
+            LOG_WRN("[ADV] adv data update failed (err %d)", err);
+        }
+    }
+}
+
+void ble_relay_adv_name_set(const char *name)
+{
+    size_t len = strlen(name);
+
+    if (len == 0) {
+        return;
+    }
+
+    /* 너무 길면 잘라서 shortened name 으로 */
+    adv_data[ADV_DATA_NAME_IDX].type = (len > BLE_ADV_NAME_MAX) ? BT_DATA_NAME_SHORTENED :
+                                                                  BT_DATA_NAME_COMPLETE;
+    len = MIN(len, BLE_ADV_NAME_MAX);
+    memcpy(adv_name, name, len);
+    adv_data[ADV_DATA_NAME_IDX].data_len = len;
+    radio_airtime_adv_params(BLE_ADV_INTERVAL_US, ad_data_len(adv_data, ARRAY_SIZE(adv_data)));
+
+    LOG_INF("[ADV] name -> %.*s", (int)len, adv_name);
+
+    adv_data_update();
+}
+
+#if defined(CONFIG_RELAY_CHAIN)
+void ble_relay_adv_chain_set(const struct relay_chain_info *info)
+{
+    chain_adv.info = *info;
+    LOG_INF("[ADV] chain node hops -> %u", info->node_hops);
+    adv_data_update();
+}
+#endif
+
+#if defined(CONFIG_RELAY_FWD_BENCH)
+/* node 연결 없이 generic_notify_cb 를 부르기 위한 가짜 value handle */
+#define BENCH_HANDLE_BASE 0x0100
+
+/* stream -> 가짜 구독 slot */
+static int8_t bench_slot[RELAY_STREAM_COUNT];
+
+void ble_relay_bench_setup(struct bt_conn *fake_hub)
+{
+    peripheral_conn = fake_hub;
+
+    memset(subs, 0, sizeof(subs));
+    memset(subs_stream, 0, sizeof(subs_stream));
+    subs_cnt = 0;
+    for (int i = 0; i < RELAY_STREAM_COUNT; i++) {
+        struct node_stream *ns = node_stream_of(i);
+
+        bench_slot[i] = -1;
+        if (!ns || subs_cnt >= MAX_SUBS) {
+            continue;
+        }
+        ns->value_handle = BENCH_HANDLE_BASE + i;
+        subs[subs_cnt].value_handle = ns->value_handle;
+        subs_stream[subs_cnt] = ns;
+        bench_slot[i] = subs_cnt++;
+    }
+
+#if defined(CONFIG_RELAY_SEG_DOWNSTREAM)
+    relay_seg_rx_init(&seq_result_rx, RELAY_SEG_STREAM_SEQ_RESULT, seq_result_reassembled);
+    relay_seg_rx_init(&debug_string_rx, RELAY_SEG_STREAM_DEBUG_STRING, debug_string_reassembled);
+#endif
+}
+
+uint8_t ble_relay_bench_notify(enum relay_stream stream, const void *data, uint16_t len)
+{
+    if (stream >= RELAY_STREAM_COUNT || bench_slot[stream] < 0) {
+        LOG_WRN("[BENCH] stream %d has no node_stream", stream);
+        return BT_GATT_ITER_CONTINUE;
+    }
+    return generic_notify_cb(NULL, &subs[bench_slot[stream]], data, len);
+}
+#endif
+
 int ble_relay_control_start(void)
 {
     int err = 0;
 
+    relay_workq_init();
+
+    radio_airtime_scan_params(BLE_SCAN_INTERVAL, BLE_SCAN_WINDOW);
+    radio_airtime_adv_params(BLE_ADV_INTERVAL_US, ad_data_len(adv_data, ARRAY_SIZE(adv_data)));
+    radio_airtime_start();
+    relay_security_init();
+    sound_iso_init();
+    relay_bulk_init();
+
+#if defined(CONFIG_RELAY_SEG_DOWNSTREAM)
+    relay_seg_rx_init(&seq_result_rx, RELAY_SEG_STREAM_SEQ_RESULT, seq_result_reassembled);
+    relay_seg_rx_init(&debug_string_rx, RELAY_SEG_STREAM_DEBUG_STRING, debug_string_reassembled);
+#endif
+
     err = bt_enable(NULL);
     if (err) {
         LOG_ERR("BLE init failed (err %d)", err);
@@ -752,6 +1435,10 @@ int ble_relay_control_start(void)
         k_sleep(K_MSEC(500));
     }
 
+#if defined(CONFIG_RELAY_CHAIN)
+    /* relay id 는 identity address 에서 나오니 bt_enable 뒤에 */
+    relay_chain_info_get(&chain_adv.info);
+#endif
     adv_start_safe(0);
 
     return err;
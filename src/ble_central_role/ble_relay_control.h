@@ -1,7 +1,38 @@
 #pragma once
 
+struct bt_conn;
+
 /* 스캔 시작/정지 및 타깃 디바이스 이름 설정 */
 int central_scan_set_target_name(const char *name);  /* NULL이면 전체 출력 */
 int central_scan_start(void);
 int central_scan_stop(void);
-int ble_relay_control_start(void);
\ No newline at end of file
+int ble_relay_control_start(void);
+
+/* 현재 연결된 SLIMHUB (relay 가 PERIPHERAL) 연결. 없으면 NULL */
+struct bt_conn *ble_relay_hub_conn(void);
+
+/* advertising 이름 변경 (relay_link_workq 에서 호출). 26 byte 를 넘으면 shortened name */
+void ble_relay_adv_name_set(const char *name);
+
+#if defined(CONFIG_RELAY_CHAIN)
+struct relay_chain_info;
+
+/* scan response 의 chain service data 변경 (relay_link_workq 에서 호출) */
+void ble_relay_adv_chain_set(const struct relay_chain_info *info);
+#endif
+
+#if defined(CONFIG_RELAY_ROOM_DEVICES)
+#include <zephyr/bluetooth/addr.h>
+
+/* room_device.c 전용: scan 을 멈추고 central 연결 생성. 다른 연결을 만드는 중이면 -EBUSY */
+int ble_relay_central_create(const bt_addr_le_t *addr, struct bt_conn **conn);
+#endif
+
+#if defined(CONFIG_RELAY_FWD_BENCH)
+#include <stdint.h>
+#include "relay_stats.h"
+
+/* relay_fwd_bench.c 전용: 가짜 node handle / hub 연결로 forward path 를 돌린다 */
+void ble_relay_bench_setup(struct bt_conn *fake_hub);
+uint8_t ble_relay_bench_notify(enum relay_stream stream, const void *data, uint16_t len);
+#endif
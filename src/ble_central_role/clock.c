@@ -1,11 +1,102 @@
 #include <zephyr/kernel.h>
 #include <zephyr/sys/printk.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/logging/log.h>
 #include <time.h>
 
 #include "clock.h"
 #include "cts.h"
 
-static time_t boot_time_epoch = 0;  // Boot reference time (Unix time)
+LOG_MODULE_REGISTER(relay_clock, LOG_LEVEL_INF);
+
+#define USEC_PER_SEC_LL             1000000LL
+/* 이보다 크게 틀리면 drift 가 아니라 시간이 새로 설정된 것 */
+#define CLOCK_STEP_THRESHOLD_US     (2 * USEC_PER_SEC_LL)
+/* drift 는 충분히 떨어진 두 sync 사이에서만 잰다 */
+#define CLOCK_DRIFT_MIN_INTERVAL_US (60 * USEC_PER_SEC_LL)
+/* 32 kHz 수정 + RC 보정 여유 */
+#define CLOCK_DRIFT_MAX_PPB         500000
+
+static struct k_spinlock clock_lock;
+static int64_t base_epoch_us;       // Unix time (us) at base_uptime_us
+static int64_t base_uptime_us;
+static int32_t drift_ppb;           // + : local clock runs slow
+static int64_t last_now_us;         // readings never go backwards (except on a step)
+static bool synced;
+static uint32_t set_count;          // hub 가 설정한 횟수 (step 포함), 0 = 부팅 기본값
+
+int64_t clock_uptime_us(void)
+{
+    return (int64_t)k_ticks_to_us_floor64(k_uptime_ticks());
+}
+
+static int64_t clock_epoch_us_at(int64_t uptime_us)
+{
+    int64_t elapsed = uptime_us - base_uptime_us;
+    /* elapsed * drift_ppb 는 ±500000 ppb 에서 ~213 일이면 int64 를 넘는다: 초와 나머지로 나눠 곱한다 */
+    int64_t sec = elapsed / 1000000LL;
+    int64_t rem_us = elapsed % 1000000LL;
+
+    return base_epoch_us + elapsed + sec * drift_ppb / 1000LL + rem_us * drift_ppb / 1000000000LL;
+}
+
+int64_t clock_now_us(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&clock_lock);
+    int64_t now = clock_epoch_us_at(clock_uptime_us());
+
+    if (now < last_now_us) {
+        now = last_now_us;
+    }
+    last_now_us = now;
+    k_spin_unlock(&clock_lock, key);
+
+    return now;
+}
+
+int64_t clock_now_ms(void)
+{
+    return clock_now_us() / 1000;
+}
+
+void clock_sync(int64_t ref_epoch_us, int64_t at_uptime_us)
+{
+    k_spinlock_key_t key = k_spin_lock(&clock_lock);
+    int64_t offset = ref_epoch_us - clock_epoch_us_at(at_uptime_us);
+    int64_t interval = at_uptime_us - base_uptime_us;
+    bool stepped = !synced || offset > CLOCK_STEP_THRESHOLD_US || offset < -CLOCK_STEP_THRESHOLD_US;
+
+    if (stepped) {
+        /* 처음 설정되었거나 시간이 새로 설정됨: 뒤로 가는 것도 허용.
+         * drift 추정은 같은 수정 발진기이므로 그대로 둔다 */
+        last_now_us = 0;
+    } else if (interval >= CLOCK_DRIFT_MIN_INTERVAL_US) {
+        /* 남은 offset 의 절반만큼 rate 보정 (한 번의 지연된 write 에 흔들리지 않게) */
+        int64_t measured_ppb = offset * 1000000000LL / interval;
+
+        drift_ppb = CLAMP(drift_ppb + measured_ppb / 2, -CLOCK_DRIFT_MAX_PPB, CLOCK_DRIFT_MAX_PPB);
+    }
+
+    if (stepped) {
+        set_count++;
+    }
+    base_epoch_us = ref_epoch_us;
+    base_uptime_us = at_uptime_us;
+    synced = true;
+    k_spin_unlock(&clock_lock, key);
+
+    LOG_INF("[CLOCK] %s by %lld us, drift %d ppb", stepped ? "stepped" : "corrected",
+            offset, drift_ppb);
+}
+
+uint32_t clock_set_count(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&clock_lock);
+    uint32_t n = set_count;
+
+    k_spin_unlock(&clock_lock, key);
+    return n;
+}
 
 // Function to print the current time
 void print_clock()
@@ -17,7 +108,7 @@ void print_clock()
         datetime.tm_year + 1900, datetime.tm_mon + 1, datetime.tm_mday);
 }
 
-// Retrieves the current date and time based on system uptime
+// Retrieves the current date and time from the disciplined clock
 void clock_get_datetime(struct tm *datetime)
 {
     if (datetime == NULL) {
@@ -25,7 +116,7 @@ void clock_get_datetime(struct tm *datetime)
         return;
     }
 
-    time_t current_time = boot_time_epoch + (k_uptime_get() / 1000);
+    time_t current_time = clock_now_ms() / 1000;
 
     struct tm temp_tm;
     struct tm *local_tm = gmtime_r(&current_time, &temp_tm);  // Use thread-safe gmtime_r()
@@ -52,17 +143,19 @@ void clock_init()
     cts_time.tm_sec = 0;
 
     sync_cts_to_time(&cts_time);  // Synchronize time
+
+    /* 부팅 기본값은 설정된 시간으로 치지 않는다: hub 의 첫 CTS write 가 step 이 된다 */
+    synced = false;
+    set_count = 0;
 }
 
-// Updates the clock with a new date and time
+// Updates the clock with a new date and time (whole seconds, now)
 void clock_set_datetime(struct tm* datetime)
 {
     time_t set_time = mktime(datetime);
-    time_t current_uptime = k_uptime_get() / 1000;
 
-    // Adjust boot_time_epoch so that current_time = set_time
-    boot_time_epoch = set_time - current_uptime;
-    
+    clock_sync((int64_t)set_time * USEC_PER_SEC_LL, clock_uptime_us());
+
     printk("Local clock set to: %02d:%02d:%02d, %04d-%02d-%02d\n",
         datetime->tm_hour, datetime->tm_min, datetime->tm_sec,
         datetime->tm_year + 1900, datetime->tm_mon + 1, datetime->tm_mday);
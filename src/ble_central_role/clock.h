@@ -1,3 +1,6 @@
+#ifndef _CLOCK_H_
+#define _CLOCK_H_
+
 #include <zephyr/kernel.h>
 #include <time.h>
 
@@ -6,4 +9,57 @@ void clock_init();
 time_t clock_get_ticks();
 
 void clock_get_datetime(struct tm *datetime);
-void clock_set_datetime(struct tm *datetime);
\ No newline at end of file
+void clock_set_datetime(struct tm *datetime);
+
+/** @brief Relay wall clock.
+ *
+ * 64-bit Unix time in microseconds, counted from the kernel tick and
+ * disciplined by every CTS write: the clock is stepped to the written time
+ * (including exact_time_256), and the offset seen at the next write corrects
+ * the estimated crystal drift. Small corrections never make a reading go
+ * backwards; only a step of more than 2 s (time set anew) can.
+ */
+
+/** @brief Uptime in microseconds (same time base as clock_sync()). */
+int64_t clock_uptime_us(void);
+
+/** @brief Current Unix time in microseconds. */
+int64_t clock_now_us(void);
+
+/** @brief Current Unix time in milliseconds. */
+int64_t clock_now_ms(void);
+
+/**
+ * @brief Discipline the clock with a reference time.
+ *
+ * @param ref_epoch_us is the reference Unix time in microseconds.
+ * @param at_uptime_us is clock_uptime_us() when the reference was received.
+ */
+void clock_sync(int64_t ref_epoch_us, int64_t at_uptime_us);
+
+/**
+ * @brief How many times the clock was set anew (first sync and steps).
+ *
+ * 0 while the clock still runs from its boot default, i.e. the hub has not
+ * written the time yet.
+ */
+uint32_t clock_set_count(void);
+
+/** @brief Relay receive timestamp appended to forwarded packets (CONFIG_RELAY_RX_TIMESTAMP).
+ *
+ * uint32_t little endian, the low 32 bits of the Unix time in milliseconds
+ * (wraps every ~49.7 days; the hub takes the high bits from its own clock).
+ */
+#if defined(CONFIG_RELAY_RX_TIMESTAMP)
+#define RELAY_RX_STAMP_SIZE 4
+#else
+#define RELAY_RX_STAMP_SIZE 0
+#endif
+
+/** @brief Relay receive timestamp for a packet received now. */
+static inline uint32_t clock_rx_stamp(void)
+{
+    return (uint32_t)clock_now_ms();
+}
+
+#endif
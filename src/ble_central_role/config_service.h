@@ -37,6 +37,7 @@ int get_dean_device_config(device_config_t *conf);
 #define BLE_FILE_TRANSFER_CMD_DATA 2
 #define BLE_FILE_TRANSFER_CMD_END 3
 #define BLE_FILE_TRANSFER_CMD_REMOVE 4
+#define BLE_FILE_TRANSFER_CMD_RESUME 5
 #define BLE_FILE_TRANSFER_CMD_FAILED 11
 
 #define BLE_FILE_TRANSFER_FRAME_SIZE 128
@@ -55,3 +56,12 @@ struct ble_file_transfer_ack_packet
 } __attribute__((packed));
 
 void process_file_transfer_write(const void *buf, uint16_t len);
+
+/**
+ * @brief Notify a file transfer ACK packet to the hub.
+ *
+ * @param data is a struct ble_file_transfer_ack_packet.
+ * @param len is the packet length.
+ * @return 0 if the notification was queued, -EACCES if the hub did not enable it.
+ */
+int bt_config_file_transfer(const void *data, uint16_t len);
@@ -26,46 +26,71 @@
 
 #include "clock.h"
 #include "cts.h"
+#include "node_time_sync.h"
+#include "relay_workq.h"
 
 static struct cts_datetime ct;
 static uint8_t ct_update;
+/* ct 를 받은 시점 (clock_uptime_us). work 가 늦게 돌아도 이 시점 기준으로 맞춘다 */
+static int64_t ct_rx_uptime_us;
 
-void time_to_cts()
+void cts_from_epoch_us(int64_t epoch_us, struct cts_datetime *dt)
 {
 	struct tm time;
-	clock_get_datetime(&time);
+	time_t now_s = epoch_us / 1000000;
+
+	gmtime_r(&now_s, &time);
 
-	ct.year = time.tm_year + 1900; // Convert to full year
-	ct.month = time.tm_mon + 1;	// Convert to 1-based month
-	ct.day = time.tm_mday;
-	ct.hours = time.tm_hour;
-	ct.minutes = time.tm_min;
-	ct.seconds = time.tm_sec;
+	dt->year = sys_cpu_to_le16(time.tm_year + 1900); // Convert to full year
+	dt->month = time.tm_mon + 1;	// Convert to 1-based month
+	dt->day = time.tm_mday;
+	dt->hours = time.tm_hour;
+	dt->minutes = time.tm_min;
+	dt->seconds = time.tm_sec;
 
 	// Convert weekday: tm_wday (0=Sun, 6=Sat) → CTS format (1=Mon, 7=Sun)
-	ct.day_of_week = (time.tm_wday == 0) ? 7 : time.tm_wday;
+	dt->day_of_week = (time.tm_wday == 0) ? 7 : time.tm_wday;
 
-	ct.exact_time_256 = 0U;
-	ct.adjust_reason = 0U;
+	dt->exact_time_256 = (epoch_us % 1000000) * 256 / 1000000;
+	dt->adjust_reason = 0U;
 }
 
-void sync_cts_to_time()
+void time_to_cts()
+{
+	cts_from_epoch_us(clock_now_us(), &ct);
+}
+
+int64_t cts_to_epoch_us(const struct cts_datetime *dt)
 {
 	struct tm time;
-	time.tm_year = ct.year - 1900; // Convert to tm_year format
-	time.tm_mon = ct.month - 1;	   // Convert to 0-based month
-	time.tm_mday = ct.day;
-	time.tm_hour = ct.hours;
-	time.tm_min = ct.minutes;
-	time.tm_sec = ct.seconds;
+	time.tm_year = sys_le16_to_cpu(dt->year) - 1900; // Convert to tm_year format
+	time.tm_mon = dt->month - 1;	   // Convert to 0-based month
+	time.tm_mday = dt->day;
+	time.tm_hour = dt->hours;
+	time.tm_min = dt->minutes;
+	time.tm_sec = dt->seconds;
 
 	// Convert CTS weekday (1=Mon, 7=Sun) → tm_wday (0=Sun, 6=Sat)
-	time.tm_wday = (ct.day_of_week == 7) ? 0 : ct.day_of_week;
+	time.tm_wday = (dt->day_of_week == 7) ? 0 : dt->day_of_week;
 
 	time.tm_yday = 0;
 	time.tm_isdst = 0;
 
-	clock_set_datetime(&time);
+	/* Fractions256 까지 포함해서 us 단위로 */
+	return (int64_t)mktime(&time) * 1000000LL + (int64_t)dt->exact_time_256 * 1000000LL / 256;
+}
+
+void sync_cts_to_time()
+{
+	uint32_t sets = clock_set_count();
+
+	clock_sync(cts_to_epoch_us(&ct), ct_rx_uptime_us);
+
+	/* 시간이 새로 설정됨: node 들에도 다시 */
+	if (clock_set_count() != sets)
+	{
+		node_time_sync_clock_set();
+	}
 }
 
 K_WORK_DEFINE(cts_sync_work, sync_cts_to_time);
@@ -90,10 +115,11 @@ static ssize_t write_ct(struct bt_conn *conn, const struct bt_gatt_attr *attr,
 		return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
 	}
 
+	ct_rx_uptime_us = clock_uptime_us();
 	memcpy(&ct, buf, len);
 	ct_update = 1U;
 
-	k_work_submit(&cts_sync_work);
+	k_work_submit_to_queue(&relay_link_workq, &cts_sync_work);
 	return len;
 }
 
@@ -137,6 +163,7 @@ void cts_init(void)
 {
 	/* Simulate current time for Current Time Service */
 	generate_current_time();
+	ct_rx_uptime_us = clock_uptime_us();
 }
 
 void cts_notify(void)
@@ -165,10 +192,3 @@ void notify_time_to_cts(struct tm *time)
 
 	cts_notify();
 }
-
-int cts_write(struct bt_conn *conn, uint16_t handle)
-{
-	time_to_cts();
-
-	return bt_gatt_write_without_response(conn, handle, &ct, sizeof(ct), false);
-}
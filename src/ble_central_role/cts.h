@@ -14,6 +14,8 @@ extern "C" {
 
 #include <stdint.h>
 
+struct bt_conn;
+
 void cts_init(void);
 void cts_notify(void);
 
@@ -32,7 +34,12 @@ struct cts_datetime {
 void time_to_cts();
 
 void sync_cts_to_time();
-int cts_write(struct bt_conn *conn, uint16_t handle);
+
+/** @brief CTS Current Time (with Fractions256) as Unix time in microseconds. */
+int64_t cts_to_epoch_us(const struct cts_datetime *dt);
+
+/** @brief Unix time in microseconds as CTS Current Time (Fractions256 truncated). */
+void cts_from_epoch_us(int64_t epoch_us, struct cts_datetime *dt);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,200 @@
+/* device_conf_store.c
+ *
+ * 목적:
+ *  - hub 가 CONFIG service 로 쓴 device name / location 을 settings (flash) 에 저장한다.
+ *  - GATT write callback (BT RX thread) 에서는 flash 를 건드리지 않고,
+ *    마지막 write 후 CONFIG_RELAY_CONF_SAVE_DELAY_MS 가 지나면 relay_hci_workq 에서 한 번에 저장한다.
+ *  - 저장된 이름은 advertising 이름으로 바로 쓰고, 저장할 때 GAP device name 도 바꾼다.
+ */
+#include "device_conf_store.h"
+
+#include <string.h>
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/logging/log.h>
+
+#include "config_service.h"
+#include "ble_relay_control.h"
+#include "relay_workq.h"
+
+LOG_MODULE_REGISTER(device_conf_store, LOG_LEVEL_INF);
+
+#define CONF_SETTINGS_ROOT  "relay"
+#define CONF_KEY_NAME       "name"
+#define CONF_KEY_LOCATION   "loc"
+
+/* flash 에 있는 값 (같은 값은 다시 쓰지 않는다) */
+static char saved_name[sizeof(dean_device_conf.device_name)];
+static char saved_location[sizeof(dean_device_conf.location)];
+/* 저장된 이름이 있으면 부팅 때부터 CONFIG_BT_DEVICE_NAME 대신 advertise */
+static bool name_loaded;
+
+static struct k_spinlock conf_lock;
+
+static void conf_save_work_handler(struct k_work *work);
+static void conf_adv_name_work_handler(struct k_work *work);
+K_WORK_DELAYABLE_DEFINE(conf_save_work, conf_save_work_handler);
+K_WORK_DEFINE(conf_adv_name_work, conf_adv_name_work_handler);
+
+static void conf_snapshot(char *name, char *location)
+{
+    k_spinlock_key_t key = k_spin_lock(&conf_lock);
+
+    memcpy(name, dean_device_conf.device_name, sizeof(dean_device_conf.device_name));
+    memcpy(location, dean_device_conf.location, sizeof(dean_device_conf.location));
+    k_spin_unlock(&conf_lock, key);
+
+    name[sizeof(dean_device_conf.device_name) - 1] = '\0';
+    location[sizeof(dean_device_conf.location) - 1] = '\0';
+}
+
+static int conf_save_str(const char *key, const char *val, char *saved, size_t size)
+{
+    int err;
+
+    if (strncmp(val, saved, size) == 0) {
+        return 0;
+    }
+
+    err = settings_save_one(key, val, strlen(val));
+    if (err) {
+        LOG_ERR("[CONF] save %s failed (err %d)", key, err);
+        return err;
+    }
+
+    strncpy(saved, val, size - 1);
+    saved[size - 1] = '\0';
+    return 1;
+}
+
+static void conf_save_work_handler(struct k_work *work)
+{
+    char name[sizeof(dean_device_conf.device_name)];
+    char location[sizeof(dean_device_conf.location)];
+    int name_saved, loc_saved;
+
+    conf_snapshot(name, location);
+
+    name_saved = conf_save_str(CONF_SETTINGS_ROOT "/" CONF_KEY_NAME, name,
+                               saved_name, sizeof(saved_name));
+    loc_saved = conf_save_str(CONF_SETTINGS_ROOT "/" CONF_KEY_LOCATION, location,
+                              saved_location, sizeof(saved_location));
+
+#if defined(CONFIG_BT_DEVICE_NAME_DYNAMIC)
+    if (name_saved > 0) {
+        /* GAP device name (bt/name) 도 BT settings 로 저장된다 */
+        int err = bt_set_name(name);
+
+        if (err) {
+            LOG_WRN("[CONF] bt_set_name failed (err %d)", err);
+        }
+    }
+#endif
+
+    if (name_saved > 0 || loc_saved > 0) {
+        LOG_INF("[CONF] saved name=\"%s\" location=\"%s\"", name, location);
+    }
+}
+
+static void conf_adv_name_work_handler(struct k_work *work)
+{
+    char name[sizeof(dean_device_conf.device_name)];
+    char location[sizeof(dean_device_conf.location)];
+
+    conf_snapshot(name, location);
+    if (name[0]) {
+        ble_relay_adv_name_set(name);
+    }
+}
+
+static int conf_write(char *dst, size_t size, const void *buf, uint16_t len)
+{
+    k_spinlock_key_t key;
+
+    if (len >= size) {
+        return -EINVAL;
+    }
+
+    key = k_spin_lock(&conf_lock);
+    memset(dst, 0, size);
+    memcpy(dst, buf, len);
+    k_spin_unlock(&conf_lock, key);
+
+    /* write 가 이어지면 마지막 write 기준으로 다시 미룬다 */
+    k_work_reschedule_for_queue(&relay_hci_workq, &conf_save_work,
+                                K_MSEC(CONFIG_RELAY_CONF_SAVE_DELAY_MS));
+    return 0;
+}
+
+int device_conf_set_name(const void *buf, uint16_t len)
+{
+    int err = conf_write(dean_device_conf.device_name, sizeof(dean_device_conf.device_name), buf, len);
+
+    if (!err) {
+        k_work_submit_to_queue(&relay_link_workq, &conf_adv_name_work);
+    }
+    return err;
+}
+
+int device_conf_set_location(const void *buf, uint16_t len)
+{
+    return conf_write(dean_device_conf.location, sizeof(dean_device_conf.location), buf, len);
+}
+
+/* ----------------- settings handler ----------------- */
+
+static int conf_settings_set(const char *key, size_t len, settings_read_cb read_cb, void *cb_arg)
+{
+    const char *next;
+    char *dst, *saved;
+    size_t size;
+    ssize_t rc;
+    k_spinlock_key_t lk;
+
+    if (settings_name_steq(key, CONF_KEY_NAME, &next) && !next) {
+        dst = dean_device_conf.device_name;
+        saved = saved_name;
+        size = sizeof(saved_name);
+    } else if (settings_name_steq(key, CONF_KEY_LOCATION, &next) && !next) {
+        dst = dean_device_conf.location;
+        saved = saved_location;
+        size = sizeof(saved_location);
+    } else {
+        return -ENOENT;
+    }
+
+    if (len >= size) {
+        return -EINVAL;
+    }
+
+    memset(saved, 0, size);
+    rc = read_cb(cb_arg, saved, len);
+    if (rc < 0) {
+        return rc;
+    }
+
+    lk = k_spin_lock(&conf_lock);
+    memcpy(dst, saved, size);
+    k_spin_unlock(&conf_lock, lk);
+
+    if (dst == dean_device_conf.device_name) {
+        name_loaded = true;
+    }
+    return 0;
+}
+
+static int conf_settings_commit(void)
+{
+    if (name_loaded) {
+        LOG_INF("[CONF] loaded name=\"%s\" location=\"%s\"",
+                dean_device_conf.device_name, dean_device_conf.location);
+        k_work_submit_to_queue(&relay_link_workq, &conf_adv_name_work);
+    }
+    return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(relay_conf, CONF_SETTINGS_ROOT, NULL,
+                               conf_settings_set, conf_settings_commit, NULL);
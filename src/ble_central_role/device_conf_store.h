@@ -0,0 +1,39 @@
+#ifndef _DEVICE_CONF_STORE_H_
+#define _DEVICE_CONF_STORE_H_
+
+#include <stdint.h>
+
+/** @brief Persistent device name / location (dean_device_conf).
+ *
+ * The CONFIG service write callbacks only update RAM through the functions
+ * below. The values are saved with the settings subsystem ("relay/name",
+ * "relay/loc") from relay_hci_workq CONFIG_RELAY_CONF_SAVE_DELAY_MS after the
+ * last write: a burst of writes is one flash write, and a value equal to the
+ * stored one is not written again.
+ *
+ * A stored name replaces CONFIG_BT_DEVICE_NAME in the advertising data
+ * (immediately) and as the GAP device name (with the save).
+ * The values are restored by settings_load() in ble_relay_control_start().
+ */
+
+/**
+ * @brief Set dean_device_conf.device_name (GATT write, BT RX thread).
+ *
+ * @param buf is the new name, not NUL terminated.
+ * @param len is the name length.
+ *
+ * @retval 0 on success, -EINVAL if the name does not fit.
+ */
+int device_conf_set_name(const void *buf, uint16_t len);
+
+/**
+ * @brief Set dean_device_conf.location (GATT write, BT RX thread).
+ *
+ * @param buf is the new location, not NUL terminated.
+ * @param len is the location length.
+ *
+ * @retval 0 on success, -EINVAL if the location does not fit.
+ */
+int device_conf_set_location(const void *buf, uint16_t len);
+
+#endif
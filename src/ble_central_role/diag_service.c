@@ -0,0 +1,154 @@
+/* diag_service.c
+ *
+ * 목적:
+ *  - relay 카운터 (relay_stats.h) 를 hub 에 보여주는 diagnostics service.
+ *  - COUNTERS: read 또는 CONFIG_RELAY_STATS_NOTIFY_INTERVAL_S 마다 notify.
+ *  - CONTROL : 카운터 reset / 즉시 notify 명령.
+ *  - AIRTIME : radio 점유율 (radio_airtime.h), window 마다 notify.
+ */
+#include "diag_service.h"
+
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/logging/log.h>
+
+#include "relay_stats.h"
+#include "relay_segment.h"
+#include "radio_airtime.h"
+#include "relay_workq.h"
+#include "ble_relay_control.h"
+
+LOG_MODULE_REGISTER(diag_service, LOG_LEVEL_INF);
+
+static bool diag_counters_notify_enabled;
+static bool diag_airtime_notify_enabled;
+
+static void diag_notify_work_handler(struct k_work *work);
+K_WORK_DELAYABLE_DEFINE(diag_notify_work, diag_notify_work_handler);
+
+static void ccc_cfg_diag_counters_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+    diag_counters_notify_enabled = (value == BT_GATT_CCC_NOTIFY);
+
+    if (diag_counters_notify_enabled && CONFIG_RELAY_STATS_NOTIFY_INTERVAL_S > 0) {
+        k_work_reschedule_for_queue(&relay_link_workq, &diag_notify_work,
+                                    K_SECONDS(CONFIG_RELAY_STATS_NOTIFY_INTERVAL_S));
+    } else {
+        k_work_cancel_delayable(&diag_notify_work);
+    }
+}
+
+static void ccc_cfg_diag_airtime_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+    diag_airtime_notify_enabled = (value == BT_GATT_CCC_NOTIFY);
+}
+
+static ssize_t diag_airtime_read_cb(struct bt_conn *conn,
+                                    const struct bt_gatt_attr *attr,
+                                    void *buf, uint16_t len,
+                                    uint16_t offset)
+{
+    struct radio_airtime_report report;
+
+    radio_airtime_last_report(&report);
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, &report, sizeof(report));
+}
+
+static ssize_t diag_counters_read_cb(struct bt_conn *conn,
+                                     const struct bt_gatt_attr *attr,
+                                     void *buf, uint16_t len,
+                                     uint16_t offset)
+{
+    struct relay_stats_packet pkt;
+
+    relay_stats_get(&pkt);
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, &pkt, sizeof(pkt));
+}
+
+static ssize_t diag_control_write_cb(struct bt_conn *conn,
+                                     const struct bt_gatt_attr *attr,
+                                     const void *buf, uint16_t len,
+                                     uint16_t offset, uint8_t flags)
+{
+    const uint8_t *cmd = buf;
+
+    if (offset || len < 1) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+    }
+
+    switch (cmd[0]) {
+    case DIAG_CMD_RESET_COUNTERS:
+        relay_stats_reset();
+        LOG_INF("[DIAG] counters reset by hub");
+        break;
+    case DIAG_CMD_NOTIFY_COUNTERS:
+        k_work_reschedule_for_queue(&relay_link_workq, &diag_notify_work, K_NO_WAIT);
+        break;
+    default:
+        return BT_GATT_ERR(BT_ATT_ERR_NOT_SUPPORTED);
+    }
+
+    return len;
+}
+
+BT_GATT_SERVICE_DEFINE(diag_svr,
+    BT_GATT_PRIMARY_SERVICE(BT_UUID_DIAG_SERVICE),
+
+    BT_GATT_CHARACTERISTIC(BT_UUID_CHRC_DIAG_COUNTERS,
+                           BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
+                           BT_GATT_PERM_READ,
+                           diag_counters_read_cb, NULL, NULL),
+    BT_GATT_CCC(ccc_cfg_diag_counters_changed,
+                BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+
+    BT_GATT_CHARACTERISTIC(BT_UUID_CHRC_DIAG_CONTROL,
+                           BT_GATT_CHRC_WRITE,
+                           BT_GATT_PERM_WRITE,
+                           NULL, diag_control_write_cb, NULL),
+
+    BT_GATT_CHARACTERISTIC(BT_UUID_CHRC_DIAG_AIRTIME,
+                           BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
+                           BT_GATT_PERM_READ,
+                           diag_airtime_read_cb, NULL, NULL),
+    BT_GATT_CCC(ccc_cfg_diag_airtime_changed,
+                BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+);
+
+int bt_diag_notify_counters(void)
+{
+    struct relay_stats_packet pkt;
+
+    if (!diag_counters_notify_enabled) {
+        return -EACCES;
+    }
+
+    relay_stats_get(&pkt);
+    /* 기본 MTU (23) 로는 한 notification 에 안 들어간다 */
+    return relay_seg_send(ble_relay_hub_conn(), &diag_svr.attrs[2], RELAY_SEG_STREAM_DIAG_COUNTERS,
+                          (const uint8_t *)&pkt, sizeof(pkt));
+}
+
+int bt_diag_notify_airtime(const void *data, uint16_t len)
+{
+    if (!diag_airtime_notify_enabled) {
+        return -EACCES;
+    }
+
+    return bt_gatt_notify(ble_relay_hub_conn(), &diag_svr.attrs[7], data, len);
+}
+
+static void diag_notify_work_handler(struct k_work *work)
+{
+    int err = bt_diag_notify_counters();
+
+    if (err && err != -EACCES) {
+        LOG_DBG("[DIAG] counters notify failed (err %d)", err);
+    }
+
+    if (diag_counters_notify_enabled && CONFIG_RELAY_STATS_NOTIFY_INTERVAL_S > 0) {
+        k_work_reschedule_for_queue(&relay_link_workq, &diag_notify_work,
+                                    K_SECONDS(CONFIG_RELAY_STATS_NOTIFY_INTERVAL_S));
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef _DIAG_SERVICE_H_
+#define _DIAG_SERVICE_H_
+
+#include "ble.h"
+
+/** Relay diagnostics service UUID definitions */
+#define DIAG_UUID_SERVICE               0x0A00
+#define DIAG_UUID_CHAR_COUNTERS         0x0A01
+#define DIAG_UUID_CHAR_CONTROL          0x0A02
+#define DIAG_UUID_CHAR_AIRTIME          0x0A03
+
+/** @brief Relay Diagnostics Service UUID */
+#define BT_UUID_DIAG_SERVICE_VAL                                        \
+    BT_UUID_128_ENCODE(BT_ADLD_SPECIFIC_UUID_FIRST + DIAG_UUID_SERVICE, \
+                       BT_ADLD_SPECIFIC_UUID_SECOND,                    \
+                       BT_ADLD_SPECIFIC_UUID_THIRD,                     \
+                       BT_ADLD_SPECIFIC_UUID_FOURTH,                    \
+                       BT_ADLD_SPECIFIC_UUID_LAST)
+/** @brief Relay Counters Characteristic UUID (read / notify, struct relay_stats_packet) */
+#define BT_UUID_CHRC_DIAG_COUNTERS_VAL                                        \
+    BT_UUID_128_ENCODE(BT_ADLD_SPECIFIC_UUID_FIRST + DIAG_UUID_CHAR_COUNTERS, \
+                       BT_ADLD_SPECIFIC_UUID_SECOND,                          \
+                       BT_ADLD_SPECIFIC_UUID_THIRD,                           \
+                       BT_ADLD_SPECIFIC_UUID_FOURTH,                          \
+                       BT_ADLD_SPECIFIC_UUID_LAST)
+/** @brief Relay Diagnostics Control Characteristic UUID (write, DIAG_CMD_*) */
+#define BT_UUID_CHRC_DIAG_CONTROL_VAL                                        \
+    BT_UUID_128_ENCODE(BT_ADLD_SPECIFIC_UUID_FIRST + DIAG_UUID_CHAR_CONTROL, \
+                       BT_ADLD_SPECIFIC_UUID_SECOND,                         \
+                       BT_ADLD_SPECIFIC_UUID_THIRD,                          \
+                       BT_ADLD_SPECIFIC_UUID_FOURTH,                         \
+                       BT_ADLD_SPECIFIC_UUID_LAST)
+/** @brief Radio Airtime Characteristic UUID (read / notify, struct radio_airtime_report) */
+#define BT_UUID_CHRC_DIAG_AIRTIME_VAL                                        \
+    BT_UUID_128_ENCODE(BT_ADLD_SPECIFIC_UUID_FIRST + DIAG_UUID_CHAR_AIRTIME, \
+                       BT_ADLD_SPECIFIC_UUID_SECOND,                         \
+                       BT_ADLD_SPECIFIC_UUID_THIRD,                          \
+                       BT_ADLD_SPECIFIC_UUID_FOURTH,                         \
+                       BT_ADLD_SPECIFIC_UUID_LAST)
+
+#define BT_UUID_DIAG_SERVICE            BT_UUID_DECLARE_128(BT_UUID_DIAG_SERVICE_VAL)
+#define BT_UUID_CHRC_DIAG_COUNTERS      BT_UUID_DECLARE_128(BT_UUID_CHRC_DIAG_COUNTERS_VAL)
+#define BT_UUID_CHRC_DIAG_CONTROL       BT_UUID_DECLARE_128(BT_UUID_CHRC_DIAG_CONTROL_VAL)
+#define BT_UUID_CHRC_DIAG_AIRTIME       BT_UUID_DECLARE_128(BT_UUID_CHRC_DIAG_AIRTIME_VAL)
+
+/** Diagnostics control commands (first byte written to the control characteristic) */
+#define DIAG_CMD_RESET_COUNTERS         0x01
+#define DIAG_CMD_NOTIFY_COUNTERS        0x02
+
+/**
+ * @brief Notify the current counters to the hub.
+ *
+ * The packet is longer than the default ATT MTU, so it goes out in
+ * RELAY_SEG_STREAM_DIAG_COUNTERS segments (relay_segment.h). A read returns
+ * it as is.
+ *
+ * @return 0 if every segment was queued, -EACCES if the hub did not enable it.
+ */
+int bt_diag_notify_counters(void);
+
+/**
+ * @brief Notify one radio airtime window to the hub.
+ *
+ * @param data is a struct radio_airtime_report.
+ * @param len is the report length.
+ * @return 0 if the notification was queued, -EACCES if the hub did not enable it.
+ */
+int bt_diag_notify_airtime(const void *data, uint16_t len);
+
+#endif
@@ -0,0 +1,422 @@
+/* feature_relay.c
+ *
+ * 목적:
+ *  - node 는 feature collection 중 mel frame 하나당 notification 하나를 보낸다.
+ *    (struct ble_sound_feature_packet, ~100 byte)
+ *  - relay 는 frame 을 ring buffer 에 모았다가 MTU 에 들어가는 만큼 묶어서
+ *    hub 로 한 번에 보낸다. hub link 가 잠깐 막혀도 ring 이 흡수한다.
+ *  - session (START ~ END) 마다 받은 frame / 보낸 frame / 유실 수를 센다.
+ *
+ * ring 은 producer (BT RX thread) 하나, consumer (relay_fwd_workq) 하나.
+ * ring_tail 은 consumer 만 바꾼다. node 가 끊기면 버릴 위치만 남기고 drain 이 옮긴다.
+ * session counter 도 두 thread 가 같이 쓰므로 atomic. next_seq 는 BT RX thread 만 쓴다.
+ */
+#include "feature_relay.h"
+
+#include <string.h>
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/logging/log.h>
+
+#include "sound.h"
+#include "sound_service.h"
+#include "ble_relay_control.h"
+#include "relay_workq.h"
+#include "relay_stats.h"
+#include "clock.h"
+#include "relay_chain.h"
+#include "relay_bulk.h"
+#include "node_stream.h"
+
+LOG_MODULE_REGISTER(feature_relay, LOG_LEVEL_INF);
+
+#define FEATURE_RING_SIZE           CONFIG_RELAY_FEATURE_RING_FRAMES
+/* START / FINISH / END 용으로 남겨두는 slot */
+#define FEATURE_RING_CTRL_RESERVE   2
+#define FEATURE_ATT_NOTIFY_OVERHEAD 3
+#define FEATURE_RETRY_MS            5
+#define FEATURE_PDU_MAX             244
+/* bulk channel 이면 SDU 하나에 더 많이 */
+#define FEATURE_BUF_MAX             MAX(FEATURE_PDU_MAX, RELAY_BULK_PAYLOAD_MAX)
+#define FEATURE_BULK_MAX            (FEATURE_BUF_MAX - sizeof(struct ble_sound_feature_bulk_hdr) - \
+                                     RELAY_RX_STAMP_SIZE)
+
+static struct ble_sound_feature_packet ring[FEATURE_RING_SIZE];
+static uint16_t ring_len[FEATURE_RING_SIZE];     /* node 가 보낸 길이 (control frame 은 그대로 보낸다) */
+#if defined(CONFIG_RELAY_RX_TIMESTAMP)
+static uint32_t ring_stamp[FEATURE_RING_SIZE];  /* frame 별 relay 수신 시각 */
+#endif
+static atomic_t ring_head;  /* producer */
+static atomic_t ring_tail;  /* consumer */
+static atomic_t ring_flush;     /* node_lost: ring_flush_to 까지 버린다 */
+static atomic_t ring_flush_to;
+
+static struct
+{
+    struct bt_conn *conn;
+    uint16_t handle;
+    atomic_t seq_valid;
+    uint16_t next_seq;
+    int64_t start_ms;
+
+    atomic_t received;
+    atomic_t forwarded;
+    atomic_t seq_lost;
+    atomic_t overflow;
+    atomic_t oversize;  /* hub MTU 에 record 하나도 안 들어가서 버린 frame */
+} fr;
+
+static struct bt_gatt_write_params feature_write_params;
+static uint8_t feature_write_buf[sizeof(struct ble_sound_feature_packet)];
+static atomic_t feature_write_busy;
+
+static void feature_drain_handler(struct k_work *work);
+K_WORK_DELAYABLE_DEFINE(feature_drain_work, feature_drain_handler);
+
+/* relay_fwd_workq 에서만 쓴다 */
+static uint8_t feature_pdu[FEATURE_BUF_MAX];
+
+/* hub 가 bulk channel 을 열었으면 그쪽으로. 위가 relay 이면 CHAIN_DATA frame 으로만 */
+static bool feature_use_bulk(void)
+{
+    return relay_bulk_ready(RELAY_BULK_LINK_HUB) && !relay_chain_upstream();
+}
+
+static int feature_notify(const void *data, uint16_t len)
+{
+    if (feature_use_bulk()) {
+        return relay_bulk_send(RELAY_BULK_LINK_HUB, RELAY_BULK_FEATURE, data, len);
+    }
+    return bt_sound_notify_feature(data, len);
+}
+
+static uint32_t feature_ring_used(void)
+{
+    return (uint32_t)atomic_get(&ring_head) - (uint32_t)atomic_get(&ring_tail);
+}
+
+/* hub MTU 기준 bulk 하나에 들어가는 frame 수. 0 이면 record 하나도 들어가지 않는다 */
+static uint8_t feature_records_per_batch(void)
+{
+    struct bt_conn *hub = ble_relay_hub_conn();
+    int room;
+
+    if (!hub) {
+        return 1;
+    }
+    /* 작은 MTU 에서 header 를 빼면 음수가 될 수 있으므로 signed 로 계산 */
+    if (feature_use_bulk()) {
+        room = (int)relay_bulk_payload_max(RELAY_BULK_LINK_HUB) -
+               (int)sizeof(struct ble_sound_feature_bulk_hdr) - RELAY_RX_STAMP_SIZE;
+    } else {
+        room = MIN((int)bt_gatt_get_mtu(hub) - FEATURE_ATT_NOTIFY_OVERHEAD, FEATURE_PDU_MAX) -
+               (int)sizeof(struct ble_sound_feature_bulk_hdr) - RELAY_RX_STAMP_SIZE -
+               (int)relay_chain_overhead();
+    }
+    if (room < (int)sizeof(struct ble_sound_feature_record)) {
+        return 0;
+    }
+    return MIN(room / sizeof(struct ble_sound_feature_record), UINT8_MAX);
+}
+
+static void feature_session_start(void)
+{
+    atomic_clear(&fr.seq_valid);
+    atomic_clear(&fr.received);
+    atomic_clear(&fr.forwarded);
+    atomic_clear(&fr.seq_lost);
+    atomic_clear(&fr.overflow);
+    atomic_clear(&fr.oversize);
+    fr.start_ms = k_uptime_get();
+}
+
+static void feature_send_report(void)
+{
+    struct ble_sound_feature_report_packet report = {
+        .cmd = BLE_FEATURE_COLLECTION_CMD_REPORT,
+        .received = (uint32_t)atomic_get(&fr.received),
+        .forwarded = (uint32_t)atomic_get(&fr.forwarded),
+        .seq_lost = (uint32_t)atomic_get(&fr.seq_lost),
+        .overflow = (uint32_t)atomic_get(&fr.overflow),
+    };
+    int64_t elapsed_ms = MAX(k_uptime_get() - fr.start_ms, 1);
+
+    LOG_INF("[FEATURE] session done: %u frames in %u ms, %u forwarded, %u lost (node), %u overflow, "
+            "%u too big for MTU", report.received, (uint32_t)elapsed_ms, report.forwarded,
+            report.seq_lost, report.overflow, (uint32_t)atomic_get(&fr.oversize));
+
+    (void)feature_notify(&report, sizeof(report));
+}
+
+/* tail 부터 연속된 DATA frame 을 최대 max 개 bulk 로 보낸다. 보낸 개수 또는 음수 errno */
+static int feature_send_bulk(uint32_t tail, uint32_t head, uint8_t max)
+{
+    uint8_t *pdu = feature_pdu;
+    struct ble_sound_feature_bulk_hdr *hdr = (struct ble_sound_feature_bulk_hdr *)pdu;
+    struct ble_sound_feature_record *rec = (struct ble_sound_feature_record *)&pdu[sizeof(*hdr)];
+    uint8_t count = 0;
+    uint16_t len;
+    int err;
+
+    max = MIN(max, FEATURE_BULK_MAX / sizeof(*rec));
+#if defined(CONFIG_RELAY_RX_TIMESTAMP)
+    /* bulk 의 첫 frame 수신 시각. 나머지는 node 의 frame 주기로 hub 가 계산 */
+    uint32_t stamp = ring_stamp[tail % FEATURE_RING_SIZE];
+#endif
+
+    while (tail != head && count < max) {
+        const struct ble_sound_feature_packet *p = &ring[tail % FEATURE_RING_SIZE];
+
+        if (p->cmd != BLE_FEATURE_COLLECTION_CMD_DATA) {
+            break;
+        }
+        rec[count].seq = p->seq;
+        memcpy(rec[count].data, p->data, sizeof(rec[count].data));
+        count++;
+        tail++;
+    }
+
+    hdr->cmd = BLE_FEATURE_COLLECTION_CMD_BULK;
+    hdr->count = count;
+
+    len = sizeof(*hdr) + count * sizeof(*rec);
+#if defined(CONFIG_RELAY_RX_TIMESTAMP)
+    sys_put_le32(stamp, &pdu[len]);
+#endif
+    err = feature_notify(pdu, len + RELAY_RX_STAMP_SIZE);
+    return err ? err : count;
+}
+
+/* hub MTU 에 record 하나도 안 들어감: tail 부터 연속된 DATA frame 을 세고 버린다 */
+static int feature_drop_oversize(uint32_t tail, uint32_t head)
+{
+    int count = 0;
+
+    while (tail != head && ring[tail % FEATURE_RING_SIZE].cmd == BLE_FEATURE_COLLECTION_CMD_DATA) {
+        relay_stats_tx(RELAY_STREAM_SOUND_FEATURE, -EMSGSIZE);
+        count++;
+        tail++;
+    }
+
+    atomic_add(&fr.oversize, count);
+    LOG_WRN("[FEATURE] hub MTU %u too small for a record, %d frames dropped",
+            ble_relay_hub_conn() ? bt_gatt_get_mtu(ble_relay_hub_conn()) : 0, count);
+    return count;
+}
+
+static void feature_drain_handler(struct k_work *work)
+{
+    uint32_t tail = (uint32_t)atomic_get(&ring_tail);
+    uint32_t head = (uint32_t)atomic_get(&ring_head);
+    uint8_t per_batch = feature_records_per_batch();
+
+    while (true) {
+        const struct ble_sound_feature_packet *p;
+        int sent;
+
+        if (atomic_clear(&ring_flush)) {
+            uint32_t to = (uint32_t)atomic_get(&ring_flush_to);
+
+            if ((int32_t)(to - tail) > 0) {
+                tail = to;
+                atomic_set(&ring_tail, (atomic_val_t)tail);
+            }
+        }
+        if (tail == head) {
+            break;
+        }
+
+        p = &ring[tail % FEATURE_RING_SIZE];
+        if (p->cmd == BLE_FEATURE_COLLECTION_CMD_DATA && per_batch == 0) {
+            tail += feature_drop_oversize(tail, head);
+            atomic_set(&ring_tail, (atomic_val_t)tail);
+            continue;
+        }
+        if (p->cmd == BLE_FEATURE_COLLECTION_CMD_DATA) {
+            sent = feature_send_bulk(tail, head, per_batch);
+        } else {
+            sent = feature_notify(p, ring_len[tail % FEATURE_RING_SIZE]);
+            sent = sent ? sent : 1;
+        }
+
+        if (sent == -ENOMEM) {
+            /* hub 쪽 TX buffer 부족: ring 에 그대로 두고 잠시 후 다시 */
+            k_work_reschedule_for_queue(&relay_fwd_workq, &feature_drain_work, K_MSEC(FEATURE_RETRY_MS));
+            break;
+        }
+
+        if (sent < 0) {
+            /* hub 가 구독 안 함 / 연결 없음: 그 frame 은 버린다 */
+            LOG_DBG("[FEATURE] cmd=%u seq=%u not sent (err %d)", p->cmd, p->seq, sent);
+            if (p->cmd == BLE_FEATURE_COLLECTION_CMD_DATA) {
+                relay_stats_tx(RELAY_STREAM_SOUND_FEATURE, sent);
+            }
+            sent = 1;
+        } else if (p->cmd == BLE_FEATURE_COLLECTION_CMD_DATA) {
+            atomic_add(&fr.forwarded, sent);
+            relay_stats_fwd_add(RELAY_STREAM_SOUND_FEATURE, sent);
+        } else if (p->cmd == BLE_FEATURE_COLLECTION_CMD_END) {
+            feature_send_report();
+        }
+
+        tail += sent;
+        atomic_set(&ring_tail, (atomic_val_t)tail);
+    }
+}
+
+void feature_relay_node_notify(const void *data, uint16_t len)
+{
+    const struct ble_sound_feature_packet *p = data;
+    uint32_t used = feature_ring_used();
+    uint32_t head;
+    bool is_data;
+
+    if (len < offsetof(struct ble_sound_feature_packet, data)) {
+        return;
+    }
+    is_data = (p->cmd == BLE_FEATURE_COLLECTION_CMD_DATA);
+
+    if (p->cmd == BLE_FEATURE_COLLECTION_CMD_START) {
+        feature_session_start();
+    }
+
+    if (is_data) {
+        atomic_inc(&fr.received);
+        relay_stats_rx(RELAY_STREAM_SOUND_FEATURE);
+        if (!atomic_set(&fr.seq_valid, 1)) {
+            fr.next_seq = p->seq + 1;
+        } else {
+            int16_t gap = (int16_t)(p->seq - fr.next_seq);
+
+            /* 중복 / 늦게 온 frame 은 유실이 아니고 next_seq 도 되돌리지 않는다 */
+            if (gap >= 0) {
+                atomic_add(&fr.seq_lost, gap);
+                fr.next_seq = p->seq + 1;
+            } else {
+                LOG_DBG("[FEATURE] seq=%u behind %u", p->seq, fr.next_seq);
+            }
+        }
+    }
+
+    if (used >= FEATURE_RING_SIZE - (is_data ? FEATURE_RING_CTRL_RESERVE : 0)) {
+        if (is_data) {
+            atomic_inc(&fr.overflow);
+            relay_stats_tx(RELAY_STREAM_SOUND_FEATURE, -ENOMEM);
+        } else {
+            LOG_WRN("[FEATURE] ring full, cmd=%u dropped", p->cmd);
+        }
+        k_work_reschedule_for_queue(&relay_fwd_workq, &feature_drain_work, K_NO_WAIT);
+        return;
+    }
+
+    head = (uint32_t)atomic_get(&ring_head);
+    memset(&ring[head % FEATURE_RING_SIZE], 0, sizeof(ring[0]));
+    memcpy(&ring[head % FEATURE_RING_SIZE], data, MIN(len, sizeof(ring[0])));
+    ring_len[head % FEATURE_RING_SIZE] = MIN(len, sizeof(ring[0]));
+#if defined(CONFIG_RELAY_RX_TIMESTAMP)
+    ring_stamp[head % FEATURE_RING_SIZE] = clock_rx_stamp();
+#endif
+    atomic_set(&ring_head, (atomic_val_t)(head + 1));
+    relay_stats_queue_level(RELAY_QUEUE_FEATURE_RING, used + 1);
+
+    if (!is_data || used + 1 >= feature_records_per_batch()) {
+        /* bulk 하나가 찼거나 control frame: 바로 보낸다 */
+        k_work_reschedule_for_queue(&relay_fwd_workq, &feature_drain_work, K_NO_WAIT);
+    } else {
+        /* 덜 찬 bulk 는 최대 CONFIG_RELAY_FEATURE_BATCH_DELAY_MS 기다린다 */
+        k_work_schedule_for_queue(&relay_fwd_workq, &feature_drain_work, K_MSEC(CONFIG_RELAY_FEATURE_BATCH_DELAY_MS));
+    }
+}
+
+/* ----------------- hub -> relay -> node ----------------- */
+
+static void feature_write_rsp(struct bt_conn *conn, uint8_t att_err, struct bt_gatt_write_params *params)
+{
+    if (att_err) {
+        LOG_WRN("[FEATURE] node write failed (att err 0x%02x)", att_err);
+    }
+    atomic_clear(&feature_write_busy);
+}
+
+int feature_relay_hub_write(const void *data, uint16_t len)
+{
+    const uint8_t *cmd = data;
+    int err;
+
+    if (!fr.conn || !fr.handle) {
+        return -ENOTCONN;
+    }
+    if (len == 0 || len > sizeof(feature_write_buf)) {
+        return -EINVAL;
+    }
+    if (atomic_set(&feature_write_busy, 1)) {
+        return -EBUSY;
+    }
+
+    if (cmd[0] == BLE_FEATURE_COLLECTION_CMD_START) {
+        feature_session_start();
+    }
+
+    memcpy(feature_write_buf, data, len);
+    feature_write_params.func = feature_write_rsp;
+    feature_write_params.handle = fr.handle;
+    feature_write_params.offset = 0;
+    feature_write_params.data = feature_write_buf;
+    feature_write_params.length = len;
+
+    err = bt_gatt_write(fr.conn, &feature_write_params);
+    if (err) {
+        atomic_clear(&feature_write_busy);
+        LOG_WRN("[FEATURE] forward cmd=%u to node failed (err %d)", cmd[0], err);
+    }
+    return err;
+}
+
+void feature_relay_node_ready(struct bt_conn *conn, uint16_t value_handle)
+{
+    fr.conn = conn;
+    fr.handle = value_handle;
+    atomic_clear(&feature_write_busy);
+}
+
+void feature_relay_node_lost(void)
+{
+    fr.conn = NULL;
+    fr.handle = 0;
+
+    if (atomic_get(&fr.received)) {
+        LOG_INF("[FEATURE] node lost: %u frames received, %u forwarded, %u dropped in ring",
+                (uint32_t)atomic_get(&fr.received), (uint32_t)atomic_get(&fr.forwarded),
+                feature_ring_used());
+    }
+    /* drain 이 돌고 있을 수 있으니 tail 은 drain 이 옮긴다 */
+    atomic_set(&ring_flush_to, atomic_get(&ring_head));
+    atomic_set(&ring_flush, 1);
+    k_work_reschedule_for_queue(&relay_fwd_workq, &feature_drain_work, K_NO_WAIT);
+    atomic_clear(&fr.seq_valid);
+}
+
+static void feature_stream_ready(struct bt_conn *conn, uint16_t value_handle, uint8_t properties)
+{
+    /* rediscover 로 같은 handle 을 다시 찾았으면 그대로 */
+    if (conn == fr.conn && value_handle == fr.handle) {
+        return;
+    }
+    feature_relay_node_ready(conn, value_handle);
+}
+
+static int feature_stream_notify(const void *data, uint16_t len)
+{
+    /* mel frame 단위 stream -> ring buffer -> MTU 단위 bulk */
+    feature_relay_node_notify(data, len);
+    return 0;
+}
+
+NODE_STREAM_DEFINE(sound_feature, BT_UUID_CHRC_SOUND_FEATURE, RELAY_STREAM_SOUND_FEATURE,
+                   .ready = feature_stream_ready,
+                   .notify = feature_stream_notify,
+                   .lost = feature_relay_node_lost);
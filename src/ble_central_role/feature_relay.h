@@ -0,0 +1,47 @@
+#ifndef _FEATURE_RELAY_H_
+#define _FEATURE_RELAY_H_
+
+#include <stdint.h>
+#include <zephyr/bluetooth/conn.h>
+
+/** @brief Sound feature collection relay (DE&N node -> relay -> SLIMHUB).
+ *
+ * The node notifies one struct ble_sound_feature_packet per mel frame.
+ *  - DATA frames are stored in a ring buffer of CONFIG_RELAY_FEATURE_RING_FRAMES
+ *    frames and sent to the hub as BLE_FEATURE_COLLECTION_CMD_BULK batches
+ *    (struct ble_sound_feature_bulk_hdr + records), as many as fit in the MTU.
+ *  - START / FINISH / END are forwarded as they are, in order with the data.
+ *  - After END the relay sends a BLE_FEATURE_COLLECTION_CMD_REPORT with the
+ *    session frame counts and losses (struct ble_sound_feature_report_packet).
+ */
+
+/**
+ * @brief The node's sound FEATURE characteristic was discovered.
+ *
+ * @param conn is the node connection.
+ * @param value_handle is the FEATURE characteristic value handle.
+ */
+void feature_relay_node_ready(struct bt_conn *conn, uint16_t value_handle);
+
+/** @brief The node connection is gone. Buffered frames are dropped. */
+void feature_relay_node_lost(void);
+
+/**
+ * @brief Notification from the node's FEATURE characteristic (BT RX thread).
+ *
+ * @param data is a struct ble_sound_feature_packet.
+ * @param len is the notification length.
+ */
+void feature_relay_node_notify(const void *data, uint16_t len);
+
+/**
+ * @brief Feature collection command written by the hub (START / FINISH).
+ *
+ * @param data is the written value, forwarded to the node unchanged.
+ * @param len is the written length.
+ *
+ * @retval 0 on success, negative errno otherwise.
+ */
+int feature_relay_hub_write(const void *data, uint16_t len);
+
+#endif
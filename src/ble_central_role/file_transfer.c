@@ -0,0 +1,666 @@
+/* file_transfer.c
+ *
+ * 목적:
+ *  - config service 의 FILE_TRANSFER 특성으로 들어오는 파일을 SD 카드에 저장한다.
+ *  - 예전 구현은 128 byte frame 마다 파일을 open/close 하고 frame 마다 ACK 했다.
+ *    여기서는
+ *      1) DATA 는 write-without-response 로 받고 N frame 마다 한 번 ACK (sliding window)
+ *      2) 512 byte 배수 버퍼 2 개를 번갈아 채우고, 꽉 찬 버퍼는 writer thread 가 SD 에 쓴다
+ *      3) 파일은 START ~ END 동안 계속 열어 둔다
+ *      4) hub 연결이 끊기면 flush 해 두고 RESUME 으로 이어 받는다
+ */
+#include "file_transfer.h"
+
+#include <string.h>
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/fs/fs.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/logging/log.h>
+
+#include "config_service.h"
+#include "sdcard.h"
+#include "relay_stats.h"
+#include "relay_bulk.h"
+
+LOG_MODULE_REGISTER(file_transfer, LOG_LEVEL_INF);
+
+#if defined(CONFIG_FILE_SYSTEM)
+
+#define FT_SD_BLOCK_SIZE        512
+#define FT_BUF_SIZE             CONFIG_RELAY_FT_BUF_SIZE
+#define FT_ACK_WINDOW           CONFIG_RELAY_FT_ACK_WINDOW
+#define FT_FILE_NAME_LEN        40
+#define FT_PACKET_HDR_SIZE      offsetof(struct ble_file_transfer_data_packet, data)
+
+BUILD_ASSERT(FT_BUF_SIZE % FT_SD_BLOCK_SIZE == 0, "FT buffer must be a multiple of the SD block size");
+BUILD_ASSERT(FT_BUF_SIZE % BLE_FILE_TRANSFER_FRAME_SIZE == 0, "FT buffer must hold whole frames");
+BUILD_ASSERT(FT_SD_BLOCK_SIZE % BLE_FILE_TRANSFER_FRAME_SIZE == 0, "SD block must hold whole frames");
+
+enum ft_state
+{
+    FT_STATE_IDLE,
+    FT_STATE_OPENING,
+    FT_STATE_RECEIVING,
+    FT_STATE_PAUSED,    /* hub 연결 끊김, RESUME 대기 */
+    FT_STATE_CLOSING,
+};
+
+enum ft_job_op
+{
+    FT_JOB_OPEN,
+    FT_JOB_WRITE,
+    FT_JOB_END,
+    FT_JOB_PAUSE,
+    FT_JOB_RESUME,
+    FT_JOB_REMOVE,
+};
+
+struct ft_job
+{
+    uint8_t op;
+    uint8_t buf_idx;
+    uint16_t len;
+};
+
+struct ft_buf
+{
+    atomic_t busy;      /* writer thread 가 SD 에 쓰는 중 */
+    uint16_t len;
+    uint8_t data[FT_BUF_SIZE] __aligned(4);
+};
+
+/* state / next_seq / unacked / gap_acked / fill / bytes 는 BT RX thread 와 writer thread 가
+ * 같이 쓰므로 ft.lock 안에서만 바꾼다. ACK 는 lock 밖에서 보낸다 */
+static struct
+{
+    struct k_spinlock lock;
+    enum ft_state state;
+    char file_name[FT_FILE_NAME_LEN];
+    char open_name[FT_FILE_NAME_LEN];   /* fp 가 열고 있는 파일 */
+    struct fs_file_t fp;
+    bool fp_open;
+
+    uint16_t next_seq;      /* 다음에 받을 DATA seq */
+    uint16_t unacked;       /* 마지막 ACK 이후 받은 frame 수 */
+    bool gap_acked;         /* gap 에 대한 dup ACK 를 이미 보냈는지 */
+    atomic_t stalled;       /* 버퍼가 모자라 frame 을 버렸음 -> writer 가 ACK 로 재전송 유도 */
+
+    uint8_t fill;           /* RX 가 채우는 버퍼 index */
+    uint32_t bytes;
+    int64_t start_ms;
+} ft;
+
+static struct ft_buf ft_bufs[2];
+
+K_MSGQ_DEFINE(ft_job_msgq, sizeof(struct ft_job), 8, 4);
+
+static void ft_send_ack(uint8_t cmd, uint16_t seq)
+{
+    struct ble_file_transfer_ack_packet ack_packet = {
+        .cmd = cmd,
+        .seq = seq,
+    };
+
+    /* hub 가 bulk channel 을 열었으면 ACK 도 그쪽으로 */
+    int err = relay_bulk_send(RELAY_BULK_LINK_HUB, RELAY_BULK_FILE_TRANSFER,
+                              &ack_packet, sizeof(ack_packet));
+    /* bulk 가 없거나 TX buffer 가 다 나가 있으면 GATT 로. ACK 를 버리면 hub 가 멈춘다 */
+    if (err == -ENOTCONN || err == -ENOMEM) {
+        err = bt_config_file_transfer(&ack_packet, sizeof(ack_packet));
+    }
+    if (err) {
+        LOG_DBG("[FT] ack cmd=%u seq=%u not sent (err %d)", cmd, seq, err);
+    }
+}
+
+static int ft_post(uint8_t op, uint8_t buf_idx, uint16_t len)
+{
+    struct ft_job job = {
+        .op = op,
+        .buf_idx = buf_idx,
+        .len = len,
+    };
+
+    int err = k_msgq_put(&ft_job_msgq, &job, K_NO_WAIT);
+    if (err) {
+        LOG_WRN("[FT] job queue full (op %u)", op);
+    }
+    relay_stats_queue_level(RELAY_QUEUE_FT_JOBS, k_msgq_num_used_get(&ft_job_msgq));
+    return err;
+}
+
+/* ft.lock 안에서 */
+static void ft_reset_buffers(void)
+{
+    for (int i = 0; i < ARRAY_SIZE(ft_bufs); i++) {
+        ft_bufs[i].len = 0;
+        atomic_set(&ft_bufs[i].busy, 0);
+    }
+    ft.fill = 0;
+    ft.unacked = 0;
+    ft.gap_acked = false;
+    atomic_set(&ft.stalled, 0);
+}
+
+static int ft_set_file_name(const struct ble_file_transfer_data_packet *packet, uint16_t len)
+{
+    uint16_t name_len = MIN(packet->size, (uint16_t)(len - FT_PACKET_HDR_SIZE));
+
+    if (name_len == 0) {
+        return -EINVAL;
+    }
+
+    snprintk(ft.file_name, sizeof(ft.file_name), SDCARD_PATH_PREFIX "%.*s",
+             (int)name_len, (const char *)packet->data);
+    return 0;
+}
+
+/* ----------------- writer thread (SD 접근은 전부 여기서) ----------------- */
+
+static int ft_sd_write(const uint8_t *data, uint16_t len)
+{
+    ssize_t ret;
+
+    if (k_mutex_lock(&sdcard_mutex, K_SECONDS(3))) {
+        LOG_ERR("[FT] Failed to lock sdcard mutex");
+        return -EBUSY;
+    }
+
+    ret = fs_write(&ft.fp, data, len);
+
+    k_mutex_unlock(&sdcard_mutex);
+
+    if (ret < 0) {
+        return (int)ret;
+    }
+    return (ret == len) ? 0 : -EIO;
+}
+
+static void ft_file_close(void)
+{
+    if (ft.fp_open) {
+        k_mutex_lock(&sdcard_mutex, K_FOREVER);
+        fs_close(&ft.fp);
+        k_mutex_unlock(&sdcard_mutex);
+        ft.fp_open = false;
+    }
+}
+
+static int ft_file_open(bool truncate)
+{
+    int ret;
+
+    ret = mount_sdcard();
+    if (ret) {
+        return ret;
+    }
+
+    if (k_mutex_lock(&sdcard_mutex, K_SECONDS(3))) {
+        return -EBUSY;
+    }
+
+    if (truncate) {
+        /* 기존 파일 삭제 → 새 파일 생성 (덮어쓰기 효과) */
+        fs_unlink(ft.file_name);
+    }
+
+    fs_file_t_init(&ft.fp);
+    ret = fs_open(&ft.fp, ft.file_name, FS_O_CREATE | FS_O_RDWR);
+    if (ret == 0) {
+        ft.fp_open = true;
+        memcpy(ft.open_name, ft.file_name, sizeof(ft.open_name));
+    }
+
+    k_mutex_unlock(&sdcard_mutex);
+    return ret;
+}
+
+static uint16_t ft_next_seq_get(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&ft.lock);
+    uint16_t seq = ft.next_seq;
+
+    k_spin_unlock(&ft.lock, key);
+    return seq;
+}
+
+static void ft_fail(uint16_t seq, int err)
+{
+    k_spinlock_key_t key = k_spin_lock(&ft.lock);
+
+    /* RX 가 더 받지 않게 먼저 IDLE 로, 그 다음 파일을 닫는다 */
+    ft.state = FT_STATE_IDLE;
+    k_spin_unlock(&ft.lock, key);
+
+    LOG_ERR("[FT] %s failed at seq %u (err %d)", ft.file_name, seq, err);
+    ft_file_close();
+    ft_send_ack(BLE_FILE_TRANSFER_CMD_FAILED, seq);
+}
+
+static void ft_job_open(void)
+{
+    k_spinlock_key_t key;
+    int ret;
+
+    /* PAUSED 상태로 남아 있던 이전 transfer 는 버린다 */
+    ft_file_close();
+    ret = ft_file_open(true);
+
+    if (ret) {
+        ft_fail(0, ret);
+        return;
+    }
+
+    key = k_spin_lock(&ft.lock);
+    ft_reset_buffers();
+    ft.next_seq = 0;
+    ft.bytes = 0;
+    ft.start_ms = k_uptime_get();
+    ft.state = FT_STATE_RECEIVING;
+    k_spin_unlock(&ft.lock, key);
+
+    LOG_INF("[FT] File transfer start: %s (window %d, buf %d)", ft.file_name, FT_ACK_WINDOW, FT_BUF_SIZE);
+    ft_send_ack(BLE_FILE_TRANSFER_CMD_START, 0);
+}
+
+static void ft_job_write(const struct ft_job *job)
+{
+    struct ft_buf *b = &ft_bufs[job->buf_idx];
+    int ret = ft_sd_write(b->data, job->len);
+    k_spinlock_key_t key;
+    uint16_t seq;
+
+    b->len = 0;
+    atomic_set(&b->busy, 0);
+
+    if (ret) {
+        ft_fail(ft_next_seq_get(), ret);
+        return;
+    }
+
+    /* RX 가 버퍼 부족으로 frame 을 버렸다면 여기서 다시 당겨온다 */
+    if (atomic_cas(&ft.stalled, 1, 0)) {
+        key = k_spin_lock(&ft.lock);
+        ft.unacked = 0;
+        seq = ft.next_seq - 1;
+        k_spin_unlock(&ft.lock, key);
+        ft_send_ack(BLE_FILE_TRANSFER_CMD_DATA, seq);
+    }
+}
+
+/* 채우던 버퍼의 남은 데이터를 쓰고 sync. state 가 CLOSING 이라 RX 는 버퍼를 건드리지 않는다 */
+static int ft_flush_fill(void)
+{
+    struct ft_buf *b = &ft_bufs[ft.fill];
+    int ret = 0;
+
+    if (b->len) {
+        ret = ft_sd_write(b->data, b->len);
+        b->len = 0;
+    }
+
+    if (!ret) {
+        k_mutex_lock(&sdcard_mutex, K_FOREVER);
+        ret = fs_sync(&ft.fp);
+        k_mutex_unlock(&sdcard_mutex);
+    }
+    return ret;
+}
+
+static void ft_job_end(void)
+{
+    k_spinlock_key_t key;
+    uint32_t bytes;
+    uint16_t seq;
+    int ret = ft_flush_fill();
+
+    if (ret) {
+        ft_fail(ft_next_seq_get(), ret);
+        return;
+    }
+
+    ft_file_close();
+
+    key = k_spin_lock(&ft.lock);
+    ft.state = FT_STATE_IDLE;
+    seq = ft.next_seq;
+    bytes = ft.bytes;
+    k_spin_unlock(&ft.lock, key);
+
+    LOG_INF("[FT] File transfer end: %s, %u bytes / %u frames in %u ms",
+            ft.file_name, bytes, seq, (uint32_t)(k_uptime_get() - ft.start_ms));
+
+    ft_send_ack(BLE_FILE_TRANSFER_CMD_END, seq);
+}
+
+static void ft_job_pause(void)
+{
+    k_spinlock_key_t key;
+    uint16_t seq;
+
+    if (ft_flush_fill()) {
+        LOG_WRN("[FT] flush on link loss failed, resume will restart earlier");
+    }
+
+    key = k_spin_lock(&ft.lock);
+    ft.state = FT_STATE_PAUSED;
+    seq = ft.next_seq;
+    k_spin_unlock(&ft.lock, key);
+
+    LOG_INF("[FT] %s paused at seq %u", ft.file_name, seq);
+}
+
+static void ft_job_resume(void)
+{
+    k_spinlock_key_t key;
+    uint16_t seq;
+    off_t size;
+    off_t aligned;
+    int ret = 0;
+
+    if (ft.fp_open && strcmp(ft.open_name, ft.file_name) != 0) {
+        /* 다른 파일로 RESUME: 이전 transfer 는 버린다 */
+        ft_file_close();
+    }
+
+    if (!ft.fp_open) {
+        /* 재부팅 등으로 상태가 없으면 기존 파일 끝에서 이어 쓴다 */
+        ret = ft_file_open(false);
+        ft.bytes = 0;
+        ft.start_ms = k_uptime_get();
+    }
+    if (ret) {
+        ft_fail(0, ret);
+        return;
+    }
+
+    k_mutex_lock(&sdcard_mutex, K_FOREVER);
+    ret = fs_seek(&ft.fp, 0, FS_SEEK_END);
+    size = fs_tell(&ft.fp);
+    aligned = ROUND_DOWN(MAX(size, 0), FT_SD_BLOCK_SIZE);
+    if (!ret && size >= 0 && aligned != size) {
+        /* 512 byte 경계로 잘라서 이후 쓰기도 block 정렬을 유지 */
+        ret = fs_truncate(&ft.fp, aligned);
+    }
+    if (!ret) {
+        ret = fs_seek(&ft.fp, aligned, FS_SEEK_SET);
+    }
+    k_mutex_unlock(&sdcard_mutex);
+
+    if (ret || size < 0) {
+        ft_fail(0, ret ? ret : (int)size);
+        return;
+    }
+
+    seq = aligned / BLE_FILE_TRANSFER_FRAME_SIZE;
+    key = k_spin_lock(&ft.lock);
+    ft_reset_buffers();
+    ft.next_seq = seq;
+    ft.state = FT_STATE_RECEIVING;
+    k_spin_unlock(&ft.lock, key);
+
+    LOG_INF("[FT] %s resume from seq %u (%u bytes kept)", ft.file_name, seq, (uint32_t)aligned);
+    ft_send_ack(BLE_FILE_TRANSFER_CMD_RESUME, seq);
+}
+
+static void ft_job_remove(void)
+{
+    k_spinlock_key_t key;
+    int ret = mount_sdcard();
+
+    if (ft.fp_open && strcmp(ft.open_name, ft.file_name) == 0) {
+        ft_file_close();
+    }
+
+    if (!ret) {
+        k_mutex_lock(&sdcard_mutex, K_FOREVER);
+        ret = fs_unlink(ft.file_name);
+        k_mutex_unlock(&sdcard_mutex);
+    }
+
+    /* 다른 파일의 PAUSED transfer 는 그대로 둔다 (RESUME 가능) */
+    key = k_spin_lock(&ft.lock);
+    ft.state = ft.fp_open ? FT_STATE_PAUSED : FT_STATE_IDLE;
+    k_spin_unlock(&ft.lock, key);
+
+    if (ret < 0) {
+        LOG_WRN("[FT] Failed to remove file: %s (err %d)", ft.file_name, ret);
+        ft_send_ack(BLE_FILE_TRANSFER_CMD_FAILED, 0);
+        return;
+    }
+
+    LOG_INF("[FT] File removed: %s", ft.file_name);
+    ft_send_ack(BLE_FILE_TRANSFER_CMD_REMOVE, 0);
+}
+
+static void ft_writer_thread(void *p1, void *p2, void *p3)
+{
+    struct ft_job job;
+
+    while (1) {
+        k_msgq_get(&ft_job_msgq, &job, K_FOREVER);
+
+        switch (job.op) {
+        case FT_JOB_OPEN:
+            ft_job_open();
+            break;
+        case FT_JOB_WRITE:
+            ft_job_write(&job);
+            break;
+        case FT_JOB_END:
+            ft_job_end();
+            break;
+        case FT_JOB_PAUSE:
+            ft_job_pause();
+            break;
+        case FT_JOB_RESUME:
+            ft_job_resume();
+            break;
+        case FT_JOB_REMOVE:
+            ft_job_remove();
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+K_THREAD_DEFINE(ft_writer_tid, CONFIG_RELAY_FT_THREAD_STACK_SIZE,
+                ft_writer_thread, NULL, NULL, NULL,
+                CONFIG_RELAY_FT_THREAD_PRIORITY, 0, 0);
+
+/* ----------------- RX 경로 (BT RX thread, 블로킹 금지) ----------------- */
+
+static void ft_rx_data(const struct ble_file_transfer_data_packet *packet, uint16_t len)
+{
+    struct ft_buf *b;
+    uint16_t size = packet->size;
+    uint8_t ack_cmd = BLE_FILE_TRANSFER_CMD_DATA;
+    uint16_t ack_seq = 0;
+    bool ack = false;
+    k_spinlock_key_t key;
+
+    if (size > BLE_FILE_TRANSFER_FRAME_SIZE || len < FT_PACKET_HDR_SIZE + size) {
+        LOG_WRN("[FT] malformed frame seq %u (size %u, len %u)", packet->seq, size, len);
+        return;
+    }
+
+    key = k_spin_lock(&ft.lock);
+
+    if (ft.state != FT_STATE_RECEIVING) {
+        goto out;
+    }
+
+    if (packet->seq != ft.next_seq) {
+        /* 순서가 어긋난 frame 은 버리고, gap 당 한 번만 dup ACK */
+        if (!ft.gap_acked) {
+            ft.gap_acked = true;
+            ft.unacked = 0;
+            ack = true;
+            ack_seq = ft.next_seq - 1;
+        }
+        goto out;
+    }
+
+    b = &ft_bufs[ft.fill];
+    if (atomic_get(&b->busy)) {
+        /* SD 가 따라오지 못함: ACK 하지 않고 버림. writer 가 끝나면 재전송 요청 */
+        atomic_set(&ft.stalled, 1);
+        goto out;
+    }
+
+    memcpy(&b->data[b->len], packet->data, size);
+    b->len += size;
+    ft.bytes += size;
+    ft.next_seq++;
+    ft.gap_acked = false;
+
+    if (b->len + BLE_FILE_TRANSFER_FRAME_SIZE > FT_BUF_SIZE) {
+        atomic_set(&b->busy, 1);
+        if (ft_post(FT_JOB_WRITE, ft.fill, b->len)) {
+            /* 이 버퍼는 쓰지 못함: 파일은 열어 둔 채 멈추고 hub 는 RESUME 으로 이어 보낸다 */
+            atomic_set(&b->busy, 0);
+            ft.state = FT_STATE_PAUSED;
+            ack = true;
+            ack_cmd = BLE_FILE_TRANSFER_CMD_FAILED;
+            ack_seq = packet->seq;
+            goto out;
+        }
+        ft.fill ^= 1;
+    }
+
+    if (++ft.unacked >= FT_ACK_WINDOW) {
+        ft.unacked = 0;
+        ack = true;
+        ack_seq = packet->seq;
+    }
+
+out:
+    k_spin_unlock(&ft.lock, key);
+    if (ack) {
+        ft_send_ack(ack_cmd, ack_seq);
+    }
+}
+
+void process_file_transfer_write(const void *buf, uint16_t len)
+{
+    const struct ble_file_transfer_data_packet *packet = buf;
+    k_spinlock_key_t key;
+
+    if (len < FT_PACKET_HDR_SIZE) {
+        return;
+    }
+
+    switch (packet->cmd)
+    {
+    case BLE_FILE_TRANSFER_CMD_DATA:
+        ft_rx_data(packet, len);
+        break;
+
+    case BLE_FILE_TRANSFER_CMD_START:
+    case BLE_FILE_TRANSFER_CMD_RESUME:
+    case BLE_FILE_TRANSFER_CMD_REMOVE:
+    {
+        enum ft_state prev;
+        uint8_t op = (packet->cmd == BLE_FILE_TRANSFER_CMD_RESUME) ? FT_JOB_RESUME :
+                     (packet->cmd == BLE_FILE_TRANSFER_CMD_START) ? FT_JOB_OPEN : FT_JOB_REMOVE;
+
+        /* writer thread 가 file_name / fp 를 쓰지 않을 때만 (IDLE, 또는 끊겨서 멈춘 PAUSED).
+         * 진행 중인 transfer 는 END 로 끝내야 한다. 확인과 OPENING 전환은 한 번에 */
+        key = k_spin_lock(&ft.lock);
+        prev = ft.state;
+        if (prev == FT_STATE_IDLE || prev == FT_STATE_PAUSED) {
+            ft.state = FT_STATE_OPENING;
+        }
+        k_spin_unlock(&ft.lock, key);
+
+        if (prev != FT_STATE_IDLE && prev != FT_STATE_PAUSED) {
+            ft_send_ack(BLE_FILE_TRANSFER_CMD_FAILED, 0);
+            break;
+        }
+
+        if (ft_set_file_name(packet, len) || ft_post(op, 0, 0)) {
+            key = k_spin_lock(&ft.lock);
+            ft.state = prev;
+            k_spin_unlock(&ft.lock, key);
+            ft_send_ack(BLE_FILE_TRANSFER_CMD_FAILED, 0);
+        }
+        break;
+    }
+
+    case BLE_FILE_TRANSFER_CMD_END:
+    {
+        bool receiving;
+        uint16_t seq;
+
+        key = k_spin_lock(&ft.lock);
+        receiving = (ft.state == FT_STATE_RECEIVING);
+        if (receiving) {
+            ft.state = FT_STATE_CLOSING;
+        }
+        seq = ft.next_seq;
+        k_spin_unlock(&ft.lock, key);
+
+        if (!receiving) {
+            ft_send_ack(BLE_FILE_TRANSFER_CMD_FAILED, seq);
+            break;
+        }
+        if (ft_post(FT_JOB_END, 0, 0)) {
+            /* hub 가 END 를 다시 보내면 된다 */
+            key = k_spin_lock(&ft.lock);
+            ft.state = FT_STATE_RECEIVING;
+            k_spin_unlock(&ft.lock, key);
+            ft_send_ack(BLE_FILE_TRANSFER_CMD_FAILED, seq);
+        }
+        break;
+    }
+
+    default:
+        LOG_WRN("[FT] unknown cmd %u", packet->cmd);
+        break;
+    }
+}
+
+void file_transfer_link_lost(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&ft.lock);
+    bool receiving = (ft.state == FT_STATE_RECEIVING);
+
+    if (receiving) {
+        ft.state = FT_STATE_CLOSING;
+    }
+    k_spin_unlock(&ft.lock, key);
+
+    if (receiving && ft_post(FT_JOB_PAUSE, 0, 0)) {
+        /* flush 는 못 했지만 RESUME 은 SD 에 쓰인 곳부터 이어 받는다 */
+        key = k_spin_lock(&ft.lock);
+        ft.state = FT_STATE_PAUSED;
+        k_spin_unlock(&ft.lock, key);
+    }
+}
+
+#else
+
+/* file system 이 없는 build (native_sim, bsim): 저장할 곳이 없으니 명령은 모두 거절 */
+void process_file_transfer_write(const void *buf, uint16_t len)
+{
+    const struct ble_file_transfer_data_packet *packet = buf;
+    struct ble_file_transfer_ack_packet ack_packet = {
+        .cmd = BLE_FILE_TRANSFER_CMD_FAILED,
+        .seq = 0,
+    };
+
+    if (len < offsetof(struct ble_file_transfer_data_packet, data) ||
+        packet->cmd == BLE_FILE_TRANSFER_CMD_DATA) {
+        return;
+    }
+    (void)bt_config_file_transfer(&ack_packet, sizeof(ack_packet));
+}
+
+void file_transfer_link_lost(void)
+{
+}
+
+#endif /* CONFIG_FILE_SYSTEM */
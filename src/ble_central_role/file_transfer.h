@@ -0,0 +1,28 @@
+#ifndef _FILE_TRANSFER_H_
+#define _FILE_TRANSFER_H_
+
+#include <stdint.h>
+
+/** @brief Windowed file transfer engine behind the config service.
+ *
+ * Protocol (struct ble_file_transfer_data_packet / ble_file_transfer_ack_packet):
+ *  - START(name)  -> ACK{START, 0} once the file is open.
+ *  - DATA frames are sent with write-without-response, seq starting at 0.
+ *    Every frame except the last one carries BLE_FILE_TRANSFER_FRAME_SIZE bytes.
+ *  - ACK{DATA, seq} = last in-order seq accepted. Sent every
+ *    CONFIG_RELAY_FT_ACK_WINDOW frames, and immediately (once) when a gap is seen.
+ *    The hub keeps at most 2 * window frames in flight and retransmits from seq + 1
+ *    on a duplicate ACK (go-back-N).
+ *  - END -> ACK{END, frame count} after everything is on the SD card.
+ *  - RESUME(name) -> ACK{RESUME, next seq} after a disconnect. The file is cut back
+ *    to a 512 byte boundary so SD writes stay block aligned.
+ *  - REMOVE(name) -> ACK{REMOVE, 0}.
+ *  - START / RESUME / REMOVE are refused (ACK{FAILED, 0}) while a transfer is
+ *    running; only a paused one may be resumed or replaced.
+ *  - Any failure is reported as ACK{FAILED, seq}.
+ */
+
+/** @brief Hub link lost: flush buffered frames so the transfer can be resumed. */
+void file_transfer_link_lost(void);
+
+#endif
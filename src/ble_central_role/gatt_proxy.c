@@ -0,0 +1,809 @@
+/* gatt_proxy.c
+ *
+ * 목적:
+ *  - relay 가 직접 구현하지 않은 node 의 서비스를 relay GATT DB 에 그대로 복사해서
+ *    hub 가 서비스별 코드 없이 node 의 characteristic 을 쓸 수 있게 한다.
+ *  - node value handle <-> local attribute 변환 table 하나로 read / write / notify 를 처리한다.
+ *
+ * 흐름 (relay_link_workq):
+ *  node discovery 완료 -> primary service 탐색 (local 에 같은 UUID 가 있으면 제외)
+ *  -> service 별 characteristic 탐색 -> dynamic service 등록 (hub 에 Service Changed)
+ *  -> 읽을 수 있는 값들을 한 번씩 읽어서 cache
+ *
+ * hub 의 read 는 항상 cache 로 바로 답하고, TTL 이 지난 값은 뒤에서 node 를 다시 읽는다.
+ */
+#include "gatt_proxy.h"
+
+#include <string.h>
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/uuid.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/logging/log.h>
+
+#include "ble_relay_control.h"
+#include "node_write.h"
+#include "radio_airtime.h"
+#include "relay_trace.h"
+#include "relay_workq.h"
+
+LOG_MODULE_REGISTER(gatt_proxy, LOG_LEVEL_INF);
+
+#if defined(CONFIG_RELAY_GATT_PROXY)
+
+#define PROXY_MAX_SVC       CONFIG_RELAY_GATT_PROXY_MAX_SVC
+#define PROXY_MAX_CHRC      CONFIG_RELAY_GATT_PROXY_MAX_CHRC
+#define PROXY_VALUE_MAX     CONFIG_RELAY_GATT_PROXY_VALUE_MAX
+/* service 선언 1 + characteristic 마다 선언 / 값 / CCC */
+#define PROXY_MAX_ATTR      (PROXY_MAX_SVC + PROXY_MAX_CHRC * 3)
+
+/* DE&N node 는 indication 을 쓰지 않으므로 notify 만 복사한다 */
+#define PROXY_CHRC_PROPS    (BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE | \
+                             BT_GATT_CHRC_WRITE_WITHOUT_RESP | BT_GATT_CHRC_NOTIFY)
+
+union proxy_uuid
+{
+    struct bt_uuid uuid;
+    struct bt_uuid_16 u16;
+    struct bt_uuid_128 u128;
+};
+
+/* proxy_chrc.flags */
+enum
+{
+    PROXY_HUB_NOTIFY,       /* hub 가 복사본 CCC 를 켰다 */
+    PROXY_NODE_SUB,         /* node 에 구독 중 */
+    PROXY_UNSUB_PENDING,    /* node 구독 해제 중 */
+};
+
+/* gatt_proxy_value.flags */
+enum
+{
+    PROXY_VALUE_VALID,      /* 현재 node 에서 받은 값이 있다 */
+    PROXY_VALUE_REFRESH,    /* node read 대기 / 진행 중 */
+};
+
+/* handle 변환 table 의 한 항목 */
+struct proxy_chrc
+{
+    union proxy_uuid uuid;
+    struct bt_gatt_chrc decl;
+    struct _bt_gatt_ccc ccc;
+    struct bt_gatt_subscribe_params sub;
+    const struct bt_gatt_attr *attr;    /* local value attribute */
+    struct gatt_proxy_value val;        /* node value handle + cache */
+    uint8_t props;
+    atomic_t flags;
+};
+
+struct proxy_svc
+{
+    union proxy_uuid uuid;
+    struct bt_gatt_service svc;
+    uint8_t chrc_first;
+    uint8_t chrc_cnt;
+};
+
+/* discovery 결과 (등록된 table 과 비교한 뒤 반영) */
+struct proxy_found_svc
+{
+    union proxy_uuid uuid;
+    uint16_t start_handle;
+    uint16_t end_handle;
+    uint8_t chrc_first;
+    uint8_t chrc_cnt;
+};
+
+struct proxy_found_chrc
+{
+    union proxy_uuid uuid;
+    uint16_t value_handle;
+    uint8_t props;
+};
+
+enum proxy_step
+{
+    PROXY_IDLE,
+    PROXY_DISC_SVC,
+    PROXY_DISC_CHRC,
+    PROXY_APPLY,
+};
+
+static struct
+{
+    struct bt_conn *conn;
+    enum proxy_step step;
+    bool ready;                 /* conn 에 대해 table 이 맞춰졌다 */
+    uint8_t idx;                /* DISC_CHRC: service */
+    uint8_t found_svc_cnt;
+    uint8_t found_chrc_cnt;
+    uint8_t svc_cnt;            /* 등록된 것 */
+    uint8_t chrc_cnt;
+} px;
+
+static struct proxy_svc svcs[PROXY_MAX_SVC];
+static struct proxy_chrc chrcs[PROXY_MAX_CHRC];
+static struct bt_gatt_attr attrs[PROXY_MAX_ATTR];
+
+static struct proxy_found_svc found_svc[PROXY_MAX_SVC];
+static struct proxy_found_chrc found_chrc[PROXY_MAX_CHRC];
+
+static struct bt_gatt_discover_params proxy_disc_params;
+static struct bt_gatt_read_params proxy_read_params;
+static struct gatt_proxy_value *refresh_val;    /* node read 진행 중인 값 */
+
+static void proxy_work_handler(struct k_work *work);
+static void proxy_sync_work_handler(struct k_work *work);
+static void proxy_refresh_work_handler(struct k_work *work);
+K_WORK_DEFINE(proxy_work, proxy_work_handler);
+K_WORK_DEFINE(proxy_sync_work, proxy_sync_work_handler);
+K_WORK_DEFINE(proxy_refresh_work, proxy_refresh_work_handler);
+
+static void proxy_uuid_copy(union proxy_uuid *dst, const struct bt_uuid *src)
+{
+    memset(dst, 0, sizeof(*dst));
+    if (src->type == BT_UUID_TYPE_16) {
+        dst->u16 = *BT_UUID_16(src);
+    } else if (src->type == BT_UUID_TYPE_32) {
+        /* ATT 선언에는 32 bit UUID 를 못 쓴다: Bluetooth base UUID 로 128 bit 로 늘린다 */
+        dst->u128 = (struct bt_uuid_128)BT_UUID_INIT_128(
+            BT_UUID_128_ENCODE(0x00000000, 0x0000, 0x1000, 0x8000, 0x00805F9B34FB));
+        sys_put_le32(BT_UUID_32(src)->val, &dst->u128.val[12]);
+    } else if (src->type == BT_UUID_TYPE_128) {
+        dst->u128 = *BT_UUID_128(src);
+    }
+}
+
+/* ----------------- local DB ----------------- */
+
+struct local_svc_ctx
+{
+    const struct bt_uuid *uuid;
+    bool found;
+};
+
+bool gatt_proxy_is_mirrored(const struct bt_gatt_attr *attr)
+{
+    return attr >= attrs && attr < &attrs[ARRAY_SIZE(attrs)];
+}
+
+static uint8_t local_svc_cb(const struct bt_gatt_attr *attr, uint16_t handle, void *user_data)
+{
+    struct local_svc_ctx *ctx = user_data;
+
+    /* 이미 복사해 둔 service 는 relay 구현이 아니다 */
+    if (gatt_proxy_is_mirrored(attr)) {
+        return BT_GATT_ITER_CONTINUE;
+    }
+    if (!bt_uuid_cmp(attr->user_data, ctx->uuid)) {
+        ctx->found = true;
+        return BT_GATT_ITER_STOP;
+    }
+    return BT_GATT_ITER_CONTINUE;
+}
+
+static bool local_has_service(const struct bt_uuid *uuid)
+{
+    struct local_svc_ctx ctx = { .uuid = uuid };
+
+    bt_gatt_foreach_attr_type(BT_ATT_FIRST_ATTRIBUTE_HANDLE, BT_ATT_LAST_ATTRIBUTE_HANDLE,
+                              BT_UUID_GATT_PRIMARY, NULL, 0, local_svc_cb, &ctx);
+    return ctx.found;
+}
+
+/* ----------------- value cache ----------------- */
+
+/* cache 는 BT RX thread (notify / read / write 완료, hub read) 에서만 바뀐다 */
+static void proxy_value_update(struct gatt_proxy_value *v, const void *data, uint16_t len)
+{
+    v->len = MIN(len, PROXY_VALUE_MAX);
+    memcpy(v->data, data, v->len);
+    v->updated_ms = k_uptime_get_32();
+    atomic_set_bit(&v->flags, PROXY_VALUE_VALID);
+}
+
+static void proxy_value_refresh(struct gatt_proxy_value *v)
+{
+    if (!px.conn || !v->node_handle || atomic_test_and_set_bit(&v->flags, PROXY_VALUE_REFRESH)) {
+        return;
+    }
+    k_work_submit_to_queue(&relay_link_workq, &proxy_refresh_work);
+}
+
+ssize_t gatt_proxy_value_read(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                              void *buf, uint16_t len, uint16_t offset)
+{
+    struct gatt_proxy_value *v = attr->user_data;
+
+    /* node 에 물으러 갈 수 없으므로 (BT RX thread) cache 로 답하고,
+     * 오래된 값이면 다음 read 를 위해 뒤에서 node 를 읽는다.
+     * offset > 0 은 같은 long read 의 뒷부분이라 갱신하지 않는다.
+     */
+    if (!atomic_test_bit(&v->flags, PROXY_VALUE_VALID)) {
+        /* 아직 node 값이 없음: 빈 값으로 성공하지 않고 에러로 답해 hub 가 다시 읽게 한다 */
+        proxy_value_refresh(v);
+        return BT_GATT_ERR(BT_ATT_ERR_UNLIKELY);
+    }
+
+    if (offset == 0 && k_uptime_get_32() - v->updated_ms > CONFIG_RELAY_GATT_PROXY_READ_TTL_MS) {
+        proxy_value_refresh(v);
+    }
+
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, v->data, v->len);
+}
+
+/* relay 서비스 안의 gatt_proxy_value_read() characteristic (복사본 제외) */
+typedef void (*bound_func_t)(struct gatt_proxy_value *v, void *user_data);
+
+struct bound_ctx
+{
+    bound_func_t func;
+    void *user_data;
+};
+
+static uint8_t bound_cb(const struct bt_gatt_attr *attr, uint16_t handle, void *user_data)
+{
+    struct bound_ctx *ctx = user_data;
+
+    if (attr->read == gatt_proxy_value_read && !gatt_proxy_is_mirrored(attr)) {
+        ctx->func(attr->user_data, ctx->user_data);
+    }
+    return BT_GATT_ITER_CONTINUE;
+}
+
+static void proxy_foreach_bound(const struct bt_uuid *uuid, bound_func_t func, void *user_data)
+{
+    struct bound_ctx ctx = { .func = func, .user_data = user_data };
+
+    bt_gatt_foreach_attr_type(BT_ATT_FIRST_ATTRIBUTE_HANDLE, BT_ATT_LAST_ATTRIBUTE_HANDLE,
+                              uuid, NULL, 0, bound_cb, &ctx);
+}
+
+static void bound_find_refresh(struct gatt_proxy_value *v, void *user_data)
+{
+    struct gatt_proxy_value **next = user_data;
+
+    if (!*next && atomic_test_bit(&v->flags, PROXY_VALUE_REFRESH)) {
+        *next = v;
+    }
+}
+
+/* 갱신 대기 중인 값 하나 (복사본 먼저) */
+static struct gatt_proxy_value *proxy_refresh_next(void)
+{
+    struct gatt_proxy_value *next = NULL;
+
+    for (int i = 0; i < px.chrc_cnt; i++) {
+        if (atomic_test_bit(&chrcs[i].val.flags, PROXY_VALUE_REFRESH)) {
+            return &chrcs[i].val;
+        }
+    }
+    proxy_foreach_bound(NULL, bound_find_refresh, &next);
+    return next;
+}
+
+static uint8_t proxy_read_cb(struct bt_conn *conn, uint8_t att_err,
+                             struct bt_gatt_read_params *params, const void *data, uint16_t length)
+{
+    struct gatt_proxy_value *v = refresh_val;
+
+    if (!v) {
+        return BT_GATT_ITER_STOP;
+    }
+
+    if (!att_err && data && conn == px.conn) {
+        proxy_value_update(v, data, length);
+    } else if (att_err) {
+        LOG_DBG("[PROXY] node read 0x%04x failed (att_err 0x%02x)", v->node_handle, att_err);
+    }
+    refresh_val = NULL;
+    atomic_clear_bit(&v->flags, PROXY_VALUE_REFRESH);
+    k_work_submit_to_queue(&relay_link_workq, &proxy_refresh_work);
+    return BT_GATT_ITER_STOP;
+}
+
+/* node read 는 한 번에 하나 */
+static void proxy_refresh_work_handler(struct k_work *work)
+{
+    struct gatt_proxy_value *v;
+    int err;
+
+    if (refresh_val || !px.conn) {
+        return;
+    }
+
+    while ((v = proxy_refresh_next()) != NULL) {
+        if (!v->node_handle) {
+            atomic_clear_bit(&v->flags, PROXY_VALUE_REFRESH);
+            continue;
+        }
+
+        memset(&proxy_read_params, 0, sizeof(proxy_read_params));
+        proxy_read_params.func = proxy_read_cb;
+        proxy_read_params.handle_count = 1;
+        proxy_read_params.single.handle = v->node_handle;
+        proxy_read_params.single.offset = 0;
+
+        refresh_val = v;
+        err = bt_gatt_read(px.conn, &proxy_read_params);
+        if (!err) {
+            return;
+        }
+        LOG_DBG("[PROXY] node read 0x%04x request failed (err %d)", v->node_handle, err);
+        refresh_val = NULL;
+        atomic_clear_bit(&v->flags, PROXY_VALUE_REFRESH);
+    }
+}
+
+static void bound_bind(struct gatt_proxy_value *v, void *user_data)
+{
+    v->node_handle = POINTER_TO_UINT(user_data);
+    atomic_clear_bit(&v->flags, PROXY_VALUE_VALID);
+}
+
+void gatt_proxy_node_chrc(const struct bt_uuid *uuid, uint16_t value_handle)
+{
+    proxy_foreach_bound(uuid, bound_bind, UINT_TO_POINTER(value_handle));
+}
+
+static void bound_queue_refresh(struct gatt_proxy_value *v, void *user_data)
+{
+    proxy_value_refresh(v);
+}
+
+static void bound_unbind(struct gatt_proxy_value *v, void *user_data)
+{
+    v->node_handle = 0;
+    atomic_clear_bit(&v->flags, PROXY_VALUE_REFRESH);
+}
+
+/* ----------------- mirrored attributes ----------------- */
+
+/* write request 가 node 에서 끝났다. 성공은 write response 로만 온다 (BT RX thread) */
+static void proxy_write_done(uint16_t handle, const void *data, uint16_t len, int err, void *user_data)
+{
+    struct proxy_chrc *c = user_data;
+
+    if (!err) {
+        proxy_value_update(&c->val, data, len);
+    }
+}
+
+static ssize_t proxy_write(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                           const void *buf, uint16_t len, uint16_t offset, uint8_t flags)
+{
+    struct proxy_chrc *c = CONTAINER_OF(attr->user_data, struct proxy_chrc, val);
+    int err;
+
+    if (offset) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+    }
+
+    /* hub 가 보낸 방식 그대로 node_write queue 로. 어떤 값인지 모르므로 합치지 않는다 */
+    if (flags & BT_GATT_WRITE_FLAG_CMD) {
+        err = node_write_submit(c->val.node_handle, buf, len, NODE_WRITE_CMD, NULL, NULL);
+    } else {
+        err = node_write_submit(c->val.node_handle, buf, len, 0, proxy_write_done, c);
+    }
+    return node_write_att_err(err, len);
+}
+
+static void proxy_ccc_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+    struct proxy_chrc *c = CONTAINER_OF((struct _bt_gatt_ccc *)attr->user_data, struct proxy_chrc, ccc);
+
+    if (value == BT_GATT_CCC_NOTIFY) {
+        atomic_set_bit(&c->flags, PROXY_HUB_NOTIFY);
+    } else {
+        atomic_clear_bit(&c->flags, PROXY_HUB_NOTIFY);
+    }
+    k_work_submit_to_queue(&relay_link_workq, &proxy_sync_work);
+}
+
+/* ----------------- node subscriptions ----------------- */
+
+/* fast path: 구독 params 가 곧 table 항목이라 handle 검색이 없다 */
+static uint8_t proxy_notify_cb(struct bt_conn *conn, struct bt_gatt_subscribe_params *params,
+                               const void *data, uint16_t length)
+{
+    struct proxy_chrc *c = CONTAINER_OF(params, struct proxy_chrc, sub);
+    int err = 0;
+
+    if (!data) {
+        atomic_clear_bit(&c->flags, PROXY_NODE_SUB);
+        atomic_clear_bit(&c->flags, PROXY_UNSUB_PENDING);
+        k_work_submit_to_queue(&relay_link_workq, &proxy_sync_work);
+        return BT_GATT_ITER_STOP;
+    }
+
+    RELAY_TRACE("rly_rx", params->value_handle, length);
+    radio_airtime_pdu(RADIO_LINK_NODE, length);
+
+    proxy_value_update(&c->val, data, length);
+
+    if (atomic_test_bit(&c->flags, PROXY_HUB_NOTIFY)) {
+        err = relay_trace_notify(ble_relay_hub_conn(), c->attr, data, length);
+        if (!err) {
+            radio_airtime_pdu(RADIO_LINK_HUB, length);
+        } else if (err != -ENOTCONN) {
+            LOG_DBG("[PROXY] hub notify 0x%04x failed (err %d)", params->value_handle, err);
+        }
+    }
+
+    RELAY_TRACE("rly_rx_done", params->value_handle, err);
+    return BT_GATT_ITER_CONTINUE;
+}
+
+static void proxy_node_subscribe(struct proxy_chrc *c)
+{
+    int err;
+
+    memset(&c->sub, 0, sizeof(c->sub));
+    /* 단순 가정: CCCD = value_handle + 1 (ble_relay_control.c 와 동일) */
+    c->sub.value_handle = c->val.node_handle;
+    c->sub.ccc_handle = c->val.node_handle + 1;
+    c->sub.value = BT_GATT_CCC_NOTIFY;
+    c->sub.notify = proxy_notify_cb;
+    atomic_set_bit(c->sub.flags, BT_GATT_SUBSCRIBE_FLAG_VOLATILE);
+
+    err = bt_gatt_subscribe(px.conn, &c->sub);
+    if (err && err != -EALREADY) {
+        LOG_WRN("[PROXY] node subscribe 0x%04x failed (err %d)", c->val.node_handle, err);
+        return;
+    }
+    atomic_set_bit(&c->flags, PROXY_NODE_SUB);
+    LOG_DBG("[PROXY] node 0x%04x subscribed", c->val.node_handle);
+}
+
+/* hub 의 CCC 상태에 node 구독을 맞춘다. hub 가 안 보는 값은 node 도 보내지 않게 */
+static void proxy_sync_work_handler(struct k_work *work)
+{
+    if (!px.conn || !px.ready) {
+        return;
+    }
+
+    for (int i = 0; i < px.chrc_cnt; i++) {
+        struct proxy_chrc *c = &chrcs[i];
+        bool want = atomic_test_bit(&c->flags, PROXY_HUB_NOTIFY);
+        bool have = atomic_test_bit(&c->flags, PROXY_NODE_SUB);
+
+        if (!(c->props & BT_GATT_CHRC_NOTIFY) || !c->val.node_handle ||
+            atomic_test_bit(&c->flags, PROXY_UNSUB_PENDING)) {
+            continue;
+        }
+
+        if (want && !have) {
+            proxy_node_subscribe(c);
+        } else if (!want && have) {
+            /* 끝나면 proxy_notify_cb(NULL) 이 불린다 */
+            atomic_set_bit(&c->flags, PROXY_UNSUB_PENDING);
+            if (bt_gatt_unsubscribe(px.conn, &c->sub)) {
+                atomic_clear_bit(&c->flags, PROXY_UNSUB_PENDING);
+                atomic_clear_bit(&c->flags, PROXY_NODE_SUB);
+            }
+        }
+    }
+}
+
+/* ----------------- mirror table ----------------- */
+
+static bool proxy_same_database(void)
+{
+    if (px.svc_cnt != px.found_svc_cnt || px.chrc_cnt != px.found_chrc_cnt) {
+        return false;
+    }
+    for (int i = 0; i < px.svc_cnt; i++) {
+        if (bt_uuid_cmp(&svcs[i].uuid.uuid, &found_svc[i].uuid.uuid) ||
+            svcs[i].chrc_cnt != found_svc[i].chrc_cnt) {
+            return false;
+        }
+    }
+    for (int i = 0; i < px.chrc_cnt; i++) {
+        if (bt_uuid_cmp(&chrcs[i].uuid.uuid, &found_chrc[i].uuid.uuid) ||
+            chrcs[i].props != found_chrc[i].props) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void proxy_unregister(void)
+{
+    for (int i = 0; i < px.svc_cnt; i++) {
+        int err = bt_gatt_service_unregister(&svcs[i].svc);
+
+        if (err) {
+            LOG_WRN("[PROXY] service %d unregister failed (err %d)", i, err);
+        }
+    }
+    px.svc_cnt = 0;
+    px.chrc_cnt = 0;
+    memset(svcs, 0, sizeof(svcs));
+    memset(chrcs, 0, sizeof(chrcs));
+    memset(attrs, 0, sizeof(attrs));
+}
+
+static void proxy_register(void)
+{
+    uint16_t n = 0;
+
+    for (int i = 0; i < px.found_svc_cnt; i++) {
+        const struct proxy_found_svc *f = &found_svc[i];
+        struct proxy_svc *s = &svcs[i];
+        struct bt_gatt_attr *first = &attrs[n];
+        char uuid_str[BT_UUID_STR_LEN];
+        int err;
+
+        s->uuid = f->uuid;
+        s->chrc_first = f->chrc_first;
+        s->chrc_cnt = f->chrc_cnt;
+
+        attrs[n++] = (struct bt_gatt_attr) {
+            .uuid = BT_UUID_GATT_PRIMARY,
+            .perm = BT_GATT_PERM_READ,
+            .read = bt_gatt_attr_read_service,
+            .user_data = &s->uuid.uuid,
+        };
+
+        for (int k = f->chrc_first; k < f->chrc_first + f->chrc_cnt; k++) {
+            struct proxy_chrc *c = &chrcs[k];
+
+            c->uuid = found_chrc[k].uuid;
+            c->val.node_handle = found_chrc[k].value_handle;
+            c->props = found_chrc[k].props;
+            c->decl = (struct bt_gatt_chrc) {
+                .uuid = &c->uuid.uuid,
+                .value_handle = 0,      /* 등록 시 정해지는 다음 handle */
+                .properties = c->props,
+            };
+
+            attrs[n++] = (struct bt_gatt_attr) {
+                .uuid = BT_UUID_GATT_CHRC,
+                .perm = BT_GATT_PERM_READ,
+                .read = bt_gatt_attr_read_chrc,
+                .user_data = &c->decl,
+            };
+
+            c->attr = &attrs[n];
+            attrs[n++] = (struct bt_gatt_attr) {
+                .uuid = &c->uuid.uuid,
+                .perm = ((c->props & BT_GATT_CHRC_READ) ? BT_GATT_PERM_READ : 0) |
+                        ((c->props & (BT_GATT_CHRC_WRITE | BT_GATT_CHRC_WRITE_WITHOUT_RESP)) ?
+                         BT_GATT_PERM_WRITE : 0),
+                .read = (c->props & BT_GATT_CHRC_READ) ? gatt_proxy_value_read : NULL,
+                .write = (c->props & (BT_GATT_CHRC_WRITE | BT_GATT_CHRC_WRITE_WITHOUT_RESP)) ?
+                         proxy_write : NULL,
+                .user_data = &c->val,
+            };
+
+            if (c->props & BT_GATT_CHRC_NOTIFY) {
+                c->ccc.cfg_changed = proxy_ccc_changed;
+                attrs[n++] = (struct bt_gatt_attr) {
+                    .uuid = BT_UUID_GATT_CCC,
+                    .perm = BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
+                    .read = bt_gatt_attr_read_ccc,
+                    .write = bt_gatt_attr_write_ccc,
+                    .user_data = &c->ccc,
+                };
+            }
+        }
+
+        s->svc.attrs = first;
+        s->svc.attr_count = &attrs[n] - first;
+
+        bt_uuid_to_str(&s->uuid.uuid, uuid_str, sizeof(uuid_str));
+        err = bt_gatt_service_register(&s->svc);
+        if (err) {
+            LOG_ERR("[PROXY] service %s register failed (err %d)", uuid_str, err);
+            break;
+        }
+        px.svc_cnt = i + 1;
+        px.chrc_cnt = f->chrc_first + f->chrc_cnt;
+        LOG_INF("[PROXY] mirrored service %s (%u characteristics)", uuid_str, f->chrc_cnt);
+    }
+}
+
+static void proxy_apply(void)
+{
+    if (px.svc_cnt && proxy_same_database()) {
+        /* 같은 구성의 node: 등록은 그대로 두고 node handle 만 바꾼다 (Service Changed 없음) */
+        for (int i = 0; i < px.chrc_cnt; i++) {
+            chrcs[i].val.node_handle = found_chrc[i].value_handle;
+            atomic_clear_bit(&chrcs[i].val.flags, PROXY_VALUE_VALID);
+        }
+        LOG_INF("[PROXY] same node database, %u characteristics remapped", px.chrc_cnt);
+    } else {
+        proxy_unregister();
+        proxy_register();
+    }
+    px.ready = true;
+
+    /* hub 가 이미 켜 둔 notify 는 새 node 에도 구독 */
+    k_work_submit_to_queue(&relay_link_workq, &proxy_sync_work);
+
+    /* 읽을 수 있는 값은 한 번씩 미리 읽어 둔다 */
+    for (int i = 0; i < px.chrc_cnt; i++) {
+        if (chrcs[i].props & BT_GATT_CHRC_READ) {
+            proxy_value_refresh(&chrcs[i].val);
+        }
+    }
+    proxy_foreach_bound(NULL, bound_queue_refresh, NULL);
+
+    LOG_INF("[PROXY] %u services, %u characteristics ready", px.svc_cnt, px.chrc_cnt);
+}
+
+/* ----------------- discovery ----------------- */
+
+static uint8_t proxy_disc_svc_cb(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                                 struct bt_gatt_discover_params *params)
+{
+    const struct bt_gatt_service_val *sv;
+    struct proxy_found_svc *f;
+
+    if (conn != px.conn || px.step != PROXY_DISC_SVC) {
+        return BT_GATT_ITER_STOP;
+    }
+    if (!attr) {
+        px.step = PROXY_DISC_CHRC;
+        px.idx = 0;
+        k_work_submit_to_queue(&relay_link_workq, &proxy_work);
+        return BT_GATT_ITER_STOP;
+    }
+
+    sv = attr->user_data;
+    if (local_has_service(sv->uuid)) {
+        return BT_GATT_ITER_CONTINUE;
+    }
+    if (px.found_svc_cnt >= PROXY_MAX_SVC) {
+        LOG_WRN("[PROXY] service table full, 0x%04x not mirrored", attr->handle);
+        return BT_GATT_ITER_CONTINUE;
+    }
+
+    f = &found_svc[px.found_svc_cnt++];
+    proxy_uuid_copy(&f->uuid, sv->uuid);
+    f->start_handle = attr->handle;
+    f->end_handle = sv->end_handle;
+    return BT_GATT_ITER_CONTINUE;
+}
+
+static uint8_t proxy_disc_chrc_cb(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                                  struct bt_gatt_discover_params *params)
+{
+    const struct bt_gatt_chrc *chrc;
+    struct proxy_found_chrc *f;
+
+    if (conn != px.conn || px.step != PROXY_DISC_CHRC) {
+        return BT_GATT_ITER_STOP;
+    }
+    if (!attr) {
+        px.idx++;
+        k_work_submit_to_queue(&relay_link_workq, &proxy_work);
+        return BT_GATT_ITER_STOP;
+    }
+
+    chrc = attr->user_data;
+    if (px.found_chrc_cnt >= PROXY_MAX_CHRC) {
+        LOG_WRN("[PROXY] characteristic table full, 0x%04x not mirrored", chrc->value_handle);
+        return BT_GATT_ITER_CONTINUE;
+    }
+
+    f = &found_chrc[px.found_chrc_cnt++];
+    proxy_uuid_copy(&f->uuid, chrc->uuid);
+    f->value_handle = chrc->value_handle;
+    f->props = chrc->properties & PROXY_CHRC_PROPS;
+    found_svc[px.idx].chrc_cnt++;
+    return BT_GATT_ITER_CONTINUE;
+}
+
+static int proxy_step_disc(uint8_t type, uint16_t start, uint16_t end, bt_gatt_discover_func_t func)
+{
+    memset(&proxy_disc_params, 0, sizeof(proxy_disc_params));
+    proxy_disc_params.uuid = NULL;
+    proxy_disc_params.func = func;
+    proxy_disc_params.start_handle = start;
+    proxy_disc_params.end_handle = end;
+    proxy_disc_params.type = type;
+
+    return bt_gatt_discover(px.conn, &proxy_disc_params);
+}
+
+static void proxy_work_handler(struct k_work *work)
+{
+    int err = 0;
+
+    if (!px.conn) {
+        return;
+    }
+
+    switch (px.step) {
+    case PROXY_DISC_SVC:
+        px.found_svc_cnt = 0;
+        px.found_chrc_cnt = 0;
+        err = proxy_step_disc(BT_GATT_DISCOVER_PRIMARY, BT_ATT_FIRST_ATTRIBUTE_HANDLE,
+                              BT_ATT_LAST_ATTRIBUTE_HANDLE, proxy_disc_svc_cb);
+        break;
+
+    case PROXY_DISC_CHRC:
+        if (px.idx < px.found_svc_cnt) {
+            struct proxy_found_svc *f = &found_svc[px.idx];
+
+            f->chrc_first = px.found_chrc_cnt;
+            f->chrc_cnt = 0;
+            err = proxy_step_disc(BT_GATT_DISCOVER_CHARACTERISTIC, f->start_handle + 1,
+                                  f->end_handle, proxy_disc_chrc_cb);
+            break;
+        }
+        px.step = PROXY_APPLY;
+        __fallthrough;
+
+    case PROXY_APPLY:
+        proxy_apply();
+        px.step = PROXY_IDLE;
+        break;
+
+    case PROXY_IDLE:
+    default:
+        break;
+    }
+
+    if (err) {
+        LOG_WRN("[PROXY] step %d failed (err %d)", px.step, err);
+        px.step = PROXY_IDLE;
+    }
+}
+
+void gatt_proxy_node_ready(struct bt_conn *conn)
+{
+    if (px.ready && px.conn == conn) {
+        /* 같은 연결에서 다시 discovery (stall 복구): table 은 그대로 */
+        return;
+    }
+
+    px.conn = conn;
+    px.ready = false;
+    px.step = PROXY_DISC_SVC;
+    k_work_submit_to_queue(&relay_link_workq, &proxy_work);
+}
+
+void gatt_proxy_node_lost(void)
+{
+    px.conn = NULL;
+    px.ready = false;
+    px.step = PROXY_IDLE;
+
+    /* volatile 구독이라 stack 이 이미 지웠다. 진행 중이던 node read 도 끝났다 */
+    for (int i = 0; i < px.chrc_cnt; i++) {
+        atomic_clear_bit(&chrcs[i].flags, PROXY_NODE_SUB);
+        atomic_clear_bit(&chrcs[i].flags, PROXY_UNSUB_PENDING);
+        atomic_clear_bit(&chrcs[i].val.flags, PROXY_VALUE_REFRESH);
+    }
+    refresh_val = NULL;
+
+    /* 복사본은 다음 node 를 위해 남기지만, relay 서비스 쪽 값은 node 가 없으면 끊는다 */
+    proxy_foreach_bound(NULL, bound_unbind, NULL);
+}
+
+#else
+
+void gatt_proxy_node_chrc(const struct bt_uuid *uuid, uint16_t value_handle)
+{
+}
+
+void gatt_proxy_node_ready(struct bt_conn *conn)
+{
+}
+
+void gatt_proxy_node_lost(void)
+{
+}
+
+bool gatt_proxy_is_mirrored(const struct bt_gatt_attr *attr)
+{
+    return false;
+}
+
+#endif /* CONFIG_RELAY_GATT_PROXY */
@@ -0,0 +1,90 @@
+#ifndef _GATT_PROXY_H_
+#define _GATT_PROXY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/uuid.h>
+
+/** @brief Transparent GATT proxy for the node services the relay does not implement.
+ *
+ * After the node is discovered, every primary service of the node that has
+ * no service with the same UUID in the relay's own GATT DB is mirrored into
+ * the relay's DB as a dynamic service (CONFIG_BT_GATT_DYNAMIC_DB). The hub
+ * gets a Service Changed indication and sees the node's characteristics
+ * (UUID, properties) on the relay.
+ *
+ * Each mirrored characteristic is one entry of the handle translation table
+ * (node value handle <-> local attribute):
+ *  - read  : served from the value cache (struct gatt_proxy_value).
+ *  - write : forwarded to the node through the node write queue
+ *            (node_write.h), as write request or write command like the
+ *            hub sent it. The hub's write is answered right away.
+ *  - notify: the relay subscribes on the node when the hub enables the
+ *            mirrored CCC. Node notifications are sent to the hub from the
+ *            subscription callback, without going through the handle chain
+ *            of the relayed streams.
+ *
+ * The mirror stays registered when the node goes away, so reconnecting a
+ * node with the same database only updates the node handles.
+ *
+ * Value cache: every proxied value keeps the last value notified by, read
+ * from or written to the node. A hub read is always answered from the cache.
+ * When the value is older than CONFIG_RELAY_GATT_PROXY_READ_TTL_MS the read
+ * also queues one background read of the node (at most one per value in
+ * flight), so the next hub read gets the fresh value. Values the node
+ * notifies stay fresh without any read. Until the value has been received
+ * from the current node (after discovery, or after the node was lost), a hub
+ * read fails with BT_ATT_ERR_UNLIKELY and queues the node read, so the hub
+ * never gets an empty value that looks like a real one.
+ *
+ * A characteristic of a service the relay implements itself can use the same
+ * cache: declare it with gatt_proxy_value_read() and a GATT_PROXY_VALUE_DEFINE()
+ * as user_data. It is bound to the node characteristic with the same UUID
+ * during discovery.
+ */
+
+#if defined(CONFIG_RELAY_GATT_PROXY)
+
+/** @brief Cached node value of one proxied characteristic. */
+struct gatt_proxy_value
+{
+    uint16_t node_handle;       /* 0: not on the current node */
+    uint16_t len;
+    uint32_t updated_ms;
+    atomic_t flags;
+    uint8_t data[CONFIG_RELAY_GATT_PROXY_VALUE_MAX];
+};
+
+#define GATT_PROXY_VALUE_DEFINE(name) static struct gatt_proxy_value name
+
+/** @brief GATT read callback serving a struct gatt_proxy_value (attr->user_data). */
+ssize_t gatt_proxy_value_read(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                              void *buf, uint16_t len, uint16_t offset);
+
+#endif
+
+/**
+ * @brief A node characteristic was discovered.
+ *
+ * Binds it to a local gatt_proxy_value_read() characteristic with the same
+ * UUID, if there is one.
+ */
+void gatt_proxy_node_chrc(const struct bt_uuid *uuid, uint16_t value_handle);
+
+/**
+ * @brief Node discovery is done, mirror its remaining services.
+ *
+ * Runs its own service / characteristic discovery on relay_link_workq.
+ */
+void gatt_proxy_node_ready(struct bt_conn *conn);
+
+/** @brief The node link is gone. */
+void gatt_proxy_node_lost(void);
+
+/** @brief @p attr belongs to a mirrored (dynamic) node service. */
+bool gatt_proxy_is_mirrored(const struct bt_gatt_attr *attr);
+
+#endif
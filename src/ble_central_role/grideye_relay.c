@@ -0,0 +1,267 @@
+/* grideye_relay.c
+ *
+ * 목적:
+ *  - node 는 grideye raw data 를 pixel 하나당 notification 하나 (index + int) 로 보낸다.
+ *    (8x8 = 64 notification / frame, 최대 10 fps)
+ *  - relay 는 이것을 frame 하나로 모아서 12-bit 샘플 또는 이전 frame 대비 delta 로 압축해
+ *    hub 에는 frame 당 1~2 개의 notification 만 보낸다. (포맷은 grideye_service.h 참고)
+ */
+#include "grideye_relay.h"
+
+#include <string.h>
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/logging/log.h>
+
+#include "grideye_service.h"
+#include "dean_device.h"
+#include "ble_relay_control.h"
+#include "relay_stats.h"
+#include "clock.h"
+#include "relay_chain.h"
+#include "node_stream.h"
+
+LOG_MODULE_REGISTER(grideye_relay, LOG_LEVEL_INF);
+
+#define GRIDEYE_PDU_MAX             (3 + GRID_EYE_PIXEL_SIZE * 2 + RELAY_RX_STAMP_SIZE)
+#define GRIDEYE_ATT_NOTIFY_OVERHEAD 3
+
+static struct
+{
+    int16_t cur[GRID_EYE_PIXEL_SIZE];
+    int16_t prev[GRID_EYE_PIXEL_SIZE];  /* hub 가 마지막으로 받은 frame (delta 기준) */
+    uint64_t seen;                      /* 이번 frame 에서 받은 pixel bitmask */
+    int last_index;
+    bool prev_valid;
+    uint8_t frame_seq;
+    uint8_t since_key;
+
+    uint32_t frames;
+    uint32_t partial_frames;
+    uint32_t send_fail;
+} ge = {
+    .last_index = -1,
+};
+
+static uint8_t grideye_bits_per_pixel(uint8_t encoding)
+{
+    switch (encoding) {
+    case GRIDEYE_FRAME_ENC_FULL12:
+        return 12;
+    case GRIDEYE_FRAME_ENC_FULL16:
+        return 16;
+    case GRIDEYE_FRAME_ENC_DELTA8:
+        return 8;
+    default:
+        return 4;
+    }
+}
+
+static uint8_t grideye_choose_encoding(void)
+{
+    int16_t min_v = INT16_MAX, max_v = INT16_MIN;
+    int min_d = INT16_MAX, max_d = INT16_MIN;
+
+    for (int i = 0; i < GRID_EYE_PIXEL_SIZE; i++) {
+        int d = ge.cur[i] - ge.prev[i];
+
+        min_v = MIN(min_v, ge.cur[i]);
+        max_v = MAX(max_v, ge.cur[i]);
+        min_d = MIN(min_d, d);
+        max_d = MAX(max_d, d);
+    }
+
+    if (ge.prev_valid && ge.since_key < CONFIG_RELAY_GRIDEYE_KEYFRAME_INTERVAL) {
+        if (min_d >= -8 && max_d <= 7) {
+            return GRIDEYE_FRAME_ENC_DELTA4;
+        }
+        if (min_d >= INT8_MIN && max_d <= INT8_MAX) {
+            return GRIDEYE_FRAME_ENC_DELTA8;
+        }
+    }
+
+    return (min_v >= -2048 && max_v <= 2047) ? GRIDEYE_FRAME_ENC_FULL12 : GRIDEYE_FRAME_ENC_FULL16;
+}
+
+/* pixel [off, off + n) 을 encoding 에 맞게 out 에 채운다. n 은 짝수. */
+static uint16_t grideye_pack(uint8_t encoding, uint8_t off, uint8_t n, uint8_t *out)
+{
+    const int16_t *px = &ge.cur[off];
+    const int16_t *ref = &ge.prev[off];
+    uint16_t len = 0;
+
+    for (int i = 0; i < n; i += 2) {
+        switch (encoding) {
+        case GRIDEYE_FRAME_ENC_FULL12:
+            out[len++] = px[i] & 0xFF;
+            out[len++] = ((px[i] >> 8) & 0x0F) | ((px[i + 1] & 0x0F) << 4);
+            out[len++] = (px[i + 1] >> 4) & 0xFF;
+            break;
+        case GRIDEYE_FRAME_ENC_FULL16:
+            sys_put_le16(px[i], &out[len]);
+            sys_put_le16(px[i + 1], &out[len + 2]);
+            len += 4;
+            break;
+        case GRIDEYE_FRAME_ENC_DELTA8:
+            out[len++] = (uint8_t)(int8_t)(px[i] - ref[i]);
+            out[len++] = (uint8_t)(int8_t)(px[i + 1] - ref[i + 1]);
+            break;
+        default:
+            out[len++] = ((px[i] - ref[i]) & 0x0F) | (((px[i + 1] - ref[i + 1]) & 0x0F) << 4);
+            break;
+        }
+    }
+
+    return len;
+}
+
+static int grideye_send_frame(void)
+{
+    struct bt_conn *hub = ble_relay_hub_conn();
+    uint8_t pdu[GRIDEYE_PDU_MAX];
+    struct bt_grideye_frame_hdr *hdr = (struct bt_grideye_frame_hdr *)pdu;
+    uint8_t encoding;
+    int room;
+    uint8_t per_part;
+#if defined(CONFIG_RELAY_RX_TIMESTAMP)
+    uint32_t stamp = clock_rx_stamp();  /* 마지막 pixel 을 받은 시각 */
+#endif
+    int err = 0;
+
+    if (!hub) {
+        return -ENOTCONN;
+    }
+
+    encoding = grideye_choose_encoding();
+    /* 작은 MTU 에서 chain header 까지 빼면 음수가 될 수 있으므로 signed 로 계산 */
+    room = MIN((int)bt_gatt_get_mtu(hub) - GRIDEYE_ATT_NOTIFY_OVERHEAD, GRIDEYE_PDU_MAX) -
+           (int)sizeof(*hdr) - RELAY_RX_STAMP_SIZE - (int)relay_chain_overhead();
+    if (room <= 0) {
+        return -EMSGSIZE;
+    }
+
+    /* 한 notification 에 들어가는 pixel 수 (짝수). 큰 MTU 면 64, MTU 23 이면 10 안팎 */
+    per_part = MIN(GRID_EYE_PIXEL_SIZE, (room * 8 / grideye_bits_per_pixel(encoding)) & ~1);
+    if (per_part == 0) {
+        return -EMSGSIZE;
+    }
+
+    for (uint8_t off = 0; off < GRID_EYE_PIXEL_SIZE && !err; off += per_part) {
+        uint8_t n = MIN(per_part, GRID_EYE_PIXEL_SIZE - off);
+
+        hdr->encoding = encoding;
+        hdr->frame_seq = ge.frame_seq;
+        hdr->pixel_offset = off;
+
+        uint16_t len = sizeof(*hdr) + grideye_pack(encoding, off, n, &pdu[sizeof(*hdr)]);
+
+#if defined(CONFIG_RELAY_RX_TIMESTAMP)
+        sys_put_le32(stamp, &pdu[len]);
+#endif
+        err = bt_grideye_send_raw_frame(pdu, len + RELAY_RX_STAMP_SIZE);
+        relay_stats_tx(RELAY_STREAM_GRIDEYE_RAW, err);
+    }
+
+    if (!err) {
+        ge.since_key = (encoding == GRIDEYE_FRAME_ENC_DELTA4 || encoding == GRIDEYE_FRAME_ENC_DELTA8) ?
+                       ge.since_key + 1 : 0;
+    }
+    return err;
+}
+
+static void grideye_relay_flush(void)
+{
+    int err;
+
+    if (ge.seen != UINT64_MAX) {
+        /* 빠진 pixel 은 이전 frame 값으로 채운다 */
+        ge.partial_frames++;
+        for (int i = 0; i < GRID_EYE_PIXEL_SIZE; i++) {
+            if (!(ge.seen & BIT64(i))) {
+                ge.cur[i] = ge.prev_valid ? ge.prev[i] : 0;
+            }
+        }
+    }
+
+    err = grideye_send_frame();
+    if (err) {
+        /* hub 가 이 frame 을 못 받았을 수 있으므로 다음은 full frame */
+        ge.prev_valid = false;
+        if (err != -EACCES && err != -ENOTCONN) {
+            ge.send_fail++;
+            LOG_DBG("[GRIDEYE] frame %u send failed (err %d)", ge.frame_seq, err);
+        }
+    } else {
+        memcpy(ge.prev, ge.cur, sizeof(ge.prev));
+        ge.prev_valid = true;
+    }
+
+    ge.frames++;
+    ge.frame_seq++;
+    ge.seen = 0;
+    ge.last_index = -1;
+}
+
+void grideye_relay_pixel(const void *data, uint16_t len)
+{
+    const uint8_t *p = data;
+    uint8_t index;
+    int32_t value;
+
+    if (len == sizeof(uint8_t) + sizeof(int32_t)) {
+        /* packed (index + int) */
+        index = p[0];
+        value = (int32_t)sys_get_le32(&p[1]);
+    } else if (len == sizeof(struct bt_grideye_data_type)) {
+        /* node 가 struct 를 그대로 보냄 (int 는 4 byte 정렬) */
+        index = p[0];
+        value = (int32_t)sys_get_le32(&p[offsetof(struct bt_grideye_data_type, data)]);
+    } else {
+        return;
+    }
+
+    if (index >= GRID_EYE_PIXEL_SIZE) {
+        return;
+    }
+    relay_stats_rx(RELAY_STREAM_GRIDEYE_RAW);
+
+    if ((int)index <= ge.last_index) {
+        /* 63 번 pixel 없이 새 frame 이 시작됨 */
+        grideye_relay_flush();
+    }
+
+    ge.cur[index] = (int16_t)CLAMP(value, INT16_MIN, INT16_MAX);
+    ge.seen |= BIT64(index);
+    ge.last_index = index;
+
+    if (index == GRID_EYE_PIXEL_SIZE - 1) {
+        grideye_relay_flush();
+    }
+}
+
+void grideye_relay_reset(void)
+{
+    if (ge.frames) {
+        LOG_INF("[GRIDEYE] relayed %u frames (%u partial, %u send failures)",
+                ge.frames, ge.partial_frames, ge.send_fail);
+    }
+
+    ge.seen = 0;
+    ge.last_index = -1;
+    ge.prev_valid = false;
+    ge.since_key = 0;
+}
+
+static int grideye_stream_notify(const void *data, uint16_t len)
+{
+    /* pixel 단위 stream -> frame 단위 packed notification */
+    grideye_relay_pixel(data, len);
+    return 0;
+}
+
+NODE_STREAM_DEFINE(grideye_raw, BT_UUID_CHRC_GRIDEYE_RAW_STREAMING, RELAY_STREAM_GRIDEYE_RAW,
+                   .notify = grideye_stream_notify,
+                   .lost = grideye_relay_reset);
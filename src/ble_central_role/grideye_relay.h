@@ -0,0 +1,20 @@
+#ifndef _GRIDEYE_RELAY_H_
+#define _GRIDEYE_RELAY_H_
+
+#include <stdint.h>
+
+/**
+ * @brief One raw pixel notification from the node (struct bt_grideye_data_type).
+ *
+ * Pixels are collected into an 8x8 frame. When pixel 63 arrives (or the index
+ * wraps) the frame is packed and sent to the hub with bt_grideye_send_raw_frame().
+ *
+ * @param data is the notification payload (index + int, packed or padded).
+ * @param len is the notification length.
+ */
+void grideye_relay_pixel(const void *data, uint16_t len);
+
+/** @brief Drop the partial frame and the delta reference (node or hub link lost). */
+void grideye_relay_reset(void);
+
+#endif
@@ -101,4 +101,41 @@ int bt_grideye_send_raw_data(struct bt_grideye_data_type *bt_grideye_data);
  * 
  * @return int "1" if the CCC is enabled, "0" if the CCC is disabled.
  */
-int is_grideye_notify_enabled(void);
\ No newline at end of file
+int is_grideye_notify_enabled(void);
+
+/** @brief Packed raw frame encodings used on the relay -> hub raw streaming characteristic.
+ *
+ * Every notification starts with struct bt_grideye_frame_hdr and carries the pixels
+ * [pixel_offset, pixel_offset + n) of one 8x8 frame. A frame is split into
+ * ceil(64 / per_part) notifications, per_part being the even number of pixels of the
+ * chosen encoding that fit into what the hub link MTU leaves after the header, the
+ * RX timestamp and the relay chain header. A large MTU sends the frame in one
+ * notification; at MTU 23 a FULL12 frame without timestamp takes 7 (10 pixels each).
+ *  - FULL12 : 12-bit two's complement samples, 2 samples per 3 bytes (LSB first)
+ *  - FULL16 : int16_t little endian samples (a sample did not fit into 12 bits)
+ *  - DELTA8 : int8_t difference against the same pixel of the previous frame
+ *  - DELTA4 : 4-bit two's complement differences, 2 per byte (low nibble first)
+ * Delta frames are only sent when the previous frame reached the hub, and a full
+ * frame is forced every CONFIG_RELAY_GRIDEYE_KEYFRAME_INTERVAL frames.
+ */
+#define GRIDEYE_FRAME_ENC_FULL12    0
+#define GRIDEYE_FRAME_ENC_FULL16    1
+#define GRIDEYE_FRAME_ENC_DELTA8    2
+#define GRIDEYE_FRAME_ENC_DELTA4    3
+
+struct bt_grideye_frame_hdr
+{
+    uint8_t encoding;
+    uint8_t frame_seq;
+    uint8_t pixel_offset;
+} __attribute__((packed));
+
+/** @brief Send one packed grideye raw frame notification to the hub.
+ *
+ * @param[in] data is a struct bt_grideye_frame_hdr followed by the packed pixels.
+ * @param[in] len is the notification length.
+ *
+ * @retval  0 if the operation was successful.
+ *          Otherwise, a (negative) error code is retruned.
+ */
+int bt_grideye_send_raw_frame(const void *data, uint16_t len);
@@ -3,6 +3,7 @@
 #include <zephyr/drivers/gpio.h>
 #include <soc.h>
 #include <stddef.h>
+#include <string.h>
 #include <errno.h>
 #include <zephyr/types.h>
 
@@ -23,6 +24,12 @@
 // #include "inference.h"
 // #include "inference_msgq.h"
 #include "inference_service.h"
+#include "relay_segment.h"
+#include "ble_relay_control.h"
+#include "radio_airtime.h"
+#include "relay_chain.h"
+#include "clock.h"
+#include "node_write.h"
 
 static bool inference_rawdata_notify_enabled;
 static bool inference_seq_anal_result_notify_enabled;
@@ -61,17 +68,6 @@ static void ccc_cfg_inference_debug_string_changed(const struct bt_gatt_attr *at
     inference_debug_string_notify_enabled = (value == BT_GATT_CCC_NOTIFY);
 }
 
-// delete later
-static void unitspace_existence_estimation(const void *buf, uint16_t len)
-{
-    // printk("Unitspace Existence Estimation Write CB called, len: %d\n", len);
-    // for (int i = 0; i < len; i++)
-    // {
-    //     printk(" %02X", ((uint8_t *)buf)[i]);
-    // }
-    // printk("\n");
-}
-
 static bt_gatt_attr_write_func_t unitspace_existence_estimation_write_cb(struct bt_conn *conn,
                                                 const struct bt_gatt_attr *attr,
                                                 const void *buf,
@@ -79,8 +75,11 @@ static bt_gatt_attr_write_func_t unitspace_existence_estimation_write_cb(struct
                                                 uint16_t offset,
                                                 uint8_t flags)
 {
-    unitspace_existence_estimation(buf, len);
-    return len;
+    if (offset) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+    }
+    /* node 로 전달 (node_write.c), 밀린 추정값은 마지막 것만 나간다 */
+    return node_write_att_err(node_write_target(NODE_WRITE_UNITSPACE, buf, len), len);
 }
 
 /** @brief inference data service declaration */
@@ -91,13 +90,13 @@ BT_GATT_SERVICE_DEFINE(
                             BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY | BT_GATT_CHRC_WRITE,
                             BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
                             NULL, unitspace_existence_estimation_write_cb, NULL),
-    BT_GATT_CCC(ccc_cfg_inference_seq_anal_result_changed,
+    BT_GATT_CCC(ccc_cfg_inference_rawdata_changed,
                             BT_GATT_PERM_READ | BT_GATT_PERM_WRITE), 
     BT_GATT_CHARACTERISTIC( BT_UUID_CHRC_INFERENCE_SEQ_ANAL_RESULT,
                             BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
                             BT_GATT_PERM_READ,
                             NULL, NULL, NULL),   
-    BT_GATT_CCC(ccc_cfg_inference_rawdata_changed,
+    BT_GATT_CCC(ccc_cfg_inference_seq_anal_result_changed,
                             BT_GATT_PERM_READ | BT_GATT_PERM_WRITE), 
     BT_GATT_CHARACTERISTIC( BT_UUID_CHRC_INFERENCE_DEBUG_STRING,
                             BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
@@ -117,36 +116,57 @@ int bt_inference_rawdata_send(uint8_t *packet_arr)
         return -EACCES;
     }
     // return 
-    
-    err = bt_gatt_notify(NULL, &inference_svr.attrs[2],
-                  packet_arr,
-                  INFERENCE_RESULT_PACKET_SIZE);
+
+#if defined(CONFIG_RELAY_RX_TIMESTAMP)
+    /* 44 byte packet 뒤에 relay 수신 시각 (clock.h) */
+    uint8_t stamped[INFERENCE_RESULT_PACKET_SIZE + RELAY_RX_STAMP_SIZE];
+
+    memcpy(stamped, packet_arr, INFERENCE_RESULT_PACKET_SIZE);
+    sys_put_le32(clock_rx_stamp(), &stamped[INFERENCE_RESULT_PACKET_SIZE]);
+    packet_arr = stamped;
+#endif
+
+    err = relay_chain_hub_notify(NULL, &inference_svr.attrs[2],
+                                 packet_arr,
+                                 INFERENCE_RESULT_PACKET_SIZE + RELAY_RX_STAMP_SIZE);
+    if (!err) {
+        radio_airtime_pdu(RADIO_LINK_HUB, INFERENCE_RESULT_PACKET_SIZE + RELAY_RX_STAMP_SIZE);
+    }
 
     return err;
 }
 
+/* seq result / debug string 은 message 끝에 relay 수신 시각 */
+static int inference_seg_send(const struct bt_gatt_attr *attr, uint8_t stream,
+                              const char *data, uint16_t len)
+{
+    uint8_t stamp[4];
+
+#if defined(CONFIG_RELAY_RX_TIMESTAMP)
+    sys_put_le32(clock_rx_stamp(), stamp);
+#endif
+    return relay_seg_send_tail(ble_relay_hub_conn(), attr, stream,
+                               (const uint8_t *)data, len, stamp, RELAY_RX_STAMP_SIZE);
+}
+
 int bt_inference_seq_anal_result_send(char *result_char_arr, uint16_t result_len_uint16_t)
 {
-    int err = 0;
-    if (!inference_rawdata_notify_enabled)
+    if (!inference_seq_anal_result_notify_enabled)
     {
         return -EACCES;
     }
 
-    err = bt_gatt_notify(NULL, &inference_svr.attrs[5],
-                         result_char_arr,
-                         result_len_uint16_t);
+    return inference_seg_send(&inference_svr.attrs[5], RELAY_SEG_STREAM_SEQ_RESULT,
+                              result_char_arr, result_len_uint16_t);
 }
 
 int bt_inference_debug_string_send(char *debug_string_arr, uint16_t debug_string_len_uint16_t)
 {
-    int err = 0;
     if (!inference_debug_string_notify_enabled)
     {
         return -EACCES;
     }
 
-    err = bt_gatt_notify(NULL, &inference_svr.attrs[8],
-                         debug_string_arr,
-                         debug_string_len_uint16_t);
-}
\ No newline at end of file
+    return inference_seg_send(&inference_svr.attrs[8], RELAY_SEG_STREAM_DEBUG_STRING,
+                              debug_string_arr, debug_string_len_uint16_t);
+}
@@ -77,6 +77,8 @@ int bt_inference_rawdata_send(uint8_t *packet_arr);
  * This function sends inference result to connected peers.
  * According to the sequence analysis result, @param result_len_uint16_t bytes of the packet will be sent.
  * The packet is string data, so it should be converted to char array when the central device receives it.
+ * Results longer than one notification are split by relay_seg_send() (see relay_segment.h),
+ * so the central device has to reassemble the START/CONTINUE/END segments.
  * 
  * @param result_char_arr is string format of the sequence analysis result.
  * @param result_len_uint16_t is the length of the result_char_arr.
@@ -89,6 +91,7 @@ int bt_inference_seq_anal_result_send(char *result_char_arr, uint16_t result_len
  * 
  * This function sends inference debugging string data to connected peers.
  * JLinkRTT log data is sent to the SLiM Hub. This function will make the debugging service more efficient.
+ * Same segment framing as bt_inference_seq_anal_result_send().
  * 
  * @param debug_string_arr is the debugging string data.
  * @param debug_string_len_uint16_t is the length of the debug_string_arr.
@@ -0,0 +1,493 @@
+/* model_update_proxy.c
+ *
+ * 목적:
+ *  - SLIMHUB 가 relay 의 sound MODEL 특성에 쓰는 model update frame 을 DEAN node 로 전달한다.
+ *  - hub 는 relay 에서 바로 DATA ACK 를 받고, relay -> node 구간은
+ *    write-without-response 를 window 만큼 겹쳐서 보낸다. (hub 왕복 + node 왕복 직렬화 제거)
+ *  - 옵션: SD 카드에 먼저 전부 저장한 뒤 node 로 밀어 넣는다. (CONFIG_RELAY_MODEL_STAGE_SD)
+ */
+#include "model_update_proxy.h"
+
+#include <string.h>
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/logging/log.h>
+
+#include "sound.h"
+#include "sound_service.h"
+#include "relay_stats.h"
+#include "radio_airtime.h"
+#include "relay_bulk.h"
+#include "node_stream.h"
+#if defined(CONFIG_RELAY_MODEL_STAGE_SD)
+#include <zephyr/fs/fs.h>
+#include "sdcard.h"
+#endif
+
+LOG_MODULE_REGISTER(model_proxy, LOG_LEVEL_INF);
+
+#define MODEL_FRAME_HDR_SIZE    offsetof(struct ble_model_update_packet, data)
+#define MODEL_TX_TIMEOUT_MS     2000
+#define MODEL_BULK_RETRY_MS     2
+/* node 가 START 에 flash erase 등을 하므로 넉넉히 */
+#define MODEL_START_TIMEOUT_MS  10000
+#define MODEL_STAGE_FILE        "/SD:/model.bin"
+
+struct model_frame
+{
+    uint16_t len;
+    uint8_t data[sizeof(struct ble_model_update_packet)];
+};
+
+K_MSGQ_DEFINE(model_frame_msgq, sizeof(struct model_frame), CONFIG_RELAY_MODEL_QUEUE_DEPTH, 4);
+/* relay -> node 로 나가 있는 frame 수 제한 */
+K_SEM_DEFINE(model_tx_slots, 0, CONFIG_RELAY_MODEL_TX_WINDOW);
+/* SD replay: node 의 START ACK (또는 FAILED / 연결 끊김) */
+K_SEM_DEFINE(model_start_acked, 0, 1);
+
+static struct
+{
+    struct bt_conn *conn;
+    uint16_t handle;
+    bool wwr;               /* node MODEL 특성이 write-without-response 지원 */
+    atomic_t aborted;       /* node FAILED 또는 연결 끊김 -> 남은 frame 버림 */
+    bool replaying;         /* SD staging 된 model 을 node 로 보내는 중 */
+    bool seq_valid;         /* START 이후 첫 DATA 를 받았음 */
+    uint16_t next_seq;      /* 다음에 queue 에 넣을 DATA seq */
+    bool gap_failed;        /* 지금 빠진 seq 에 대해 FAILED 를 이미 보냈음 */
+    uint32_t frames;
+    int64_t start_ms;
+} mp;
+
+static struct bt_gatt_write_params model_write_params;
+static uint8_t model_write_buf[sizeof(struct ble_model_update_packet)];
+
+static void model_ack_hub(uint8_t cmd, uint16_t seq)
+{
+    struct ble_ack_packet ack_packet = {
+        .cmd = cmd,
+        .seq = seq,
+    };
+
+    int err = relay_bulk_send(RELAY_BULK_LINK_HUB, RELAY_BULK_MODEL_UPDATE,
+                              &ack_packet, sizeof(ack_packet));
+    /* bulk channel 이 없거나 꽉 찼으면 GATT notification 으로 */
+    if (err == -ENOTCONN || err == -ENOMEM) {
+        err = bt_sound_notify_model(&ack_packet, sizeof(ack_packet));
+    }
+    if (err) {
+        LOG_DBG("[MODEL] hub ack cmd=%u seq=%u not sent (err %d)", cmd, seq, err);
+    }
+}
+
+/* ----------------- relay -> node ----------------- */
+
+static void model_wwr_done(struct bt_conn *conn, void *user_data)
+{
+    k_sem_give(&model_tx_slots);
+}
+
+static void model_write_rsp(struct bt_conn *conn, uint8_t att_err, struct bt_gatt_write_params *params)
+{
+    if (att_err) {
+        const struct ble_model_update_packet *packet = (const void *)model_write_buf;
+
+        /* node 가 frame 을 받지 않음: 남은 frame 을 보내면 node image 에 구멍이 난다 */
+        LOG_WRN("[MODEL] node write cmd=%u seq=%u failed (att err 0x%02x), abort",
+                packet->cmd, packet->seq, att_err);
+        atomic_set(&mp.aborted, 1);
+        k_msgq_purge(&model_frame_msgq);
+        k_sem_give(&model_start_acked);
+        model_ack_hub(BLE_MODEL_UPDATE_CMD_FAILED, packet->seq);
+    }
+    k_sem_give(&model_tx_slots);
+}
+
+/* node 가 bulk channel 을 받았으면 window 대신 L2CAP credit 으로 흐름 제어 */
+static int model_node_send_bulk(const uint8_t *data, uint16_t len)
+{
+    int64_t deadline = k_uptime_get() + MODEL_TX_TIMEOUT_MS;
+    int err;
+
+    while ((err = relay_bulk_send(RELAY_BULK_LINK_NODE, RELAY_BULK_MODEL_UPDATE, data, len)) == -ENOMEM) {
+        if (k_uptime_get() > deadline) {
+            return -ETIMEDOUT;
+        }
+        k_sleep(K_MSEC(MODEL_BULK_RETRY_MS));
+    }
+    return err;
+}
+
+static int model_node_send(const uint8_t *data, uint16_t len)
+{
+    struct bt_conn *conn = mp.conn;
+    int err;
+
+    if (!conn || atomic_get(&mp.aborted)) {
+        return -ENOTCONN;
+    }
+
+    err = model_node_send_bulk(data, len);
+    if (err != -ENOTCONN) {
+        return err;
+    }
+
+    err = k_sem_take(&model_tx_slots, K_MSEC(MODEL_TX_TIMEOUT_MS));
+    if (err) {
+        return (err == -EAGAIN) ? -ECANCELED : -ETIMEDOUT;
+    }
+
+    if (mp.wwr) {
+        err = bt_gatt_write_without_response_cb(conn, mp.handle, data, len, false,
+                                                model_wwr_done, NULL);
+    } else {
+        /* write request 는 ATT 상 한 번에 하나 (window 1) */
+        memcpy(model_write_buf, data, len);
+        model_write_params.func = model_write_rsp;
+        model_write_params.handle = mp.handle;
+        model_write_params.offset = 0;
+        model_write_params.data = model_write_buf;
+        model_write_params.length = len;
+        err = bt_gatt_write(conn, &model_write_params);
+    }
+
+    if (err) {
+        k_sem_give(&model_tx_slots);
+    } else {
+        radio_airtime_pdu(RADIO_LINK_NODE, len);
+    }
+    return err;
+}
+
+#if defined(CONFIG_RELAY_MODEL_STAGE_SD)
+static struct fs_file_t stage_fp;
+static bool stage_open;
+static struct model_frame stage_start_frame;
+static uint16_t stage_next_seq;
+static bool stage_seq_valid;
+
+static int model_stage_replay(const struct model_frame *end_frame)
+{
+    struct ble_model_update_packet packet;
+    ssize_t n;
+    int err;
+
+    mp.replaying = true;
+
+    k_sem_reset(&model_start_acked);
+    err = model_node_send(stage_start_frame.data, stage_start_frame.len);
+    if (!err) {
+        /* node 가 START 를 받아 준비될 때까지 DATA 를 보내지 않는다 */
+        if (k_sem_take(&model_start_acked, K_MSEC(MODEL_START_TIMEOUT_MS))) {
+            LOG_WRN("[MODEL] node did not ACK START");
+            err = -ETIMEDOUT;
+        } else if (atomic_get(&mp.aborted)) {
+            err = -ECANCELED;
+        }
+    }
+
+    k_mutex_lock(&sdcard_mutex, K_FOREVER);
+    fs_seek(&stage_fp, 0, FS_SEEK_SET);
+    k_mutex_unlock(&sdcard_mutex);
+
+    packet.cmd = BLE_MODEL_UPDATE_CMD_DATA;
+    packet.seq = 0;
+    while (!err) {
+        k_mutex_lock(&sdcard_mutex, K_FOREVER);
+        n = fs_read(&stage_fp, packet.data, sizeof(packet.data));
+        k_mutex_unlock(&sdcard_mutex);
+
+        if (n <= 0) {
+            err = (int)n;
+            break;
+        }
+
+        err = model_node_send((const uint8_t *)&packet, MODEL_FRAME_HDR_SIZE + n);
+        packet.seq++;
+    }
+
+    if (!err) {
+        err = model_node_send(end_frame->data, end_frame->len);
+    }
+
+    k_mutex_lock(&sdcard_mutex, K_FOREVER);
+    fs_close(&stage_fp);
+    k_mutex_unlock(&sdcard_mutex);
+    stage_open = false;
+
+    return err;
+}
+
+static int model_stage_frame(const struct model_frame *f)
+{
+    const struct ble_model_update_packet *packet = (const void *)f->data;
+    ssize_t n;
+    int err = 0;
+
+    switch (packet->cmd) {
+    case BLE_MODEL_UPDATE_CMD_START:
+        err = mount_sdcard();
+        if (err) {
+            break;
+        }
+        k_mutex_lock(&sdcard_mutex, K_FOREVER);
+        if (stage_open) {
+            fs_close(&stage_fp);
+        }
+        fs_unlink(MODEL_STAGE_FILE);
+        fs_file_t_init(&stage_fp);
+        err = fs_open(&stage_fp, MODEL_STAGE_FILE, FS_O_CREATE | FS_O_RDWR);
+        k_mutex_unlock(&sdcard_mutex);
+        stage_open = (err == 0);
+        if (!err) {
+            stage_start_frame = *f;
+            stage_seq_valid = false;
+            mp.replaying = false;
+            model_ack_hub(BLE_MODEL_UPDATE_CMD_START, packet->seq);
+        }
+        break;
+
+    case BLE_MODEL_UPDATE_CMD_DATA:
+        if (!stage_open) {
+            err = -EBADF;
+            break;
+        }
+        /* 파일 offset = 도착 순서. 빠지거나 뒤바뀐 frame 은 image 를 망가뜨린다 */
+        if (stage_seq_valid && packet->seq != stage_next_seq) {
+            LOG_WRN("[MODEL] stage expected seq %u, got %u", stage_next_seq, packet->seq);
+            err = -EILSEQ;
+            break;
+        }
+        stage_seq_valid = true;
+        stage_next_seq = packet->seq + 1;
+        k_mutex_lock(&sdcard_mutex, K_FOREVER);
+        n = fs_write(&stage_fp, packet->data, f->len - MODEL_FRAME_HDR_SIZE);
+        k_mutex_unlock(&sdcard_mutex);
+        err = (n < 0) ? (int)n : 0;
+        break;
+
+    case BLE_MODEL_UPDATE_CMD_END:
+        if (!stage_open) {
+            err = -EBADF;
+            break;
+        }
+        LOG_INF("[MODEL] staged %u frames on SD, pushing to node", mp.frames);
+        err = model_stage_replay(f);
+        break;
+
+    default:
+        err = model_node_send(f->data, f->len);
+        break;
+    }
+
+    return err;
+}
+#endif
+
+static void model_proxy_thread(void *p1, void *p2, void *p3)
+{
+    struct model_frame f;
+    int err;
+
+    while (1) {
+        k_msgq_get(&model_frame_msgq, &f, K_FOREVER);
+
+#if defined(CONFIG_RELAY_MODEL_STAGE_SD)
+        err = model_stage_frame(&f);
+#else
+        err = model_node_send(f.data, f.len);
+#endif
+        relay_stats_tx(RELAY_STREAM_SOUND_MODEL, err);
+        if (err) {
+            const struct ble_model_update_packet *packet = (const void *)f.data;
+
+            LOG_WRN("[MODEL] forward cmd=%u seq=%u failed (err %d)", packet->cmd, packet->seq, err);
+            atomic_set(&mp.aborted, 1);
+            k_msgq_purge(&model_frame_msgq);
+            model_ack_hub(BLE_MODEL_UPDATE_CMD_FAILED, packet->seq);
+        }
+    }
+}
+
+K_THREAD_DEFINE(model_proxy_tid, CONFIG_RELAY_MODEL_THREAD_STACK_SIZE,
+                model_proxy_thread, NULL, NULL, NULL,
+                CONFIG_RELAY_MODEL_THREAD_PRIORITY, 0, 0);
+
+/* ----------------- hub -> relay (BT RX thread) ----------------- */
+
+void process_model_update_write(const void *buf, uint16_t len)
+{
+    const struct ble_model_update_packet *packet = buf;
+    struct model_frame f;
+
+    if (len < MODEL_FRAME_HDR_SIZE || len > sizeof(f.data)) {
+        LOG_WRN("[MODEL] bad frame length %u", len);
+        return;
+    }
+
+    relay_stats_rx(RELAY_STREAM_SOUND_MODEL);
+
+    if (packet->cmd == BLE_MODEL_UPDATE_CMD_START) {
+        atomic_set(&mp.aborted, 0);
+        mp.frames = 0;
+        mp.start_ms = k_uptime_get();
+        mp.seq_valid = false;
+        mp.gap_failed = false;
+    }
+
+    if (!IS_ENABLED(CONFIG_RELAY_MODEL_STAGE_SD) && !mp.conn) {
+        model_ack_hub(BLE_MODEL_UPDATE_CMD_FAILED, packet->seq);
+        return;
+    }
+
+    if (atomic_get(&mp.aborted)) {
+        model_ack_hub(BLE_MODEL_UPDATE_CMD_FAILED, packet->seq);
+        return;
+    }
+
+    if (packet->cmd == BLE_MODEL_UPDATE_CMD_END && mp.gap_failed) {
+        /* 빠진 frame 이 아직 다시 오지 않았음 */
+        model_ack_hub(BLE_MODEL_UPDATE_CMD_FAILED, mp.next_seq);
+        return;
+    }
+
+    if (packet->cmd == BLE_MODEL_UPDATE_CMD_DATA && mp.seq_valid &&
+        packet->seq != mp.next_seq) {
+        if ((int16_t)(packet->seq - mp.next_seq) < 0) {
+            /* 이미 queue 에 넣은 frame 의 재전송: ACK 만 다시 */
+            model_ack_hub(BLE_MODEL_UPDATE_CMD_DATA, packet->seq);
+        } else if (!mp.gap_failed) {
+            /* 앞 frame 이 빠졌음: 순서대로만 넣는다. 빠진 seq 를 한 번 FAILED 로 알려
+             * hub 가 거기서부터 다시 보내게 한다 */
+            mp.gap_failed = true;
+            model_ack_hub(BLE_MODEL_UPDATE_CMD_FAILED, mp.next_seq);
+        }
+        return;
+    }
+
+    f.len = len;
+    memcpy(f.data, buf, len);
+
+    if (k_msgq_put(&model_frame_msgq, &f, K_NO_WAIT)) {
+        /* hub 가 window 보다 앞서 나감: 이 seq 부터 다시 보내도록 FAILED */
+        LOG_WRN("[MODEL] frame queue full, drop seq %u", packet->seq);
+        relay_stats_tx(RELAY_STREAM_SOUND_MODEL, -ENOMEM);
+        if (packet->cmd == BLE_MODEL_UPDATE_CMD_DATA && !mp.seq_valid) {
+            mp.seq_valid = true;
+            mp.next_seq = packet->seq;
+        }
+        mp.gap_failed = true;
+        model_ack_hub(BLE_MODEL_UPDATE_CMD_FAILED, packet->seq);
+        return;
+    }
+    relay_stats_queue_level(RELAY_QUEUE_MODEL_FRAMES, k_msgq_num_used_get(&model_frame_msgq));
+
+    if (packet->cmd == BLE_MODEL_UPDATE_CMD_DATA) {
+        /* DATA 는 relay 가 대신 ACK -> hub 는 node 왕복을 기다리지 않는다 */
+        mp.seq_valid = true;
+        mp.next_seq = packet->seq + 1;
+        mp.gap_failed = false;
+        mp.frames++;
+        model_ack_hub(BLE_MODEL_UPDATE_CMD_DATA, packet->seq);
+    }
+}
+
+/* ----------------- node -> relay -> hub ----------------- */
+
+void model_update_proxy_node_notify(const void *data, uint16_t len)
+{
+    const struct ble_ack_packet *ack = data;
+    int64_t elapsed_ms;
+
+    if (len < sizeof(*ack)) {
+        return;
+    }
+
+    switch (ack->cmd) {
+    case BLE_MODEL_UPDATE_CMD_DATA:
+        /* DATA ACK 는 이미 relay 가 hub 에 보냈음 */
+        break;
+
+    case BLE_MODEL_UPDATE_CMD_START:
+        if (mp.replaying) {
+            k_sem_give(&model_start_acked);
+        } else {
+            model_ack_hub(ack->cmd, ack->seq);
+        }
+        break;
+
+    case BLE_MODEL_UPDATE_CMD_END:
+        elapsed_ms = MAX(k_uptime_get() - mp.start_ms, 1);
+        LOG_INF("[MODEL] update done: %u frames in %u ms (%u B/s)",
+                mp.frames, (uint32_t)elapsed_ms,
+                (uint32_t)(mp.frames * BLE_SOUND_MODEL_FRAME_SIZE * 1000ULL / elapsed_ms));
+        mp.replaying = false;
+        model_ack_hub(ack->cmd, ack->seq);
+        break;
+
+    case BLE_MODEL_UPDATE_CMD_FAILED:
+        LOG_WRN("[MODEL] node reported failure at seq %u", ack->seq);
+        atomic_set(&mp.aborted, 1);
+        k_msgq_purge(&model_frame_msgq);
+        k_sem_give(&model_start_acked);
+        mp.replaying = false;
+        model_ack_hub(ack->cmd, ack->seq);
+        break;
+
+    default:
+        model_ack_hub(ack->cmd, ack->seq);
+        break;
+    }
+}
+
+void model_update_proxy_node_ready(struct bt_conn *conn, uint16_t value_handle, uint8_t properties)
+{
+    mp.conn = conn;
+    mp.handle = value_handle;
+    mp.wwr = (properties & BT_GATT_CHRC_WRITE_WITHOUT_RESP) != 0;
+    atomic_set(&mp.aborted, 0);
+
+    /* proxy thread 가 k_sem_take 로 기다리고 있을 수 있으니 k_sem_init 대신 reset 후 채운다.
+     * reset 으로 깨어난 thread 는 -EAGAIN 을 받고 그 frame 을 실패로 처리한다 */
+    k_sem_reset(&model_tx_slots);
+    for (int i = 0; i < (mp.wwr ? CONFIG_RELAY_MODEL_TX_WINDOW : 1); i++) {
+        k_sem_give(&model_tx_slots);
+    }
+
+    LOG_INF("[MODEL] node MODEL char at 0x%04x (%s)", value_handle,
+            mp.wwr ? "write-without-response" : "write request");
+}
+
+void model_update_proxy_node_lost(void)
+{
+    mp.conn = NULL;
+    mp.handle = 0;
+    atomic_set(&mp.aborted, 1);
+    k_msgq_purge(&model_frame_msgq);
+    /* 나가 있던 frame 의 완료 콜백 / START ACK 를 기다리던 thread 를 깨운다 */
+    k_sem_give(&model_tx_slots);
+    k_sem_give(&model_start_acked);
+}
+
+static void model_stream_ready(struct bt_conn *conn, uint16_t value_handle, uint8_t properties)
+{
+    /* rediscover 로 같은 handle 을 다시 찾았으면 진행 중인 update 유지 */
+    if (conn == mp.conn && value_handle == mp.handle) {
+        return;
+    }
+    model_update_proxy_node_ready(conn, value_handle, properties);
+}
+
+static int model_stream_notify(const void *data, uint16_t len)
+{
+    model_update_proxy_node_notify(data, len);
+    return 0;
+}
+
+NODE_STREAM_DEFINE(sound_model, BT_UUID_CHRC_SOUND_MODEL, RELAY_STREAM_SOUND_MODEL,
+                   .ready = model_stream_ready,
+                   .notify = model_stream_notify,
+                   .lost = model_update_proxy_node_lost);
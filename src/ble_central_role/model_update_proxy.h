@@ -0,0 +1,47 @@
+#ifndef _MODEL_UPDATE_PROXY_H_
+#define _MODEL_UPDATE_PROXY_H_
+
+#include <stdint.h>
+#include <zephyr/bluetooth/conn.h>
+
+/** @brief Sound model update proxy (SLIMHUB -> relay -> DE&N node).
+ *
+ * The hub writes struct ble_model_update_packet frames to the relay's sound
+ * MODEL characteristic (process_model_update_write() in sound.h).
+ *  - DATA frames are ACKed to the hub as soon as they are queued on the relay,
+ *    and forwarded to the node with at most CONFIG_RELAY_MODEL_TX_WINDOW
+ *    write-without-response frames in flight.
+ *  - DATA frames are queued strictly in seq order. A frame dropped because the
+ *    queue is full is answered with ACK{FAILED, seq}, and later frames are not
+ *    queued (nor ACKed) until the hub sends that seq again; END is refused
+ *    while such a gap is open.
+ *  - START / END / REMOVE and every FAILED ACK of the node are passed back
+ *    upstream as they are, so the hub still sees the node's verdict.
+ *  - A node write request answered with an ATT error aborts the update and
+ *    the hub gets ACK{FAILED, seq}.
+ *  - With CONFIG_RELAY_MODEL_STAGE_SD the whole model is first stored on the
+ *    relay SD card and pushed to the node after END. The relay waits for the
+ *    node's START ACK before pushing the DATA frames.
+ */
+
+/**
+ * @brief The node's sound MODEL characteristic was discovered.
+ *
+ * @param conn is the node connection.
+ * @param value_handle is the MODEL characteristic value handle.
+ * @param properties are the characteristic properties (BT_GATT_CHRC_*).
+ */
+void model_update_proxy_node_ready(struct bt_conn *conn, uint16_t value_handle, uint8_t properties);
+
+/** @brief The node connection is gone. Pending frames are dropped. */
+void model_update_proxy_node_lost(void);
+
+/**
+ * @brief ACK notification from the node's MODEL characteristic.
+ *
+ * @param data is a struct ble_ack_packet.
+ * @param len is the notification length.
+ */
+void model_update_proxy_node_notify(const void *data, uint16_t len);
+
+#endif
@@ -0,0 +1,59 @@
+/* node_stream.c
+ *
+ * 목적:
+ *  - node characteristic 을 처리하는 module 이 NODE_STREAM_DEFINE 으로 UUID 와 handler 를 등록한다.
+ *  - discovery 때 UUID 로 찾아 value handle 을 기록하고 ready() 를 부른다.
+ *  - notification dispatch 는 ble_relay_control.c 가 구독 slot -> node_stream 표로 한다.
+ *    (여기 목록을 훑는 건 discovery / stall 복구 때뿐)
+ */
+#include "node_stream.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(node_stream, LOG_LEVEL_INF);
+
+struct node_stream *node_stream_discovered(struct bt_conn *conn, const struct bt_uuid *uuid,
+                                           uint16_t value_handle, uint8_t properties)
+{
+    STRUCT_SECTION_FOREACH(node_stream, s) {
+        if (bt_uuid_cmp(s->uuid, uuid)) {
+            continue;
+        }
+
+        LOG_INF("[DISCOVER] found %s char at 0x%04x", s->name, value_handle);
+        if (s->ready) {
+            s->ready(conn, value_handle, properties);
+        }
+        s->value_handle = value_handle;
+        return s;
+    }
+    return NULL;
+}
+
+struct node_stream *node_stream_of(enum relay_stream stream)
+{
+    STRUCT_SECTION_FOREACH(node_stream, s) {
+        if (s->stream == stream) {
+            return s;
+        }
+    }
+    return NULL;
+}
+
+uint16_t node_stream_value_handle(enum relay_stream stream)
+{
+    struct node_stream *s = node_stream_of(stream);
+
+    return s ? s->value_handle : 0;
+}
+
+void node_stream_lost(void)
+{
+    STRUCT_SECTION_FOREACH(node_stream, s) {
+        if (s->lost) {
+            s->lost();
+        }
+        s->value_handle = 0;
+    }
+}
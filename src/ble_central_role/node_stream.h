@@ -0,0 +1,77 @@
+#ifndef _NODE_STREAM_H_
+#define _NODE_STREAM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/uuid.h>
+#include <zephyr/sys/iterable_sections.h>
+
+#include "relay_stats.h"
+
+/** @brief Node characteristic handlers, registered by UUID.
+ *
+ * A module that consumes a node characteristic defines a struct node_stream
+ * with NODE_STREAM_DEFINE(). During discovery the relay looks the
+ * characteristic UUID up among these definitions, records the value handle,
+ * calls ready() and subscribes when the characteristic can notify.
+ *
+ * Every subscription slot of the node link points to its node_stream, so a
+ * notification reaches its handler in constant time however many streams
+ * are defined, and a new sensor stream needs no change in the relay core.
+ * Characteristics without a node_stream are left to the GATT proxy
+ * (CONFIG_RELAY_GATT_PROXY), otherwise subscribed and logged as unknown.
+ */
+struct node_stream
+{
+    const char *name;
+    const struct bt_uuid *uuid;         /* characteristic UUID on the node */
+    enum relay_stream stream;           /* liveness / stall recovery, RELAY_STREAM_COUNT: none */
+    bool no_subscribe;                  /* read / write only, even if it can notify */
+
+    /** Found on the node, again after every rediscovery. Optional. */
+    void (*ready)(struct bt_conn *conn, uint16_t value_handle, uint8_t properties);
+    /** Notification (BT RX thread). @return forward result (trace only), or
+     *  -EBADMSG if the packet is malformed: it then does not count for liveness. */
+    int (*notify)(const void *data, uint16_t len);
+    /** The node link is gone. Optional. */
+    void (*lost)(void);
+
+    uint16_t value_handle;              /* on the current node, 0: not found (set by the relay) */
+};
+
+/**
+ * @brief Register a node stream.
+ *
+ * @param _name is the variable name, also used in logs.
+ * @param _uuid is the characteristic UUID (const struct bt_uuid *).
+ * @param _stream is the enum relay_stream, RELAY_STREAM_COUNT for none.
+ * @param ... are the remaining struct node_stream initializers.
+ */
+#define NODE_STREAM_DEFINE(_name, _uuid, _stream, ...)  \
+    STRUCT_SECTION_ITERABLE(node_stream, _name) = {     \
+        .name = #_name,                                 \
+        .uuid = _uuid,                                  \
+        .stream = _stream,                              \
+        __VA_ARGS__                                     \
+    }
+
+/**
+ * @brief A characteristic was discovered on the node.
+ *
+ * @return the node_stream registered for @p uuid (value handle recorded and
+ *         ready() called), NULL if there is none.
+ */
+struct node_stream *node_stream_discovered(struct bt_conn *conn, const struct bt_uuid *uuid,
+                                           uint16_t value_handle, uint8_t properties);
+
+/** @brief The node_stream feeding @p stream, NULL if none is registered. */
+struct node_stream *node_stream_of(enum relay_stream stream);
+
+/** @brief Value handle of @p stream on the current node, 0 if not found. */
+uint16_t node_stream_value_handle(enum relay_stream stream);
+
+/** @brief The node link is gone: forget the handles and call every lost(). */
+void node_stream_lost(void);
+
+#endif
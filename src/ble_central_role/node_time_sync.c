@@ -0,0 +1,363 @@
+/* node_time_sync.c
+ *
+ * 목적:
+ *  - node 들의 시계를 relay 시계 (hub 의 CTS 로 맞춰진) 에 맞춘다.
+ *  - 연결 직후 한 번 쓰고, 이후에는 node 의 CTS 를 읽어서 얼마나 틀어졌는지만 본다.
+ *    (read 1 번 = 작은 ATT 요청/응답, push 는 필요할 때만)
+ *  - 틀어진 정도 / 지난 push 이후 시간 = node drift. 다음 확인은 drift 로
+ *    CONFIG_RELAY_NODE_TIME_ERROR_MS 만큼 틀어질 때쯤으로 잡는다.
+ *  - push 는 node 에 도착할 때의 시간을 쓴다 (지난 RTT / 2, 처음에는 conn interval 만큼 앞선 값).
+ *  - hub 가 relay 시간을 설정하기 전에는 아무것도 보내지 않고, 설정될 때마다 다시 push 한다.
+ */
+#include "node_time_sync.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/logging/log.h>
+
+#include "clock.h"
+#include "cts.h"
+#include "relay_workq.h"
+#include "node_stream.h"
+
+LOG_MODULE_REGISTER(node_time_sync, LOG_LEVEL_INF);
+
+#define NODE_TIME_SLOTS         CONFIG_BT_MAX_CONN
+#define NODE_TIME_ERROR_US      (CONFIG_RELAY_NODE_TIME_ERROR_MS * 1000LL)
+/* 이보다 크게 틀리면 drift 가 아니라 relay 또는 node 시계가 새로 설정된 것 */
+#define NODE_TIME_STEP_US       (1000LL * 1000LL)
+/* subscribe write 들이 먼저 나가도록 */
+#define NODE_TIME_FIRST_PUSH_MS 200
+/* CTS 는 1/256 s 로 잘리므로 반 칸 앞선 값을 써서 반올림 */
+#define NODE_TIME_HALF_TICK_US  (1000000LL / 512)
+
+struct node_time
+{
+    struct bt_conn *conn;
+    uint16_t handle;
+    bool started;           /* node_time_sync_start() 이후 */
+    bool write_rsp;         /* Current Time 이 write request 를 받음 */
+    struct k_work_delayable work;
+
+    /* ATT 요청이 걸려 있는 동안 (att_busy) 에는 slot 을 다시 써도 이 params 는 건드리지 않는다 */
+    struct bt_gatt_read_params read_params;
+    struct bt_gatt_write_params write_params;
+    struct cts_datetime push_ct;
+    bool att_busy;
+    bool att_stale;         /* 걸려 있는 요청은 rediscovery 이전 것: 결과를 버림 */
+
+    int64_t read_start_us;  /* read 요청 시각 (uptime) */
+    int64_t write_start_us; /* write request 시각 (uptime) */
+    int64_t rtt_us;         /* 마지막 ATT 요청/응답 시간, 0 = 아직 */
+    int64_t push_us;        /* 마지막 push 가 node 에 닿은 시각 (uptime), 0 = 아직 */
+    uint32_t clock_sets;    /* push 때의 clock_set_count() */
+    int32_t drift_ppb;      /* + : node 가 빠름 */
+    bool drift_valid;
+
+    uint32_t pushes;
+    uint32_t checks;
+};
+
+static struct node_time nodes[NODE_TIME_SLOTS];
+
+static struct node_time *node_time_find(struct bt_conn *conn)
+{
+    for (int i = 0; i < NODE_TIME_SLOTS; i++) {
+        if (nodes[i].conn == conn) {
+            return &nodes[i];
+        }
+    }
+    return NULL;
+}
+
+static void node_time_schedule(struct node_time *nt, uint32_t delay_s)
+{
+    k_work_reschedule_for_queue(&relay_link_workq, &nt->work, K_SECONDS(delay_s));
+}
+
+static void node_time_write_cb(struct bt_conn *conn, uint8_t att_err,
+                               struct bt_gatt_write_params *params)
+{
+    struct node_time *nt = CONTAINER_OF(params, struct node_time, write_params);
+
+    nt->att_busy = false;
+    if (nt->att_stale || nt->conn != conn) {
+        nt->att_stale = false;
+        return;
+    }
+
+    if (att_err) {
+        LOG_WRN("[TIMESYNC] push failed (att err 0x%02x)", att_err);
+        nt->push_us = 0;
+        nt->drift_valid = false;
+        return;
+    }
+    nt->rtt_us = clock_uptime_us() - nt->write_start_us;
+}
+
+/* request 가 node 에 닿기까지: 재어 본 RTT 의 절반, 아직 없으면 conn interval 하나 */
+static int64_t node_time_lead_us(const struct node_time *nt)
+{
+    struct bt_conn_info info;
+
+    if (nt->rtt_us) {
+        return nt->rtt_us / 2;
+    }
+    if (bt_conn_get_info(nt->conn, &info) == 0) {
+        return (int64_t)info.le.interval * 1250;
+    }
+    return 0;
+}
+
+static int node_time_push(struct node_time *nt)
+{
+    int64_t lead_us = node_time_lead_us(nt);
+    int64_t now_up = clock_uptime_us();
+    int err;
+
+    cts_from_epoch_us(clock_now_us() + lead_us + NODE_TIME_HALF_TICK_US, &nt->push_ct);
+    /* 응답이 이 함수보다 먼저 올 수 있으므로 보내기 전에 */
+    nt->push_us = now_up + lead_us;
+    nt->clock_sets = clock_set_count();
+
+    if (nt->write_rsp) {
+        memset(&nt->write_params, 0, sizeof(nt->write_params));
+        nt->write_params.func = node_time_write_cb;
+        nt->write_params.handle = nt->handle;
+        nt->write_params.data = &nt->push_ct;
+        nt->write_params.length = sizeof(nt->push_ct);
+
+        nt->write_start_us = now_up;
+        nt->att_busy = true;
+        err = bt_gatt_write(nt->conn, &nt->write_params);
+        if (err) {
+            nt->att_busy = false;
+        }
+    } else {
+        err = bt_gatt_write_without_response(nt->conn, nt->handle, &nt->push_ct,
+                                             sizeof(nt->push_ct), false);
+    }
+
+    if (err) {
+        LOG_WRN("[TIMESYNC] push failed (err %d)", err);
+        nt->push_us = 0;
+        return err;
+    }
+    nt->pushes++;
+    return 0;
+}
+
+/* node 가 residual_us 만큼 틀어진 상태에서 오차 한도에 닿을 때까지 (s) */
+static uint32_t node_time_next_check_s(const struct node_time *nt, int64_t residual_us)
+{
+    int64_t budget_us = NODE_TIME_ERROR_US - llabs(residual_us);
+    int64_t drift = llabs(nt->drift_ppb);
+    int64_t interval_s;
+
+    if (!nt->drift_valid || drift == 0) {
+        return CONFIG_RELAY_NODE_TIME_SYNC_MIN_S;
+    }
+
+    /* budget_us / (drift_ppb / 1e9) */
+    interval_s = MAX(budget_us, 0) * 1000LL / drift;
+    return CLAMP(interval_s, CONFIG_RELAY_NODE_TIME_SYNC_MIN_S, CONFIG_RELAY_NODE_TIME_SYNC_MAX_S);
+}
+
+static uint8_t node_time_read_cb(struct bt_conn *conn, uint8_t att_err,
+                                 struct bt_gatt_read_params *params,
+                                 const void *data, uint16_t length)
+{
+    struct node_time *nt = CONTAINER_OF(params, struct node_time, read_params);
+    int64_t now_up = clock_uptime_us();
+    int64_t rtt_us = now_up - nt->read_start_us;
+    int64_t mid_up = nt->read_start_us + rtt_us / 2;
+    int64_t offset_us;
+    uint32_t next_s;
+
+    nt->att_busy = false;
+    if (nt->att_stale || nt->conn != conn) {
+        nt->att_stale = false;
+        return BT_GATT_ITER_STOP;
+    }
+
+    if (att_err || !data || length < sizeof(struct cts_datetime)) {
+        LOG_WRN("[TIMESYNC] read failed (att err 0x%02x, len %u)", att_err, length);
+        node_time_schedule(nt, CONFIG_RELAY_NODE_TIME_SYNC_MIN_S);
+        return BT_GATT_ITER_STOP;
+    }
+
+    /* node 가 응답한 시점 ~ 요청/응답의 중간. CTS 해상도는 1/256 s */
+    offset_us = cts_to_epoch_us(data) - (clock_now_us() - (now_up - mid_up));
+    nt->rtt_us = rtt_us;
+    nt->checks++;
+
+    if (offset_us > NODE_TIME_STEP_US || offset_us < -NODE_TIME_STEP_US) {
+        /* 시계가 새로 설정됨: drift 는 다시 잰다 */
+        LOG_INF("[TIMESYNC] node off by %lld ms, resync", offset_us / 1000);
+        nt->drift_valid = false;
+        node_time_push(nt);
+        node_time_schedule(nt, CONFIG_RELAY_NODE_TIME_SYNC_MIN_S);
+        return BT_GATT_ITER_STOP;
+    }
+
+    if (nt->push_us && mid_up > nt->push_us) {
+        int32_t measured = (int32_t)(offset_us * 1000000000LL / (mid_up - nt->push_us));
+
+        nt->drift_ppb = nt->drift_valid ? (nt->drift_ppb * 3 + measured) / 4 : measured;
+        nt->drift_valid = true;
+    }
+
+    if (llabs(offset_us) > NODE_TIME_ERROR_US / 2) {
+        node_time_push(nt);
+        next_s = node_time_next_check_s(nt, 0);
+    } else {
+        /* 아직 충분히 맞음: push 없이 다음 확인만 */
+        next_s = node_time_next_check_s(nt, offset_us);
+    }
+
+    LOG_INF("[TIMESYNC] node offset %lld us (rtt %lld us), drift %d ppb, next check %u s, %u pushes / %u checks",
+            offset_us, rtt_us, nt->drift_ppb, next_s, nt->pushes, nt->checks);
+    node_time_schedule(nt, next_s);
+    return BT_GATT_ITER_STOP;
+}
+
+static void node_time_work_handler(struct k_work *work)
+{
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    struct node_time *nt = CONTAINER_OF(dwork, struct node_time, work);
+    int err;
+
+    if (!nt->conn) {
+        return;
+    }
+
+    if (nt->att_busy) {
+        /* 이전 read / write 의 응답을 기다린다 */
+        k_work_reschedule_for_queue(&relay_link_workq, &nt->work, K_MSEC(NODE_TIME_FIRST_PUSH_MS));
+        return;
+    }
+
+    if (!clock_set_count()) {
+        /* hub 가 아직 시간을 쓰지 않음: 부팅 기본값을 퍼뜨리지 않는다.
+         * 설정되면 node_time_sync_clock_set() 이 다시 깨운다 */
+        LOG_DBG("[TIMESYNC] relay clock not set yet");
+        return;
+    }
+
+    if (!nt->push_us || nt->clock_sets != clock_set_count()) {
+        /* 연결 직후 또는 relay 시간이 새로 설정됨: 읽지 않고 바로 쓴다 */
+        nt->drift_valid = false;
+        err = node_time_push(nt);
+        node_time_schedule(nt, CONFIG_RELAY_NODE_TIME_SYNC_MIN_S);
+        if (!err) {
+            LOG_INF("[TIMESYNC] push done (%u)", nt->pushes);
+        }
+        return;
+    }
+
+    memset(&nt->read_params, 0, sizeof(nt->read_params));
+    nt->read_params.func = node_time_read_cb;
+    nt->read_params.handle_count = 1;
+    nt->read_params.single.handle = nt->handle;
+    nt->read_params.single.offset = 0;
+
+    nt->read_start_us = clock_uptime_us();
+    nt->att_busy = true;
+    err = bt_gatt_read(nt->conn, &nt->read_params);
+    if (err) {
+        nt->att_busy = false;
+        LOG_WRN("[TIMESYNC] read start failed (err %d)", err);
+        node_time_schedule(nt, CONFIG_RELAY_NODE_TIME_SYNC_MIN_S);
+    }
+}
+
+void node_time_sync_ready(struct bt_conn *conn, uint16_t value_handle, uint8_t properties)
+{
+    struct node_time *nt = node_time_find(conn);
+    bool busy;
+
+    if (nt) {
+        /* 같은 연결에서 다시 discovery */
+        k_work_cancel_delayable(&nt->work);
+    } else {
+        nt = node_time_find(NULL);
+    }
+    if (!nt) {
+        LOG_WRN("[TIMESYNC] no free slot");
+        return;
+    }
+
+    /* GATT read / write 는 취소할 수 없다: params 는 두고, 응답이 오면 버린다 */
+    busy = nt->att_busy;
+    if (!busy) {
+        memset(nt, 0, sizeof(*nt));
+        k_work_init_delayable(&nt->work, node_time_work_handler);
+    } else {
+        nt->att_stale = true;
+        nt->started = false;
+        nt->rtt_us = 0;
+        nt->push_us = 0;
+        nt->clock_sets = 0;
+        nt->drift_ppb = 0;
+        nt->drift_valid = false;
+        nt->pushes = 0;
+        nt->checks = 0;
+    }
+    nt->conn = conn;
+    nt->handle = value_handle;
+    nt->write_rsp = (properties & BT_GATT_CHRC_WRITE) != 0;
+}
+
+void node_time_sync_start(struct bt_conn *conn)
+{
+    struct node_time *nt = node_time_find(conn);
+
+    if (nt && conn) {
+        nt->started = true;
+        k_work_reschedule_for_queue(&relay_link_workq, &nt->work, K_MSEC(NODE_TIME_FIRST_PUSH_MS));
+    }
+}
+
+void node_time_sync_clock_set(void)
+{
+    for (int i = 0; i < NODE_TIME_SLOTS; i++) {
+        if (nodes[i].conn && nodes[i].started) {
+            k_work_reschedule_for_queue(&relay_link_workq, &nodes[i].work, K_NO_WAIT);
+        }
+    }
+}
+
+void node_time_sync_node_lost(struct bt_conn *conn)
+{
+    struct node_time *nt = node_time_find(conn);
+
+    if (!nt || !conn) {
+        return;
+    }
+
+    k_work_cancel_delayable(&nt->work);
+    if (nt->checks) {
+        LOG_INF("[TIMESYNC] node lost: drift %d ppb, %u pushes / %u checks",
+                nt->drift_ppb, nt->pushes, nt->checks);
+    }
+    nt->conn = NULL;
+    nt->handle = 0;
+    nt->started = false;
+}
+
+#if defined(CONFIG_RELAY_NODE_TIME_SYNC)
+static void cts_stream_ready(struct bt_conn *conn, uint16_t value_handle, uint8_t properties)
+{
+    node_time_sync_ready(conn, value_handle, properties);
+}
+
+/* read / write 만 쓴다. node 의 CTS notify 는 구독하지 않는다 */
+NODE_STREAM_DEFINE(cts_current_time, BT_UUID_CTS_CURRENT_TIME, RELAY_STREAM_COUNT,
+                   .no_subscribe = true,
+                   .ready = cts_stream_ready);
+#endif
@@ -0,0 +1,49 @@
+#ifndef _NODE_TIME_SYNC_H_
+#define _NODE_TIME_SYNC_H_
+
+#include <stdint.h>
+#include <zephyr/bluetooth/conn.h>
+
+/** @brief Time sync push from the relay to the connected DE&N nodes.
+ *
+ * The relay writes its clock (clock.h) to the node's CTS Current Time
+ * characteristic right after the node is subscribed. Afterwards it reads
+ * the node's time back, and from the offset found since the last push it
+ * estimates the node's drift. The next check is scheduled when the node is
+ * expected to be CONFIG_RELAY_NODE_TIME_ERROR_MS off, within
+ * [CONFIG_RELAY_NODE_TIME_SYNC_MIN_S, CONFIG_RELAY_NODE_TIME_SYNC_MAX_S],
+ * and a new push is only sent when the node is more than half of that off.
+ *
+ * A push carries the time at which it is expected to reach the node (half
+ * the last measured ATT round trip, one connection interval before the
+ * first one). Nothing is pushed before the hub has set the relay clock.
+ */
+
+/**
+ * @brief The node's CTS Current Time characteristic was discovered.
+ *
+ * @param conn is the node connection.
+ * @param value_handle is the Current Time value handle.
+ * @param properties are the characteristic properties; with BT_GATT_CHRC_WRITE
+ *        the push is a write request and its round trip is measured.
+ */
+void node_time_sync_ready(struct bt_conn *conn, uint16_t value_handle, uint8_t properties);
+
+/**
+ * @brief Discovery and subscriptions of the node are done: push the time now.
+ *
+ * @param conn is the node connection.
+ */
+void node_time_sync_start(struct bt_conn *conn);
+
+/** @brief The relay clock was set anew (clock_set_count() changed): push it to every node. */
+void node_time_sync_clock_set(void);
+
+/**
+ * @brief The node connection is gone.
+ *
+ * @param conn is the node connection.
+ */
+void node_time_sync_node_lost(struct bt_conn *conn);
+
+#endif
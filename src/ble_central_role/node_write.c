@@ -0,0 +1,388 @@
+/* node_write.c
+ *
+ * 목적:
+ *  - hub 가 relay 에 쓴 제어 값 (grideye prediction, unitspace 추정, 이름 / 위치, proxy 된 값) 을
+ *    node 로 전달하는 downstream write queue.
+ *  - hub 에는 바로 답하고, relay -> node 구간은 relay_fwd_workq 에서 순서대로 보낸다.
+ *    write-without-response 는 window 만큼 겹치고, write request 는 ATT 상 한 번에 하나.
+ *  - 아직 안 나간 같은 handle 의 write 는 마지막 값 하나로 합친다. (NODE_WRITE_COALESCE)
+ */
+#include "node_write.h"
+
+#include <string.h>
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/logging/log.h>
+
+#include "config_service.h"
+#include "grideye_service.h"
+#include "inference_service.h"
+#include "radio_airtime.h"
+#include "relay_stats.h"
+#include "relay_workq.h"
+
+LOG_MODULE_REGISTER(node_write, LOG_LEVEL_INF);
+
+#define NODE_WRITE_QUEUE_LEN    CONFIG_RELAY_NODE_WRITE_QUEUE_LEN
+#define NODE_WRITE_MAX          CONFIG_RELAY_NODE_WRITE_MAX
+/* TX buffer 가 없을 때 다시 시도하는 간격 */
+#define NODE_WRITE_RETRY_MS     5
+
+struct node_write_entry
+{
+    uint16_t handle;
+    uint16_t len;
+    uint8_t flags;
+    node_write_done_t done;
+    void *user_data;
+    uint8_t data[NODE_WRITE_MAX];
+};
+
+static struct
+{
+    struct bt_conn *conn;
+    struct k_spinlock lock;
+    struct node_write_entry q[NODE_WRITE_QUEUE_LEN];    /* 아직 안 나간 write (ring) */
+    uint8_t head;
+    uint8_t cnt;
+    bool req_busy;              /* write request 가 node 에 나가 있다 */
+    atomic_t cmd_inflight;      /* TX buffer 를 기다리는 write command */
+    uint32_t coalesced;
+} nw;
+
+/* 진행 중인 write request (params.data 가 가리킨다) */
+static struct node_write_entry req;
+static struct bt_gatt_write_params req_params;
+
+/* relay 특성 -> node 특성 */
+static const struct bt_uuid *const target_uuid[NODE_WRITE_TARGET_COUNT] = {
+    [NODE_WRITE_GRIDEYE_PRED] = BT_UUID_CHRC_GRIDEYE_PREDICTION,
+    [NODE_WRITE_UNITSPACE]    = BT_UUID_CHRC_INFERENCE_RAWDATA,
+    [NODE_WRITE_DEVICE_NAME]  = BT_UUID_CHRC_DEVICE_NAME,
+    [NODE_WRITE_LOCATION]     = BT_UUID_CHRC_LOCATION,
+};
+
+static struct
+{
+    uint16_t handle;
+    uint8_t props;
+} target[NODE_WRITE_TARGET_COUNT];
+
+static void node_write_work_handler(struct k_work *work);
+K_WORK_DELAYABLE_DEFINE(node_write_work, node_write_work_handler);
+
+static void node_write_kick(void)
+{
+    k_work_reschedule_for_queue(&relay_fwd_workq, &node_write_work, K_NO_WAIT);
+}
+
+static void node_write_finish(const struct node_write_entry *e, int err)
+{
+    /* ATT error 는 relay_stats 에서 "other" */
+    relay_stats_tx(RELAY_STREAM_NODE_WRITE, err > 0 ? -EIO : err);
+
+    if (err) {
+        LOG_WRN("[NODE_WR] write 0x%04x (%u bytes) failed (err %d)", e->handle, e->len, err);
+    }
+    if (e->done) {
+        e->done(e->handle, e->data, e->len, err, e->user_data);
+    }
+}
+
+/* 같은 handle 의 합칠 수 있는 write 가 queue 에 있나 (lock 안에서).
+ * 완료 callback 이 있는 write 는 덮어쓰지 않는다: 호출자는 그 결과를 기다린다 */
+static struct node_write_entry *node_write_find(uint16_t handle)
+{
+    for (int i = 0; i < nw.cnt; i++) {
+        struct node_write_entry *e = &nw.q[(nw.head + i) % NODE_WRITE_QUEUE_LEN];
+
+        if (e->handle == handle && (e->flags & NODE_WRITE_COALESCE) && !e->done) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+int node_write_submit(uint16_t handle, const void *data, uint16_t len, uint8_t flags,
+                      node_write_done_t done, void *user_data)
+{
+    struct node_write_entry *e = NULL;
+    k_spinlock_key_t key;
+    uint8_t level;
+
+    if (!nw.conn || !handle) {
+        return -ENOTCONN;
+    }
+    if (len > NODE_WRITE_MAX) {
+        return -EINVAL;
+    }
+
+    relay_stats_rx(RELAY_STREAM_NODE_WRITE);
+
+    key = k_spin_lock(&nw.lock);
+
+    if (flags & NODE_WRITE_COALESCE) {
+        e = node_write_find(handle);
+        if (e) {
+            nw.coalesced++;
+        }
+    }
+    if (!e) {
+        if (nw.cnt == NODE_WRITE_QUEUE_LEN) {
+            k_spin_unlock(&nw.lock, key);
+            relay_stats_tx(RELAY_STREAM_NODE_WRITE, -ENOMEM);
+            LOG_WRN("[NODE_WR] queue full, write 0x%04x rejected", handle);
+            return -ENOMEM;
+        }
+        e = &nw.q[(nw.head + nw.cnt) % NODE_WRITE_QUEUE_LEN];
+        nw.cnt++;
+    }
+
+    e->handle = handle;
+    e->len = len;
+    e->flags = flags;
+    e->done = done;
+    e->user_data = user_data;
+    memcpy(e->data, data, len);
+    level = nw.cnt;
+
+    k_spin_unlock(&nw.lock, key);
+
+    relay_stats_queue_level(RELAY_QUEUE_NODE_WRITES, level);
+    node_write_kick();
+    return 0;
+}
+
+int node_write_target(enum node_write_target t, const void *data, uint16_t len)
+{
+    uint8_t flags = NODE_WRITE_COALESCE;
+
+    if (t >= NODE_WRITE_TARGET_COUNT) {
+        return -EINVAL;
+    }
+    if (target[t].props & BT_GATT_CHRC_WRITE_WITHOUT_RESP) {
+        flags |= NODE_WRITE_CMD;
+    }
+    return node_write_submit(target[t].handle, data, len, flags, NULL, NULL);
+}
+
+ssize_t node_write_att_err(int err, uint16_t len)
+{
+    switch (err) {
+    case 0:
+        return len;
+    case -EINVAL:
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+    case -ENOMEM:
+        return BT_GATT_ERR(BT_ATT_ERR_INSUFFICIENT_RESOURCES);
+    default:
+        return BT_GATT_ERR(BT_ATT_ERR_UNLIKELY);
+    }
+}
+
+/* ----------------- relay -> node (relay_fwd_workq) ----------------- */
+
+static void node_write_cmd_sent(struct bt_conn *conn, void *user_data)
+{
+    /* node_lost 뒤 늦게 오는 callback 은 무시 */
+    if (atomic_get(&nw.cmd_inflight) > 0) {
+        atomic_dec(&nw.cmd_inflight);
+    }
+    node_write_kick();
+}
+
+static void node_write_rsp(struct bt_conn *conn, uint8_t att_err, struct bt_gatt_write_params *params)
+{
+    k_spinlock_key_t key;
+
+    /* 끊긴 연결의 응답: node_write_node_lost 가 이미 -ENOTCONN 으로 끝냈다 */
+    if (conn != nw.conn) {
+        return;
+    }
+
+    node_write_finish(&req, att_err);
+
+    key = k_spin_lock(&nw.lock);
+    nw.req_busy = false;
+    k_spin_unlock(&nw.lock, key);
+
+    node_write_kick();
+}
+
+static int node_write_send(const struct node_write_entry *e)
+{
+    int err;
+
+    if (e->flags & NODE_WRITE_CMD) {
+        atomic_inc(&nw.cmd_inflight);
+        err = bt_gatt_write_without_response_cb(nw.conn, e->handle, e->data, e->len, false,
+                                                node_write_cmd_sent, NULL);
+        if (err) {
+            atomic_dec(&nw.cmd_inflight);
+            return err;
+        }
+        radio_airtime_pdu(RADIO_LINK_NODE, e->len);
+        /* write command 는 stack 에 넘긴 것으로 끝 */
+        node_write_finish(e, 0);
+        return 0;
+    }
+
+    req = *e;
+    req_params.func = node_write_rsp;
+    req_params.handle = req.handle;
+    req_params.offset = 0;
+    req_params.data = req.data;
+    req_params.length = req.len;
+
+    err = bt_gatt_write(nw.conn, &req_params);
+    if (err) {
+        k_spinlock_key_t key = k_spin_lock(&nw.lock);
+
+        nw.req_busy = false;
+        k_spin_unlock(&nw.lock, key);
+        return err;
+    }
+    radio_airtime_pdu(RADIO_LINK_NODE, e->len);
+    return 0;
+}
+
+/* TX buffer 부족으로 못 보낸 write 를 queue 맨 앞으로 되돌린다 */
+static void node_write_requeue(const struct node_write_entry *e)
+{
+    k_spinlock_key_t key = k_spin_lock(&nw.lock);
+
+    if ((e->flags & NODE_WRITE_COALESCE) && !e->done && node_write_find(e->handle)) {
+        /* 그 사이 새 값이 들어왔다 */
+        nw.coalesced++;
+        k_spin_unlock(&nw.lock, key);
+        return;
+    }
+    if (nw.cnt < NODE_WRITE_QUEUE_LEN) {
+        nw.head = (nw.head + NODE_WRITE_QUEUE_LEN - 1) % NODE_WRITE_QUEUE_LEN;
+        nw.q[nw.head] = *e;
+        nw.cnt++;
+        k_spin_unlock(&nw.lock, key);
+        return;
+    }
+    k_spin_unlock(&nw.lock, key);
+    node_write_finish(e, -ENOMEM);
+}
+
+static void node_write_work_handler(struct k_work *work)
+{
+    struct node_write_entry e;
+    k_spinlock_key_t key;
+    int err;
+
+    while (nw.conn) {
+        const struct node_write_entry *head;
+        bool cmd;
+
+        key = k_spin_lock(&nw.lock);
+        if (!nw.cnt) {
+            k_spin_unlock(&nw.lock, key);
+            return;
+        }
+
+        /* window 가 찼거나 request 가 나가 있으면 완료 callback 이 다시 깨운다 */
+        head = &nw.q[nw.head];
+        cmd = head->flags & NODE_WRITE_CMD;
+        if (cmd ? atomic_get(&nw.cmd_inflight) >= CONFIG_RELAY_NODE_WRITE_WINDOW : nw.req_busy) {
+            k_spin_unlock(&nw.lock, key);
+            return;
+        }
+
+        e = *head;
+        nw.head = (nw.head + 1) % NODE_WRITE_QUEUE_LEN;
+        nw.cnt--;
+        if (!cmd) {
+            nw.req_busy = true;
+        }
+        k_spin_unlock(&nw.lock, key);
+
+        err = node_write_send(&e);
+        if (err == -ENOMEM) {
+            node_write_requeue(&e);
+            k_work_reschedule_for_queue(&relay_fwd_workq, &node_write_work,
+                                        K_MSEC(NODE_WRITE_RETRY_MS));
+            return;
+        }
+        if (err) {
+            node_write_finish(&e, err);
+        }
+    }
+}
+
+/* ----------------- node link ----------------- */
+
+void node_write_node_chrc(const struct bt_uuid *uuid, uint16_t value_handle, uint8_t properties)
+{
+    if (!(properties & (BT_GATT_CHRC_WRITE | BT_GATT_CHRC_WRITE_WITHOUT_RESP))) {
+        return;
+    }
+
+    for (int i = 0; i < NODE_WRITE_TARGET_COUNT; i++) {
+        if (!bt_uuid_cmp(uuid, target_uuid[i])) {
+            target[i].handle = value_handle;
+            target[i].props = properties;
+            LOG_DBG("[NODE_WR] target %d -> 0x%04x%s", i, value_handle,
+                    (properties & BT_GATT_CHRC_WRITE_WITHOUT_RESP) ? " (cmd)" : "");
+        }
+    }
+}
+
+void node_write_node_ready(struct bt_conn *conn)
+{
+    if (nw.conn == conn) {
+        /* 같은 연결에서 다시 discovery (stall 복구): queue 유지 */
+        node_write_kick();
+        return;
+    }
+
+    nw.conn = conn;
+    nw.req_busy = false;
+    atomic_set(&nw.cmd_inflight, 0);
+    node_write_kick();
+}
+
+void node_write_node_lost(void)
+{
+    struct node_write_entry e;
+    k_spinlock_key_t key = k_spin_lock(&nw.lock);
+    bool req_busy = nw.req_busy;
+    uint8_t dropped = 0;
+
+    nw.conn = NULL;
+    nw.req_busy = false;
+    k_spin_unlock(&nw.lock, key);
+
+    k_work_cancel_delayable(&node_write_work);
+    memset(target, 0, sizeof(target));
+
+    /* 모든 완료 callback 은 정확히 한 번: 나가 있던 request 와 queue 에 남은 write 도 끝낸다 */
+    if (req_busy) {
+        node_write_finish(&req, -ENOTCONN);
+    }
+    while (true) {
+        key = k_spin_lock(&nw.lock);
+        if (!nw.cnt) {
+            nw.head = 0;
+            k_spin_unlock(&nw.lock, key);
+            break;
+        }
+        e = nw.q[nw.head];
+        nw.head = (nw.head + 1) % NODE_WRITE_QUEUE_LEN;
+        nw.cnt--;
+        k_spin_unlock(&nw.lock, key);
+
+        node_write_finish(&e, -ENOTCONN);
+        dropped++;
+    }
+    if (dropped || nw.coalesced) {
+        LOG_INF("[NODE_WR] node lost: %u queued writes dropped, %u coalesced", dropped, nw.coalesced);
+    }
+    nw.coalesced = 0;
+}
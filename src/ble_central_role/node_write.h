@@ -0,0 +1,80 @@
+#ifndef _NODE_WRITE_H_
+#define _NODE_WRITE_H_
+
+#include <stdint.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/uuid.h>
+
+/** @brief Downstream write queue (SLIMHUB -> relay -> DE&N node).
+ *
+ * Hub writes that have to reach the node are answered to the hub right away
+ * and queued on the relay, up to CONFIG_RELAY_NODE_WRITE_QUEUE_LEN writes.
+ * relay_fwd_workq sends them in order:
+ *  - write commands (write-without-response) are pipelined, at most
+ *    CONFIG_RELAY_NODE_WRITE_WINDOW waiting for a TX buffer at a time.
+ *  - write requests go one at a time (ATT allows one outstanding request).
+ *
+ * With NODE_WRITE_COALESCE a write replaces a queued, not yet sent write to
+ * the same handle, so a burst of control values only sends the last one.
+ * A queued write with a completion callback is never replaced, so every
+ * callback is called exactly once.
+ *
+ * A full queue, an oversized value or a missing node is returned to the
+ * caller (node_write_att_err() maps it to the hub's ATT error). Failures
+ * on the node side are reported to the optional completion callback and
+ * counted in relay_stats as RELAY_STREAM_NODE_WRITE.
+ */
+
+/** node_write_submit() flags */
+#define NODE_WRITE_CMD          BIT(0)  /* write-without-response */
+#define NODE_WRITE_COALESCE     BIT(1)  /* replace a queued write to the same handle */
+
+/** Relay characteristics whose hub writes are forwarded to the node. */
+enum node_write_target
+{
+    NODE_WRITE_GRIDEYE_PRED,    /* grideye prediction */
+    NODE_WRITE_UNITSPACE,       /* inference rawdata: unitspace existence estimation */
+    NODE_WRITE_DEVICE_NAME,     /* config device name */
+    NODE_WRITE_LOCATION,        /* config location */
+    NODE_WRITE_TARGET_COUNT,
+};
+
+/**
+ * @brief Write finished on the node.
+ *
+ * @param err is 0, a negative errno of the send or a positive ATT error.
+ *            Write commands complete when they are handed to the stack.
+ */
+typedef void (*node_write_done_t)(uint16_t handle, const void *data, uint16_t len,
+                                  int err, void *user_data);
+
+/**
+ * @brief Queue a write to a node value handle.
+ *
+ * @return 0, -ENOTCONN (no node), -EINVAL (too long) or -ENOMEM (queue full).
+ */
+int node_write_submit(uint16_t handle, const void *data, uint16_t len, uint8_t flags,
+                      node_write_done_t done, void *user_data);
+
+/**
+ * @brief Forward a hub write of one of the relay's characteristics.
+ *
+ * Coalesced, and sent as write command when the node characteristic allows it.
+ */
+int node_write_target(enum node_write_target target, const void *data, uint16_t len);
+
+/** @brief ATT write callback result for a node_write_submit() / _target() return value. */
+ssize_t node_write_att_err(int err, uint16_t len);
+
+/** @brief A node characteristic was discovered (binds the forwarded targets). */
+void node_write_node_chrc(const struct bt_uuid *uuid, uint16_t value_handle, uint8_t properties);
+
+/** @brief Node discovery is done, start sending. */
+void node_write_node_ready(struct bt_conn *conn);
+
+/** @brief The node link is gone. Queued and outstanding writes complete with -ENOTCONN. */
+void node_write_node_lost(void);
+
+#endif
@@ -1,3 +1,8 @@
+#ifndef _PERIPHERAL_SERVICE_H_
+#define _PERIPHERAL_SERVICE_H_
+
+#include <stddef.h>
+#include <stdint.h>
 #include "ble.h"
 
 /** peripheral service UUID definitions*/
@@ -22,6 +27,33 @@
 #define BT_UUID_peripheral_ACTION_SERVICE BT_UUID_DECLARE_128(BT_UUID_peripheral_ACTION_SERVICE_VAL)
 #define BT_UUID_CHRC_peripheral_ACTION_DATA BT_UUID_DECLARE_128(BT_UUID_CHRC_peripheral_ACTION_DATA_VAL)
 
+/** Room device profiles (room_device.h) */
+enum peripheral_action_profile
+{
+    PERIPHERAL_ACTION_BUTTON = 1,   /* NUS, "BUTTON_" name */
+    PERIPHERAL_ACTION_PAAR   = 2,   /* PAAR service */
+    PERIPHERAL_ACTION_UBINOS = 3,   /* Ubinos UART service */
+};
+
+#define PERIPHERAL_ACTION_DATA_MAX  32
+
+/** Peripheral action notification: one room device event. All fields little endian. */
+struct ble_peripheral_action_packet
+{
+    uint8_t profile;            /* enum peripheral_action_profile */
+    uint8_t device;             /* room device slot on the relay */
+    uint8_t addr[6];            /* device address */
+    uint16_t seq;               /* per device, from 0 after every connection */
+    uint32_t time_ms;           /* relay receive time, low 32 bits of Unix ms */
+    uint8_t len;                /* bytes of data (longer events are cut) */
+    uint8_t data[PERIPHERAL_ACTION_DATA_MAX];   /* device payload, UART text without CR / LF */
+} __attribute__((packed));
+
+#define PERIPHERAL_ACTION_HDR_SIZE  offsetof(struct ble_peripheral_action_packet, data)
+
+/** @brief Notify a room device event to the hub (CONFIG_RELAY_ROOM_DEVICES). */
+int bt_peripheral_notify_action(const void *data, uint16_t len);
+
 
 
 /* 타깃 디바이스 광고 이름 (Bluefruit.setName("BUTTON_RECORD_ULP")) */
@@ -29,19 +61,23 @@
 /* 타깃 디바이스 광고 이름은 설치되는 디바이스 이름 마다 서로 다르게 표현 */
 /* */
 
-/* Nordic UART Service (Adafruit BLEUart) 128-bit UUID */
-static struct bt_uuid_128 NUS_SVC_UUID = BT_UUID_INIT_128(
+/* Nordic UART Service (Adafruit BLEUart) 128-bit UUID.
+ * 헤더에 static 객체를 두지 않는다 (include 하는 파일마다 unused 경고) */
+#define NUS_SVC_UUID_VAL \
     BT_UUID_128_ENCODE(0x6E400001, 0xB5A3, 0xF393, 0xE0A9, 0xE50E24DCCA9E)
-);
 
 /* (옵션) TX/RX 캐릭터리스틱 UUID — 디스커버리/구독 시 사용 */
-static struct bt_uuid_128 NUS_TX_UUID = BT_UUID_INIT_128(
+#define NUS_TX_UUID_VAL \
     BT_UUID_128_ENCODE(0x6E400003, 0xB5A3, 0xF393, 0xE0A9, 0xE50E24DCCA9E)
-);
-static struct bt_uuid_128 NUS_RX_UUID = BT_UUID_INIT_128(
+#define NUS_RX_UUID_VAL \
     BT_UUID_128_ENCODE(0x6E400002, 0xB5A3, 0xF393, 0xE0A9, 0xE50E24DCCA9E)
-);
+
+#define NUS_SVC_UUID    BT_UUID_DECLARE_128(NUS_SVC_UUID_VAL)
+#define NUS_TX_UUID     BT_UUID_DECLARE_128(NUS_TX_UUID_VAL)
+#define NUS_RX_UUID     BT_UUID_DECLARE_128(NUS_RX_UUID_VAL)
 
 #ifndef MIN
 #define MIN(a, b) ((a) < (b) ? (a) : (b))
-#endif
\ No newline at end of file
+#endif
+
+#endif
@@ -0,0 +1,372 @@
+/* radio_airtime.c
+ *
+ * 목적:
+ *  - scan 100% duty + connectable adv + central / peripheral 연결 두 개가
+ *    radio 하나를 나눠 쓰는데, 어디에 시간이 쓰이는지 추정한다.
+ *  - 파라미터 (scan interval/window, adv interval, conn interval, PHY, data length)
+ *    와 실제 relay 된 PDU 수로 window 마다 활동별 점유율을 계산한다.
+ *
+ * 정확한 controller 스케줄이 아니라 "필요한 radio 시간" 추정이다.
+ * 합이 100% 를 넘으면 controller 가 scan window 를 잘라내거나 conn event 를 건너뛴다.
+ */
+#include "radio_airtime.h"
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gap.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/logging/log.h>
+
+#include "relay_workq.h"
+#include "diag_service.h"
+#include "room_device.h"
+
+LOG_MODULE_REGISTER(radio_airtime, LOG_LEVEL_INF);
+
+#define RADIO_IFS_US            150
+#define RADIO_ADV_CHANNELS      3
+#define RADIO_ADDR_LEN          6
+#define RADIO_LL_OVERHEAD       (4 + 2 + 3)     /* access address + header + CRC */
+#define RADIO_L2CAP_ATT_HDR     (4 + 3)         /* L2CAP header + ATT opcode/handle */
+#define RADIO_DEFAULT_TX_LEN    27
+
+struct airtime_link
+{
+    bool connected;
+    int64_t since_ms;
+    uint32_t on_ms;
+    uint32_t interval_us;
+    uint8_t phy;
+    uint16_t tx_max_len;
+    atomic_t data_us;
+};
+
+static struct
+{
+    struct k_spinlock lock;
+
+    uint16_t scan_interval;
+    uint16_t scan_window;
+    bool scan_on;
+    int64_t scan_since_ms;
+    uint32_t scan_ms;
+
+    uint32_t adv_interval_us;
+    uint16_t adv_len;
+    bool adv_on;
+    int64_t adv_since_ms;
+    uint32_t adv_ms;
+
+    struct airtime_link link[RADIO_LINK_COUNT];
+
+    int64_t window_start_ms;
+    bool oversubscribed;
+    struct radio_airtime_report last;
+} at;
+
+static void airtime_window_handler(struct k_work *work);
+K_WORK_DELAYABLE_DEFINE(airtime_window_work, airtime_window_handler);
+
+/* PDU 하나의 on-air 시간 (us) */
+static uint32_t airtime_pdu_us(uint8_t phy, uint16_t payload)
+{
+    uint32_t bytes = RADIO_LL_OVERHEAD + payload;
+
+    switch (phy) {
+    case BT_GAP_LE_PHY_2M:
+        return (2 + bytes) * 4;
+    case BT_GAP_LE_PHY_CODED:
+        /* S=8 기준 */
+        return (1 + bytes) * 64;
+    default:
+        return (1 + bytes) * 8;
+    }
+}
+
+/* data 가 없는 connection event (empty PDU 왕복) */
+static uint32_t airtime_empty_event_us(uint8_t phy)
+{
+    return 2 * airtime_pdu_us(phy, 0) + 2 * RADIO_IFS_US;
+}
+
+/* ADV_IND x 3 채널. scan request / response 는 hub 가 scan 할 때만이라 뺀다 */
+static uint32_t airtime_adv_event_us(void)
+{
+    return RADIO_ADV_CHANNELS * (airtime_pdu_us(BT_GAP_LE_PHY_1M, RADIO_ADDR_LEN + at.adv_len) +
+                                 RADIO_IFS_US);
+}
+
+static uint16_t airtime_permille(uint64_t us, uint32_t window_ms)
+{
+    return (uint16_t)MIN(us / window_ms, UINT16_MAX);
+}
+
+static enum radio_link airtime_link_of(struct bt_conn *conn, struct bt_conn_info *info)
+{
+    /* room device link 는 node link 가 아니다 (room_device.h) */
+    if (bt_conn_get_info(conn, info) || room_device_owns(conn)) {
+        return RADIO_LINK_COUNT;
+    }
+    return (info->role == BT_CONN_ROLE_CENTRAL) ? RADIO_LINK_NODE : RADIO_LINK_HUB;
+}
+
+static void airtime_link_update(struct airtime_link *l, const struct bt_conn_info *info)
+{
+    l->interval_us = info->le.interval * 1250U;
+    if (info->le.phy) {
+        l->phy = info->le.phy->tx_phy;
+    }
+#if defined(CONFIG_BT_USER_DATA_LEN_UPDATE)
+    if (info->le.data_len) {
+        l->tx_max_len = info->le.data_len->tx_max_len;
+    }
+#endif
+}
+
+/* ----------------- state hooks ----------------- */
+
+void radio_airtime_scan_params(uint16_t interval, uint16_t window)
+{
+    at.scan_interval = interval;
+    at.scan_window = window;
+}
+
+void radio_airtime_adv_params(uint32_t interval_us, uint16_t adv_len)
+{
+    at.adv_interval_us = interval_us;
+    at.adv_len = adv_len;
+}
+
+void radio_airtime_scan(bool on)
+{
+    k_spinlock_key_t key = k_spin_lock(&at.lock);
+
+    if (on && !at.scan_on) {
+        at.scan_since_ms = k_uptime_get();
+    } else if (!on && at.scan_on) {
+        at.scan_ms += (uint32_t)(k_uptime_get() - at.scan_since_ms);
+    }
+    at.scan_on = on;
+
+    k_spin_unlock(&at.lock, key);
+}
+
+void radio_airtime_adv(bool on)
+{
+    k_spinlock_key_t key = k_spin_lock(&at.lock);
+
+    if (on && !at.adv_on) {
+        at.adv_since_ms = k_uptime_get();
+    } else if (!on && at.adv_on) {
+        at.adv_ms += (uint32_t)(k_uptime_get() - at.adv_since_ms);
+    }
+    at.adv_on = on;
+
+    k_spin_unlock(&at.lock, key);
+}
+
+void radio_airtime_pdu(enum radio_link link, uint16_t att_len)
+{
+    struct airtime_link *l = &at.link[link];
+    uint32_t total = att_len + RADIO_L2CAP_ATT_HDR;
+    uint16_t frag = l->tx_max_len ? l->tx_max_len : RADIO_DEFAULT_TX_LEN;
+    uint32_t npdu = DIV_ROUND_UP(total, frag);
+    uint32_t us;
+
+    /* payload 만큼 길어진 PDU + fragment 마다 추가 왕복 */
+    us = airtime_pdu_us(l->phy, total) - airtime_pdu_us(l->phy, 0) +
+         (npdu - 1) * airtime_empty_event_us(l->phy);
+    atomic_add(&l->data_us, (atomic_val_t)us);
+}
+
+static void airtime_connected(struct bt_conn *conn, uint8_t err)
+{
+    struct bt_conn_info info;
+    enum radio_link link;
+    k_spinlock_key_t key;
+
+    if (err) {
+        return;
+    }
+    link = airtime_link_of(conn, &info);
+    if (link == RADIO_LINK_COUNT) {
+        return;
+    }
+
+    key = k_spin_lock(&at.lock);
+    at.link[link].connected = true;
+    at.link[link].since_ms = k_uptime_get();
+    at.link[link].phy = BT_GAP_LE_PHY_1M;
+    at.link[link].tx_max_len = RADIO_DEFAULT_TX_LEN;
+    airtime_link_update(&at.link[link], &info);
+    k_spin_unlock(&at.lock, key);
+}
+
+static void airtime_disconnected(struct bt_conn *conn, uint8_t reason)
+{
+    struct bt_conn_info info;
+    enum radio_link link = airtime_link_of(conn, &info);
+    k_spinlock_key_t key;
+
+    if (link == RADIO_LINK_COUNT) {
+        return;
+    }
+
+    key = k_spin_lock(&at.lock);
+    if (at.link[link].connected) {
+        at.link[link].on_ms += (uint32_t)(k_uptime_get() - at.link[link].since_ms);
+    }
+    at.link[link].connected = false;
+    k_spin_unlock(&at.lock, key);
+}
+
+static void airtime_params_changed(struct bt_conn *conn)
+{
+    struct bt_conn_info info;
+    enum radio_link link = airtime_link_of(conn, &info);
+    k_spinlock_key_t key;
+
+    if (link == RADIO_LINK_COUNT) {
+        return;
+    }
+
+    key = k_spin_lock(&at.lock);
+    airtime_link_update(&at.link[link], &info);
+    k_spin_unlock(&at.lock, key);
+}
+
+static void airtime_le_param_updated(struct bt_conn *conn, uint16_t interval,
+                                     uint16_t latency, uint16_t timeout)
+{
+    airtime_params_changed(conn);
+}
+
+#if defined(CONFIG_BT_USER_PHY_UPDATE)
+static void airtime_le_phy_updated(struct bt_conn *conn, struct bt_conn_le_phy_info *param)
+{
+    airtime_params_changed(conn);
+}
+#endif
+
+#if defined(CONFIG_BT_USER_DATA_LEN_UPDATE)
+static void airtime_le_data_len_updated(struct bt_conn *conn, struct bt_conn_le_data_len_info *info)
+{
+    airtime_params_changed(conn);
+}
+#endif
+
+BT_CONN_CB_DEFINE(airtime_conn_callbacks) = {
+    .connected = airtime_connected,
+    .disconnected = airtime_disconnected,
+    .le_param_updated = airtime_le_param_updated,
+#if defined(CONFIG_BT_USER_PHY_UPDATE)
+    .le_phy_updated = airtime_le_phy_updated,
+#endif
+#if defined(CONFIG_BT_USER_DATA_LEN_UPDATE)
+    .le_data_len_updated = airtime_le_data_len_updated,
+#endif
+};
+
+/* ----------------- window ----------------- */
+
+static void airtime_window_handler(struct k_work *work)
+{
+    struct radio_airtime_report r = { 0 };
+    uint64_t link_us[RADIO_LINK_COUNT];
+    uint64_t scan_us = 0, adv_us = 0;
+    uint32_t total_pm = 0;
+    k_spinlock_key_t key;
+    int64_t now;
+
+    key = k_spin_lock(&at.lock);
+    now = k_uptime_get();
+    r.window_ms = MAX((uint32_t)(now - at.window_start_ms), 1);
+    at.window_start_ms = now;
+
+    if (at.scan_on) {
+        at.scan_ms += (uint32_t)(now - at.scan_since_ms);
+        at.scan_since_ms = now;
+    }
+    if (at.adv_on) {
+        at.adv_ms += (uint32_t)(now - at.adv_since_ms);
+        at.adv_since_ms = now;
+    }
+
+    if (at.scan_interval) {
+        scan_us = (uint64_t)at.scan_ms * 1000U * at.scan_window / at.scan_interval;
+    }
+    if (at.adv_interval_us) {
+        adv_us = (uint64_t)at.adv_ms * 1000U / at.adv_interval_us * airtime_adv_event_us();
+    }
+
+    for (int i = 0; i < RADIO_LINK_COUNT; i++) {
+        struct airtime_link *l = &at.link[i];
+
+        if (l->connected) {
+            l->on_ms += (uint32_t)(now - l->since_ms);
+            l->since_ms = now;
+            r.link_interval_us125[i] = l->interval_us / 1250U;
+        }
+
+        link_us[i] = (uint64_t)atomic_set(&l->data_us, 0);
+        if (l->interval_us) {
+            link_us[i] += (uint64_t)l->on_ms * 1000U / l->interval_us * airtime_empty_event_us(l->phy);
+        }
+        l->on_ms = 0;
+    }
+
+    at.scan_ms = 0;
+    at.adv_ms = 0;
+    k_spin_unlock(&at.lock, key);
+
+    r.scan_pm = airtime_permille(scan_us, r.window_ms);
+    r.adv_pm = airtime_permille(adv_us, r.window_ms);
+    total_pm = r.scan_pm + r.adv_pm;
+    for (int i = 0; i < RADIO_LINK_COUNT; i++) {
+        r.link_pm[i] = airtime_permille(link_us[i], r.window_ms);
+        total_pm += r.link_pm[i];
+    }
+    r.total_pm = (uint16_t)MIN(total_pm, UINT16_MAX);
+    r.oversubscribed = (total_pm > CONFIG_RELAY_AIRTIME_WARN_PERMILLE);
+
+    LOG_INF("[AIRTIME] scan %u.%u%% adv %u.%u%% node %u.%u%% hub %u.%u%% = %u.%u%%",
+            r.scan_pm / 10, r.scan_pm % 10, r.adv_pm / 10, r.adv_pm % 10,
+            r.link_pm[RADIO_LINK_NODE] / 10, r.link_pm[RADIO_LINK_NODE] % 10,
+            r.link_pm[RADIO_LINK_HUB] / 10, r.link_pm[RADIO_LINK_HUB] % 10,
+            r.total_pm / 10, r.total_pm % 10);
+
+    /* 상태가 바뀔 때만 경고 (scan 100% duty 면 연결 중에는 항상 넘는다) */
+    if (r.oversubscribed && !at.oversubscribed) {
+        LOG_WRN("[AIRTIME] radio oversubscribed (%u.%u%%): scan window %u/%u, node interval %u us, "
+                "hub interval %u us -> scan window is cut by the controller",
+                r.total_pm / 10, r.total_pm % 10, at.scan_window, at.scan_interval,
+                at.link[RADIO_LINK_NODE].interval_us, at.link[RADIO_LINK_HUB].interval_us);
+    } else if (!r.oversubscribed && at.oversubscribed) {
+        LOG_INF("[AIRTIME] radio demand back under %u permille", CONFIG_RELAY_AIRTIME_WARN_PERMILLE);
+    }
+    at.oversubscribed = r.oversubscribed;
+    at.last = r;
+
+    (void)bt_diag_notify_airtime(&r, sizeof(r));
+
+    k_work_reschedule_for_queue(&relay_link_workq, &airtime_window_work,
+                                K_SECONDS(CONFIG_RELAY_AIRTIME_WINDOW_S));
+}
+
+void radio_airtime_last_report(struct radio_airtime_report *report)
+{
+    k_spinlock_key_t key = k_spin_lock(&at.lock);
+
+    *report = at.last;
+    k_spin_unlock(&at.lock, key);
+}
+
+void radio_airtime_start(void)
+{
+    at.window_start_ms = k_uptime_get();
+    k_work_reschedule_for_queue(&relay_link_workq, &airtime_window_work,
+                                K_SECONDS(CONFIG_RELAY_AIRTIME_WINDOW_S));
+}
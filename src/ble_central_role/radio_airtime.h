@@ -0,0 +1,76 @@
+#ifndef _RADIO_AIRTIME_H_
+#define _RADIO_AIRTIME_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/** @brief Radio airtime accounting.
+ *
+ * Scanning, advertising, the node link (central role) and the hub link
+ * (peripheral role) share one radio. Every CONFIG_RELAY_AIRTIME_WINDOW_S the
+ * relay estimates how much radio time each activity needed:
+ *  - scan : time scanning was on x window / interval
+ *  - adv  : advertising events (3 channels) at the configured interval
+ *  - links: one empty packet exchange per connection event at the current
+ *           interval / PHY, plus the air time of the ATT PDUs that were
+ *           actually relayed (fragmented by the LL data length).
+ * The result is logged, published with the diagnostics service and a warning
+ * is logged when the estimated demand exceeds CONFIG_RELAY_AIRTIME_WARN_PERMILLE.
+ */
+
+enum radio_link
+{
+    RADIO_LINK_NODE,    /* relay = central */
+    RADIO_LINK_HUB,     /* relay = peripheral */
+    RADIO_LINK_COUNT,
+};
+
+/** Utilization of one window, in permille of the window. */
+struct radio_airtime_report
+{
+    uint32_t window_ms;
+    uint16_t scan_pm;
+    uint16_t adv_pm;
+    uint16_t link_pm[RADIO_LINK_COUNT];
+    uint16_t total_pm;
+    uint16_t link_interval_us125[RADIO_LINK_COUNT];  /* 1.25 ms units, 0 = not connected */
+    uint8_t oversubscribed;
+} __attribute__((packed));
+
+/**
+ * @brief Scan parameters in use.
+ *
+ * @param interval is the scan interval (0.625 ms units).
+ * @param window is the scan window (0.625 ms units).
+ */
+void radio_airtime_scan_params(uint16_t interval, uint16_t window);
+
+/**
+ * @brief Advertising parameters in use.
+ *
+ * @param interval_us is the advertising interval (+ average adv delay).
+ * @param adv_len is the advertising data length (bytes).
+ */
+void radio_airtime_adv_params(uint32_t interval_us, uint16_t adv_len);
+
+/** @brief Scanning started / stopped. */
+void radio_airtime_scan(bool on);
+
+/** @brief Advertising started / stopped. */
+void radio_airtime_adv(bool on);
+
+/**
+ * @brief One ATT PDU (notification / write) went over @p link.
+ *
+ * @param link is the connection the PDU used.
+ * @param att_len is the ATT value length.
+ */
+void radio_airtime_pdu(enum radio_link link, uint16_t att_len);
+
+/** @brief Last published window. */
+void radio_airtime_last_report(struct radio_airtime_report *report);
+
+/** @brief Start the accounting windows. */
+void radio_airtime_start(void);
+
+#endif
@@ -0,0 +1,598 @@
+/* relay_bulk.c
+ *
+ * 목적:
+ *  - hub / node 링크에 LE credit based L2CAP channel (CoC) 을 하나씩 두고
+ *    file transfer, model update, feature collection 을 큰 SDU 로 보낸다.
+ *  - SDU 안에 record (type + 길이 + GATT PDU 그대로) 를 여러 개 담을 수 있고,
+ *    받은 record 는 GATT 경로와 같은 handler 로 넘긴다.
+ *  - 흐름 제어는 L2CAP credit: handler 가 끝나야 credit 이 돌아간다.
+ *  - CONFIG_RELAY_BULK_BENCH: 아래 relay 로 같은 양을 CoC / GATT 로 보내 처리량 비교.
+ */
+#include "relay_bulk.h"
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/l2cap.h>
+#include <zephyr/net_buf.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/logging/log.h>
+
+#include "ble.h"
+#include "ble_relay_control.h"
+#include "config_service.h"
+#include "feature_relay.h"
+#include "model_update_proxy.h"
+#include "radio_airtime.h"
+#include "sound.h"
+
+LOG_MODULE_REGISTER(relay_bulk, LOG_LEVEL_INF);
+
+#if defined(CONFIG_RELAY_BULK)
+
+#define BULK_REC_HDR_SIZE   sizeof(struct relay_bulk_rec_hdr)
+#define BULK_TYPE_COUNT     (RELAY_BULK_BENCH + 1)
+/* ACK 같은 작은 record 용 예비 buffer 의 payload 한도 */
+#define BULK_CTRL_PAYLOAD_MAX   16
+
+/* 한 링크에 SDU 하나씩 재조립. recv 가 끝나면 stack 이 바로 돌려준다 */
+NET_BUF_POOL_FIXED_DEFINE(bulk_rx_pool, RELAY_BULK_LINK_COUNT,
+                          BT_L2CAP_SDU_BUF_SIZE(CONFIG_RELAY_BULK_SDU_SIZE), 8, NULL);
+NET_BUF_POOL_FIXED_DEFINE(bulk_tx_pool, CONFIG_RELAY_BULK_TX_BUFS,
+                          BT_L2CAP_SDU_BUF_SIZE(CONFIG_RELAY_BULK_SDU_SIZE),
+                          CONFIG_BT_CONN_TX_USER_DATA_SIZE, NULL);
+/* feature drain 이 bulk_tx_pool 을 다 써도 ACK 는 나가도록 하나 남겨 둔다 */
+NET_BUF_POOL_FIXED_DEFINE(bulk_ctrl_pool, 1,
+                          BT_L2CAP_SDU_BUF_SIZE(BULK_REC_HDR_SIZE + BULK_CTRL_PAYLOAD_MAX),
+                          CONFIG_BT_CONN_TX_USER_DATA_SIZE, NULL);
+
+typedef void (*bulk_rx_fn_t)(const void *data, uint16_t len);
+
+struct bulk_link
+{
+    struct bt_l2cap_le_chan le;
+    atomic_t up;
+    atomic_t busy;              /* 연결 중 또는 연결됨 */
+    const char *name;
+    const bulk_rx_fn_t *rx;     /* enum relay_bulk_type -> handler */
+    uint32_t rx_sdus;
+    uint32_t rx_bytes;
+};
+
+static void bulk_feature_hub_write(const void *data, uint16_t len);
+#if defined(CONFIG_RELAY_BULK_BENCH)
+static void bench_hub_rx(const void *data, uint16_t len);
+static void bench_node_rx(const void *data, uint16_t len);
+static void bench_node_connected(void);
+#endif
+
+/* hub -> relay */
+static const bulk_rx_fn_t hub_rx[BULK_TYPE_COUNT] = {
+    [RELAY_BULK_FILE_TRANSFER] = process_file_transfer_write,
+    [RELAY_BULK_MODEL_UPDATE] = process_model_update_write,
+    [RELAY_BULK_FEATURE] = bulk_feature_hub_write,
+#if defined(CONFIG_RELAY_BULK_BENCH)
+    [RELAY_BULK_BENCH] = bench_hub_rx,
+#endif
+};
+
+/* node -> relay */
+static const bulk_rx_fn_t node_rx[BULK_TYPE_COUNT] = {
+    [RELAY_BULK_MODEL_UPDATE] = model_update_proxy_node_notify,
+    [RELAY_BULK_FEATURE] = feature_relay_node_notify,
+#if defined(CONFIG_RELAY_BULK_BENCH)
+    [RELAY_BULK_BENCH] = bench_node_rx,
+#endif
+};
+
+static struct bulk_link links[RELAY_BULK_LINK_COUNT] = {
+    [RELAY_BULK_LINK_HUB] = { .name = "hub", .rx = hub_rx },
+    [RELAY_BULK_LINK_NODE] = { .name = "node", .rx = node_rx },
+};
+
+static struct bt_conn *node_conn;
+
+static void bulk_feature_hub_write(const void *data, uint16_t len)
+{
+    int err = feature_relay_hub_write(data, len);
+
+    if (err) {
+        LOG_WRN("[BULK] feature command to node failed (err %d)", err);
+    }
+}
+
+static struct bulk_link *bulk_link_of(struct bt_l2cap_chan *chan)
+{
+    return CONTAINER_OF(BT_L2CAP_LE_CHAN(chan), struct bulk_link, le);
+}
+
+static enum relay_bulk_link bulk_link_id(const struct bulk_link *l)
+{
+    return (enum relay_bulk_link)(l - links);
+}
+
+/* ----------------- L2CAP channel ----------------- */
+
+static void bulk_connected(struct bt_l2cap_chan *chan)
+{
+    struct bulk_link *l = bulk_link_of(chan);
+
+    l->rx_sdus = 0;
+    l->rx_bytes = 0;
+    atomic_set(&l->up, 1);
+    LOG_INF("[BULK] %s channel connected: rx mtu %u mps %u, tx mtu %u mps %u",
+            l->name, l->le.rx.mtu, l->le.rx.mps, l->le.tx.mtu, l->le.tx.mps);
+
+#if defined(CONFIG_RELAY_BULK_BENCH)
+    if (bulk_link_id(l) == RELAY_BULK_LINK_NODE) {
+        bench_node_connected();
+    }
+#endif
+}
+
+static void bulk_disconnected(struct bt_l2cap_chan *chan)
+{
+    struct bulk_link *l = bulk_link_of(chan);
+
+    if (atomic_set(&l->up, 0)) {
+        LOG_INF("[BULK] %s channel disconnected (%u SDUs, %u B received)",
+                l->name, l->rx_sdus, l->rx_bytes);
+    } else if (bulk_link_id(l) == RELAY_BULK_LINK_NODE) {
+        /* node 가 PSM 을 모름: GATT 만 쓴다 */
+        LOG_INF("[BULK] node has no bulk channel, staying on GATT");
+    }
+    atomic_set(&l->busy, 0);
+}
+
+static struct net_buf *bulk_alloc_buf(struct bt_l2cap_chan *chan)
+{
+    return net_buf_alloc(&bulk_rx_pool, K_NO_WAIT);
+}
+
+/* BT RX thread: SDU 안의 record 를 차례로 handler 에 넘긴다 */
+static int bulk_recv(struct bt_l2cap_chan *chan, struct net_buf *buf)
+{
+    struct bulk_link *l = bulk_link_of(chan);
+    const uint8_t *p = buf->data;
+    uint16_t left = buf->len;
+
+    l->rx_sdus++;
+    l->rx_bytes += buf->len;
+
+    while (left >= BULK_REC_HDR_SIZE) {
+        const struct relay_bulk_rec_hdr *hdr = (const void *)p;
+        uint16_t len = sys_le16_to_cpu(hdr->len);
+        bulk_rx_fn_t fn;
+
+        if (len > left - BULK_REC_HDR_SIZE) {
+            LOG_WRN("[BULK] %s: record type %u len %u over SDU end", l->name, hdr->type, len);
+            break;
+        }
+
+        fn = (hdr->type < BULK_TYPE_COUNT) ? l->rx[hdr->type] : NULL;
+        if (fn) {
+            fn(p + BULK_REC_HDR_SIZE, len);
+        } else {
+            LOG_DBG("[BULK] %s: record type %u ignored", l->name, hdr->type);
+        }
+
+        p += BULK_REC_HDR_SIZE + len;
+        left -= BULK_REC_HDR_SIZE + len;
+    }
+
+    return 0;
+}
+
+static const struct bt_l2cap_chan_ops bulk_ops = {
+    .connected = bulk_connected,
+    .disconnected = bulk_disconnected,
+    .alloc_buf = bulk_alloc_buf,
+    .recv = bulk_recv,
+};
+
+static void bulk_chan_init(struct bulk_link *l)
+{
+    memset(&l->le, 0, sizeof(l->le));
+    l->le.chan.ops = &bulk_ops;
+    l->le.rx.mtu = CONFIG_RELAY_BULK_SDU_SIZE;
+}
+
+static int bulk_accept(struct bt_conn *conn, struct bt_l2cap_server *server,
+                       struct bt_l2cap_chan **chan)
+{
+    struct bulk_link *l = &links[RELAY_BULK_LINK_HUB];
+
+    /* hub 링크에서 온 channel 하나만 */
+    if (conn != ble_relay_hub_conn()) {
+        return -EACCES;
+    }
+    if (atomic_set(&l->busy, 1)) {
+        return -ENOMEM;
+    }
+
+    bulk_chan_init(l);
+    *chan = &l->le.chan;
+    return 0;
+}
+
+static struct bt_l2cap_server bulk_server = {
+    .psm = CONFIG_RELAY_BULK_PSM,
+    .sec_level = BT_SECURITY_L1,
+    .accept = bulk_accept,
+};
+
+/* ----------------- API ----------------- */
+
+bool relay_bulk_ready(enum relay_bulk_link link)
+{
+    return atomic_get(&links[link].up) != 0;
+}
+
+uint16_t relay_bulk_payload_max(enum relay_bulk_link link)
+{
+    const struct bulk_link *l = &links[link];
+
+    if (!atomic_get(&l->up)) {
+        return 0;
+    }
+    return MIN(l->le.tx.mtu, CONFIG_RELAY_BULK_SDU_SIZE) - BULK_REC_HDR_SIZE;
+}
+
+int relay_bulk_send(enum relay_bulk_link link, uint8_t type, const void *data, uint16_t len)
+{
+    struct bulk_link *l = &links[link];
+    struct relay_bulk_rec_hdr hdr = {
+        .type = type,
+        .len = sys_cpu_to_le16(len),
+    };
+    struct net_buf *buf;
+    int err;
+
+    if (!atomic_get(&l->up)) {
+        return -ENOTCONN;
+    }
+    if (len > relay_bulk_payload_max(link)) {
+        return -EMSGSIZE;
+    }
+
+    buf = net_buf_alloc(&bulk_tx_pool, K_NO_WAIT);
+    if (!buf && len <= BULK_CTRL_PAYLOAD_MAX) {
+        buf = net_buf_alloc(&bulk_ctrl_pool, K_NO_WAIT);
+    }
+    if (!buf) {
+        return -ENOMEM;
+    }
+    net_buf_reserve(buf, BT_L2CAP_SDU_CHAN_SEND_RESERVE);
+    net_buf_add_mem(buf, &hdr, sizeof(hdr));
+    net_buf_add_mem(buf, data, len);
+
+    err = bt_l2cap_chan_send(&l->le.chan, buf);
+    if (err < 0) {
+        net_buf_unref(buf);
+        return err;
+    }
+
+    radio_airtime_pdu(link == RELAY_BULK_LINK_HUB ? RADIO_LINK_HUB : RADIO_LINK_NODE,
+                      sizeof(hdr) + len);
+    return 0;
+}
+
+void relay_bulk_init(void)
+{
+    int err = bt_l2cap_server_register(&bulk_server);
+
+    if (err) {
+        LOG_WRN("[BULK] server register failed (err %d)", err);
+    }
+}
+
+void relay_bulk_node_ready(struct bt_conn *conn)
+{
+    struct bulk_link *l = &links[RELAY_BULK_LINK_NODE];
+    int err;
+
+    if (node_conn == conn || atomic_set(&l->busy, 1)) {
+        /* rediscover: channel 은 그대로 */
+        return;
+    }
+    node_conn = bt_conn_ref(conn);
+
+    bulk_chan_init(l);
+    err = bt_l2cap_chan_connect(conn, &l->le.chan, CONFIG_RELAY_BULK_PSM);
+    if (err) {
+        LOG_WRN("[BULK] node channel connect failed (err %d)", err);
+        atomic_set(&l->busy, 0);
+    }
+}
+
+void relay_bulk_node_lost(void)
+{
+    /* channel 은 ACL 과 함께 끊긴다 */
+    if (node_conn) {
+        bt_conn_unref(node_conn);
+        node_conn = NULL;
+    }
+}
+
+/* ----------------- CoC vs GATT 처리량 (CONFIG_RELAY_BULK_BENCH) ----------------- */
+
+#if defined(CONFIG_RELAY_BULK_BENCH)
+
+#define BENCH_UUID_SERVICE      0x0C00
+#define BENCH_UUID_CHAR_SINK    0x0C01
+#define BENCH_DONE_TIMEOUT_MS   10000
+#define BENCH_RETRY_MS          1
+
+/* BENCH record / GATT write 의 첫 byte */
+enum bench_op
+{
+    BENCH_OP_DATA,
+    BENCH_OP_END,       /* 받은 byte 수를 돌려 달라 */
+    BENCH_OP_DONE,      /* + uint32_t 받은 byte 수 */
+};
+
+static struct bt_uuid_128 bench_svc_uuid = BT_UUID_INIT_128(
+    BT_UUID_128_ENCODE(BT_ADLD_SPECIFIC_UUID_FIRST + BENCH_UUID_SERVICE, BT_ADLD_SPECIFIC_UUID_SECOND,
+                       BT_ADLD_SPECIFIC_UUID_THIRD, BT_ADLD_SPECIFIC_UUID_FOURTH, BT_ADLD_SPECIFIC_UUID_LAST));
+static struct bt_uuid_128 bench_sink_uuid = BT_UUID_INIT_128(
+    BT_UUID_128_ENCODE(BT_ADLD_SPECIFIC_UUID_FIRST + BENCH_UUID_CHAR_SINK, BT_ADLD_SPECIFIC_UUID_SECOND,
+                       BT_ADLD_SPECIFIC_UUID_THIRD, BT_ADLD_SPECIFIC_UUID_FOURTH, BT_ADLD_SPECIFIC_UUID_LAST));
+
+static uint32_t sink_bytes;         /* 위 relay 가 보낸 양 (받는 쪽) */
+static uint32_t bench_rx_bytes;     /* 아래 relay 가 받았다고 한 양 (보내는 쪽) */
+static uint16_t bench_sink_handle;
+static uint8_t bench_buf[CONFIG_RELAY_BULK_SDU_SIZE];
+static struct bt_gatt_discover_params bench_discover_params;
+static struct bt_gatt_write_params bench_write_params;
+
+K_SEM_DEFINE(bench_start_sem, 0, 1);
+K_SEM_DEFINE(bench_step_sem, 0, 1);
+
+/* 받는 쪽: hub 링크 (위 relay) 에서 온 BENCH record */
+static void bench_hub_rx(const void *data, uint16_t len)
+{
+    const uint8_t *op = data;
+    uint8_t done[1 + sizeof(uint32_t)];
+
+    if (len == 0) {
+        return;
+    }
+    if (*op == BENCH_OP_DATA) {
+        sink_bytes += len;
+        return;
+    }
+    if (*op == BENCH_OP_END) {
+        done[0] = BENCH_OP_DONE;
+        sys_put_le32(sink_bytes, &done[1]);
+        sink_bytes = 0;
+        (void)relay_bulk_send(RELAY_BULK_LINK_HUB, RELAY_BULK_BENCH, done, sizeof(done));
+    }
+}
+
+static ssize_t bench_sink_write_cb(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                                   const void *buf, uint16_t len, uint16_t offset, uint8_t flags)
+{
+    const uint8_t *op = buf;
+
+    if (len && *op == BENCH_OP_END) {
+        /* write request: 앞의 write command 를 다 처리한 뒤에 응답이 나간다 */
+        LOG_INF("[BULK] bench GATT sink: %u B", sink_bytes);
+        sink_bytes = 0;
+    } else {
+        sink_bytes += len;
+    }
+    return len;
+}
+
+BT_GATT_SERVICE_DEFINE(bulk_bench_svr,
+    BT_GATT_PRIMARY_SERVICE(&bench_svc_uuid.uuid),
+    BT_GATT_CHARACTERISTIC(&bench_sink_uuid.uuid,
+                           BT_GATT_CHRC_WRITE | BT_GATT_CHRC_WRITE_WITHOUT_RESP,
+                           BT_GATT_PERM_WRITE,
+                           NULL, bench_sink_write_cb, NULL),
+);
+
+/* 보내는 쪽: node 링크 (아래 relay) 에서 온 BENCH record */
+static void bench_node_rx(const void *data, uint16_t len)
+{
+    const uint8_t *p = data;
+
+    if (len >= 1 + sizeof(uint32_t) && p[0] == BENCH_OP_DONE) {
+        bench_rx_bytes = sys_get_le32(&p[1]);
+        k_sem_give(&bench_step_sem);
+    }
+}
+
+static void bench_node_connected(void)
+{
+    k_sem_give(&bench_start_sem);
+}
+
+static uint8_t bench_discover_cb(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                                 struct bt_gatt_discover_params *params)
+{
+    if (attr) {
+        const struct bt_gatt_chrc *chrc = attr->user_data;
+
+        bench_sink_handle = chrc->value_handle;
+    }
+    k_sem_give(&bench_step_sem);
+    return BT_GATT_ITER_STOP;
+}
+
+static void bench_write_rsp(struct bt_conn *conn, uint8_t att_err, struct bt_gatt_write_params *params)
+{
+    k_sem_give(&bench_step_sem);
+}
+
+static uint32_t bench_kbps(uint32_t bytes, uint32_t ms)
+{
+    return (uint32_t)((uint64_t)bytes * 8 / MAX(ms, 1));
+}
+
+/* @return 걸린 ms, 음수 errno */
+static int bench_coc(uint32_t total)
+{
+    uint16_t chunk = relay_bulk_payload_max(RELAY_BULK_LINK_NODE);
+    uint32_t start = k_uptime_get_32();
+    uint32_t sent = 0;
+    int err;
+
+    memset(bench_buf, 0xA5, chunk);
+    bench_buf[0] = BENCH_OP_DATA;
+    k_sem_reset(&bench_step_sem);
+
+    while (sent < total) {
+        err = relay_bulk_send(RELAY_BULK_LINK_NODE, RELAY_BULK_BENCH, bench_buf, chunk);
+        if (err == -ENOMEM) {
+            k_sleep(K_MSEC(BENCH_RETRY_MS));
+            continue;
+        }
+        if (err) {
+            return err;
+        }
+        sent += chunk;
+    }
+
+    bench_buf[0] = BENCH_OP_END;
+    while ((err = relay_bulk_send(RELAY_BULK_LINK_NODE, RELAY_BULK_BENCH, bench_buf, 1)) == -ENOMEM) {
+        k_sleep(K_MSEC(BENCH_RETRY_MS));
+    }
+    if (err) {
+        return err;
+    }
+    if (k_sem_take(&bench_step_sem, K_MSEC(BENCH_DONE_TIMEOUT_MS))) {
+        return -ETIMEDOUT;
+    }
+    if (bench_rx_bytes != sent) {
+        LOG_WRN("[BULK] bench CoC: sent %u B, peer got %u B", sent, bench_rx_bytes);
+    }
+    return k_uptime_get_32() - start;
+}
+
+static int bench_gatt(struct bt_conn *conn, uint32_t total)
+{
+    uint16_t chunk = MIN(bt_gatt_get_mtu(conn) - 3, sizeof(bench_buf));
+    uint32_t start = k_uptime_get_32();
+    uint32_t sent = 0;
+    int err;
+
+    memset(bench_buf, 0x5A, chunk);
+    bench_buf[0] = BENCH_OP_DATA;
+    k_sem_reset(&bench_step_sem);
+
+    while (sent < total) {
+        err = bt_gatt_write_without_response(conn, bench_sink_handle, bench_buf, chunk, false);
+        if (err == -ENOMEM) {
+            k_sleep(K_MSEC(BENCH_RETRY_MS));
+            continue;
+        }
+        if (err) {
+            return err;
+        }
+        sent += chunk;
+    }
+
+    bench_buf[0] = BENCH_OP_END;
+    bench_write_params.func = bench_write_rsp;
+    bench_write_params.handle = bench_sink_handle;
+    bench_write_params.offset = 0;
+    bench_write_params.data = bench_buf;
+    bench_write_params.length = 1;
+    err = bt_gatt_write(conn, &bench_write_params);
+    if (err) {
+        return err;
+    }
+    if (k_sem_take(&bench_step_sem, K_MSEC(BENCH_DONE_TIMEOUT_MS))) {
+        return -ETIMEDOUT;
+    }
+    return k_uptime_get_32() - start;
+}
+
+static void bench_thread(void *p1, void *p2, void *p3)
+{
+    const uint32_t total = CONFIG_RELAY_BULK_BENCH_BYTES;
+
+    while (1) {
+        struct bt_conn *conn;
+        int coc_ms;
+        int gatt_ms = -ENOENT;
+
+        k_sem_take(&bench_start_sem, K_FOREVER);
+        if (!node_conn) {
+            continue;
+        }
+        conn = bt_conn_ref(node_conn);
+
+        /* GATT 쪽 sink 를 먼저 찾는다 (아래 relay 의 bench service) */
+        bench_sink_handle = 0;
+        k_sem_reset(&bench_step_sem);
+        bench_discover_params.uuid = &bench_sink_uuid.uuid;
+        bench_discover_params.func = bench_discover_cb;
+        bench_discover_params.start_handle = BT_ATT_FIRST_ATTRIBUTE_HANDLE;
+        bench_discover_params.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
+        bench_discover_params.type = BT_GATT_DISCOVER_CHARACTERISTIC;
+        if (!bt_gatt_discover(conn, &bench_discover_params)) {
+            (void)k_sem_take(&bench_step_sem, K_MSEC(BENCH_DONE_TIMEOUT_MS));
+        }
+
+        coc_ms = bench_coc(total);
+        if (bench_sink_handle) {
+            gatt_ms = bench_gatt(conn, total);
+        }
+        bt_conn_unref(conn);
+
+        if (coc_ms < 0) {
+            LOG_WRN("[BULK] bench CoC failed (err %d)", coc_ms);
+            continue;
+        }
+        if (gatt_ms < 0) {
+            LOG_WRN("[BULK] bench %u B: CoC %d ms (%u kbit/s), GATT failed (err %d)",
+                    total, coc_ms, bench_kbps(total, coc_ms), gatt_ms);
+            continue;
+        }
+        LOG_INF("[BULK] bench %u B: CoC %d ms (%u kbit/s), GATT %d ms (%u kbit/s), x%u.%02u",
+                total, coc_ms, bench_kbps(total, coc_ms), gatt_ms, bench_kbps(total, gatt_ms),
+                gatt_ms / MAX(coc_ms, 1), (gatt_ms * 100 / MAX(coc_ms, 1)) % 100);
+    }
+}
+
+K_THREAD_DEFINE(bulk_bench_tid, 1024, bench_thread, NULL, NULL, NULL,
+                K_LOWEST_APPLICATION_THREAD_PRIO, 0, 0);
+
+#endif /* CONFIG_RELAY_BULK_BENCH */
+
+#else
+
+void relay_bulk_init(void)
+{
+}
+
+void relay_bulk_node_ready(struct bt_conn *conn)
+{
+}
+
+void relay_bulk_node_lost(void)
+{
+}
+
+bool relay_bulk_ready(enum relay_bulk_link link)
+{
+    return false;
+}
+
+uint16_t relay_bulk_payload_max(enum relay_bulk_link link)
+{
+    return 0;
+}
+
+int relay_bulk_send(enum relay_bulk_link link, uint8_t type, const void *data, uint16_t len)
+{
+    return -ENOTCONN;
+}
+
+#endif /* CONFIG_RELAY_BULK */
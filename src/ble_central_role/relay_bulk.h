@@ -0,0 +1,88 @@
+#ifndef _RELAY_BULK_H_
+#define _RELAY_BULK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/bluetooth/conn.h>
+
+/** @brief L2CAP CoC bulk channel on the hub and node links (CONFIG_RELAY_BULK).
+ *
+ * File transfer, model update and feature collection send many small GATT
+ * PDUs, each with its own ATT header and at most one ATT MTU long. With
+ * CONFIG_RELAY_BULK the relay also offers an LE credit based L2CAP channel:
+ *  - hub link : the hub connects to PSM CONFIG_RELAY_BULK_PSM on the relay.
+ *  - node link: after discovery the relay connects to the same PSM on the
+ *               node (or lower relay). A node without it stays on GATT.
+ *
+ * An SDU (up to CONFIG_RELAY_BULK_SDU_SIZE bytes) carries one or more records:
+ *
+ *   struct relay_bulk_rec_hdr | payload | struct relay_bulk_rec_hdr | payload ...
+ *
+ * The payload of a record is exactly the GATT write or notification it
+ * replaces (struct ble_file_transfer_data_packet, struct
+ * ble_model_update_packet, ...), so the same handlers process both paths.
+ * Replies go back on the bulk channel while it is connected, otherwise on
+ * GATT as before.
+ *
+ * Flow control is the L2CAP credits: the stack returns a credit only after
+ * the record handlers have run, so a sender never gets more SDUs in flight
+ * than the receiver has buffers for. Senders that find the TX pool empty
+ * get -ENOMEM and retry, as they do for GATT.
+ */
+
+enum relay_bulk_link
+{
+    RELAY_BULK_LINK_HUB,
+    RELAY_BULK_LINK_NODE,
+    RELAY_BULK_LINK_COUNT,
+};
+
+/** Record types */
+enum relay_bulk_type
+{
+    RELAY_BULK_FILE_TRANSFER = 1,   /* config FILE_TRANSFER data / ack */
+    RELAY_BULK_MODEL_UPDATE  = 2,   /* sound MODEL frames / ack */
+    RELAY_BULK_FEATURE       = 3,   /* sound FEATURE notifications */
+    RELAY_BULK_BENCH         = 4,   /* CONFIG_RELAY_BULK_BENCH */
+};
+
+/** Record header. All fields little endian. */
+struct relay_bulk_rec_hdr
+{
+    uint8_t type;               /* enum relay_bulk_type */
+    uint16_t len;               /* payload bytes that follow */
+} __attribute__((packed));
+
+#if defined(CONFIG_RELAY_BULK)
+#define RELAY_BULK_PAYLOAD_MAX  (CONFIG_RELAY_BULK_SDU_SIZE - sizeof(struct relay_bulk_rec_hdr))
+#else
+#define RELAY_BULK_PAYLOAD_MAX  0
+#endif
+
+/** @brief Register the bulk server on the hub link. Call once before bt_enable(). */
+void relay_bulk_init(void);
+
+/** @brief Node discovery is done: open the bulk channel to the node. */
+void relay_bulk_node_ready(struct bt_conn *conn);
+
+/** @brief The node link is gone. */
+void relay_bulk_node_lost(void);
+
+/** @brief The bulk channel of @p link is connected. */
+bool relay_bulk_ready(enum relay_bulk_link link);
+
+/** @brief Largest record payload that fits one SDU on @p link (0 if not connected). */
+uint16_t relay_bulk_payload_max(enum relay_bulk_link link);
+
+/**
+ * @brief Send one record in its own SDU.
+ *
+ * @retval -ENOTCONN if the channel is not connected; use the GATT path.
+ * @retval -ENOMEM if every TX buffer is in flight; try again later. Records
+ *         of up to 16 bytes (ACKs) also get a reserved buffer.
+ * @retval -EMSGSIZE if @p len exceeds relay_bulk_payload_max().
+ * @return otherwise the result of bt_l2cap_chan_send().
+ */
+int relay_bulk_send(enum relay_bulk_link link, uint8_t type, const void *data, uint16_t len);
+
+#endif
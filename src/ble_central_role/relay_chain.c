@@ -0,0 +1,575 @@
+/* relay_chain.c
+ *
+ * 목적:
+ *  - relay 아래에 relay 를 붙일 수 있게 한다 (hub <- relay <- relay <- node).
+ *  - 위가 relay 이면 hub 로 보내는 notification 을 CHAIN_DATA frame 에 담고,
+ *    중간 relay 는 자기 hop 을 더해 올리고, 맨 위 relay 는 frame 을 풀어 hub 에 보낸다.
+ *  - 경로에 자기 id 가 있거나 hop 한도를 넘는 frame 은 버린다 (loop 방지).
+ *  - frame 은 attribute handle 을 싣고 가므로, attribute table hash 가 다른 relay 의
+ *    frame 은 받지 않는다 (Kconfig 에 따라 handle 이 밀린다).
+ *  - 맨 위 relay 는 hop 별 지연 (보낸 시각 차이) 을 모아 주기적으로 log 에 남긴다.
+ *  - node 까지의 hop 수를 CHAIN_INFO 와 scan response 로 알린다.
+ */
+#include "relay_chain.h"
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/logging/log.h>
+
+#include "ble_relay_control.h"
+#include "clock.h"
+#include "gatt_proxy.h"
+#include "relay_stats.h"
+#include "relay_trace.h"
+#include "relay_workq.h"
+#include "node_stream.h"
+
+LOG_MODULE_REGISTER(relay_chain, LOG_LEVEL_INF);
+
+#if defined(CONFIG_RELAY_CHAIN)
+
+/* LE data length 251 - L2CAP 4 - ATT 3 (relay_segment.h 와 같은 한도) */
+#define CHAIN_PDU_MAX           244
+/* hop 별 지연은 이만큼 frame 을 받을 때마다 log */
+#define CHAIN_LAT_LOG_EVERY     256
+
+#define CHAIN_ATTRS_INFO_IDX    2
+#define CHAIN_ATTRS_DATA_IDX    5
+/* FNV-1a 32 bit */
+#define CHAIN_HASH_INIT         2166136261u
+#define CHAIN_HASH_PRIME        16777619u
+
+static atomic_t upstream;       /* hub 링크 건너편이 relay (CHAIN_DATA 구독) */
+static atomic_t info_notify;
+static atomic_t node_hops = ATOMIC_INIT(RELAY_CHAIN_NO_NODE);
+static atomic_t child_ok;       /* 아래 relay 의 CHAIN_INFO 가 id / db hash 검사를 통과했다 */
+static uint32_t own_id;
+static uint32_t own_db_hash;
+
+/* 맨 위 relay 에서 본 link 별 지연. [0] 은 바로 아래 relay -> 이 relay */
+static struct
+{
+    uint32_t cnt;
+    uint32_t sum_ms;
+    uint16_t max_ms;
+} lat[CONFIG_RELAY_CHAIN_MAX_HOPS];
+static uint32_t lat_frames;
+
+static void chain_info_work_handler(struct k_work *work);
+K_WORK_DEFINE(chain_info_work, chain_info_work_handler);
+
+static const struct bt_uuid_128 chain_svc_uuid = BT_UUID_INIT_128(BT_UUID_RELAY_CHAIN_SERVICE_VAL);
+
+/* ----------------- GATT service ----------------- */
+
+static void chain_info_get(struct relay_chain_info *info)
+{
+    info->id = sys_cpu_to_le32(relay_chain_id());
+    info->node_hops = (uint8_t)atomic_get(&node_hops);
+    info->db_hash = sys_cpu_to_le32(relay_chain_db_hash());
+}
+
+static ssize_t chain_info_read_cb(struct bt_conn *conn,
+                                  const struct bt_gatt_attr *attr,
+                                  void *buf, uint16_t len,
+                                  uint16_t offset)
+{
+    struct relay_chain_info info;
+
+    chain_info_get(&info);
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, &info, sizeof(info));
+}
+
+static void ccc_cfg_chain_info_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+    atomic_set(&info_notify, value == BT_GATT_CCC_NOTIFY);
+
+    /* 구독하자마자 현재 값을 한 번 보낸다 */
+    if (value == BT_GATT_CCC_NOTIFY) {
+        k_work_submit_to_queue(&relay_link_workq, &chain_info_work);
+    }
+}
+
+static void ccc_cfg_chain_data_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+    bool on = (value == BT_GATT_CCC_NOTIFY);
+
+    if (atomic_set(&upstream, on) != on) {
+        LOG_INF("[CHAIN] upstream is %s", on ? "a relay, framing hub notifications" : "the hub");
+    }
+}
+
+BT_GATT_SERVICE_DEFINE(chain_svr,
+    BT_GATT_PRIMARY_SERVICE(BT_UUID_RELAY_CHAIN_SERVICE),
+
+    BT_GATT_CHARACTERISTIC(BT_UUID_CHRC_RELAY_CHAIN_INFO,
+                           BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
+                           BT_GATT_PERM_READ,
+                           chain_info_read_cb, NULL, NULL),
+    BT_GATT_CCC(ccc_cfg_chain_info_changed,
+                BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+
+    BT_GATT_CHARACTERISTIC(BT_UUID_CHRC_RELAY_CHAIN_DATA,
+                           BT_GATT_CHRC_NOTIFY,
+                           BT_GATT_PERM_NONE,
+                           NULL, NULL, NULL),
+    BT_GATT_CCC(ccc_cfg_chain_data_changed,
+                BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+);
+
+static void chain_info_work_handler(struct k_work *work)
+{
+    struct relay_chain_info info;
+    int err;
+
+    chain_info_get(&info);
+    ble_relay_adv_chain_set(&info);
+
+    if (atomic_get(&info_notify)) {
+        err = bt_gatt_notify(ble_relay_hub_conn(), &chain_svr.attrs[CHAIN_ATTRS_INFO_IDX],
+                             &info, sizeof(info));
+        if (err) {
+            LOG_DBG("[CHAIN] info notify failed (err %d)", err);
+        }
+    }
+}
+
+static void chain_node_hops_set(uint8_t hops)
+{
+    if ((uint8_t)atomic_set(&node_hops, hops) == hops) {
+        return;
+    }
+
+    if (hops == RELAY_CHAIN_NO_NODE) {
+        LOG_INF("[CHAIN] no node below");
+    } else {
+        LOG_INF("[CHAIN] node %u relay hop(s) below", hops);
+    }
+    k_work_submit_to_queue(&relay_link_workq, &chain_info_work);
+}
+
+/* ----------------- framing ----------------- */
+
+static void chain_hop_put(struct relay_chain_hop *hop)
+{
+    hop->id = sys_cpu_to_le32(relay_chain_id());
+    hop->sent_ms = sys_cpu_to_le16((uint16_t)clock_now_ms());
+}
+
+static int chain_notify(struct bt_conn *conn, const uint8_t *pdu, uint16_t len)
+{
+    if (len > bt_gatt_get_mtu(conn) - 3) {
+        return -EMSGSIZE;
+    }
+    return bt_gatt_notify(conn, &chain_svr.attrs[CHAIN_ATTRS_DATA_IDX], pdu, len);
+}
+
+uint32_t relay_chain_id(void)
+{
+    bt_addr_le_t addrs[CONFIG_BT_ID_MAX];
+    size_t count = ARRAY_SIZE(addrs);
+
+    if (own_id) {
+        return own_id;
+    }
+
+    bt_id_get(addrs, &count);
+    if (count) {
+        own_id = sys_get_le32(addrs[BT_ID_DEFAULT].a.val);
+    }
+    return own_id;
+}
+
+static uint32_t chain_hash_add(uint32_t hash, const uint8_t *p, size_t len)
+{
+    while (len--) {
+        hash = (hash ^ *p++) * CHAIN_HASH_PRIME;
+    }
+    return hash;
+}
+
+static uint8_t chain_hash_attr_cb(const struct bt_gatt_attr *attr, uint16_t handle, void *user_data)
+{
+    uint32_t *hash = user_data;
+    uint8_t buf[2 + BT_UUID_SIZE_128];
+    uint8_t n = 2;
+
+    /* proxy 가 복사한 attribute 는 relay 마다 다르고 framing 도 안 한다 */
+    if (gatt_proxy_is_mirrored(attr)) {
+        return BT_GATT_ITER_CONTINUE;
+    }
+
+    sys_put_le16(handle, buf);
+    switch (attr->uuid->type) {
+    case BT_UUID_TYPE_16:
+        sys_put_le16(BT_UUID_16(attr->uuid)->val, &buf[n]);
+        n += BT_UUID_SIZE_16;
+        break;
+    case BT_UUID_TYPE_32:
+        sys_put_le32(BT_UUID_32(attr->uuid)->val, &buf[n]);
+        n += BT_UUID_SIZE_32;
+        break;
+    default:
+        memcpy(&buf[n], BT_UUID_128(attr->uuid)->val, BT_UUID_SIZE_128);
+        n += BT_UUID_SIZE_128;
+        break;
+    }
+    *hash = chain_hash_add(*hash, buf, n);
+    return BT_GATT_ITER_CONTINUE;
+}
+
+uint32_t relay_chain_db_hash(void)
+{
+    uint32_t hash = CHAIN_HASH_INIT;
+
+    /* static table 은 build 마다 고정이라 한 번만 계산한다 */
+    if (own_db_hash) {
+        return own_db_hash;
+    }
+
+    bt_gatt_foreach_attr(BT_ATT_FIRST_ATTRIBUTE_HANDLE, BT_ATT_LAST_ATTRIBUTE_HANDLE,
+                         chain_hash_attr_cb, &hash);
+    own_db_hash = hash ? hash : 1;
+    return own_db_hash;
+}
+
+void relay_chain_info_get(struct relay_chain_info *info)
+{
+    chain_info_get(info);
+}
+
+bool relay_chain_upstream(void)
+{
+    return atomic_get(&upstream);
+}
+
+uint16_t relay_chain_overhead(void)
+{
+    /* 위로 올라가며 붙을 hop 까지 미리 비워 둔다 */
+    return atomic_get(&upstream) ? RELAY_CHAIN_HDR_MAX : 0;
+}
+
+int relay_chain_send(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                     const void *data, uint16_t len)
+{
+    uint8_t pdu[CHAIN_PDU_MAX];
+    struct relay_chain_hdr *hdr = (struct relay_chain_hdr *)pdu;
+    uint16_t n = sizeof(*hdr) + sizeof(struct relay_chain_hop) + len;
+
+    /* dynamic DB 의 handle 은 relay 마다 다르다 */
+    if (gatt_proxy_is_mirrored(attr)) {
+        return -ENOTSUP;
+    }
+
+    if (!conn) {
+        conn = ble_relay_hub_conn();
+    }
+    if (!conn) {
+        return -ENOTCONN;
+    }
+    if (n > sizeof(pdu)) {
+        return -EMSGSIZE;
+    }
+
+    hdr->version = RELAY_CHAIN_VERSION;
+    hdr->hops = 1;
+    hdr->handle = sys_cpu_to_le16(bt_gatt_attr_get_handle(attr));
+    chain_hop_put((struct relay_chain_hop *)&pdu[sizeof(*hdr)]);
+    memcpy(&pdu[n - len], data, len);
+
+    return chain_notify(conn, pdu, n);
+}
+
+int relay_chain_hub_notify(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                           const void *data, uint16_t len)
+{
+    if (atomic_get(&upstream)) {
+        int err = relay_chain_send(conn, attr, data, len);
+
+        if (err != -ENOTSUP) {
+            return err;
+        }
+    }
+    return relay_trace_notify(conn, attr, data, len);
+}
+
+/* 중간 relay: 자기 hop 을 붙여서 그대로 위로 */
+static int chain_forward(const uint8_t *data, uint16_t len, uint16_t path_len)
+{
+    struct bt_conn *hub = ble_relay_hub_conn();
+    uint8_t pdu[CHAIN_PDU_MAX];
+    struct relay_chain_hdr *hdr = (struct relay_chain_hdr *)pdu;
+
+    if (!hub) {
+        return -ENOTCONN;
+    }
+    if (len + sizeof(struct relay_chain_hop) > sizeof(pdu)) {
+        return -EMSGSIZE;
+    }
+
+    memcpy(pdu, data, path_len);
+    hdr->hops++;
+    chain_hop_put((struct relay_chain_hop *)&pdu[path_len]);
+    memcpy(&pdu[path_len + sizeof(struct relay_chain_hop)], &data[path_len], len - path_len);
+
+    return chain_notify(hub, pdu, len + sizeof(struct relay_chain_hop));
+}
+
+static void chain_latency_add(const struct relay_chain_hop *hops, uint8_t n)
+{
+    uint16_t now = (uint16_t)clock_now_ms();
+
+    /* hops[] 는 origin 부터. 시계 오차로 음수가 나오면 0 으로 센다 */
+    for (uint8_t i = 0; i < n; i++) {
+        uint16_t sent = sys_le16_to_cpu(hops[i].sent_ms);
+        uint16_t next = (i + 1 < n) ? sys_le16_to_cpu(hops[i + 1].sent_ms) : now;
+        uint16_t d = (uint16_t)MAX((int16_t)(next - sent), 0);
+        uint8_t link = n - 1 - i;
+
+        lat[link].cnt++;
+        lat[link].sum_ms += d;
+        lat[link].max_ms = MAX(lat[link].max_ms, d);
+    }
+
+    if (++lat_frames % CHAIN_LAT_LOG_EVERY) {
+        return;
+    }
+    for (uint8_t link = 0; link < ARRAY_SIZE(lat) && lat[link].cnt; link++) {
+        LOG_INF("[CHAIN] link %u below: avg %u ms, max %u ms (%u frames)", link,
+                lat[link].sum_ms / lat[link].cnt, lat[link].max_ms, lat[link].cnt);
+    }
+}
+
+static uint8_t chain_attr_find_cb(const struct bt_gatt_attr *attr, uint16_t handle, void *user_data)
+{
+    *(const struct bt_gatt_attr **)user_data = attr;
+    return BT_GATT_ITER_STOP;
+}
+
+/* 맨 위 relay: frame 을 풀어서 같은 handle 의 자기 attribute 로 hub 에 보낸다 */
+static int chain_deliver(uint16_t handle, const uint8_t *payload, uint16_t len)
+{
+    struct bt_conn *hub = ble_relay_hub_conn();
+    const struct bt_gatt_attr *attr = NULL;
+
+    bt_gatt_foreach_attr(handle, handle, chain_attr_find_cb, &attr);
+    if (!attr || gatt_proxy_is_mirrored(attr)) {
+        return -ENOENT;
+    }
+    if (!hub) {
+        return -ENOTCONN;
+    }
+    if (!bt_gatt_is_subscribed(hub, attr, BT_GATT_CCC_NOTIFY)) {
+        return -EACCES;
+    }
+    return relay_trace_notify(hub, attr, payload, len);
+}
+
+void relay_chain_rx(const void *data, uint16_t len)
+{
+    const uint8_t *p = data;
+    const struct relay_chain_hdr *hdr = data;
+    const struct relay_chain_hop *hops = (const struct relay_chain_hop *)&p[sizeof(*hdr)];
+    uint16_t path_len;
+    int err;
+
+    relay_stats_rx(RELAY_STREAM_CHAIN);
+
+    if (len < sizeof(*hdr) || hdr->version != RELAY_CHAIN_VERSION || hdr->hops == 0 ||
+        hdr->hops > CONFIG_RELAY_CHAIN_MAX_HOPS) {
+        LOG_DBG("[CHAIN] bad frame (len %u)", len);
+        relay_stats_tx(RELAY_STREAM_CHAIN, -EINVAL);
+        return;
+    }
+    path_len = sizeof(*hdr) + hdr->hops * sizeof(struct relay_chain_hop);
+    if (len < path_len) {
+        relay_stats_tx(RELAY_STREAM_CHAIN, -EINVAL);
+        return;
+    }
+
+    /* handle 이 이 relay 의 것과 같다는 확인 (CHAIN_INFO) 전에는 받지 않는다 */
+    if (!atomic_get(&child_ok)) {
+        LOG_DBG("[CHAIN] frame before a matching CHAIN_INFO, drop");
+        relay_stats_tx(RELAY_STREAM_CHAIN, -ESTALE);
+        return;
+    }
+
+    for (uint8_t i = 0; i < hdr->hops; i++) {
+        if (sys_le32_to_cpu(hops[i].id) == relay_chain_id()) {
+            LOG_WRN("[CHAIN] loop: frame already went through this relay (hop %u)", i);
+            relay_stats_tx(RELAY_STREAM_CHAIN, -ELOOP);
+            return;
+        }
+    }
+
+    if (atomic_get(&upstream)) {
+        if (hdr->hops >= CONFIG_RELAY_CHAIN_MAX_HOPS) {
+            LOG_WRN("[CHAIN] hop limit %u reached, drop", CONFIG_RELAY_CHAIN_MAX_HOPS);
+            err = -E2BIG;
+        } else {
+            err = chain_forward(p, len, path_len);
+        }
+    } else {
+        chain_latency_add(hops, hdr->hops);
+        err = chain_deliver(sys_le16_to_cpu(hdr->handle), &p[path_len], len - path_len);
+    }
+
+    relay_stats_tx(RELAY_STREAM_CHAIN, err);
+    if (err && err != -EACCES) {
+        LOG_DBG("[CHAIN] frame for 0x%04x not forwarded (err %d)",
+                sys_le16_to_cpu(hdr->handle), err);
+    }
+}
+
+/* ----------------- central link (child) ----------------- */
+
+void relay_chain_child_info(const void *data, uint16_t len)
+{
+    struct relay_chain_info info;
+
+    if (len < sizeof(info)) {
+        return;
+    }
+    memcpy(&info, data, sizeof(info));
+
+    if (sys_le32_to_cpu(info.id) == relay_chain_id()) {
+        LOG_ERR("[CHAIN] relay below has this relay's id %08x, refusing its frames",
+                relay_chain_id());
+        atomic_set(&child_ok, false);
+        chain_node_hops_set(RELAY_CHAIN_NO_NODE);
+        return;
+    }
+    if (sys_le32_to_cpu(info.db_hash) != relay_chain_db_hash()) {
+        LOG_ERR("[CHAIN] relay below has another attribute table (%08x, own %08x), "
+                "refusing its frames", sys_le32_to_cpu(info.db_hash), relay_chain_db_hash());
+        atomic_set(&child_ok, false);
+        chain_node_hops_set(RELAY_CHAIN_NO_NODE);
+        return;
+    }
+    atomic_set(&child_ok, true);
+
+    if (info.node_hops == RELAY_CHAIN_NO_NODE || info.node_hops + 1 > CONFIG_RELAY_CHAIN_MAX_HOPS) {
+        chain_node_hops_set(RELAY_CHAIN_NO_NODE);
+    } else {
+        chain_node_hops_set(info.node_hops + 1);
+    }
+}
+
+void relay_chain_child_ready(bool relay)
+{
+    /* 아래가 relay 이면 CHAIN_INFO notification 을 기다린다.
+     * 구독 중에 이미 왔을 수 있으니 child_ok 는 child_lost 에서만 지운다
+     */
+    if (!relay) {
+        chain_node_hops_set(0);
+    }
+}
+
+void relay_chain_child_lost(void)
+{
+    atomic_set(&child_ok, false);
+    chain_node_hops_set(RELAY_CHAIN_NO_NODE);
+    memset(lat, 0, sizeof(lat));
+    lat_frames = 0;
+}
+
+static int chain_data_stream_notify(const void *data, uint16_t len)
+{
+    /* 아래 relay 가 감싸 보낸 hub notification */
+    relay_chain_rx(data, len);
+    return 0;
+}
+
+static int chain_info_stream_notify(const void *data, uint16_t len)
+{
+    relay_chain_child_info(data, len);
+    return 0;
+}
+
+/* 아래가 relay 일 때만 찾는다. child_ready / child_lost 는 node 여부와 상관없이 ble_relay_control 이 부른다 */
+NODE_STREAM_DEFINE(relay_chain_data, BT_UUID_CHRC_RELAY_CHAIN_DATA, RELAY_STREAM_CHAIN,
+                   .notify = chain_data_stream_notify);
+NODE_STREAM_DEFINE(relay_chain_info, BT_UUID_CHRC_RELAY_CHAIN_INFO, RELAY_STREAM_COUNT,
+                   .notify = chain_info_stream_notify);
+
+/* ----------------- scan ----------------- */
+
+bool relay_chain_adv_parse(const uint8_t *data, uint8_t len, struct relay_chain_peer *peer)
+{
+    const struct relay_chain_adv *adv = (const struct relay_chain_adv *)data;
+
+    if (len < sizeof(*adv) || memcmp(adv->uuid, chain_svc_uuid.val, sizeof(adv->uuid))) {
+        return false;
+    }
+
+    peer->relay = true;
+    peer->id = sys_le32_to_cpu(adv->info.id);
+    peer->node_hops = adv->info.node_hops;
+    peer->db_hash = sys_le32_to_cpu(adv->info.db_hash);
+    return true;
+}
+
+int16_t relay_chain_score(const struct relay_chain_peer *peer, int8_t rssi)
+{
+    uint8_t hops = 0;
+
+    if (peer->relay) {
+        /* node 가 없는 relay 는 (이 relay 의 조상일 수도 있으니) 쓰지 않는다 */
+        if (peer->node_hops == RELAY_CHAIN_NO_NODE ||
+            peer->node_hops + 1 > CONFIG_RELAY_CHAIN_MAX_HOPS ||
+            peer->id == relay_chain_id() ||
+            peer->db_hash != relay_chain_db_hash()) {
+            return INT16_MIN;
+        }
+        hops = peer->node_hops + 1;
+    }
+
+    return rssi - hops * CONFIG_RELAY_CHAIN_HOP_PENALTY_DB;
+}
+
+#else
+
+bool relay_chain_upstream(void)
+{
+    return false;
+}
+
+uint16_t relay_chain_overhead(void)
+{
+    return 0;
+}
+
+int relay_chain_send(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                     const void *data, uint16_t len)
+{
+    return -ENOTSUP;
+}
+
+int relay_chain_hub_notify(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                           const void *data, uint16_t len)
+{
+    return relay_trace_notify(conn, attr, data, len);
+}
+
+void relay_chain_rx(const void *data, uint16_t len)
+{
+}
+
+void relay_chain_child_info(const void *data, uint16_t len)
+{
+}
+
+void relay_chain_child_ready(bool relay)
+{
+}
+
+void relay_chain_child_lost(void)
+{
+}
+
+#endif /* CONFIG_RELAY_CHAIN */
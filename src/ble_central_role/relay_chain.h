@@ -0,0 +1,178 @@
+#ifndef _RELAY_CHAIN_H_
+#define _RELAY_CHAIN_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+
+#include "ble.h"
+
+/** @brief Relay chaining (CONFIG_RELAY_CHAIN): hub <- relay <- relay <- node.
+ *
+ * A relay can connect to another relay instead of a DE&N node. The lower
+ * relay sees an upper relay on its hub link when that relay has enabled the
+ * CHAIN_DATA notifications. It then sends every hub notification of its
+ * static GATT services as one CHAIN_DATA frame:
+ *
+ *   struct relay_chain_hdr | struct relay_chain_hop x hops | payload
+ *
+ * Each relay on the way appends its own hop entry (relay id, send time) and
+ * drops frames that already went through it or exceed
+ * CONFIG_RELAY_CHAIN_MAX_HOPS. The relay connected to the hub strips the
+ * header and notifies the payload on its own attribute with the same handle.
+ * Handles move with the build configuration, so every relay puts a hash of
+ * its static attribute table in CHAIN_INFO and the upper relay refuses the
+ * frames of a lower relay whose hash differs. Hop send times use the relay clock,
+ * which the upper relay keeps in sync through CTS (node_time_sync.h), so the
+ * top relay can account the latency of every hop.
+ *
+ * CHAIN_INFO (read / notify) tells the upper relay how many hops away the
+ * nearest node is. The same value is advertised as service data (struct
+ * relay_chain_adv) so a scanning relay can pick the best downstream link.
+ */
+
+/** Relay chain service UUID definitions */
+#define CHAIN_UUID_SERVICE              0x0B00
+#define CHAIN_UUID_CHAR_INFO            0x0B01
+#define CHAIN_UUID_CHAR_DATA            0x0B02
+
+/** @brief Relay Chain Service UUID */
+#define BT_UUID_RELAY_CHAIN_SERVICE_VAL                                  \
+    BT_UUID_128_ENCODE(BT_ADLD_SPECIFIC_UUID_FIRST + CHAIN_UUID_SERVICE, \
+                       BT_ADLD_SPECIFIC_UUID_SECOND,                     \
+                       BT_ADLD_SPECIFIC_UUID_THIRD,                      \
+                       BT_ADLD_SPECIFIC_UUID_FOURTH,                     \
+                       BT_ADLD_SPECIFIC_UUID_LAST)
+/** @brief Chain Info Characteristic UUID (read / notify, struct relay_chain_info) */
+#define BT_UUID_CHRC_RELAY_CHAIN_INFO_VAL                                  \
+    BT_UUID_128_ENCODE(BT_ADLD_SPECIFIC_UUID_FIRST + CHAIN_UUID_CHAR_INFO, \
+                       BT_ADLD_SPECIFIC_UUID_SECOND,                       \
+                       BT_ADLD_SPECIFIC_UUID_THIRD,                        \
+                       BT_ADLD_SPECIFIC_UUID_FOURTH,                       \
+                       BT_ADLD_SPECIFIC_UUID_LAST)
+/** @brief Chain Data Characteristic UUID (notify, framed hub notifications) */
+#define BT_UUID_CHRC_RELAY_CHAIN_DATA_VAL                                  \
+    BT_UUID_128_ENCODE(BT_ADLD_SPECIFIC_UUID_FIRST + CHAIN_UUID_CHAR_DATA, \
+                       BT_ADLD_SPECIFIC_UUID_SECOND,                       \
+                       BT_ADLD_SPECIFIC_UUID_THIRD,                        \
+                       BT_ADLD_SPECIFIC_UUID_FOURTH,                       \
+                       BT_ADLD_SPECIFIC_UUID_LAST)
+
+#define BT_UUID_RELAY_CHAIN_SERVICE     BT_UUID_DECLARE_128(BT_UUID_RELAY_CHAIN_SERVICE_VAL)
+#define BT_UUID_CHRC_RELAY_CHAIN_INFO   BT_UUID_DECLARE_128(BT_UUID_CHRC_RELAY_CHAIN_INFO_VAL)
+#define BT_UUID_CHRC_RELAY_CHAIN_DATA   BT_UUID_DECLARE_128(BT_UUID_CHRC_RELAY_CHAIN_DATA_VAL)
+
+#define RELAY_CHAIN_VERSION         2
+/* node 까지의 경로가 없다 */
+#define RELAY_CHAIN_NO_NODE         0xFF
+
+/** CHAIN_DATA frame header. All fields little endian. */
+struct relay_chain_hdr
+{
+    uint8_t version;            /* RELAY_CHAIN_VERSION */
+    uint8_t hops;               /* struct relay_chain_hop entries that follow */
+    uint16_t handle;            /* attribute handle of the payload (same db_hash on every relay) */
+} __attribute__((packed));
+
+/** One relay the frame went through, origin first. */
+struct relay_chain_hop
+{
+    uint32_t id;                /* relay id (low 32 bits of the identity address) */
+    uint16_t sent_ms;           /* low 16 bits of the relay clock in ms when sent up */
+} __attribute__((packed));
+
+#if defined(CONFIG_RELAY_CHAIN)
+#define RELAY_CHAIN_HDR_MAX \
+    (sizeof(struct relay_chain_hdr) + CONFIG_RELAY_CHAIN_MAX_HOPS * sizeof(struct relay_chain_hop))
+#else
+#define RELAY_CHAIN_HDR_MAX 0
+#endif
+
+/** CHAIN_INFO value */
+struct relay_chain_info
+{
+    uint32_t id;
+    uint8_t node_hops;          /* 0: node connected to this relay, RELAY_CHAIN_NO_NODE: none */
+    uint32_t db_hash;           /* relay_chain_db_hash() */
+} __attribute__((packed));
+
+/** Scan response service data: relay chain service UUID followed by this. */
+struct relay_chain_adv
+{
+    uint8_t uuid[16];
+    struct relay_chain_info info;
+} __attribute__((packed));
+
+/** @brief A node or relay seen while scanning (host byte order). */
+struct relay_chain_peer
+{
+    bool relay;                 /* advertised struct relay_chain_adv */
+    uint32_t id;
+    uint8_t node_hops;
+    uint32_t db_hash;
+};
+
+/** @brief This relay's id. */
+uint32_t relay_chain_id(void);
+
+/** @brief Hash of the handles and UUIDs of the static attributes (not the mirrored ones). */
+uint32_t relay_chain_db_hash(void);
+
+/** @brief Current CHAIN_INFO value (initial scan response data). */
+void relay_chain_info_get(struct relay_chain_info *info);
+
+/** @brief The hub link goes to an upper relay (hub notifications are framed). */
+bool relay_chain_upstream(void);
+
+/** @brief Header bytes to keep free in every hub notification. */
+uint16_t relay_chain_overhead(void);
+
+/**
+ * @brief Hub notification while relay_chain_upstream().
+ *
+ * @param conn is the hub link, NULL for ble_relay_hub_conn().
+ * @retval -ENOTSUP if @p attr is not framed (dynamic attribute); send it as is.
+ * @return otherwise the result of the CHAIN_DATA notification.
+ */
+int relay_chain_send(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                     const void *data, uint16_t len);
+
+/**
+ * @brief Send a relayed stream notification towards the hub.
+ *
+ * Stream senders call this instead of relay_trace_notify(). While
+ * relay_chain_upstream() the notification goes out as a CHAIN_DATA frame
+ * (relay_chain_send()), otherwise, and for attributes that are not framed,
+ * as a plain relay_trace_notify() on @p attr.
+ *
+ * @param conn is the hub link, NULL for every subscribed peer (as bt_gatt_notify()).
+ * @retval 0 on success, negative errno otherwise.
+ */
+int relay_chain_hub_notify(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                           const void *data, uint16_t len);
+
+/** @brief CHAIN_DATA notification from the lower relay. */
+void relay_chain_rx(const void *data, uint16_t len);
+
+/** @brief CHAIN_INFO notification from the lower relay. */
+void relay_chain_child_info(const void *data, uint16_t len);
+
+/** @brief Discovery of the central link is done. @p relay: it is a relay. */
+void relay_chain_child_ready(bool relay);
+
+/** @brief The central link is gone. */
+void relay_chain_child_lost(void);
+
+/** @brief Parse a BT_DATA_SVC_DATA128 AD structure. @return true if it is a relay. */
+bool relay_chain_adv_parse(const uint8_t *data, uint8_t len, struct relay_chain_peer *peer);
+
+/**
+ * @brief Scan candidate ranking: RSSI minus a penalty per hop to the node.
+ *
+ * @return score, or INT16_MIN if the peer must not be used (no node behind
+ *         it, too many hops, another attribute table, or this relay).
+ */
+int16_t relay_chain_score(const struct relay_chain_peer *peer, int8_t rssi);
+
+#endif
@@ -0,0 +1,240 @@
+/* relay_fwd_bench.c
+ *
+ * 목적:
+ *  - radio 없이 node notification -> hub notification forward path 의 CPU 비용을 잰다.
+ *  - generic_notify_cb 에 stream / 크기별 가짜 packet 을 넣고,
+ *    bt_gatt_notify_cb 는 linker --wrap 으로 가로채서 바로 성공을 돌려준다. (src/CMakeLists.txt)
+ *  - packet 당 cycle, notify 수 / byte, heap / net_buf 할당 수를 출력한다.
+ *
+ * native_sim: west build -b native_sim -- -DOVERLAY_CONFIG=overlay-fwd-bench.conf
+ *             ./build/zephyr/zephyr.exe
+ * 실행이 끝나면 "[BENCH] done" 을 찍고 종료한다. (budget 초과 시 exit code 1)
+ */
+#if defined(CONFIG_RELAY_FWD_BENCH)
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/net_buf.h>
+#include <zephyr/timing/timing.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/logging/log_ctrl.h>
+#if defined(CONFIG_ARCH_POSIX)
+#include <posix_board_if.h>
+#endif
+
+#include "ble_relay_control.h"
+#include "relay_stats.h"
+#include "relay_workq.h"
+#include "inference_service.h"
+#include "grideye_service.h"
+#include "dean_device.h"
+#include "sound.h"
+
+LOG_MODULE_REGISTER(relay_fwd_bench, LOG_LEVEL_INF);
+
+#define BENCH_HUB_MTU   247
+
+struct bench_case
+{
+    const char *name;
+    enum relay_stream stream;
+    uint16_t len;
+};
+
+static const struct bench_case bench_cases[] = {
+    { "rawdata",       RELAY_STREAM_RAWDATA,       INFERENCE_RESULT_PACKET_SIZE },
+    { "seq_result",    RELAY_STREAM_SEQ_RESULT,    20 },
+    { "seq_result",    RELAY_STREAM_SEQ_RESULT,    120 },
+    { "seq_result",    RELAY_STREAM_SEQ_RESULT,    480 },
+    { "debug_string",  RELAY_STREAM_DEBUG_STRING,  20 },
+    { "debug_string",  RELAY_STREAM_DEBUG_STRING,  240 },
+    { "grideye_pixel", RELAY_STREAM_GRIDEYE_RAW,   sizeof(struct bt_grideye_data_type) },
+    { "model_ack",     RELAY_STREAM_SOUND_MODEL,   sizeof(struct ble_ack_packet) },
+    { "feature",       RELAY_STREAM_SOUND_FEATURE, sizeof(struct ble_sound_feature_packet) },
+};
+
+static struct
+{
+    uint32_t notify_cnt;
+    uint32_t notify_bytes;
+    uint32_t alloc_cnt;
+} bench;
+
+static uint8_t bench_fake_hub;
+static uint8_t bench_payload[512];
+
+/* ----------------- mocks (--wrap) ----------------- */
+
+int __wrap_bt_gatt_notify_cb(struct bt_conn *conn, struct bt_gatt_notify_params *params)
+{
+    bench.notify_cnt++;
+    bench.notify_bytes += params->len;
+    return 0;
+}
+
+uint16_t __wrap_bt_gatt_get_mtu(struct bt_conn *conn)
+{
+    return BENCH_HUB_MTU;
+}
+
+void *__real_k_malloc(size_t size);
+void *__wrap_k_malloc(size_t size)
+{
+    bench.alloc_cnt++;
+    return __real_k_malloc(size);
+}
+
+void *__real_k_heap_alloc(struct k_heap *h, size_t bytes, k_timeout_t timeout);
+void *__wrap_k_heap_alloc(struct k_heap *h, size_t bytes, k_timeout_t timeout)
+{
+    bench.alloc_cnt++;
+    return __real_k_heap_alloc(h, bytes, timeout);
+}
+
+struct net_buf *__real_net_buf_alloc_fixed(struct net_buf_pool *pool, k_timeout_t timeout);
+struct net_buf *__wrap_net_buf_alloc_fixed(struct net_buf_pool *pool, k_timeout_t timeout)
+{
+    bench.alloc_cnt++;
+    return __real_net_buf_alloc_fixed(pool, timeout);
+}
+
+/* ----------------- cycle source ----------------- */
+
+/* native_sim 의 k_cycle / timing 은 시뮬레이션 시간이라 host TSC 를 쓴다 */
+static inline uint64_t bench_cycles(void)
+{
+#if defined(CONFIG_ARCH_POSIX) && (defined(__x86_64__) || defined(__i386__))
+    return __builtin_ia32_rdtsc();
+#else
+    return timing_counter_get();
+#endif
+}
+
+static uint64_t bench_elapsed(uint64_t start, uint64_t end)
+{
+#if defined(CONFIG_ARCH_POSIX) && (defined(__x86_64__) || defined(__i386__))
+    return end - start;
+#else
+    timing_t s = start, e = end;
+
+    return timing_cycles_get(&s, &e);
+#endif
+}
+
+/* ----------------- input ----------------- */
+
+static uint16_t bench_fill(const struct bench_case *c, uint32_t i)
+{
+    memset(bench_payload, 0x5A, c->len);
+
+    switch (c->stream) {
+    case RELAY_STREAM_GRIDEYE_RAW: {
+        struct bt_grideye_data_type *px = (struct bt_grideye_data_type *)bench_payload;
+
+        px->index = i % GRID_EYE_PIXEL_SIZE;
+        px->data = 100 + (int)(i % 7);
+        break;
+    }
+    case RELAY_STREAM_SOUND_MODEL: {
+        struct ble_ack_packet *ack = (struct ble_ack_packet *)bench_payload;
+
+        ack->cmd = BLE_MODEL_UPDATE_CMD_START;
+        ack->seq = i;
+        break;
+    }
+    case RELAY_STREAM_SOUND_FEATURE: {
+        struct ble_sound_feature_packet *f = (struct ble_sound_feature_packet *)bench_payload;
+
+        f->cmd = BLE_FEATURE_COLLECTION_CMD_DATA;
+        f->seq = i;
+        break;
+    }
+    default:
+        break;
+    }
+
+    return c->len;
+}
+
+static bool bench_run_case(const struct bench_case *c)
+{
+    uint64_t total = 0, min_cyc = UINT64_MAX, max_cyc = 0;
+    uint32_t n = CONFIG_RELAY_FWD_BENCH_ITERATIONS;
+    uint64_t avg;
+
+    memset(&bench, 0, sizeof(bench));
+
+    for (uint32_t i = 0; i < n; i++) {
+        uint16_t len = bench_fill(c, i);
+        uint64_t t0 = bench_cycles();
+
+        ble_relay_bench_notify(c->stream, bench_payload, len);
+
+        uint64_t cyc = bench_elapsed(t0, bench_cycles());
+
+        total += cyc;
+        min_cyc = MIN(min_cyc, cyc);
+        max_cyc = MAX(max_cyc, cyc);
+
+        if (c->stream == RELAY_STREAM_SOUND_FEATURE && (i % 32) == 31) {
+            /* feature ring 은 relay_fwd_workq 가 비운다 */
+            k_yield();
+        }
+    }
+
+    avg = total / n;
+    LOG_INF("[BENCH] %-13s %4u B: %6u cyc/pkt (min %u, max %u), notify %u.%02u/pkt %u B/pkt, alloc %u.%02u/pkt",
+            c->name, c->len, (uint32_t)avg, (uint32_t)min_cyc, (uint32_t)max_cyc,
+            bench.notify_cnt / n, (bench.notify_cnt % n) * 100 / n,
+            bench.notify_bytes / n,
+            bench.alloc_cnt / n, (bench.alloc_cnt % n) * 100 / n);
+
+    return CONFIG_RELAY_FWD_BENCH_BUDGET_CYCLES == 0 || avg <= CONFIG_RELAY_FWD_BENCH_BUDGET_CYCLES;
+}
+
+/* 모든 hub 쪽 CCC 를 notify enable 로 (hub 가 구독한 상태) */
+static uint8_t bench_enable_ccc(const struct bt_gatt_attr *attr, uint16_t handle, void *user_data)
+{
+    struct _bt_gatt_ccc *ccc = attr->user_data;
+
+    if (ccc && ccc->cfg_changed) {
+        ccc->cfg_changed(attr, BT_GATT_CCC_NOTIFY);
+    }
+    return BT_GATT_ITER_CONTINUE;
+}
+
+int relay_fwd_bench_run(void)
+{
+    bool ok = true;
+
+    timing_init();
+    timing_start();
+    relay_workq_init();
+
+    ble_relay_bench_setup((struct bt_conn *)&bench_fake_hub);
+    bt_gatt_foreach_attr_type(BT_ATT_FIRST_ATTRIBUTE_HANDLE, BT_ATT_LAST_ATTRIBUTE_HANDLE,
+                              BT_UUID_GATT_CCC, NULL, 0, bench_enable_ccc, NULL);
+
+    LOG_INF("[BENCH] %u iterations per case, hub MTU %u", CONFIG_RELAY_FWD_BENCH_ITERATIONS,
+            BENCH_HUB_MTU);
+
+    for (int i = 0; i < ARRAY_SIZE(bench_cases); i++) {
+        if (!bench_run_case(&bench_cases[i])) {
+            LOG_ERR("[BENCH] %s %u B over budget (%u cyc/pkt)", bench_cases[i].name,
+                    bench_cases[i].len, CONFIG_RELAY_FWD_BENCH_BUDGET_CYCLES);
+            ok = false;
+        }
+    }
+
+    LOG_INF("[BENCH] done (%s)", ok ? "pass" : "over budget");
+    log_panic();
+
+#if defined(CONFIG_ARCH_POSIX)
+    posix_exit(ok ? 0 : 1);
+#endif
+    return ok ? 0 : -ERANGE;
+}
+
+#endif /* CONFIG_RELAY_FWD_BENCH */
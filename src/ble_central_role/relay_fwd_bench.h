@@ -0,0 +1,17 @@
+#ifndef _RELAY_FWD_BENCH_H_
+#define _RELAY_FWD_BENCH_H_
+
+/**
+ * @brief Forwarding path microbenchmark (CONFIG_RELAY_FWD_BENCH).
+ *
+ * Feeds synthetic node notifications of every relayed stream through the
+ * central notify callback with bt_gatt_notify_cb() mocked out, and logs
+ * cycles, notifications, bytes and allocations per packet.
+ * On native_sim the process exits when done (exit code 1 if a case is over
+ * CONFIG_RELAY_FWD_BENCH_BUDGET_CYCLES).
+ *
+ * @retval 0 when every case is within budget, -ERANGE otherwise.
+ */
+int relay_fwd_bench_run(void);
+
+#endif
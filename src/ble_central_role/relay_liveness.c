@@ -0,0 +1,112 @@
+/* relay_liveness.c
+ *
+ * 목적:
+ *  - node 가 연결은 유지한 채 notify 만 멈추는 경우 (CCC 가 조용히 초기화됨 등) 를 찾는다.
+ *  - stream 마다 notification 간격을 학습해서, 평균 간격의 몇 배 동안 아무것도 안 오면 stall.
+ *  - 간격이 들쭉날쭉한 stream (debug string 등) 은 학습 단계에서 제외된다.
+ */
+#include "relay_liveness.h"
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+
+/* EWMA 1/8 (RTT 추정과 같은 방식) */
+#define LIVENESS_EWMA_SHIFT 3
+
+struct liveness
+{
+    uint32_t last_ms;
+    uint32_t avg_gap_ms;
+    uint32_t jitter_ms;
+    uint16_t samples;
+    bool seen;
+};
+
+static struct liveness lv[RELAY_STREAM_COUNT];
+static struct k_spinlock lv_lock;
+
+static bool liveness_monitored(enum relay_stream stream)
+{
+    return stream != RELAY_STREAM_SOUND_MODEL && stream != RELAY_STREAM_SOUND_FEATURE &&
+           stream != RELAY_STREAM_NODE_WRITE && stream != RELAY_STREAM_CHAIN &&
+           stream != RELAY_STREAM_SOUND_ISO && stream != RELAY_STREAM_ROOM_DEVICE;
+}
+
+static bool liveness_periodic(const struct liveness *l)
+{
+    return l->samples >= RELAY_LIVENESS_LEARN_SAMPLES && l->jitter_ms * 2 <= l->avg_gap_ms;
+}
+
+static uint32_t liveness_stall_ms(const struct liveness *l)
+{
+    return MAX(l->avg_gap_ms * CONFIG_RELAY_LIVENESS_STALL_FACTOR, CONFIG_RELAY_LIVENESS_MIN_STALL_MS);
+}
+
+void relay_liveness_rx(enum relay_stream stream)
+{
+    uint32_t now = k_uptime_get_32();
+    struct liveness *l;
+    k_spinlock_key_t key;
+    uint32_t gap;
+
+    if (stream >= RELAY_STREAM_COUNT || !liveness_monitored(stream)) {
+        return;
+    }
+    l = &lv[stream];
+
+    key = k_spin_lock(&lv_lock);
+    gap = now - l->last_ms;
+    /* stall 뒤 첫 notification 이면 끊겼던 시간은 학습하지 않는다 */
+    if (l->seen && !(liveness_periodic(l) && gap > liveness_stall_ms(l))) {
+        if (l->samples == 0) {
+            l->avg_gap_ms = gap;
+            l->jitter_ms = 0;
+        } else {
+            int32_t err = (int32_t)gap - (int32_t)l->avg_gap_ms;
+            int32_t abs_err = err < 0 ? -err : err;
+
+            l->avg_gap_ms = (int32_t)l->avg_gap_ms + (err >> LIVENESS_EWMA_SHIFT);
+            l->jitter_ms += (abs_err - (int32_t)l->jitter_ms) >> LIVENESS_EWMA_SHIFT;
+        }
+        if (l->samples < UINT16_MAX) {
+            l->samples++;
+        }
+    }
+    l->seen = true;
+    l->last_ms = now;
+    k_spin_unlock(&lv_lock, key);
+}
+
+uint32_t relay_liveness_stalled(uint32_t now_ms)
+{
+    uint32_t mask = 0;
+    k_spinlock_key_t key = k_spin_lock(&lv_lock);
+
+    for (int i = 0; i < RELAY_STREAM_COUNT; i++) {
+        const struct liveness *l = &lv[i];
+
+        if (liveness_periodic(l) && now_ms - l->last_ms > liveness_stall_ms(l)) {
+            mask |= BIT(i);
+        }
+    }
+    k_spin_unlock(&lv_lock, key);
+
+    return mask;
+}
+
+uint32_t relay_liveness_expected_ms(enum relay_stream stream)
+{
+    if (stream >= RELAY_STREAM_COUNT || !liveness_periodic(&lv[stream])) {
+        return 0;
+    }
+    return lv[stream].avg_gap_ms;
+}
+
+void relay_liveness_reset(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&lv_lock);
+
+    memset(lv, 0, sizeof(lv));
+    k_spin_unlock(&lv_lock, key);
+}
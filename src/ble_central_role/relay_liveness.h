@@ -0,0 +1,42 @@
+#ifndef _RELAY_LIVENESS_H_
+#define _RELAY_LIVENESS_H_
+
+#include <stdint.h>
+#include "relay_stats.h"
+
+/** @brief Per-stream liveness of the node notifications.
+ *
+ * The expected gap between two notifications of a stream is learned from the
+ * traffic (moving average and jitter of the gaps). Once a stream has shown at
+ * least RELAY_LIVENESS_LEARN_SAMPLES gaps with a jitter below half of the
+ * average gap it is considered periodic, and it is stalled when nothing came
+ * for CONFIG_RELAY_LIVENESS_STALL_FACTOR average gaps (at least
+ * CONFIG_RELAY_LIVENESS_MIN_STALL_MS).
+ *
+ * Streams with explicit sessions (sound model update, feature collection)
+ * stop by design and are not monitored.
+ */
+#define RELAY_LIVENESS_LEARN_SAMPLES    8
+
+/** @brief A notification of @p stream arrived (BT RX thread). */
+void relay_liveness_rx(enum relay_stream stream);
+
+/**
+ * @brief Streams that are stalled now.
+ *
+ * @param now_ms is k_uptime_get_32().
+ * @return Bitmask of BIT(enum relay_stream).
+ */
+uint32_t relay_liveness_stalled(uint32_t now_ms);
+
+/**
+ * @brief Expected gap of @p stream.
+ *
+ * @return Average gap in ms, 0 while the stream is still being learned.
+ */
+uint32_t relay_liveness_expected_ms(enum relay_stream stream);
+
+/** @brief Forget the learned rates (new node connection). */
+void relay_liveness_reset(void);
+
+#endif
@@ -0,0 +1,211 @@
+/* relay_security.c
+ *
+ * 목적:
+ *  - node / hub 링크를 연결 직후 암호화한다.
+ *  - 이미 bond 가 있으면 저장된 LTK 로 바로 encryption (pairing 없음),
+ *    처음 보는 상대면 LE Secure Connections pairing + bonding.
+ *  - 연결부터 암호화 완료까지 걸린 시간을 경로별로 기록한다.
+ */
+#include "relay_security.h"
+
+#include <stdbool.h>
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/addr.h>
+#include <zephyr/logging/log.h>
+
+#include "room_device.h"
+
+LOG_MODULE_REGISTER(relay_sec, LOG_LEVEL_INF);
+
+#if defined(CONFIG_RELAY_LINK_SECURITY)
+
+enum sec_link
+{
+    SEC_LINK_NODE,      /* relay = central */
+    SEC_LINK_HUB,       /* relay = peripheral */
+    SEC_LINK_COUNT,
+};
+
+enum sec_path
+{
+    SEC_PATH_RESUME,    /* bond 있음, LTK 로 encryption */
+    SEC_PATH_PAIRING,   /* 새 pairing */
+    SEC_PATH_COUNT,
+};
+
+static const char *const sec_link_str[] = { "node", "hub" };
+static const char *const sec_path_str[] = { "re-encryption", "pairing" };
+
+struct sec_latency
+{
+    uint32_t cnt;
+    uint32_t sum_ms;
+    uint32_t max_ms;
+};
+
+static struct
+{
+    struct bt_conn *conn;       /* 비교용, ref 는 잡지 않는다 */
+    uint32_t connected_ms;
+    bool bonded;
+    bool encrypted;
+} links[SEC_LINK_COUNT];
+
+static struct sec_latency latency[SEC_LINK_COUNT][SEC_PATH_COUNT];
+
+static int sec_link_of(struct bt_conn *conn)
+{
+    struct bt_conn_info info;
+
+    if (bt_conn_get_info(conn, &info)) {
+        return -EINVAL;
+    }
+    return (info.role == BT_CONN_ROLE_CENTRAL) ? SEC_LINK_NODE : SEC_LINK_HUB;
+}
+
+struct bond_find_ctx
+{
+    const bt_addr_le_t *addr;
+    bool found;
+};
+
+static void bond_find_cb(const struct bt_bond_info *info, void *user_data)
+{
+    struct bond_find_ctx *ctx = user_data;
+
+    if (bt_addr_le_eq(&info->addr, ctx->addr)) {
+        ctx->found = true;
+    }
+}
+
+static bool sec_is_bonded(struct bt_conn *conn)
+{
+    struct bond_find_ctx ctx = { .addr = bt_conn_get_dst(conn) };
+
+    bt_foreach_bond(BT_ID_DEFAULT, bond_find_cb, &ctx);
+    return ctx.found;
+}
+
+static void sec_connected(struct bt_conn *conn, uint8_t conn_err)
+{
+    int link;
+    int err;
+
+    if (conn_err || (link = sec_link_of(conn)) < 0) {
+        return;
+    }
+    /* button / PAAR 장치는 pairing 을 못 하는 경우가 많고, node link 도 아니다 */
+    if (room_device_owns(conn)) {
+        return;
+    }
+
+    links[link].conn = conn;
+    links[link].connected_ms = k_uptime_get_32();
+    links[link].bonded = sec_is_bonded(conn);
+    links[link].encrypted = false;
+
+    err = bt_conn_set_security(conn, BT_SECURITY_L2);
+    if (err) {
+        LOG_WRN("[SEC] %s link: security request failed (err %d)", sec_link_str[link], err);
+    } else {
+        LOG_DBG("[SEC] %s link: %s", sec_link_str[link],
+                links[link].bonded ? "bonded, starting encryption" : "new peer, pairing");
+    }
+}
+
+static void sec_disconnected(struct bt_conn *conn, uint8_t reason)
+{
+    for (int i = 0; i < SEC_LINK_COUNT; i++) {
+        if (links[i].conn == conn) {
+            links[i].conn = NULL;
+        }
+    }
+}
+
+static void sec_security_changed(struct bt_conn *conn, bt_security_t level, enum bt_security_err err)
+{
+    struct sec_latency *lat;
+    enum sec_path path;
+    uint32_t ms;
+    int link = sec_link_of(conn);
+
+    if (link < 0 || links[link].conn != conn) {
+        return;
+    }
+
+    if (err) {
+        if (err == BT_SECURITY_ERR_PIN_OR_KEY_MISSING && links[link].bonded) {
+            /* 상대가 bond 를 지웠다. 우리 쪽도 지우면 (연결이 끊기고) 다음 연결에서 새로 pairing */
+            LOG_WRN("[SEC] %s link: peer lost the bond, removing ours", sec_link_str[link]);
+            bt_unpair(BT_ID_DEFAULT, bt_conn_get_dst(conn));
+        } else {
+            /* 우리 characteristic 은 암호화를 요구하지 않으므로 평문으로 계속 */
+            LOG_WRN("[SEC] %s link: security failed (err %d), staying unencrypted",
+                    sec_link_str[link], err);
+        }
+        return;
+    }
+
+    if (links[link].encrypted || level < BT_SECURITY_L2) {
+        return;
+    }
+    links[link].encrypted = true;
+
+    ms = k_uptime_get_32() - links[link].connected_ms;
+    path = links[link].bonded ? SEC_PATH_RESUME : SEC_PATH_PAIRING;
+    lat = &latency[link][path];
+    lat->cnt++;
+    lat->sum_ms += ms;
+    lat->max_ms = MAX(lat->max_ms, ms);
+
+    LOG_INF("[SEC] %s link encrypted (L%d) by %s in %u ms (avg %u ms, max %u ms over %u)",
+            sec_link_str[link], level, sec_path_str[path], ms, lat->sum_ms / lat->cnt, lat->max_ms, lat->cnt);
+}
+
+BT_CONN_CB_DEFINE(sec_conn_callbacks) = {
+    .connected = sec_connected,
+    .disconnected = sec_disconnected,
+    .security_changed = sec_security_changed,
+};
+
+static void sec_pairing_complete(struct bt_conn *conn, bool bonded)
+{
+    struct bt_conn_info info;
+    bool sc = false;
+
+    if (!bt_conn_get_info(conn, &info)) {
+        sc = (info.security.flags & BT_SECURITY_FLAG_SC) != 0;
+    }
+    LOG_INF("[SEC] pairing complete (%s, %s)", bonded ? "bonded" : "not bonded",
+            sc ? "LE Secure Connections" : "legacy");
+}
+
+static void sec_pairing_failed(struct bt_conn *conn, enum bt_security_err reason)
+{
+    LOG_WRN("[SEC] pairing failed (reason %d)", reason);
+}
+
+static struct bt_conn_auth_info_cb sec_auth_info_cb = {
+    .pairing_complete = sec_pairing_complete,
+    .pairing_failed = sec_pairing_failed,
+};
+
+void relay_security_init(void)
+{
+    int err = bt_conn_auth_info_cb_register(&sec_auth_info_cb);
+
+    if (err) {
+        LOG_WRN("[SEC] auth info callback register failed (err %d)", err);
+    }
+}
+
+#else
+
+void relay_security_init(void)
+{
+}
+
+#endif /* CONFIG_RELAY_LINK_SECURITY */
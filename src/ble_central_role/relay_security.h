@@ -0,0 +1,24 @@
+#ifndef _RELAY_SECURITY_H_
+#define _RELAY_SECURITY_H_
+
+/** @brief Encryption of the node and hub links.
+ *
+ * Right after a link comes up the relay asks for BT_SECURITY_L2:
+ *  - bonded peer : encryption is started with the stored LTK (no pairing).
+ *  - new peer    : LE Secure Connections pairing (Just Works) with bonding.
+ * On the hub link the relay is peripheral, so this is a security request
+ * and the hub decides. Discovery and forwarding are not held back while the
+ * link is being encrypted.
+ *
+ * Bonds are kept with the BT settings. When the table (CONFIG_BT_MAX_PAIRED)
+ * is full the least recently used bond is replaced
+ * (CONFIG_BT_KEYS_OVERWRITE_OLDEST).
+ *
+ * The time from connection to encryption is logged per link and per path
+ * (re-encryption / pairing) with its running average and maximum.
+ */
+
+/** @brief Register the pairing callbacks. Call once before bt_enable(). */
+void relay_security_init(void);
+
+#endif
@@ -0,0 +1,237 @@
+/* relay_segment.c
+ *
+ * 목적:
+ *  - ATT MTU 보다 긴 가변 길이 payload (seq result, debug string, blob) 를
+ *    START / CONTINUE / END 헤더가 붙은 여러 notification 으로 나눠 보낸다.
+ *  - 반대 방향으로는 segment 를 모아서 원래 payload 로 재조립한다. (timeout 포함)
+ */
+#include "relay_segment.h"
+
+#include <string.h>
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/logging/log.h>
+
+#include "relay_workq.h"
+#include "radio_airtime.h"
+#include "relay_chain.h"
+
+LOG_MODULE_REGISTER(relay_seg, LOG_LEVEL_INF);
+
+/* stream 별 송신 segment 카운터 */
+static uint8_t tx_seq[RELAY_SEG_STREAM_MASK + 1];
+
+uint16_t relay_seg_payload_size(struct bt_conn *conn)
+{
+    uint16_t mtu = bt_gatt_get_mtu(conn);
+    uint16_t pdu = MIN((uint16_t)(mtu - RELAY_SEG_ATT_NOTIFY_OVERHEAD), RELAY_SEG_MAX_PDU);
+
+    /* 위가 relay 이면 CHAIN_DATA frame header 자리를 남긴다 */
+    return pdu - relay_chain_overhead() - RELAY_SEG_HDR_SIZE;
+}
+
+/* payload + tail 을 이어붙인 것의 [off, off + n) 을 dst 로 */
+static void relay_seg_copy(uint8_t *dst, const uint8_t *data, uint16_t data_len,
+                           const uint8_t *tail, uint16_t off, uint16_t n)
+{
+    if (off < data_len) {
+        uint16_t from_data = MIN(n, (uint16_t)(data_len - off));
+
+        memcpy(dst, &data[off], from_data);
+        dst += from_data;
+        off += from_data;
+        n -= from_data;
+    }
+    if (n) {
+        memcpy(dst, &tail[off - data_len], n);
+    }
+}
+
+int relay_seg_send(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                   uint8_t stream, const uint8_t *data, uint16_t len)
+{
+    return relay_seg_send_tail(conn, attr, stream, data, len, NULL, 0);
+}
+
+int relay_seg_send_tail(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                        uint8_t stream, const uint8_t *data, uint16_t data_len,
+                        const uint8_t *tail, uint8_t tail_len)
+{
+    uint8_t pdu[RELAY_SEG_MAX_PDU];
+    uint16_t len = data_len + tail_len;
+    uint16_t seg_max;
+    uint16_t sent = 0;
+    int err;
+
+    if (!conn) {
+        return -ENOTCONN;
+    }
+
+    if ((!data && data_len) || (!tail && tail_len)) {
+        return -EINVAL;
+    }
+
+    seg_max = relay_seg_payload_size(conn);
+
+    /* START segment 는 전체 길이 2 byte 를 더 싣는다 */
+    do {
+        struct relay_seg_hdr *hdr = (struct relay_seg_hdr *)pdu;
+        bool first = (sent == 0);
+        uint16_t hdr_len = first ? RELAY_SEG_START_HDR_SIZE : RELAY_SEG_HDR_SIZE;
+        uint16_t room = seg_max + RELAY_SEG_HDR_SIZE - hdr_len;
+        uint16_t chunk = MIN(room, (uint16_t)(len - sent));
+
+        hdr->ctrl = stream & RELAY_SEG_STREAM_MASK;
+        if (first) {
+            hdr->ctrl |= RELAY_SEG_FLAG_START;
+            sys_put_le16(len, &pdu[RELAY_SEG_HDR_SIZE]);
+        }
+        if (sent + chunk == len) {
+            hdr->ctrl |= RELAY_SEG_FLAG_END;
+        }
+        hdr->seq = tx_seq[stream & RELAY_SEG_STREAM_MASK]++;
+
+        relay_seg_copy(&pdu[hdr_len], data, data_len, tail, sent, chunk);
+
+        /* 중간에 실패하면 hub 쪽 재조립은 다음 START 에서 버려진다 */
+        err = relay_chain_hub_notify(conn, attr, pdu, hdr_len + chunk);
+        if (err) {
+            LOG_DBG("[SEG] stream %u notify failed at %u/%u (err %d)", stream, sent, len, err);
+            return err;
+        }
+        radio_airtime_pdu(RADIO_LINK_HUB, hdr_len + chunk);
+
+        sent += chunk;
+    } while (sent < len);
+
+    return 0;
+}
+
+static void relay_seg_timeout_work_handler(struct k_work *work)
+{
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    struct relay_seg_rx *rx = CONTAINER_OF(dwork, struct relay_seg_rx, timeout_work);
+    k_spinlock_key_t key = k_spin_lock(&rx->lock);
+
+    if (rx->active) {
+        LOG_WRN("[SEG] stream %u reassembly timeout (%u/%u)", rx->stream, rx->offset, rx->total_len);
+        rx->active = false;
+        rx->drop_cnt++;
+    }
+
+    k_spin_unlock(&rx->lock, key);
+}
+
+void relay_seg_rx_init(struct relay_seg_rx *rx, uint8_t stream, relay_seg_rx_cb_t cb)
+{
+    memset(rx, 0, sizeof(*rx));
+    rx->stream = stream & RELAY_SEG_STREAM_MASK;
+    rx->cb = cb;
+    k_work_init_delayable(&rx->timeout_work, relay_seg_timeout_work_handler);
+}
+
+void relay_seg_rx_reset(struct relay_seg_rx *rx)
+{
+    k_spinlock_key_t key = k_spin_lock(&rx->lock);
+
+    rx->active = false;
+    rx->offset = 0;
+    rx->total_len = 0;
+
+    k_spin_unlock(&rx->lock, key);
+    k_work_cancel_delayable(&rx->timeout_work);
+}
+
+int relay_seg_rx_feed(struct relay_seg_rx *rx, const uint8_t *data, uint16_t len)
+{
+    const struct relay_seg_hdr *hdr = (const struct relay_seg_hdr *)data;
+    uint16_t hdr_len = RELAY_SEG_HDR_SIZE;
+    uint16_t chunk;
+    uint16_t total = 0;
+    bool started = false;
+    bool complete = false;
+    bool active;
+    k_spinlock_key_t key;
+    int err = 0;
+
+    if (len < RELAY_SEG_HDR_SIZE || (hdr->ctrl & RELAY_SEG_STREAM_MASK) != rx->stream) {
+        return -EINVAL;
+    }
+
+    key = k_spin_lock(&rx->lock);
+
+    if (hdr->ctrl & RELAY_SEG_FLAG_START) {
+        if (len < RELAY_SEG_START_HDR_SIZE) {
+            err = -EINVAL;
+            goto out;
+        }
+        if (rx->active) {
+            /* 이전 payload 의 END 가 오지 않았음 */
+            rx->drop_cnt++;
+        }
+
+        rx->total_len = sys_get_le16(&data[RELAY_SEG_HDR_SIZE]);
+        rx->offset = 0;
+        rx->active = false;
+        hdr_len = RELAY_SEG_START_HDR_SIZE;
+
+        if (rx->total_len > sizeof(rx->buf)) {
+            rx->drop_cnt++;
+            err = -EMSGSIZE;
+            goto out;
+        }
+
+        rx->active = true;
+        started = true;
+    } else if (!rx->active || hdr->seq != rx->next_seq) {
+        if (rx->active) {
+            rx->active = false;
+            rx->drop_cnt++;
+        }
+        err = -EILSEQ;
+        goto out;
+    }
+
+    chunk = len - hdr_len;
+    if (rx->offset + chunk > rx->total_len) {
+        rx->active = false;
+        rx->drop_cnt++;
+        err = -EMSGSIZE;
+        goto out;
+    }
+
+    memcpy(&rx->buf[rx->offset], &data[hdr_len], chunk);
+    rx->offset += chunk;
+    rx->next_seq = hdr->seq + 1;
+
+    if (hdr->ctrl & RELAY_SEG_FLAG_END) {
+        rx->active = false;
+        if (rx->offset == rx->total_len) {
+            complete = true;
+            total = rx->offset;
+        } else {
+            rx->drop_cnt++;
+            err = -EILSEQ;
+        }
+    }
+
+out:
+    /* timeout / reset 이 lock 밖에서 active 를 바꿀 수 있으므로 lock 안에서 읽어 둔다 */
+    active = rx->active;
+    k_spin_unlock(&rx->lock, key);
+
+    if (started && !complete) {
+        k_work_reschedule_for_queue(&relay_fwd_workq, &rx->timeout_work, K_MSEC(CONFIG_RELAY_SEG_RX_TIMEOUT_MS));
+    } else if (!active) {
+        k_work_cancel_delayable(&rx->timeout_work);
+    }
+
+    if (complete && rx->cb) {
+        /* feed 는 BT RX thread 하나에서만 불리므로 buf 를 그대로 넘겨도 안전 */
+        rx->cb(rx, rx->buf, total);
+    }
+
+    return err;
+}
@@ -0,0 +1,126 @@
+#ifndef _RELAY_SEGMENT_H_
+#define _RELAY_SEGMENT_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+
+/** @brief Segment header control bits
+ *
+ * 모든 가변 길이 스트림(seq result, debug string, blob)은 notification 마다
+ * 2 byte 헤더를 붙인다.
+ *  - START : 첫 segment. 헤더 뒤에 전체 길이(uint16_t, LE)가 온다.
+ *  - END   : 마지막 segment.
+ *  - START | END : 한 notification 에 다 들어가는 경우 (single)
+ *  - 둘 다 없음 : continue segment
+ */
+#define RELAY_SEG_FLAG_START        0x80
+#define RELAY_SEG_FLAG_END          0x40
+#define RELAY_SEG_STREAM_MASK       0x3F
+
+#define RELAY_SEG_HDR_SIZE          2
+#define RELAY_SEG_START_HDR_SIZE    (RELAY_SEG_HDR_SIZE + sizeof(uint16_t))
+
+/** ATT notification header (opcode + handle) */
+#define RELAY_SEG_ATT_NOTIFY_OVERHEAD   3
+/** Largest notification payload we ever build (ATT MTU 247) */
+#define RELAY_SEG_MAX_PDU               244
+
+/** @brief Stream ids carried in the segment header */
+enum relay_seg_stream
+{
+    RELAY_SEG_STREAM_SEQ_RESULT   = 1,
+    RELAY_SEG_STREAM_DEBUG_STRING = 2,
+    RELAY_SEG_STREAM_BLOB         = 3,
+    RELAY_SEG_STREAM_DIAG_COUNTERS = 4,    /* struct relay_stats_packet notification */
+};
+
+struct relay_seg_hdr
+{
+    uint8_t ctrl;   /* START/END flag + stream id */
+    uint8_t seq;    /* per-stream rolling segment counter (loss detection) */
+} __attribute__((packed));
+
+struct relay_seg_rx;
+
+/** @brief Callback type for a fully reassembled payload. */
+typedef void (*relay_seg_rx_cb_t)(struct relay_seg_rx *rx, const uint8_t *data, uint16_t len);
+
+/** @brief Reassembly context for one segmented stream. */
+struct relay_seg_rx
+{
+    uint8_t stream;
+    uint8_t next_seq;
+    bool active;
+    uint16_t total_len;
+    uint16_t offset;
+    uint32_t drop_cnt;
+    relay_seg_rx_cb_t cb;
+    struct k_spinlock lock;
+    struct k_work_delayable timeout_work;
+    uint8_t buf[CONFIG_RELAY_SEG_RX_BUF_SIZE];
+};
+
+/**
+ * @brief Largest segment payload (without segment header) for the given link.
+ *
+ * @param conn is the connection the segments will be sent on.
+ * @return uint16_t ATT MTU - notification overhead - segment header.
+ */
+uint16_t relay_seg_payload_size(struct bt_conn *conn);
+
+/**
+ * @brief Send a variable length payload as one or more notifications.
+ *
+ * The payload is split according to the current ATT MTU of @p conn and every
+ * segment is queued back-to-back so the whole result goes out in as few
+ * connection events as the controller allows.
+ *
+ * @param conn is the (hub) connection to notify.
+ * @param attr is the characteristic value attribute.
+ * @param stream is one of relay_seg_stream.
+ * @param data is the payload.
+ * @param len is the payload length.
+ * @return 0 if every segment was queued.
+ *         Otherwise, a (negative) error code of the first failing segment.
+ */
+int relay_seg_send(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                   uint8_t stream, const uint8_t *data, uint16_t len);
+
+/**
+ * @brief relay_seg_send() of @p data followed by @p tail, without copying
+ *        them into one buffer first (e.g. a relay receive timestamp).
+ *
+ * The total length in the START segment is data_len + tail_len.
+ */
+int relay_seg_send_tail(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                        uint8_t stream, const uint8_t *data, uint16_t data_len,
+                        const uint8_t *tail, uint8_t tail_len);
+
+/**
+ * @brief Initialize a reassembly context.
+ *
+ * @param rx is the context to initialize.
+ * @param stream is the stream id expected on this context.
+ * @param cb is called from the feeding thread when a payload is complete.
+ */
+void relay_seg_rx_init(struct relay_seg_rx *rx, uint8_t stream, relay_seg_rx_cb_t cb);
+
+/**
+ * @brief Feed one received segment into a reassembly context.
+ *
+ * A partially received payload is dropped when a segment is lost, when a new
+ * START arrives, or when CONFIG_RELAY_SEG_RX_TIMEOUT_MS elapses without END.
+ *
+ * @return 0 if the segment was accepted.
+ *         -EINVAL for a malformed segment, -EILSEQ for a sequence gap,
+ *         -EMSGSIZE if the payload exceeds the reassembly buffer.
+ */
+int relay_seg_rx_feed(struct relay_seg_rx *rx, const uint8_t *data, uint16_t len);
+
+/** @brief Drop any partially reassembled payload. */
+void relay_seg_rx_reset(struct relay_seg_rx *rx);
+
+#endif
@@ -0,0 +1,148 @@
+/* relay_stats.c
+ *
+ * 목적:
+ *  - relay 가 무엇을 받고 / 보내고 / 버렸는지 숫자로 남긴다.
+ *  - hub 는 diagnostics service 로 읽어서 relay 끼리 비교한다.
+ */
+#include "relay_stats.h"
+
+#include <string.h>
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
+
+enum
+{
+    DROP_EACCES,
+    DROP_ENOMEM,
+    DROP_ENOTCONN,
+    DROP_OTHER,
+    DROP_COUNT,
+};
+
+static struct
+{
+    atomic_t rx[RELAY_STREAM_COUNT];
+    atomic_t fwd[RELAY_STREAM_COUNT];
+    atomic_t drop[RELAY_STREAM_COUNT][DROP_COUNT];
+    atomic_t event[RELAY_STATS_EVENT_COUNT];
+    atomic_t discovery_last_ms;
+    atomic_t discovery_max_ms;
+    atomic_t queue_hwm[RELAY_QUEUE_COUNT];
+    atomic_t reset_ms;      /* k_uptime_get_32(), since_reset_s 는 49 일마다 wrap */
+} rs;
+
+static void atomic_max(atomic_t *target, atomic_val_t value)
+{
+    atomic_val_t cur = atomic_get(target);
+
+    while (value > cur) {
+        if (atomic_cas(target, cur, value)) {
+            break;
+        }
+        cur = atomic_get(target);
+    }
+}
+
+/* 다른 thread 가 세는 중에도 counter 하나씩 0 으로 (memset 은 증가 중인 값을 덮는다) */
+static void atomic_clear_all(atomic_t *v, size_t n)
+{
+    for (size_t i = 0; i < n; i++) {
+        atomic_clear(&v[i]);
+    }
+}
+
+static uint16_t sat16(atomic_t *v)
+{
+    return (uint16_t)MIN((uint32_t)atomic_get(v), UINT16_MAX);
+}
+
+void relay_stats_rx(enum relay_stream stream)
+{
+    atomic_inc(&rs.rx[stream]);
+}
+
+void relay_stats_tx(enum relay_stream stream, int err)
+{
+    switch (err) {
+    case 0:
+        atomic_inc(&rs.fwd[stream]);
+        break;
+    case -EACCES:
+        atomic_inc(&rs.drop[stream][DROP_EACCES]);
+        break;
+    case -ENOMEM:
+        atomic_inc(&rs.drop[stream][DROP_ENOMEM]);
+        break;
+    case -ENOTCONN:
+        atomic_inc(&rs.drop[stream][DROP_ENOTCONN]);
+        break;
+    default:
+        atomic_inc(&rs.drop[stream][DROP_OTHER]);
+        break;
+    }
+}
+
+void relay_stats_fwd_add(enum relay_stream stream, uint32_t n)
+{
+    atomic_add(&rs.fwd[stream], (atomic_val_t)n);
+}
+
+void relay_stats_event(enum relay_stats_event event)
+{
+    atomic_inc(&rs.event[event]);
+}
+
+void relay_stats_discovery_done(uint32_t ms)
+{
+    atomic_set(&rs.discovery_last_ms, (atomic_val_t)ms);
+    atomic_max(&rs.discovery_max_ms, (atomic_val_t)ms);
+}
+
+void relay_stats_queue_level(enum relay_queue queue, uint32_t level)
+{
+    atomic_max(&rs.queue_hwm[queue], (atomic_val_t)level);
+}
+
+void relay_stats_reset(void)
+{
+    atomic_clear_all(rs.rx, ARRAY_SIZE(rs.rx));
+    atomic_clear_all(rs.fwd, ARRAY_SIZE(rs.fwd));
+    atomic_clear_all(&rs.drop[0][0], RELAY_STREAM_COUNT * DROP_COUNT);
+    atomic_clear_all(rs.event, ARRAY_SIZE(rs.event));
+    atomic_clear(&rs.discovery_last_ms);
+    atomic_clear(&rs.discovery_max_ms);
+    atomic_clear_all(rs.queue_hwm, ARRAY_SIZE(rs.queue_hwm));
+    atomic_set(&rs.reset_ms, (atomic_val_t)k_uptime_get_32());
+}
+
+void relay_stats_get(struct relay_stats_packet *pkt)
+{
+    int64_t now = k_uptime_get();
+
+    memset(pkt, 0, sizeof(*pkt));
+    pkt->version = RELAY_STATS_PACKET_VERSION;
+    pkt->uptime_s = (uint32_t)(now / MSEC_PER_SEC);
+    pkt->since_reset_s = ((uint32_t)now - (uint32_t)atomic_get(&rs.reset_ms)) / MSEC_PER_SEC;
+
+    for (int i = 0; i < RELAY_STREAM_COUNT; i++) {
+        pkt->stream[i].rx = (uint32_t)atomic_get(&rs.rx[i]);
+        pkt->stream[i].fwd = (uint32_t)atomic_get(&rs.fwd[i]);
+        pkt->stream[i].drop_eacces = sat16(&rs.drop[i][DROP_EACCES]);
+        pkt->stream[i].drop_enomem = sat16(&rs.drop[i][DROP_ENOMEM]);
+        pkt->stream[i].drop_enotconn = sat16(&rs.drop[i][DROP_ENOTCONN]);
+        pkt->stream[i].drop_other = sat16(&rs.drop[i][DROP_OTHER]);
+    }
+
+    for (int i = 0; i < RELAY_STATS_EVENT_COUNT; i++) {
+        pkt->event[i] = sat16(&rs.event[i]);
+    }
+
+    pkt->discovery_last_ms = sat16(&rs.discovery_last_ms);
+    pkt->discovery_max_ms = sat16(&rs.discovery_max_ms);
+
+    for (int i = 0; i < RELAY_QUEUE_COUNT; i++) {
+        pkt->queue_hwm[i] = sat16(&rs.queue_hwm[i]);
+    }
+}
@@ -0,0 +1,107 @@
+#ifndef _RELAY_STATS_H_
+#define _RELAY_STATS_H_
+
+#include <stdint.h>
+
+/** @brief Relay runtime counters.
+ *
+ * Counters are atomic and can be updated from any thread (BT RX, work
+ * queues, proxy threads). They are exposed to the hub by the diagnostics
+ * service (diag_service.h) as one struct relay_stats_packet.
+ */
+
+/** Forwarded streams. rx = frames coming in, fwd = frames going out. */
+enum relay_stream
+{
+    RELAY_STREAM_RAWDATA,       /* node -> hub, inference rawdata */
+    RELAY_STREAM_SEQ_RESULT,    /* node -> hub, seq analysis result */
+    RELAY_STREAM_DEBUG_STRING,  /* node -> hub, debug string */
+    RELAY_STREAM_GRIDEYE_RAW,   /* node -> hub, rx = pixels, fwd = frame parts */
+    RELAY_STREAM_SOUND_MODEL,   /* hub -> node, model update frames */
+    RELAY_STREAM_SOUND_FEATURE, /* node -> hub, rx = frames, fwd = frames in batches */
+    RELAY_STREAM_NODE_WRITE,    /* hub -> node, rx = queued writes, fwd = sent (node_write.h) */
+    RELAY_STREAM_CHAIN,         /* lower relay -> hub, CHAIN_DATA frames (relay_chain.h) */
+    RELAY_STREAM_SOUND_ISO,     /* node -> hub, raw sound SDUs over CIS (sound_iso.h) */
+    RELAY_STREAM_ROOM_DEVICE,   /* room devices -> hub, button / PAAR / Ubinos events (room_device.h) */
+    RELAY_STREAM_COUNT,
+};
+
+enum relay_stats_event
+{
+    RELAY_STATS_SCAN_MATCH,
+    RELAY_STATS_CONN_ATTEMPT,
+    RELAY_STATS_CONN_FAIL,
+    RELAY_STATS_NODE_RECONNECT,
+    RELAY_STATS_NODE_DISCONNECT,
+    RELAY_STATS_HUB_CONNECT,
+    RELAY_STATS_HUB_DISCONNECT,
+    RELAY_STATS_NODE_STALL,         /* node stream stopped while connected */
+    RELAY_STATS_STALL_RECOVERED,    /* ... and came back without a reconnect */
+    RELAY_STATS_EVENT_COUNT,
+};
+
+/** Queues with a high-water mark. */
+enum relay_queue
+{
+    RELAY_QUEUE_FEATURE_RING,
+    RELAY_QUEUE_MODEL_FRAMES,
+    RELAY_QUEUE_FT_JOBS,
+    RELAY_QUEUE_NODE_WRITES,
+    RELAY_QUEUE_COUNT,
+};
+
+#define RELAY_STATS_PACKET_VERSION  6  /* 2: stall events, 3: node write stream / queue, 4: chain stream,
+                                        * 5: sound ISO stream, 6: room device stream */
+
+struct relay_stats_stream_packet
+{
+    uint32_t rx;
+    uint32_t fwd;
+    uint16_t drop_eacces;       /* hub did not enable notifications */
+    uint16_t drop_enomem;       /* no TX buffer / queue full */
+    uint16_t drop_enotconn;     /* link gone */
+    uint16_t drop_other;
+} __attribute__((packed));
+
+struct relay_stats_packet
+{
+    uint8_t version;            /* RELAY_STATS_PACKET_VERSION */
+    uint32_t uptime_s;
+    uint32_t since_reset_s;
+    struct relay_stats_stream_packet stream[RELAY_STREAM_COUNT];
+    uint16_t event[RELAY_STATS_EVENT_COUNT];
+    uint16_t discovery_last_ms;
+    uint16_t discovery_max_ms;
+    uint16_t queue_hwm[RELAY_QUEUE_COUNT];
+} __attribute__((packed));
+
+/** @brief One frame of @p stream came in. */
+void relay_stats_rx(enum relay_stream stream);
+
+/**
+ * @brief Result of forwarding one frame of @p stream.
+ *
+ * @param err is 0 (forwarded) or the negative errno of the send; drops are
+ *            counted per errno (-EACCES, -ENOMEM, -ENOTCONN, other).
+ */
+void relay_stats_tx(enum relay_stream stream, int err);
+
+/** @brief @p n frames of @p stream were forwarded in one batch. */
+void relay_stats_fwd_add(enum relay_stream stream, uint32_t n);
+
+/** @brief Count a link event. */
+void relay_stats_event(enum relay_stats_event event);
+
+/** @brief GATT discovery of the node took @p ms. */
+void relay_stats_discovery_done(uint32_t ms);
+
+/** @brief Current fill level of @p queue, keeps the maximum. */
+void relay_stats_queue_level(enum relay_queue queue, uint32_t level);
+
+/** @brief Clear all counters. */
+void relay_stats_reset(void);
+
+/** @brief Snapshot of all counters in wire format. */
+void relay_stats_get(struct relay_stats_packet *pkt);
+
+#endif
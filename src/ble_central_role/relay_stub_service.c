@@ -17,14 +17,32 @@
 #include "peripheral_service.h"
 #include "env_service.h"
 #include "sound_service.h"
+#include "sound.h"
+#include "sound_iso.h"
+#include "feature_relay.h"
+#include "ble_relay_control.h"
+#include "radio_airtime.h"
+#include "relay_chain.h"
+#include "device_conf_store.h"
+#include "gatt_proxy.h"
+#include "node_write.h"
 // inference_service.h 는 별도 실제 구현 파일에서 사용
 
-/* 공통 dummy 읽기 함수: attr->user_data 의 버퍼를 그대로 반환 */
+/* dummy_read 의 user_data: 버퍼와 그 길이 */
+struct dummy_value
+{
+    const void *data;
+    uint16_t len;
+};
+
+#define DUMMY_VALUE(buf) (&(struct dummy_value){ .data = (buf), .len = sizeof(buf) })
+
+/* 공통 dummy 읽기 함수: attr->user_data (DUMMY_VALUE) 의 버퍼를 그대로 반환 */
 static ssize_t dummy_read(struct bt_conn *conn,
                           const struct bt_gatt_attr *attr,
                           void *buf, uint16_t len, uint16_t offset)
 {
-    const void *value = attr->user_data;
+    const struct dummy_value *value = attr->user_data;
 
     /* attr->user_data 가 NULL 인 경우도 방어 */
     if (!value) {
@@ -32,8 +50,8 @@ static ssize_t dummy_read(struct bt_conn *conn,
         return bt_gatt_attr_read(conn, attr, buf, len, offset, &zero, sizeof(zero));
     }
 
-    /* 여기서는 길이를 몰라서 "최대 len" 만큼만 읽어주고, offset 은 bt_gatt_attr_read 에 맡긴다. */
-    return bt_gatt_attr_read(conn, attr, buf, len, offset, value, len);
+    /* 버퍼 길이까지만 읽어주고, offset / len 은 bt_gatt_attr_read 에 맡긴다. */
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, value->data, value->len);
 }
 
 /* 공통 dummy 쓰기 함수: 수신 데이터는 그대로 버리지만, 길이만큼 처리가 된 것처럼 리턴 */
@@ -62,7 +80,9 @@ static ssize_t dummy_write(struct bt_conn *conn,
 
 /* 각 서비스별 notify enable 상태 플래그 */
 DEFINE_CCC_FLAG(cfg_notify_enabled);
+#if !defined(CONFIG_RELAY_GATT_PROXY)
 DEFINE_CCC_FLAG(env_notify_enabled);
+#endif
 DEFINE_CCC_FLAG(grideye_pred_notify_enabled);
 DEFINE_CCC_FLAG(grideye_raw_notify_enabled);
 DEFINE_CCC_FLAG(periph_notify_enabled);
@@ -88,6 +108,16 @@ static bt_gatt_attr_read_func_t name_read_cb(struct bt_conn *conn,
                              strlen(dean_device_conf.device_name));
 }
 
+/* 이름 / 위치는 relay 에 저장하고 node 에도 전달한다. node 가 없으면 relay 값만 바뀐다.
+ * node 로 가는 write 를 먼저 queue 에 넣고, 성공했을 때만 relay 에 반영한다
+ * (hub 가 실패로 본 write 가 relay 에만 남지 않게) */
+static ssize_t config_forward(enum node_write_target target, const void *buf, uint16_t len)
+{
+    int err = node_write_target(target, buf, len);
+
+    return node_write_att_err(err == -ENOTCONN ? 0 : err, len);
+}
+
 static bt_gatt_attr_write_func_t name_write_cb(struct bt_conn *conn,
                                                const struct bt_gatt_attr *attr,
                                                const void *buf,
@@ -95,10 +125,22 @@ static bt_gatt_attr_write_func_t name_write_cb(struct bt_conn *conn,
                                                uint16_t offset,
                                                uint8_t flags)
 {
-    memset(dean_device_conf.device_name, 0, sizeof(dean_device_conf.device_name));
-    memcpy(dean_device_conf.device_name, buf, len);
+    ssize_t ret;
 
-    return len;
+    if (offset) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+    }
+    if (len >= sizeof(dean_device_conf.device_name)) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+    }
+
+    ret = config_forward(NODE_WRITE_DEVICE_NAME, buf, len);
+    if (ret < 0) {
+        return ret;
+    }
+    /* RAM 만 바꾸고 flash 저장은 device_conf_store 가 나중에 한 번에 */
+    (void)device_conf_set_name(buf, len);
+    return ret;
 }
 
 static bt_gatt_attr_read_func_t location_read_cb(struct bt_conn *conn,
@@ -118,14 +160,23 @@ static bt_gatt_attr_write_func_t location_write_cb(struct bt_conn *conn,
                                                    uint16_t offset,
                                                    uint8_t flags)
 {
-    dean_device_conf.update_flag = 1;
-    memset(dean_device_conf.location, 0, sizeof(dean_device_conf.location));
-    memcpy(dean_device_conf.location, buf, len);
+    ssize_t ret;
 
-    return len;
-}
+    if (offset) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+    }
+    if (len >= sizeof(dean_device_conf.location)) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+    }
 
-void process_file_transfer_write(const void *buf, uint16_t len);
+    ret = config_forward(NODE_WRITE_LOCATION, buf, len);
+    if (ret < 0) {
+        return ret;
+    }
+    (void)device_conf_set_location(buf, len);
+    dean_device_conf.update_flag = 1;
+    return ret;
+}
 
 static bt_gatt_attr_write_func_t file_write_cb(struct bt_conn *conn,
                                                const struct bt_gatt_attr *attr,
@@ -134,142 +185,21 @@ static bt_gatt_attr_write_func_t file_write_cb(struct bt_conn *conn,
                                                uint16_t offset,
                                                uint8_t flags)
 {
+    /* DATA frame 은 write-without-response 로 온다 (file_transfer.c 참고) */
     process_file_transfer_write(buf, len);
     return len;
 }
-void process_file_transfer_write(const void *buf, uint16_t len)
-{
-    int ret;
-    int retry_cnt = 0;
-
-    struct ble_file_transfer_data_packet packet = {0};
-    struct ble_file_transfer_ack_packet ack_packet = {0};
-
-    memcpy(&packet, buf, len);
-
-    // switch (packet.cmd)
-    // {
-    // case BLE_FILE_TRANSFER_CMD_START:
-    // {
-    //     memset(current_file_name, 0, sizeof(current_file_name));
-    //     snprintf(current_file_name, packet.size + 6, "/SD:/%s", packet.data);
-    //     printk("File transfer start: %s\n", current_file_name);
-
-    //     /* changed lines from here */
-    //     /* 기존 파일 삭제 → 새 파일 생성 준비 (덮어쓰기 효과) */
-    //     if (!k_mutex_lock(&sdcard_mutex, K_SECONDS(3)))
-    //     {
-    //         if (!get_disk_status())
-    //         {
-    //             ret = fs_unlink(current_file_name);
-    //             if (ret == 0)
-    //             {
-    //                 printk("Existing file removed: %s\n", current_file_name);
-    //             }
-    //         }
-    //         k_mutex_unlock(&sdcard_mutex);
-    //     }
-    //     else
-    //     {
-    //         printk("Failed to lock sdcard mutex\n");
-    //     }
-    //     /* changed lines to here */
-
-    //     struct ble_file_transfer_ack_packet ack_packet;
-    //     ack_packet.cmd = BLE_FILE_TRANSFER_CMD_START;
-    //     ack_packet.seq = 0;
-
-    //     bt_config_file_transfer(&ack_packet, sizeof(ack_packet));
-    //     break;
-    // }
-    // case BLE_FILE_TRANSFER_CMD_DATA:
-    // {
-    //     struct fs_file_t fp;
-    //     fs_file_t_init(&fp);
-
-    //     if (!k_mutex_lock(&sdcard_mutex, K_SECONDS(3)))
-    //     {
-    //         if (!get_disk_status())
-    //         {
-    //             ret = fs_open(&fp, current_file_name, FS_O_CREATE | FS_O_WRITE | FS_O_APPEND);
-    //             if (ret < 0)
-    //             {
-    //                 printk("Failed to open file: %s\n", current_file_name);
-    //                 ack_packet.cmd = BLE_FILE_TRANSFER_CMD_FAILED;
-    //                 ack_packet.seq = packet.seq;
-    //                 bt_config_file_transfer(&ack_packet, sizeof(ack_packet));
-    //                 break;
-    //             }
-    //             ret = fs_write(&fp, packet.data, packet.size);
-    //             if (ret < 0)
-    //             {
-    //                 printk("Failed to write file: %s\n", current_file_name);
-    //                 fs_close(&fp);
-    //                 ack_packet.cmd = BLE_FILE_TRANSFER_CMD_FAILED;
-    //                 ack_packet.seq = packet.seq;
-    //                 bt_config_file_transfer(&ack_packet, sizeof(ack_packet));
-    //                 break;
-    //             }
-    //             fs_close(&fp);
-    //         }
-    //         k_mutex_unlock(&sdcard_mutex);
-    //         ack_packet.cmd = BLE_FILE_TRANSFER_CMD_DATA;
-    //         ack_packet.seq = packet.seq;
-    //         bt_config_file_transfer(&ack_packet, sizeof(ack_packet));
-    //         break;
-    //     }
-    //     else
-    //     {
-    //         printk("Failed to lock sdcard mutex\n");
-    //         ack_packet.cmd = BLE_FILE_TRANSFER_CMD_FAILED;
-    //         ack_packet.seq = packet.seq;
-    //         bt_config_file_transfer(&ack_packet, sizeof(ack_packet));
-    //         break;
-    //     }
-    // }
-    // case BLE_FILE_TRANSFER_CMD_END:
-    // {
-    //     printk("File transfer end: %s\n", current_file_name);
-    //     ack_packet.cmd = BLE_FILE_TRANSFER_CMD_END;
-    //     ack_packet.seq = 0;
-    //     bt_config_file_transfer(&ack_packet, sizeof(ack_packet));
-    //     inference_msgq_packet_data_t packet;
-    //     packet.type = INFERENCE_MSGQ_TYPE_IFDATA_LOAD;
-    //     k_msgq_put(&inference_msgq, &packet, K_NO_WAIT);
-    //     break;
-    // }
-    // case BLE_FILE_TRANSFER_CMD_REMOVE:
-    // {
-    //     memset(current_file_name, 0, sizeof(current_file_name));
-    //     snprintf(current_file_name, packet.size + 6, "/SD:/%s", packet.data);
-    //     printk("File remove request: %s\n", current_file_name);
-
-    //     ret = fs_unlink(current_file_name);
-    //     if (ret < 0)
-    //     {
-    //         printk("Failed to remove file: %s\n", current_file_name);
-    //         ack_packet.cmd = BLE_FILE_TRANSFER_CMD_FAILED;
-    //         ack_packet.seq = 0;
-    //         bt_config_file_transfer(&ack_packet, sizeof(ack_packet));
-    //         break;
-    //     }
-    //     ack_packet.cmd = BLE_FILE_TRANSFER_CMD_REMOVE;
-    //     ack_packet.seq = 0;
-    //     bt_config_file_transfer(&ack_packet, sizeof(ack_packet));
-    //     break;
-    // }
-    // }
-}
 
 BT_GATT_SERVICE_DEFINE(config_svr,
     BT_GATT_PRIMARY_SERVICE(BT_UUID_CONFIG_SERVICE),
 
-    /* 원래 FILE_TRANSFER 특성:
-     *  - 실제 DEAN node 에서는 파일 전송용이었지만,
-     *  - 여기서는 단순 dummy 버퍼 + notify 용도로만 사용
+    /* FILE_TRANSFER 특성:
+     *  - START/END/RESUME/REMOVE 는 write, DATA 는 write-without-response
+     *  - ACK 는 notify (window 단위)
      */
     BT_GATT_CHARACTERISTIC(BT_UUID_CHRC_FILE_TRANSFER,
-                           BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE | BT_GATT_CHRC_NOTIFY,
+                           BT_GATT_CHRC_READ | BT_GATT_CHRC_WRITE |
+                           BT_GATT_CHRC_WRITE_WITHOUT_RESP | BT_GATT_CHRC_NOTIFY,
                            BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
                            NULL, file_write_cb,
                            cfg_file_transfer_dummy),
@@ -291,8 +221,20 @@ BT_GATT_SERVICE_DEFINE(config_svr,
                            dean_device_conf.location)
 );
 
+int bt_config_file_transfer(const void *data, uint16_t len)
+{
+    if (!cfg_notify_enabled) {
+        return -EACCES;
+    }
+
+    return bt_gatt_notify(NULL, &config_svr.attrs[2], data, len);
+}
+
 /* ----------------- 2) ENVIRONMENT SERVICE (환경값 dummy) ----------------- */
 
+/* CONFIG_RELAY_GATT_PROXY: node 의 실제 ENV / PERIPHERAL 서비스를 gatt_proxy 가 복사한다 */
+#if !defined(CONFIG_RELAY_GATT_PROXY)
+
 /* SLIMHUB 가 ENV 서비스의 notify 를 enable 할 수 있도록
  * 최소한 하나의 "send" 특성만 제공 (필요 시 나머지 확장 가능)
  */
@@ -305,16 +247,25 @@ BT_GATT_SERVICE_DEFINE(env_svr,
                            BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
                            BT_GATT_PERM_READ,
                            dummy_read, NULL,
-                           env_dummy_data),
+                           DUMMY_VALUE(env_dummy_data)),
     BT_GATT_CCC(env_notify_enabled_ccc_changed,
                 BT_GATT_PERM_READ | BT_GATT_PERM_WRITE)
 );
+#endif /* !CONFIG_RELAY_GATT_PROXY */
 
 /* ----------------- 3) GRIDEYE SERVICE (열화상 관련 dummy) ----------------- */
 
 /* prediction / raw 두 개 다 DEAN node 에서 쓰므로 그대로 흉내 */
+#if defined(CONFIG_RELAY_GATT_PROXY)
+/* prediction read 는 node 의 값을 cache 해서 답한다 (gatt_proxy.c) */
+GATT_PROXY_VALUE_DEFINE(grideye_pred_value);
+#define GRIDEYE_PRED_READ   gatt_proxy_value_read
+#define GRIDEYE_PRED_VALUE  (&grideye_pred_value)
+#else
 static uint8_t grideye_pred_dummy[8];
-static uint8_t grideye_raw_dummy[64];
+#define GRIDEYE_PRED_READ   dummy_read
+#define GRIDEYE_PRED_VALUE  DUMMY_VALUE(grideye_pred_dummy)
+#endif
 static bool grideye_notify_enabled;
 static void ccc_cfg_grideye_changed(const struct bt_gatt_attr *attr,
                                     uint16_t value)
@@ -328,8 +279,11 @@ static bt_gatt_attr_write_func_t grideye_write_cb(struct bt_conn *conn,
                                                   uint16_t offset,
                                                   uint8_t flags)
 {
-    // grideye_prediction_callback(buf, len);
-    return len;
+    if (offset) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_OFFSET);
+    }
+    /* node 로 전달 (node_write.c) */
+    return node_write_att_err(node_write_target(NODE_WRITE_GRIDEYE_PRED, buf, len), len);
 }
 
 BT_GATT_SERVICE_DEFINE(grideye_svr,
@@ -339,22 +293,38 @@ BT_GATT_SERVICE_DEFINE(grideye_svr,
     BT_GATT_CHARACTERISTIC(BT_UUID_CHRC_GRIDEYE_PREDICTION,
                            BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
                            BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
-                           dummy_read, grideye_write_cb,
-                           grideye_pred_dummy),
+                           GRIDEYE_PRED_READ, grideye_write_cb,
+                           GRIDEYE_PRED_VALUE),
     BT_GATT_CCC(ccc_cfg_grideye_changed,
                 BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
 
-    /* raw data */
+    /* raw data: node 의 pixel 단위 stream 을 frame 단위로 묶어서 전달 (grideye_relay.c) */
     BT_GATT_CHARACTERISTIC(BT_UUID_CHRC_GRIDEYE_RAW_STREAMING,
-                           BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
-                           BT_GATT_PERM_READ,
-                           dummy_read, NULL,
-                           grideye_raw_dummy),
-    BT_GATT_CCC(NULL,
+                           BT_GATT_CHRC_NOTIFY,
+                           BT_GATT_PERM_NONE,
+                           NULL, NULL, NULL),
+    BT_GATT_CCC(grideye_raw_notify_enabled_ccc_changed,
                 BT_GATT_PERM_READ | BT_GATT_PERM_WRITE)
 );
 
-/* ----------------- 4) PERIPHERAL SERVICE (카운터/제어 dummy) ----------------- */
+int bt_grideye_send_raw_frame(const void *data, uint16_t len)
+{
+    if (!grideye_raw_notify_enabled) {
+        return -EACCES;
+    }
+
+    int err;
+
+    err = relay_chain_hub_notify(ble_relay_hub_conn(), &grideye_svr.attrs[5], data, len);
+    if (!err) {
+        radio_airtime_pdu(RADIO_LINK_HUB, len);
+    }
+    return err;
+}
+
+/* ----------------- 4) PERIPHERAL SERVICE (room device event / 카운터 dummy) ----------------- */
+
+#if !defined(CONFIG_RELAY_GATT_PROXY) || defined(CONFIG_RELAY_ROOM_DEVICES)
 
 static uint8_t periph_counter_dummy[4];
 static uint8_t periph_ctrl_dummy[4];
@@ -365,51 +335,218 @@ static void ccc_cfg_peripheral_action_changed(const struct bt_gatt_attr *attr,
     peripheral_action_notify_enabled = (value == BT_GATT_CCC_NOTIFY);
 }
 
+#if defined(CONFIG_RELAY_ROOM_DEVICES)
+/* 마지막 room device event (read 용) */
+static struct ble_peripheral_action_packet periph_action_last;
+static uint16_t periph_action_last_len;
+
+static ssize_t peripheral_action_read(struct bt_conn *conn,
+                                      const struct bt_gatt_attr *attr,
+                                      void *buf, uint16_t len,
+                                      uint16_t offset)
+{
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, &periph_action_last, periph_action_last_len);
+}
+#endif
+
+/* room device 가 있으면 그 event 를, 아니면 node 의 값을 흉내내는 dummy (gatt proxy 가 없을 때) */
 BT_GATT_SERVICE_DEFINE(peripheral_svr,
     BT_GATT_PRIMARY_SERVICE(BT_UUID_peripheral_ACTION_SERVICE),
 
+#if defined(CONFIG_RELAY_ROOM_DEVICES)
+    BT_GATT_CHARACTERISTIC(BT_UUID_CHRC_peripheral_ACTION_DATA,
+                           BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
+                           BT_GATT_PERM_READ,
+                           peripheral_action_read, NULL, NULL),
+#else
     BT_GATT_CHARACTERISTIC(BT_UUID_CHRC_peripheral_ACTION_DATA,
                            BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
                            BT_GATT_PERM_READ,
                            dummy_read, NULL,
-                           periph_counter_dummy),
+                           DUMMY_VALUE(periph_counter_dummy)),
+#endif
     BT_GATT_CCC(ccc_cfg_peripheral_action_changed,
                 BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
 );
 
+#if defined(CONFIG_RELAY_ROOM_DEVICES)
+int bt_peripheral_notify_action(const void *data, uint16_t len)
+{
+    int err;
+
+    len = MIN(len, sizeof(periph_action_last));
+    memcpy(&periph_action_last, data, len);
+    periph_action_last_len = len;
+
+    if (!peripheral_action_notify_enabled) {
+        return -EACCES;
+    }
+
+    err = relay_chain_hub_notify(ble_relay_hub_conn(), &peripheral_svr.attrs[2], data, len);
+    if (!err) {
+        radio_airtime_pdu(RADIO_LINK_HUB, len);
+    }
+    return err;
+}
+#endif
+#endif /* !CONFIG_RELAY_GATT_PROXY || CONFIG_RELAY_ROOM_DEVICES */
+
 /* ----------------- 5) SOUND SERVICE (소리 추론 결과 / raw dummy) ----------------- */
 
 static uint8_t sound_pred_dummy[8];
+static uint8_t sound_feature_dummy[4];
 static uint8_t sound_raw_dummy[32];
 bool model_notify_enabled;
+static bool feature_notify_enabled;
 static void ccc_cfg_sound_changed_event(const struct bt_gatt_attr *attr, uint16_t value)
 {
     model_notify_enabled = (value == BT_GATT_CCC_NOTIFY);
 }
 
+static void ccc_cfg_sound_feature_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+    feature_notify_enabled = (value == BT_GATT_CCC_NOTIFY);
+}
+
+static bt_gatt_attr_write_func_t sound_model_write_cb(struct bt_conn *conn,
+                                                      const struct bt_gatt_attr *attr,
+                                                      const void *buf,
+                                                      uint16_t len,
+                                                      uint16_t offset,
+                                                      uint8_t flags)
+{
+    /* model update frame 은 node 로 그대로 전달 (model_update_proxy.c) */
+    process_model_update_write(buf, len);
+    return len;
+}
+
+static bt_gatt_attr_write_func_t sound_feature_write_cb(struct bt_conn *conn,
+                                                        const struct bt_gatt_attr *attr,
+                                                        const void *buf,
+                                                        uint16_t len,
+                                                        uint16_t offset,
+                                                        uint8_t flags)
+{
+    /* feature collection START / FINISH 는 node 로 전달 (feature_relay.c) */
+    int err = feature_relay_hub_write(buf, len);
+
+    if (err == -EINVAL) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+    }
+    if (err) {
+        return BT_GATT_ERR(BT_ATT_ERR_UNLIKELY);
+    }
+    return len;
+}
+
+#if defined(CONFIG_RELAY_SOUND_ISO)
+static bool iso_notify_enabled;
+
+static void ccc_cfg_sound_iso_changed(const struct bt_gatt_attr *attr, uint16_t value)
+{
+    iso_notify_enabled = (value == BT_GATT_CCC_NOTIFY);
+}
+
+static ssize_t sound_iso_read_cb(struct bt_conn *conn,
+                                 const struct bt_gatt_attr *attr,
+                                 void *buf, uint16_t len,
+                                 uint16_t offset)
+{
+    struct ble_sound_iso_report_packet report;
+
+    sound_iso_report_get(&report);
+    return bt_gatt_attr_read(conn, attr, buf, len, offset, &report, sizeof(report));
+}
+#endif
+
 BT_GATT_SERVICE_DEFINE(sound_svr,
     BT_GATT_PRIMARY_SERVICE(BT_UUID_SOUND_SERVICE),
 
-    BT_GATT_CHARACTERISTIC(BT_UUID_SOUND_SERVICE,
+    /* MODEL 특성: hub -> relay -> node model update, ACK 는 notify */
+    BT_GATT_CHARACTERISTIC(BT_UUID_CHRC_SOUND_MODEL,
+                           BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY |
+                           BT_GATT_CHRC_WRITE | BT_GATT_CHRC_WRITE_WITHOUT_RESP,
+                           BT_GATT_PERM_READ | BT_GATT_PERM_WRITE,
+                           dummy_read, sound_model_write_cb,
+                           DUMMY_VALUE(sound_pred_dummy)),
+    BT_GATT_CCC(ccc_cfg_sound_changed_event,
+                BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+
+    /* FEATURE 특성: hub -> node 수집 명령, node -> hub feature bulk / report 는 notify */
+    BT_GATT_CHARACTERISTIC(BT_UUID_CHRC_SOUND_FEATURE,
+                           BT_GATT_CHRC_NOTIFY | BT_GATT_CHRC_WRITE,
+                           BT_GATT_PERM_WRITE,
+                           NULL, sound_feature_write_cb,
+                           sound_feature_dummy),
+    BT_GATT_CCC(ccc_cfg_sound_feature_changed,
+                BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+
+#if defined(CONFIG_RELAY_SOUND_ISO)
+    /* ISO 특성: raw sound 는 CIS 로 가고, 여기서는 손실 / 지연 통계만 read / notify */
+    BT_GATT_CHARACTERISTIC(BT_UUID_CHRC_SOUND_ISO,
                            BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
                            BT_GATT_PERM_READ,
-                           dummy_read, NULL,
-                           sound_pred_dummy),
-    BT_GATT_CCC(ccc_cfg_sound_changed_event,
+                           sound_iso_read_cb, NULL, NULL),
+    BT_GATT_CCC(ccc_cfg_sound_iso_changed,
                 BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
+#endif
 
     // BT_GATT_CHARACTERISTIC(BT_UUID_CHRC_SOUND_RAWDATA,
     //                        BT_GATT_CHRC_READ | BT_GATT_CHRC_NOTIFY,
     //                        BT_GATT_PERM_READ,
     //                        dummy_read, NULL,
-    //                        sound_raw_dummy),
+    //                        DUMMY_VALUE(sound_raw_dummy)),
     // BT_GATT_CCC(sound_raw_notify_enabled_ccc_changed,
     //             BT_GATT_PERM_READ | BT_GATT_PERM_WRITE)
 );
 
-/* ----------------- 6) UBINOS / PAAR 서비스는 필요 시 나중에 추가 ----------------- */
-/* 현재 SLIMHUB 기준으로 사용하지 않는다면 굳이 올릴 필요는 없음.
- * 필요해지면 ubinos_service.h 에 정의된 UUID 로 위와 동일한 패턴으로
- * BT_GATT_SERVICE_DEFINE(...) 하나 더 만들어주면 된다.
+int bt_sound_notify_model(const void *data, uint16_t len)
+{
+    if (!model_notify_enabled) {
+        return -EACCES;
+    }
+
+    return bt_gatt_notify(NULL, &sound_svr.attrs[SOUND_ATTRS_MODEL_IDX], data, len);
+}
+
+bool is_feature_notify_enabled(void)
+{
+    return feature_notify_enabled;
+}
+
+bool is_model_notify_enabled(void)
+{
+    return model_notify_enabled;
+}
+
+int bt_sound_notify_feature(const void *data, uint16_t len)
+{
+    if (!feature_notify_enabled) {
+        return -EACCES;
+    }
+
+    int err;
+
+    err = relay_chain_hub_notify(ble_relay_hub_conn(), &sound_svr.attrs[SOUND_ATTRS_FEATURE_IDX], data, len);
+    if (!err) {
+        radio_airtime_pdu(RADIO_LINK_HUB, len);
+    }
+    return err;
+}
+
+#if defined(CONFIG_RELAY_SOUND_ISO)
+int bt_sound_notify_iso_report(const void *data, uint16_t len)
+{
+    if (!iso_notify_enabled) {
+        return -EACCES;
+    }
+
+    return bt_gatt_notify(ble_relay_hub_conn(), &sound_svr.attrs[SOUND_ATTRS_ISO_IDX], data, len);
+}
+#endif
+
+/* ----------------- 6) 그 밖의 node 서비스 (UBINOS / PAAR 등) ----------------- */
+/* 여기 없는 node 서비스는 CONFIG_RELAY_GATT_PROXY 로 gatt_proxy.c 가 node DB 에서 복사한다.
+ * relay 쪽 처리 (묶음 전송, 재조립 등) 가 필요한 경우에만 여기에 직접 정의한다.
  */
 
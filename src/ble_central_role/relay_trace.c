@@ -0,0 +1,34 @@
+/* relay_trace.c
+ *
+ * 목적:
+ *  - hub 로 보내는 notification 에 완료 callback 을 달아서
+ *    queue 에 넣은 시점 (rly_tx) 과 controller 가 보낸 시점 (rly_tx_done) 을 trace 에 남긴다.
+ */
+#if defined(CONFIG_RELAY_TRACE)
+
+#include "relay_trace.h"
+
+#include <zephyr/sys/util.h>
+
+static void relay_trace_notify_sent(struct bt_conn *conn, void *user_data)
+{
+    RELAY_TRACE("rly_tx_done", POINTER_TO_UINT(user_data), 0);
+}
+
+int relay_trace_notify(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                       const void *data, uint16_t len)
+{
+    uint16_t handle = bt_gatt_attr_get_handle(attr);
+    struct bt_gatt_notify_params params = {
+        .attr = attr,
+        .data = data,
+        .len = len,
+        .func = relay_trace_notify_sent,
+        .user_data = UINT_TO_POINTER(handle),
+    };
+
+    RELAY_TRACE("rly_tx", handle, len);
+    return bt_gatt_notify_cb(conn, &params);
+}
+
+#endif /* CONFIG_RELAY_TRACE */
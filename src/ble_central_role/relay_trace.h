@@ -0,0 +1,51 @@
+#ifndef _RELAY_TRACE_H_
+#define _RELAY_TRACE_H_
+
+#include <stdint.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+
+/** @brief Relay trace points (CONFIG_RELAY_TRACE).
+ *
+ * Named CTF events next to the kernel events (threads, work queues, ISRs),
+ * so a stall can be placed on one timeline in Trace Compass / babeltrace2:
+ *  - "rly_rx"      : node notification entered generic_notify_cb (handle, len)
+ *  - "rly_rx_done" : generic_notify_cb returned (handle, err)
+ *  - "rly_tx"      : hub notification queued (local attr handle, len)
+ *  - "rly_tx_done" : hub notification sent by the controller (local attr handle, 0)
+ *  - "rly_work"    : link work handler started (enum relay_trace_work, 0)
+ *  - "rly_conn"    : connected callback (role, hci err)
+ *  - "rly_disconn" : disconnected callback (role, reason)
+ *
+ * Without CONFIG_RELAY_TRACE the macros compile to nothing and
+ * relay_trace_notify() is plain bt_gatt_notify().
+ */
+enum relay_trace_work
+{
+    RELAY_TRACE_WORK_SCAN_RESTART,
+    RELAY_TRACE_WORK_ADV_RESTART,
+    RELAY_TRACE_WORK_ADV_TX_POWER,
+    RELAY_TRACE_WORK_INITIATE_TIMEOUT,
+    RELAY_TRACE_WORK_RESET,
+};
+
+#if defined(CONFIG_RELAY_TRACE)
+#include <zephyr/tracing/tracing.h>
+
+/* CTF named event: name 은 최대 20 byte */
+#define RELAY_TRACE(name, arg0, arg1) \
+    sys_trace_named_event(name, (uint32_t)(arg0), (uint32_t)(arg1))
+
+/**
+ * @brief bt_gatt_notify() with "rly_tx" / "rly_tx_done" trace events.
+ *
+ * @retval 0 on success, negative errno otherwise (same as bt_gatt_notify()).
+ */
+int relay_trace_notify(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                       const void *data, uint16_t len);
+#else
+#define RELAY_TRACE(name, arg0, arg1) do { } while (0)
+#define relay_trace_notify(conn, attr, data, len) bt_gatt_notify(conn, attr, data, len)
+#endif
+
+#endif
@@ -0,0 +1,51 @@
+/* relay_workq.c
+ *
+ * 목적:
+ *  - link 제어 / 데이터 전달 / HCI vendor command 를 서로 다른 work queue 에서 돌린다.
+ *  - adv TX power 설정 같은 bt_hci_cmd_send_sync 가 느려져도
+ *    scan 재시작이나 packet 전달이 밀리지 않게 한다.
+ */
+#include "relay_workq.h"
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(relay_workq, LOG_LEVEL_INF);
+
+K_THREAD_STACK_DEFINE(relay_fwd_workq_stack, CONFIG_RELAY_FWD_WORKQ_STACK_SIZE);
+K_THREAD_STACK_DEFINE(relay_link_workq_stack, CONFIG_RELAY_LINK_WORKQ_STACK_SIZE);
+K_THREAD_STACK_DEFINE(relay_hci_workq_stack, CONFIG_RELAY_HCI_WORKQ_STACK_SIZE);
+
+struct k_work_q relay_fwd_workq;
+struct k_work_q relay_link_workq;
+struct k_work_q relay_hci_workq;
+
+void relay_workq_init(void)
+{
+    static bool started;
+    struct k_work_queue_config cfg = { 0 };
+
+    if (started) {
+        return;
+    }
+    started = true;
+
+    cfg.name = "relay_fwd";
+    k_work_queue_start(&relay_fwd_workq, relay_fwd_workq_stack,
+                       K_THREAD_STACK_SIZEOF(relay_fwd_workq_stack),
+                       CONFIG_RELAY_FWD_WORKQ_PRIORITY, &cfg);
+
+    cfg.name = "relay_link";
+    k_work_queue_start(&relay_link_workq, relay_link_workq_stack,
+                       K_THREAD_STACK_SIZEOF(relay_link_workq_stack),
+                       CONFIG_RELAY_LINK_WORKQ_PRIORITY, &cfg);
+
+    cfg.name = "relay_hci";
+    k_work_queue_start(&relay_hci_workq, relay_hci_workq_stack,
+                       K_THREAD_STACK_SIZEOF(relay_hci_workq_stack),
+                       CONFIG_RELAY_HCI_WORKQ_PRIORITY, &cfg);
+
+    LOG_INF("[WORKQ] fwd prio %d, link prio %d, hci prio %d",
+            CONFIG_RELAY_FWD_WORKQ_PRIORITY, CONFIG_RELAY_LINK_WORKQ_PRIORITY,
+            CONFIG_RELAY_HCI_WORKQ_PRIORITY);
+}
@@ -0,0 +1,29 @@
+#ifndef _RELAY_WORKQ_H_
+#define _RELAY_WORKQ_H_
+
+#include <zephyr/kernel.h>
+
+/** @brief Relay work queues.
+ *
+ * The system work queue is shared with the BT host and other subsystems, so
+ * the relay uses its own queues:
+ *  - relay_fwd_workq  : data forwarding (batch drains, reassembly timeouts).
+ *                       Highest priority, never blocks on HCI.
+ *  - relay_link_workq : link control (adv / scan restart, connection timeouts,
+ *                       subscription recovery).
+ *  - relay_hci_workq  : blocking HCI vendor commands (bt_hci_cmd_send_sync)
+ *                       and settings (flash) writes. Lowest priority, a slow
+ *                       controller round trip or flash erase only delays
+ *                       this queue.
+ *
+ * Priorities and stack sizes are set with CONFIG_RELAY_*_WORKQ_*.
+ * Check the stack usage with overlay-thread-analyzer.conf.
+ */
+extern struct k_work_q relay_fwd_workq;
+extern struct k_work_q relay_link_workq;
+extern struct k_work_q relay_hci_workq;
+
+/** @brief Start the relay work queues. Call once before bt_enable(). */
+void relay_workq_init(void);
+
+#endif
@@ -0,0 +1,380 @@
+/* room_device.c
+ *
+ * 목적:
+ *  - DE&N node 말고도 방 안의 button (NUS) / PAAR / Ubinos 장치에 central 로 연결한다.
+ *  - profile 별 notify characteristic 을 찾아 구독하고, 받은 값을
+ *    struct ble_peripheral_action_packet 하나로 바꿔 hub 의 peripheral action 으로 notify 한다.
+ *
+ * 흐름:
+ *  scan report -> 이름 / service UUID 로 profile 판별 -> 빈 slot 으로 연결
+ *  -> notify characteristic 탐색 -> 구독 -> notification 마다 hub 로
+ */
+#include "room_device.h"
+
+#include <string.h>
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/uuid.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/logging/log.h>
+
+#include "peripheral_service.h"
+#include "ubinos_service.h"
+#include "ble_relay_control.h"
+#include "relay_stats.h"
+#include "clock.h"
+
+LOG_MODULE_REGISTER(room_device, LOG_LEVEL_INF);
+
+#if defined(CONFIG_RELAY_ROOM_DEVICES)
+
+#define ROOM_MAX    CONFIG_RELAY_ROOM_DEVICE_MAX
+
+/* hub 1 + node 1 + room devices */
+BUILD_ASSERT(CONFIG_BT_MAX_CONN >= 2 + ROOM_MAX,
+             "CONFIG_BT_MAX_CONN must cover the hub, the node and the room devices");
+
+struct room_profile
+{
+    const char *name;
+    uint8_t id;                         /* enum peripheral_action_profile */
+    const struct bt_uuid *notify_chrc;
+    bool text;                          /* UART 문자열: 끝의 CR / LF / NUL 을 뗀다 */
+};
+
+/* 광고로 가른다 (room_profile_of): button 은 TARGET_NAME 이름, PAAR / Ubinos 는 service UUID */
+enum
+{
+    PROFILE_BUTTON,
+    PROFILE_PAAR,
+    PROFILE_UBINOS,
+};
+
+static const struct room_profile profiles[] = {
+    [PROFILE_BUTTON] = { "button", PERIPHERAL_ACTION_BUTTON, NUS_TX_UUID, true },
+    [PROFILE_PAAR]   = { "PAAR", PERIPHERAL_ACTION_PAAR, BT_UUID_PAAR_CHRC_TX, false },
+    [PROFILE_UBINOS] = { "Ubinos", PERIPHERAL_ACTION_UBINOS, BT_UUID_UBINOS_TX_CHRC, true },
+};
+
+struct room_device
+{
+    struct bt_conn *conn;               /* NULL: 빈 slot */
+    bt_addr_le_t addr;
+    const struct room_profile *profile;
+    uint16_t seq;
+    uint32_t events;
+    uint32_t send_fail;
+    struct bt_gatt_discover_params disc;
+    struct bt_gatt_subscribe_params sub;
+};
+
+static struct room_device rooms[ROOM_MAX];
+
+/* button 도 NUS 를 광고하고 이름은 보통 scan response 에 온다.
+ * NUS 만 본 광고는 여기 기억해 두고 뒤따르는 scan response 의 이름으로 button / Ubinos 를 가른다.
+ */
+static bt_addr_le_t nus_adv_addr;
+static bool nus_adv_valid;
+
+struct room_adv_ctx
+{
+    bool button;                        /* TARGET_NAME 으로 시작하는 이름 */
+    bool named;
+    bool paar;
+    bool nus;
+};
+
+static struct room_device *room_find(struct bt_conn *conn)
+{
+    for (int i = 0; i < ROOM_MAX; i++) {
+        if (conn && rooms[i].conn == conn) {
+            return &rooms[i];
+        }
+    }
+    return NULL;
+}
+
+static void room_free(struct room_device *d)
+{
+    bt_conn_unref(d->conn);
+    memset(d, 0, sizeof(*d));
+}
+
+static bool room_adv_uuid128(const struct bt_data *data, const struct bt_uuid *uuid)
+{
+    struct bt_uuid_128 u;
+
+    for (uint8_t off = 0; off + 16 <= data->data_len; off += 16) {
+        if (bt_uuid_create(&u.uuid, &data->data[off], 16) && !bt_uuid_cmp(&u.uuid, uuid)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool room_adv_parse_cb(struct bt_data *data, void *user_data)
+{
+    struct room_adv_ctx *ctx = user_data;
+
+    switch (data->type) {
+    case BT_DATA_NAME_COMPLETE:
+    case BT_DATA_NAME_SHORTENED:
+        ctx->named = true;
+        ctx->button = data->data_len >= strlen(TARGET_NAME) &&
+                      !memcmp(data->data, TARGET_NAME, strlen(TARGET_NAME));
+        break;
+    case BT_DATA_UUID128_ALL:
+    case BT_DATA_UUID128_SOME:
+        ctx->paar |= room_adv_uuid128(data, BT_UUID_PAAR_SERVICE);
+        ctx->nus |= room_adv_uuid128(data, BT_UUID_UBINOS_SERVICE_UART);
+        break;
+    default:
+        break;
+    }
+    return true;
+}
+
+static const struct room_profile *room_profile_of(const bt_addr_le_t *addr, uint8_t type,
+                                                  struct net_buf_simple *ad)
+{
+    struct room_adv_ctx ctx = { 0 };
+    bool nus_seen;
+
+    if (ad && ad->len) {
+        bt_data_parse(ad, room_adv_parse_cb, &ctx);
+    }
+
+    if (ctx.button) {
+        return &profiles[PROFILE_BUTTON];
+    }
+    if (ctx.paar) {
+        return &profiles[PROFILE_PAAR];
+    }
+
+    nus_seen = ctx.nus || (nus_adv_valid && bt_addr_le_eq(addr, &nus_adv_addr));
+    if (!nus_seen) {
+        return NULL;
+    }
+    if (type != BT_GAP_ADV_TYPE_SCAN_RSP && !ctx.named) {
+        /* 이름은 scan response 에서 */
+        bt_addr_le_copy(&nus_adv_addr, addr);
+        nus_adv_valid = true;
+        return NULL;
+    }
+    nus_adv_valid = false;
+    return &profiles[PROFILE_UBINOS];
+}
+
+bool room_device_scan(const bt_addr_le_t *addr, int8_t rssi, uint8_t type, struct net_buf_simple *ad)
+{
+    const struct room_profile *profile = room_profile_of(addr, type, ad);
+    char addr_str[BT_ADDR_LE_STR_LEN];
+    struct room_device *d = NULL;
+    struct bt_conn *conn;
+    int err;
+
+    if (!profile || rssi < CONFIG_RELAY_ROOM_DEVICE_MIN_RSSI) {
+        return false;
+    }
+
+    /* 이미 연결된 장치 (room device / node / hub) */
+    conn = bt_conn_lookup_addr_le(BT_ID_DEFAULT, addr);
+    if (conn) {
+        bt_conn_unref(conn);
+        return false;
+    }
+
+    for (int i = 0; i < ROOM_MAX && !d; i++) {
+        if (!rooms[i].conn) {
+            d = &rooms[i];
+        }
+    }
+    if (!d) {
+        return false;
+    }
+
+    bt_addr_le_to_str(addr, addr_str, sizeof(addr_str));
+    err = ble_relay_central_create(addr, &conn);
+    if (err) {
+        LOG_DBG("[ROOM] connect to %s %s failed (err %d)", profile->name, addr_str, err);
+        return false;
+    }
+
+    d->conn = conn;
+    bt_addr_le_copy(&d->addr, addr);
+    d->profile = profile;
+    LOG_INF("[ROOM] connecting to %s %s (RSSI %d, slot %d)",
+            profile->name, addr_str, rssi, (int)(d - rooms));
+    return true;
+}
+
+bool room_device_owns(struct bt_conn *conn)
+{
+    return room_find(conn) != NULL;
+}
+
+bool room_device_wanted(void)
+{
+    for (int i = 0; i < ROOM_MAX; i++) {
+        if (!rooms[i].conn) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* ----------------- room device -> relay -> hub ----------------- */
+
+static uint8_t room_notify_cb(struct bt_conn *conn, struct bt_gatt_subscribe_params *params,
+                              const void *data, uint16_t length)
+{
+    struct room_device *d = CONTAINER_OF(params, struct room_device, sub);
+    struct ble_peripheral_action_packet pkt;
+    const uint8_t *p = data;
+    uint16_t n = length;
+    int err;
+
+    if (!data) {
+        params->value_handle = 0;
+        return BT_GATT_ITER_STOP;
+    }
+
+    if (d->profile->text) {
+        while (n && (p[n - 1] == '\r' || p[n - 1] == '\n' || p[n - 1] == '\0')) {
+            n--;
+        }
+    }
+    n = MIN(n, PERIPHERAL_ACTION_DATA_MAX);
+
+    pkt.profile = d->profile->id;
+    pkt.device = (uint8_t)(d - rooms);
+    memcpy(pkt.addr, d->addr.a.val, sizeof(pkt.addr));
+    pkt.seq = sys_cpu_to_le16(d->seq++);
+    pkt.time_ms = sys_cpu_to_le32(clock_rx_stamp());
+    pkt.len = (uint8_t)n;
+    memcpy(pkt.data, p, n);
+
+    d->events++;
+    relay_stats_rx(RELAY_STREAM_ROOM_DEVICE);
+    err = bt_peripheral_notify_action(&pkt, PERIPHERAL_ACTION_HDR_SIZE + n);
+    relay_stats_tx(RELAY_STREAM_ROOM_DEVICE, err);
+    if (err && err != -EACCES) {
+        d->send_fail++;
+        LOG_WRN("[ROOM] %s event %u not sent (err %d)", d->profile->name, d->seq - 1, err);
+    }
+    return BT_GATT_ITER_CONTINUE;
+}
+
+static uint8_t room_discover_cb(struct bt_conn *conn, const struct bt_gatt_attr *attr,
+                                struct bt_gatt_discover_params *params)
+{
+    struct room_device *d = CONTAINER_OF(params, struct room_device, disc);
+    const struct bt_gatt_chrc *chrc;
+    int err;
+
+    if (!attr) {
+        if (!d->sub.value_handle) {
+            LOG_WRN("[ROOM] %s has no notify characteristic, disconnect", d->profile->name);
+            bt_conn_disconnect(conn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
+        }
+        return BT_GATT_ITER_STOP;
+    }
+
+    chrc = attr->user_data;
+    if (!(chrc->properties & BT_GATT_CHRC_NOTIFY)) {
+        return BT_GATT_ITER_CONTINUE;
+    }
+
+    /* node 와 같은 가정: CCCD = value_handle + 1 */
+    d->sub.ccc_handle = chrc->value_handle + 1;
+    d->sub.value_handle = chrc->value_handle;
+    d->sub.value = BT_GATT_CCC_NOTIFY;
+    d->sub.notify = room_notify_cb;
+    atomic_set_bit(d->sub.flags, BT_GATT_SUBSCRIBE_FLAG_VOLATILE);
+
+    err = bt_gatt_subscribe(conn, &d->sub);
+    if (err && err != -EALREADY) {
+        LOG_WRN("[ROOM] %s subscribe failed (err %d), disconnect", d->profile->name, err);
+        bt_conn_disconnect(conn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
+    } else {
+        LOG_INF("[ROOM] %s subscribed: val=0x%04x", d->profile->name, d->sub.value_handle);
+    }
+    return BT_GATT_ITER_STOP;
+}
+
+bool room_device_connected(struct bt_conn *conn, uint8_t conn_err)
+{
+    struct room_device *d = room_find(conn);
+    int err;
+
+    if (!d) {
+        return false;
+    }
+
+    if (conn_err) {
+        LOG_WRN("[ROOM] %s connection failed (err %u)", d->profile->name, conn_err);
+        room_free(d);
+        return true;
+    }
+
+    d->disc.uuid = d->profile->notify_chrc;
+    d->disc.func = room_discover_cb;
+    d->disc.start_handle = BT_ATT_FIRST_ATTRIBUTE_HANDLE;
+    d->disc.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
+    d->disc.type = BT_GATT_DISCOVER_CHARACTERISTIC;
+
+    err = bt_gatt_discover(conn, &d->disc);
+    if (err) {
+        LOG_WRN("[ROOM] %s discovery failed (err %d), disconnect", d->profile->name, err);
+        bt_conn_disconnect(conn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
+    } else {
+        LOG_INF("[ROOM] %s connected (slot %d)", d->profile->name, (int)(d - rooms));
+    }
+    return true;
+}
+
+bool room_device_disconnected(struct bt_conn *conn, uint8_t reason)
+{
+    struct room_device *d = room_find(conn);
+
+    if (!d) {
+        return false;
+    }
+
+    LOG_INF("[ROOM] %s disconnected (reason %u): %u events, %u not sent",
+            d->profile->name, reason, d->events, d->send_fail);
+    room_free(d);
+    return true;
+}
+
+#else
+
+bool room_device_scan(const bt_addr_le_t *addr, int8_t rssi, uint8_t type, struct net_buf_simple *ad)
+{
+    return false;
+}
+
+bool room_device_owns(struct bt_conn *conn)
+{
+    return false;
+}
+
+bool room_device_wanted(void)
+{
+    return false;
+}
+
+bool room_device_connected(struct bt_conn *conn, uint8_t conn_err)
+{
+    return false;
+}
+
+bool room_device_disconnected(struct bt_conn *conn, uint8_t reason)
+{
+    return false;
+}
+
+#endif /* CONFIG_RELAY_ROOM_DEVICES */
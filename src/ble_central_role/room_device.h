@@ -0,0 +1,46 @@
+#ifndef _ROOM_DEVICE_H_
+#define _ROOM_DEVICE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <zephyr/bluetooth/addr.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/net_buf.h>
+
+/** @brief Room devices next to the DE&N node (CONFIG_RELAY_ROOM_DEVICES).
+ *
+ * Besides the node, the relay connects as central to up to
+ * CONFIG_RELAY_ROOM_DEVICE_MAX other devices in the room:
+ *  - button : NUS (Adafruit BLEUart) devices advertising a "BUTTON_" name
+ *             (peripheral_service.h), NUS TX notifications.
+ *  - PAAR   : devices advertising the PAAR service, PAAR TX notifications.
+ *  - Ubinos : devices advertising the Ubinos UART service, its TX
+ *             notifications (ubinos_service.h).
+ *
+ * After connecting, the relay finds the notify characteristic of the
+ * profile and subscribes to it. Every notification becomes one struct
+ * ble_peripheral_action_packet (profile, device, address, sequence number,
+ * receive time, payload) notified to the hub on the peripheral action
+ * characteristic. A room device that disconnects frees its slot and the
+ * relay scans for it again.
+ */
+
+/** @brief Scan report: connect to it if it is a room device with a free slot.
+ *
+ * @return true if the report was taken (a connection is being created).
+ */
+bool room_device_scan(const bt_addr_le_t *addr, int8_t rssi, uint8_t type, struct net_buf_simple *ad);
+
+/** @brief @p conn is a room device link (not the node). */
+bool room_device_owns(struct bt_conn *conn);
+
+/** @brief Slots are free: the relay keeps scanning for room devices. */
+bool room_device_wanted(void);
+
+/** @brief Connected callback of a central link. @return true if it was a room device. */
+bool room_device_connected(struct bt_conn *conn, uint8_t conn_err);
+
+/** @brief Disconnected callback of a central link. @return true if it was a room device. */
+bool room_device_disconnected(struct bt_conn *conn, uint8_t reason);
+
+#endif
@@ -0,0 +1,91 @@
+/* sdcard.c
+ *
+ * SD card (FAT) mount 및 disk 상태 확인. 여러 모듈이 같이 쓰므로 sdcard_mutex 로 보호한다.
+ */
+#include <errno.h>
+#include <zephyr/kernel.h>
+#include <zephyr/storage/disk_access.h>
+#include <zephyr/fs/fs.h>
+#include <zephyr/logging/log.h>
+#if defined(CONFIG_FAT_FILESYSTEM_ELM)
+#include <ff.h>
+#endif
+
+#include "sdcard.h"
+
+LOG_MODULE_REGISTER(sdcard, LOG_LEVEL_INF);
+
+#define SDCARD_DISK_NAME    "SD"
+#define SDCARD_MOUNT_POINT  "/SD:"
+
+K_MUTEX_DEFINE(sdcard_mutex);
+
+#if defined(CONFIG_FAT_FILESYSTEM_ELM)
+
+static FATFS fat_fs;
+static struct fs_mount_t sdcard_mount = {
+    .type = FS_FATFS,
+    .fs_data = &fat_fs,
+    .storage_dev = (void *)SDCARD_DISK_NAME,
+    .mnt_point = SDCARD_MOUNT_POINT,
+};
+static bool sdcard_mounted;
+
+int mount_sdcard(void)
+{
+    int err;
+
+    if (sdcard_mounted) {
+        return 0;
+    }
+
+    err = disk_access_init(SDCARD_DISK_NAME);
+    if (err) {
+        LOG_ERR("[SD] disk init failed (err %d)", err);
+        return err;
+    }
+
+    err = fs_mount(&sdcard_mount);
+    if (err) {
+        LOG_ERR("[SD] mount %s failed (err %d)", SDCARD_MOUNT_POINT, err);
+        return err;
+    }
+
+    sdcard_mounted = true;
+    LOG_INF("[SD] mounted at %s", SDCARD_MOUNT_POINT);
+    return 0;
+}
+
+int get_disk_status()
+{
+    if (!sdcard_mounted) {
+        return -ENODEV;
+    }
+
+    return disk_access_status(SDCARD_DISK_NAME);
+}
+
+int sdcard_mutext_init(struct k_mutex *sdcard_mutex)
+{
+    return k_mutex_init(sdcard_mutex);
+}
+
+#else
+
+/* SD card 가 없는 board (native_sim, bsim) */
+int mount_sdcard(void)
+{
+    return -ENOTSUP;
+}
+
+int get_disk_status()
+{
+    return -ENODEV;
+}
+
+int sdcard_mutext_init(struct k_mutex *sdcard_mutex)
+{
+    return k_mutex_init(sdcard_mutex);
+}
+
+#endif /* CONFIG_FAT_FILESYSTEM_ELM */
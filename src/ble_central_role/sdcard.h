@@ -1,3 +1,11 @@
+#ifndef _SDCARD_H_
+#define _SDCARD_H_
+
+#include <zephyr/kernel.h>
+
+/** SD card mount point (FAT) */
+#define SDCARD_PATH_PREFIX "/SD:/"
+
 int mount_sdcard(void);
 
 /**
@@ -10,4 +18,6 @@ int get_disk_status();
 
 int sdcard_mutext_init(struct k_mutex *sdcard_mutex);
 
-extern struct k_mutex sdcard_mutex;
\ No newline at end of file
+extern struct k_mutex sdcard_mutex;
+
+#endif
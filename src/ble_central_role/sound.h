@@ -24,6 +24,9 @@ int sound_thread_init(void);
 #define BLE_FEATURE_COLLECTION_CMD_DATA 6
 #define BLE_FEATURE_COLLECTION_CMD_FINISH 7
 #define BLE_FEATURE_COLLECTION_CMD_END 8
+/* relay -> hub only */
+#define BLE_FEATURE_COLLECTION_CMD_BULK 9
+#define BLE_FEATURE_COLLECTION_CMD_REPORT 10
 
 #define BLE_SOUND_MODEL_FRAME_SIZE 128
 
@@ -41,6 +44,43 @@ struct ble_sound_feature_packet
     uint16_t data[NUM_MEL_FILTERS];
 } __attribute__((packed));
 
+/** Relay bulk batch: header followed by count x (seq, data[NUM_MEL_FILTERS]) */
+struct ble_sound_feature_bulk_hdr
+{
+    uint8_t cmd;    /* BLE_FEATURE_COLLECTION_CMD_BULK */
+    uint8_t count;
+} __attribute__((packed));
+
+struct ble_sound_feature_record
+{
+    uint16_t seq;
+    uint16_t data[NUM_MEL_FILTERS];
+} __attribute__((packed));
+
+/** Relay per-session statistics, sent after the node's END */
+struct ble_sound_feature_report_packet
+{
+    uint8_t cmd;    /* BLE_FEATURE_COLLECTION_CMD_REPORT */
+    uint32_t received;
+    uint32_t forwarded;
+    uint32_t seq_lost;      /* node -> relay (seq gap) */
+    uint32_t overflow;      /* relay ring buffer full */
+} __attribute__((packed));
+
+/** Relay raw sound ISO statistics (CONFIG_RELAY_SOUND_ISO), read / notify on SOUND_ISO */
+struct ble_sound_iso_report_packet
+{
+    uint32_t received;      /* valid SDUs from the node */
+    uint32_t lost;          /* node -> relay: SDU missing (sequence gap or flagged lost) */
+    uint32_t errors;        /* node -> relay: SDU received with errors */
+    uint32_t forwarded;     /* relay -> hub: handed to the controller */
+    uint32_t dropped;       /* relay -> hub: no hub CIS or TX queue full */
+    uint32_t node_latency_us;   /* CIS transport latency node -> relay */
+    uint32_t hub_latency_us;    /* CIS transport latency relay -> hub */
+    uint32_t relay_avg_us;      /* node SDU received -> sent on the hub CIS */
+    uint32_t relay_max_us;
+} __attribute__((packed));
+
 struct ble_ack_packet
 {
     uint8_t cmd;
@@ -0,0 +1,456 @@
+/* sound_iso.c
+ *
+ * 목적:
+ *  - node 의 raw sound 를 GATT 대신 CIS 로 받아서 (relay 가 central, CIG 생성)
+ *    hub 가 만든 CIS 로 같은 SDU interval 에 그대로 보낸다.
+ *  - 재전송 / queue 적체 없이: hub 쪽이 밀리면 새 SDU 를 버린다.
+ *  - 손실 / 지연 통계를 log 와 SOUND_ISO 특성 (struct ble_sound_iso_report_packet) 으로 알린다.
+ */
+#include "sound_iso.h"
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/iso.h>
+#include <zephyr/net_buf.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/logging/log.h>
+
+#include "sound_service.h"
+#include "ble_relay_control.h"
+#include "relay_stats.h"
+#include "relay_workq.h"
+
+LOG_MODULE_REGISTER(sound_iso, LOG_LEVEL_INF);
+
+#if defined(CONFIG_RELAY_SOUND_ISO)
+
+/* node 가 CIS 를 받지 않으면 연결이 살아 있는 동안 이만큼만 다시 시도 */
+#define ISO_CONNECT_RETRY_MS    2000
+#define ISO_CONNECT_TRIES       3
+
+NET_BUF_POOL_FIXED_DEFINE(iso_tx_pool, CONFIG_RELAY_SOUND_ISO_TX_QUEUE,
+                          BT_ISO_SDU_BUF_SIZE(CONFIG_RELAY_SOUND_ISO_SDU_SIZE),
+                          CONFIG_BT_CONN_TX_USER_DATA_SIZE, NULL);
+
+static void iso_connect_work_handler(struct k_work *work);
+static void iso_report_work_handler(struct k_work *work);
+K_WORK_DELAYABLE_DEFINE(iso_connect_work, iso_connect_work_handler);
+K_WORK_DELAYABLE_DEFINE(iso_report_work, iso_report_work_handler);
+
+static struct bt_conn *node_conn;
+static struct bt_iso_cig *cig;
+static uint8_t connect_tries;
+
+static struct k_spinlock iso_lock;
+static struct
+{
+    bool seq_valid;
+    uint16_t next_seq;
+    uint32_t received;
+    uint32_t lost;
+    uint32_t errors;
+    uint32_t forwarded;
+    uint32_t dropped;
+    uint32_t node_latency_us;
+    uint32_t hub_latency_us;
+    uint64_t relay_sum_us;
+    uint32_t relay_cnt;
+    uint32_t relay_max_us;
+    /* controller 에 넘긴 SDU 의 수신 시각 (sent callback 에서 꺼낸다) */
+    uint32_t tx_cyc[CONFIG_RELAY_SOUND_ISO_TX_QUEUE];
+    uint32_t tx_head;
+    uint32_t tx_tail;
+    /* hub CIS 의 sequence number: 연결 후 지난 SDU interval 수 (건너뛴 interval 포함) */
+    int64_t hub_start_us;
+    bool hub_seq_valid;
+    uint16_t hub_seq;
+} iso;
+
+/* ----------------- node CIS (relay = central, node -> relay) ----------------- */
+
+static void node_iso_connected(struct bt_iso_chan *chan);
+static void node_iso_disconnected(struct bt_iso_chan *chan, uint8_t reason);
+static void node_iso_recv(struct bt_iso_chan *chan, const struct bt_iso_recv_info *info,
+                          struct net_buf *buf);
+
+static struct bt_iso_chan_ops node_iso_ops = {
+    .connected = node_iso_connected,
+    .disconnected = node_iso_disconnected,
+    .recv = node_iso_recv,
+};
+
+static struct bt_iso_chan_io_qos node_rx_qos = {
+    .sdu = CONFIG_RELAY_SOUND_ISO_SDU_SIZE,
+    .phy = BT_GAP_LE_PHY_2M,
+    .rtn = CONFIG_RELAY_SOUND_ISO_RTN,
+};
+
+static struct bt_iso_chan_qos node_iso_qos = {
+    .rx = &node_rx_qos,
+    .tx = NULL,
+};
+
+static struct bt_iso_chan node_chan = {
+    .ops = &node_iso_ops,
+    .qos = &node_iso_qos,
+};
+
+/* ----------------- hub CIS (relay = peripheral, relay -> hub) ----------------- */
+
+static void hub_iso_connected(struct bt_iso_chan *chan);
+static void hub_iso_disconnected(struct bt_iso_chan *chan, uint8_t reason);
+static void hub_iso_sent(struct bt_iso_chan *chan);
+
+static struct bt_iso_chan_ops hub_iso_ops = {
+    .connected = hub_iso_connected,
+    .disconnected = hub_iso_disconnected,
+    .sent = hub_iso_sent,
+};
+
+static struct bt_iso_chan_io_qos hub_tx_qos = {
+    .sdu = CONFIG_RELAY_SOUND_ISO_SDU_SIZE,
+    .phy = BT_GAP_LE_PHY_2M,
+    .rtn = CONFIG_RELAY_SOUND_ISO_RTN,
+};
+
+static struct bt_iso_chan_qos hub_iso_qos = {
+    .tx = &hub_tx_qos,
+    .rx = NULL,
+};
+
+static struct bt_iso_chan hub_chan = {
+    .ops = &hub_iso_ops,
+    .qos = &hub_iso_qos,
+};
+static atomic_t hub_iso_up;
+
+static int hub_iso_accept(const struct bt_iso_accept_info *info, struct bt_iso_chan **chan)
+{
+    /* hub 링크에서 온 CIS 하나만 받는다 */
+    if (info->acl != ble_relay_hub_conn()) {
+        return -EACCES;
+    }
+    if (hub_chan.state != BT_ISO_STATE_DISCONNECTED) {
+        return -ENOMEM;
+    }
+
+    *chan = &hub_chan;
+    return 0;
+}
+
+static struct bt_iso_server iso_server = {
+#if defined(CONFIG_BT_SMP)
+    .sec_level = BT_SECURITY_L1,
+#endif
+    .accept = hub_iso_accept,
+};
+
+static uint32_t iso_p_to_c_latency_us(struct bt_iso_chan *chan)
+{
+    struct bt_iso_info info;
+
+    if (bt_iso_chan_get_info(chan, &info)) {
+        return 0;
+    }
+    /* 두 CIS 모두 peripheral -> central 방향만 쓴다 */
+    return info.unicast.peripheral.latency;
+}
+
+static void hub_iso_connected(struct bt_iso_chan *chan)
+{
+    k_spinlock_key_t key = k_spin_lock(&iso_lock);
+
+    iso.hub_latency_us = iso_p_to_c_latency_us(chan);
+    iso.tx_head = 0;
+    iso.tx_tail = 0;
+    iso.hub_start_us = k_ticks_to_us_floor64(k_uptime_ticks());
+    iso.hub_seq_valid = false;
+    k_spin_unlock(&iso_lock, key);
+
+    atomic_set(&hub_iso_up, 1);
+    LOG_INF("[ISO] hub CIS connected, transport latency %u us", iso.hub_latency_us);
+}
+
+static void hub_iso_disconnected(struct bt_iso_chan *chan, uint8_t reason)
+{
+    atomic_set(&hub_iso_up, 0);
+    LOG_INF("[ISO] hub CIS disconnected (reason 0x%02x)", reason);
+}
+
+static void hub_iso_sent(struct bt_iso_chan *chan)
+{
+    k_spinlock_key_t key = k_spin_lock(&iso_lock);
+
+    if (iso.tx_tail != iso.tx_head) {
+        uint32_t us = k_cyc_to_us_floor32(k_cycle_get_32() -
+                                          iso.tx_cyc[iso.tx_tail % ARRAY_SIZE(iso.tx_cyc)]);
+
+        iso.tx_tail++;
+        iso.relay_sum_us += us;
+        iso.relay_cnt++;
+        iso.relay_max_us = MAX(iso.relay_max_us, us);
+    }
+    k_spin_unlock(&iso_lock, key);
+}
+
+/* BT RX thread: 받은 SDU 를 바로 hub CIS 로. 밀려 있으면 버린다 */
+static int hub_iso_forward(struct net_buf *sdu, uint32_t rx_cyc)
+{
+    struct net_buf *buf;
+    k_spinlock_key_t key;
+    uint16_t seq_num;
+    int err;
+
+    if (!atomic_get(&hub_iso_up)) {
+        return -ENOTCONN;
+    }
+
+    buf = net_buf_alloc(&iso_tx_pool, K_NO_WAIT);
+    if (!buf) {
+        return -ENOMEM;
+    }
+    net_buf_reserve(buf, BT_ISO_CHAN_SEND_RESERVE);
+    net_buf_add_mem(buf, sdu->data, MIN(sdu->len, CONFIG_RELAY_SOUND_ISO_SDU_SIZE));
+
+    key = k_spin_lock(&iso_lock);
+    iso.tx_cyc[iso.tx_head % ARRAY_SIZE(iso.tx_cyc)] = rx_cyc;
+    iso.tx_head++;
+    /* node seq 는 node CIS 가 다시 연결되면 처음부터라 hub CIS 에는 쓰지 않는다.
+     * 같은 interval 에 두 SDU 가 오면 (지터) 다음 번호로 밀어 겹치지 않게 한다 */
+    seq_num = (uint16_t)((k_ticks_to_us_floor64(k_uptime_ticks()) - iso.hub_start_us) /
+                         CONFIG_RELAY_SOUND_ISO_SDU_INTERVAL_US);
+    if (iso.hub_seq_valid && (int16_t)(seq_num - iso.hub_seq) <= 0) {
+        seq_num = iso.hub_seq + 1;
+    }
+    iso.hub_seq_valid = true;
+    iso.hub_seq = seq_num;
+    k_spin_unlock(&iso_lock, key);
+
+    err = bt_iso_chan_send(&hub_chan, buf, seq_num);
+    if (err) {
+        net_buf_unref(buf);
+        key = k_spin_lock(&iso_lock);
+        iso.tx_head--;
+        k_spin_unlock(&iso_lock, key);
+    }
+    return err;
+}
+
+static void node_iso_recv(struct bt_iso_chan *chan, const struct bt_iso_recv_info *info,
+                          struct net_buf *buf)
+{
+    uint32_t rx_cyc = k_cycle_get_32();
+    k_spinlock_key_t key = k_spin_lock(&iso_lock);
+    int err;
+
+    /* sequence number 가 건너뛰면 그 사이 SDU 는 controller 가 알리지 않은 손실 */
+    if (iso.seq_valid && info->seq_num != iso.next_seq) {
+        iso.lost += (uint16_t)(info->seq_num - iso.next_seq);
+    }
+    iso.seq_valid = true;
+    iso.next_seq = info->seq_num + 1;
+
+    if (!(info->flags & BT_ISO_FLAGS_VALID) || buf->len == 0) {
+        if (info->flags & BT_ISO_FLAGS_ERROR) {
+            iso.errors++;
+        } else {
+            iso.lost++;
+        }
+        k_spin_unlock(&iso_lock, key);
+        return;
+    }
+    iso.received++;
+    k_spin_unlock(&iso_lock, key);
+
+    relay_stats_rx(RELAY_STREAM_SOUND_ISO);
+    err = hub_iso_forward(buf, rx_cyc);
+    relay_stats_tx(RELAY_STREAM_SOUND_ISO, err);
+
+    key = k_spin_lock(&iso_lock);
+    if (err) {
+        iso.dropped++;
+    } else {
+        iso.forwarded++;
+    }
+    k_spin_unlock(&iso_lock, key);
+}
+
+static void node_iso_connected(struct bt_iso_chan *chan)
+{
+    k_spinlock_key_t key = k_spin_lock(&iso_lock);
+    uint32_t tx_head = iso.tx_head;
+    uint32_t tx_tail = iso.tx_tail;
+    int64_t hub_start_us = iso.hub_start_us;
+    bool hub_seq_valid = iso.hub_seq_valid;
+    uint16_t hub_seq = iso.hub_seq;
+
+    /* 통계는 node CIS 마다 새로. hub CIS 의 송신 상태 (보내는 중인 SDU, seq) 는 그대로 */
+    memset(&iso, 0, sizeof(iso));
+    iso.tx_head = tx_head;
+    iso.tx_tail = tx_tail;
+    iso.hub_start_us = hub_start_us;
+    iso.hub_seq_valid = hub_seq_valid;
+    iso.hub_seq = hub_seq;
+    iso.node_latency_us = iso_p_to_c_latency_us(chan);
+    if (atomic_get(&hub_iso_up)) {
+        iso.hub_latency_us = iso_p_to_c_latency_us(&hub_chan);
+    }
+    k_spin_unlock(&iso_lock, key);
+
+    connect_tries = 0;
+    LOG_INF("[ISO] node CIS connected, SDU %u B every %u us, transport latency %u us",
+            CONFIG_RELAY_SOUND_ISO_SDU_SIZE, CONFIG_RELAY_SOUND_ISO_SDU_INTERVAL_US,
+            iso.node_latency_us);
+    k_work_reschedule_for_queue(&relay_link_workq, &iso_report_work,
+                                K_SECONDS(CONFIG_RELAY_SOUND_ISO_REPORT_S));
+}
+
+static void node_iso_disconnected(struct bt_iso_chan *chan, uint8_t reason)
+{
+    LOG_INF("[ISO] node CIS disconnected (reason 0x%02x)", reason);
+    k_work_cancel_delayable(&iso_report_work);
+
+    /* node 링크는 살아 있는데 CIS 만 끊겼으면 다시 연결 */
+    if (node_conn && ++connect_tries < ISO_CONNECT_TRIES) {
+        k_work_reschedule_for_queue(&relay_link_workq, &iso_connect_work,
+                                    K_MSEC(ISO_CONNECT_RETRY_MS));
+    }
+}
+
+static int iso_cig_create(void)
+{
+    struct bt_iso_chan *chans[] = { &node_chan };
+    struct bt_iso_cig_param param = {
+        .cis_channels = chans,
+        .num_cis = ARRAY_SIZE(chans),
+        .sca = BT_GAP_SCA_UNKNOWN,
+        .packing = BT_ISO_PACKING_SEQUENTIAL,
+        .framing = BT_ISO_FRAMING_UNFRAMED,
+        .c_to_p_latency = CONFIG_RELAY_SOUND_ISO_LATENCY_MS,
+        .p_to_c_latency = CONFIG_RELAY_SOUND_ISO_LATENCY_MS,
+        .c_to_p_interval = CONFIG_RELAY_SOUND_ISO_SDU_INTERVAL_US,
+        .p_to_c_interval = CONFIG_RELAY_SOUND_ISO_SDU_INTERVAL_US,
+    };
+
+    return bt_iso_cig_create(&param, &cig);
+}
+
+static void iso_connect_work_handler(struct k_work *work)
+{
+    struct bt_iso_connect_param param;
+    int err;
+
+    if (!node_conn || node_chan.state != BT_ISO_STATE_DISCONNECTED) {
+        return;
+    }
+
+    /* CIG 는 한 번 만들어 두고 node 가 바뀌어도 그대로 쓴다 */
+    if (!cig) {
+        err = iso_cig_create();
+        if (err) {
+            LOG_WRN("[ISO] CIG create failed (err %d), raw sound stays off", err);
+            return;
+        }
+    }
+
+    param.acl = node_conn;
+    param.iso_chan = &node_chan;
+    err = bt_iso_chan_connect(&param, 1);
+    if (err) {
+        LOG_WRN("[ISO] node CIS connect failed (err %d)", err);
+        if (++connect_tries < ISO_CONNECT_TRIES) {
+            k_work_reschedule_for_queue(&relay_link_workq, &iso_connect_work,
+                                        K_MSEC(ISO_CONNECT_RETRY_MS));
+        }
+    }
+}
+
+void sound_iso_report_get(struct ble_sound_iso_report_packet *report)
+{
+    k_spinlock_key_t key = k_spin_lock(&iso_lock);
+
+    report->received = iso.received;
+    report->lost = iso.lost;
+    report->errors = iso.errors;
+    report->forwarded = iso.forwarded;
+    report->dropped = iso.dropped;
+    report->node_latency_us = iso.node_latency_us;
+    report->hub_latency_us = atomic_get(&hub_iso_up) ? iso.hub_latency_us : 0;
+    report->relay_avg_us = iso.relay_cnt ? (uint32_t)(iso.relay_sum_us / iso.relay_cnt) : 0;
+    report->relay_max_us = iso.relay_max_us;
+    k_spin_unlock(&iso_lock, key);
+}
+
+static void iso_report_work_handler(struct k_work *work)
+{
+    struct ble_sound_iso_report_packet report;
+    int err;
+
+    sound_iso_report_get(&report);
+
+    /* node -> hub 지연 = 두 CIS 의 transport latency + relay 안에서 머문 시간 */
+    LOG_INF("[ISO] rx %u lost %u err %u -> fwd %u drop %u, latency %u + %u (max %u) + %u us",
+            report.received, report.lost, report.errors, report.forwarded, report.dropped,
+            report.node_latency_us, report.relay_avg_us, report.relay_max_us,
+            report.hub_latency_us);
+
+    err = bt_sound_notify_iso_report(&report, sizeof(report));
+    if (err && err != -EACCES) {
+        LOG_DBG("[ISO] report notify failed (err %d)", err);
+    }
+
+    k_work_reschedule_for_queue(&relay_link_workq, &iso_report_work,
+                                K_SECONDS(CONFIG_RELAY_SOUND_ISO_REPORT_S));
+}
+
+void sound_iso_init(void)
+{
+    int err = bt_iso_server_register(&iso_server);
+
+    if (err) {
+        LOG_WRN("[ISO] server register failed (err %d)", err);
+    }
+}
+
+void sound_iso_node_ready(struct bt_conn *conn)
+{
+    if (node_conn == conn) {
+        /* rediscover: CIS 는 그대로 */
+        return;
+    }
+    if (node_conn) {
+        bt_conn_unref(node_conn);
+    }
+    node_conn = bt_conn_ref(conn);
+    connect_tries = 0;
+    k_work_reschedule_for_queue(&relay_link_workq, &iso_connect_work, K_NO_WAIT);
+}
+
+void sound_iso_node_lost(void)
+{
+    /* CIS 는 ACL 과 함께 끊긴다 */
+    k_work_cancel_delayable(&iso_connect_work);
+    k_work_cancel_delayable(&iso_report_work);
+    if (node_conn) {
+        bt_conn_unref(node_conn);
+        node_conn = NULL;
+    }
+}
+
+#else
+
+void sound_iso_init(void)
+{
+}
+
+void sound_iso_node_ready(struct bt_conn *conn)
+{
+}
+
+void sound_iso_node_lost(void)
+{
+}
+
+#endif /* CONFIG_RELAY_SOUND_ISO */
@@ -0,0 +1,44 @@
+#ifndef _SOUND_ISO_H_
+#define _SOUND_ISO_H_
+
+#include <stdint.h>
+#include <zephyr/bluetooth/conn.h>
+
+#include "sound.h"
+
+/** @brief Raw sound over LE isochronous channels (CONFIG_RELAY_SOUND_ISO).
+ *
+ * GATT notifications queue up behind each other and are retransmitted
+ * until they get through, so continuous audio builds a backlog. Raw sound
+ * goes over two CISes instead:
+ *  - node -> relay: the relay (central of the node link) creates a CIG with
+ *    one CIS after the node is discovered, peripheral to central only,
+ *    SDU interval CONFIG_RELAY_SOUND_ISO_SDU_INTERVAL_US and
+ *    CONFIG_RELAY_SOUND_ISO_RTN retransmissions.
+ *  - relay -> hub: the hub (central of the hub link) creates the CIS, the
+ *    relay accepts it and sends every node SDU in the same SDU interval.
+ *
+ * An SDU is forwarded from the ISO receive callback. When the hub CIS is
+ * not connected or CONFIG_RELAY_SOUND_ISO_TX_QUEUE SDUs are still waiting
+ * for the controller, the SDU is dropped instead of queued, so the delay
+ * never grows. SDUs lost or broken on the node CIS are not sent.
+ *
+ * Every CONFIG_RELAY_SOUND_ISO_REPORT_S the relay logs and notifies a
+ * struct ble_sound_iso_report_packet on the sound ISO characteristic.
+ */
+
+/** @brief Register the hub CIS server. Call once before bt_enable(). */
+void sound_iso_init(void);
+
+/** @brief Node discovery is done: set up the node CIS. */
+void sound_iso_node_ready(struct bt_conn *conn);
+
+/** @brief The node link is gone. */
+void sound_iso_node_lost(void);
+
+#if defined(CONFIG_RELAY_SOUND_ISO)
+/** @brief Counters since the node CIS was set up. */
+void sound_iso_report_get(struct ble_sound_iso_report_packet *report);
+#endif
+
+#endif
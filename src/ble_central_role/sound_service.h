@@ -3,6 +3,7 @@
 #define SOUND_UUID_SERVICE      0x0500
 #define SOUND_UUID_CHAR_MODEL   0x0501
 #define SOUND_UUID_CHAR_FEATURE 0x0502
+#define SOUND_UUID_CHAR_ISO     0x0503
 
 /** UUID of the sound prediction service */
 #define BT_UUID_SOUND_SERVICE_VAL \
@@ -16,16 +17,23 @@
 #define BT_UUID_CHRC_SOUND_FEATURE_VAL \
     BT_UUID_128_ENCODE(BT_ADLD_SPECIFIC_UUID_FIRST + SOUND_UUID_CHAR_FEATURE, BT_ADLD_SPECIFIC_UUID_SECOND, BT_ADLD_SPECIFIC_UUID_THIRD, BT_ADLD_SPECIFIC_UUID_FOURTH, BT_ADLD_SPECIFIC_UUID_LAST)
 
+/** UUID of the raw sound ISO statistics characteristic (CONFIG_RELAY_SOUND_ISO) */
+#define BT_UUID_CHRC_SOUND_ISO_VAL \
+    BT_UUID_128_ENCODE(BT_ADLD_SPECIFIC_UUID_FIRST + SOUND_UUID_CHAR_ISO, BT_ADLD_SPECIFIC_UUID_SECOND, BT_ADLD_SPECIFIC_UUID_THIRD, BT_ADLD_SPECIFIC_UUID_FOURTH, BT_ADLD_SPECIFIC_UUID_LAST)
+
 /** Sound Prediction Service */
 #define BT_UUID_SOUND_SERVICE       BT_UUID_DECLARE_128(BT_UUID_SOUND_SERVICE_VAL)
 /** Sound Prediction Event Characteristic */
 #define BT_UUID_CHRC_SOUND_MODEL    BT_UUID_DECLARE_128(BT_UUID_CHRC_SOUND_MODEL_VAL)
 /** Sound Prediction Feature Collection Characteristic*/
 #define BT_UUID_CHRC_SOUND_FEATURE  BT_UUID_DECLARE_128(BT_UUID_CHRC_SOUND_FEATURE_VAL)
+/** Raw Sound ISO Statistics Characteristic */
+#define BT_UUID_CHRC_SOUND_ISO      BT_UUID_DECLARE_128(BT_UUID_CHRC_SOUND_ISO_VAL)
 
 /** BLE gatt attribute idx*/
 #define SOUND_ATTRS_MODEL_IDX         1
 #define SOUND_ATTRS_FEATURE_IDX       4
+#define SOUND_ATTRS_ISO_IDX           7
 
 bool is_feature_notify_enabled(void);
 bool is_model_notify_enabled(void);
@@ -35,5 +43,6 @@ struct k_sem *get_noti_enabled_sem(void);
 
 int bt_sound_notify_model(const void *data, uint16_t len);
 int bt_sound_notify_feature(const void *data, uint16_t len);
+int bt_sound_notify_iso_report(const void *data, uint16_t len);
 
 uint8_t bt_sound_result_notify_handler(struct bt_conn *conn, struct bt_gatt_subscribe_params *params, const void *data, uint16_t length);
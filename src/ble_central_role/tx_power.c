@@ -0,0 +1,346 @@
+/* tx_power.c
+ *
+ * 목적:
+ *  - 광고 / 연결 TX power 를 vendor specific HCI 명령으로 쓰고 읽는다.
+ *  - CONFIG_RELAY_TX_POWER_CONTROL: 연결마다 RSSI 와 (가능하면) LE Power Control 로
+ *    받은 상대 TX power 로 path loss 를 구하고, 상대가 받는 RSSI 가 목표 band 안에
+ *    들도록 연결별 TX power 를 조절한다.
+ *
+ * 필요 이상으로 큰 TX power 는 옆 방 relay 링크에 간섭이 되고, 너무 작으면
+ * 재전송이 는다. band 아래로 떨어지면 바로 올리고, 위로 벗어나면 한 step 씩 내린다.
+ */
+#include "tx_power.h"
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/hci.h>
+#include <zephyr/bluetooth/hci_vs.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+#include <zephyr/logging/log.h>
+
+#include "relay_workq.h"
+#include "room_device.h"
+
+LOG_MODULE_REGISTER(tx_power, LOG_LEVEL_INF);
+
+int tx_power_write(uint8_t handle_type, uint16_t handle, int8_t tx_dbm)
+{
+    struct bt_hci_cp_vs_write_tx_power_level *cp;
+    struct net_buf *buf, *rsp = NULL;
+
+    buf = bt_hci_cmd_create(BT_HCI_OP_VS_WRITE_TX_POWER_LEVEL, sizeof(*cp));
+    if (!buf) {
+        return -ENOMEM;
+    }
+
+    cp = net_buf_add(buf, sizeof(*cp));
+    cp->handle_type    = handle_type;
+    cp->handle         = sys_cpu_to_le16(handle);
+    cp->tx_power_level = tx_dbm;
+
+    int err = bt_hci_cmd_send_sync(BT_HCI_OP_VS_WRITE_TX_POWER_LEVEL, buf, &rsp);
+    if (rsp) {
+        net_buf_unref(rsp);
+    }
+    return err;
+}
+
+int tx_power_read(uint8_t handle_type, uint16_t handle, int8_t *out_dbm)
+{
+    struct bt_hci_cp_vs_read_tx_power_level *cp;
+    struct bt_hci_rp_vs_read_tx_power_level *rp;
+    struct net_buf *buf, *rsp = NULL;
+
+    buf = bt_hci_cmd_create(BT_HCI_OP_VS_READ_TX_POWER_LEVEL, sizeof(*cp));
+    if (!buf) {
+        return -ENOMEM;
+    }
+
+    cp = net_buf_add(buf, sizeof(*cp));
+    cp->handle_type = handle_type;
+    cp->handle      = sys_cpu_to_le16(handle);
+
+    int err = bt_hci_cmd_send_sync(BT_HCI_OP_VS_READ_TX_POWER_LEVEL, buf, &rsp);
+    if (err) {
+        return err;
+    }
+
+    rp = (void *)rsp->data;
+    *out_dbm = (int8_t)rp->tx_power_level;
+    net_buf_unref(rsp);
+    return 0;
+}
+
+#if defined(CONFIG_RELAY_TX_POWER_CONTROL)
+
+BUILD_ASSERT(CONFIG_RELAY_TX_POWER_TARGET_LOW_DBM < CONFIG_RELAY_TX_POWER_TARGET_HIGH_DBM,
+             "empty TX power target band");
+BUILD_ASSERT(CONFIG_RELAY_TX_POWER_TARGET_HIGH_DBM - CONFIG_RELAY_TX_POWER_TARGET_LOW_DBM >=
+             CONFIG_RELAY_TX_POWER_STEP_DB,
+             "one step down must not jump over the target band");
+BUILD_ASSERT(CONFIG_RELAY_TX_POWER_MIN_DBM <= CONFIG_RELAY_TX_POWER_MAX_DBM,
+             "CONFIG_RELAY_TX_POWER_MIN_DBM above CONFIG_RELAY_TX_POWER_MAX_DBM");
+
+#define TX_POWER_UNKNOWN        127     /* HCI: RSSI / TX power 없음 */
+#define TX_POWER_TARGET_MID     ((CONFIG_RELAY_TX_POWER_TARGET_LOW_DBM + \
+                                  CONFIG_RELAY_TX_POWER_TARGET_HIGH_DBM) / 2)
+#define Q4(dbm)                 ((int32_t)(dbm) * 16)   /* 1/16 dB */
+
+struct tx_link
+{
+    const char *name;       /* hub / node / room */
+    bool ready;             /* 현재 TX power 를 읽었음 */
+    bool rssi_valid;
+    int32_t rssi_q4;        /* 평균 RSSI (EWMA 1/4), 1/16 dB */
+    int8_t peer_dbm;        /* 평균에 쓴 상대 TX power */
+    int8_t tx_dbm;          /* controller 의 현재 (effective) TX power */
+    uint16_t changes;
+};
+
+/* bt_conn_index() 별. links[] 는 relay_hci_workq 에서만 만진다. */
+static struct tx_link links[CONFIG_BT_MAX_CONN];
+static atomic_t peer_tx_dbm[CONFIG_BT_MAX_CONN];
+static ATOMIC_DEFINE(link_new, CONFIG_BT_MAX_CONN);
+static ATOMIC_DEFINE(peer_stale, CONFIG_BT_MAX_CONN);
+
+static void tx_power_work_handler(struct k_work *work);
+
+K_WORK_DELAYABLE_DEFINE(tx_power_work, tx_power_work_handler);
+
+static int hci_read_rssi(uint16_t handle, int8_t *out_rssi)
+{
+    struct bt_hci_cp_read_rssi *cp;
+    struct bt_hci_rp_read_rssi *rp;
+    struct net_buf *buf, *rsp = NULL;
+
+    buf = bt_hci_cmd_create(BT_HCI_OP_READ_RSSI, sizeof(*cp));
+    if (!buf) {
+        return -ENOMEM;
+    }
+
+    cp = net_buf_add(buf, sizeof(*cp));
+    cp->handle = sys_cpu_to_le16(handle);
+
+    int err = bt_hci_cmd_send_sync(BT_HCI_OP_READ_RSSI, buf, &rsp);
+    if (err) {
+        return err;
+    }
+
+    rp = (void *)rsp->data;
+    *out_rssi = rp->rssi;
+    net_buf_unref(rsp);
+    return 0;
+}
+
+#if defined(CONFIG_BT_TRANSMIT_POWER_CONTROL)
+static enum bt_conn_le_tx_power_phy tx_power_phy(uint8_t gap_phy)
+{
+    switch (gap_phy) {
+    case BT_GAP_LE_PHY_2M:
+        return BT_CONN_LE_TX_POWER_PHY_2M;
+    case BT_GAP_LE_PHY_CODED:
+        return BT_CONN_LE_TX_POWER_PHY_CODED_S8;
+    default:
+        return BT_CONN_LE_TX_POWER_PHY_1M;
+    }
+}
+
+/* 상대 TX power: 지금 값 한 번 읽고, 이후 바뀔 때마다 report 받기 */
+static void peer_power_request(struct bt_conn *conn, const struct bt_conn_info *info)
+{
+    int err = bt_conn_le_set_tx_power_report_enable(conn, false, true);
+
+    if (!err) {
+        /* 상대가 보내는 PHY = 우리가 받는 PHY */
+        err = bt_conn_le_get_remote_tx_power_level(conn, tx_power_phy(info->le.phy->rx_phy));
+    }
+    if (err) {
+        LOG_DBG("[TXPWR] LE Power Control not available (err %d), peer assumed at %d dBm",
+                err, CONFIG_RELAY_TX_POWER_PEER_DBM);
+    }
+}
+
+static void tx_power_report(struct bt_conn *conn, const struct bt_conn_le_tx_power_report *report)
+{
+    if (report->reason != BT_HCI_LE_TX_POWER_REPORT_REASON_REMOTE_CHANGED &&
+        report->reason != BT_HCI_LE_TX_POWER_REPORT_REASON_READ_REMOTE) {
+        return;
+    }
+    if (report->tx_power_level == BT_HCI_LE_TX_POWER_LEVEL_NOT_MANAGED ||
+        report->tx_power_level == BT_HCI_LE_TX_POWER_LEVEL_UNAVAILABLE) {
+        return;
+    }
+
+    atomic_set(&peer_tx_dbm[bt_conn_index(conn)], report->tx_power_level);
+}
+#else
+static void peer_power_request(struct bt_conn *conn, const struct bt_conn_info *info)
+{
+    ARG_UNUSED(conn);
+    ARG_UNUSED(info);
+}
+#endif /* CONFIG_BT_TRANSMIT_POWER_CONTROL */
+
+static const char *link_name(struct bt_conn *conn, const struct bt_conn_info *info)
+{
+    if (info->role == BT_CONN_ROLE_PERIPHERAL) {
+        return "hub";
+    }
+    return room_device_owns(conn) ? "room" : "node";
+}
+
+/* 연결 하나의 한 주기: RSSI -> path loss -> 상대가 받는 RSSI -> TX power */
+static void link_update(struct bt_conn *conn, void *user_data)
+{
+    unsigned int *active = user_data;
+    uint8_t idx = bt_conn_index(conn);
+    struct tx_link *l = &links[idx];
+    struct bt_conn_info info;
+    uint16_t handle;
+    int8_t rssi, peer, eff;
+    int32_t at_peer_q4, want;
+    int err;
+
+    if (bt_conn_get_info(conn, &info) || info.state != BT_CONN_STATE_CONNECTED ||
+        bt_hci_get_conn_handle(conn, &handle)) {
+        return;
+    }
+    (*active)++;
+
+    if (atomic_test_and_clear_bit(link_new, idx)) {
+        memset(l, 0, sizeof(*l));
+        l->name = link_name(conn, &info);
+        atomic_set_bit(peer_stale, idx);
+    }
+    if (atomic_test_and_clear_bit(peer_stale, idx)) {
+        peer_power_request(conn, &info);
+    }
+
+    if (!l->ready) {
+        if (tx_power_read(BT_HCI_VS_LL_HANDLE_TYPE_CONN, handle, &l->tx_dbm)) {
+            return;
+        }
+        l->ready = true;
+    }
+
+    if (hci_read_rssi(handle, &rssi) || rssi == TX_POWER_UNKNOWN) {
+        return;
+    }
+
+    peer = (int8_t)atomic_get(&peer_tx_dbm[idx]);
+    if (peer == TX_POWER_UNKNOWN) {
+        peer = CONFIG_RELAY_TX_POWER_PEER_DBM;
+    }
+
+    if (!l->rssi_valid || peer != l->peer_dbm) {
+        /* 상대가 TX power 를 바꾸면 평균을 새로 시작 */
+        l->rssi_q4 = Q4(rssi);
+        l->peer_dbm = peer;
+        l->rssi_valid = true;
+    } else {
+        l->rssi_q4 += (Q4(rssi) - l->rssi_q4) / 4;
+    }
+
+    /* path loss = 상대 TX - 우리 RSSI,  상대가 받는 RSSI = 우리 TX - path loss */
+    at_peer_q4 = Q4(l->tx_dbm) - (Q4(peer) - l->rssi_q4);
+
+    if (at_peer_q4 < Q4(CONFIG_RELAY_TX_POWER_TARGET_LOW_DBM)) {
+        /* margin 부족: 재전송이 늘기 전에 band 가운데까지 바로 */
+        want = l->tx_dbm + DIV_ROUND_UP(Q4(TX_POWER_TARGET_MID) - at_peer_q4, 16);
+    } else if (at_peer_q4 > Q4(CONFIG_RELAY_TX_POWER_TARGET_HIGH_DBM)) {
+        /* 남는 margin: 한 step 씩 */
+        want = l->tx_dbm - MIN(CONFIG_RELAY_TX_POWER_STEP_DB,
+                               (at_peer_q4 - Q4(TX_POWER_TARGET_MID)) / 16);
+    } else {
+        return;
+    }
+
+    want = CLAMP(want, CONFIG_RELAY_TX_POWER_MIN_DBM, CONFIG_RELAY_TX_POWER_MAX_DBM);
+    if (want == l->tx_dbm) {
+        return;
+    }
+
+    err = tx_power_write(BT_HCI_VS_LL_HANDLE_TYPE_CONN, handle, (int8_t)want);
+    if (!err) {
+        err = tx_power_read(BT_HCI_VS_LL_HANDLE_TYPE_CONN, handle, &eff);
+    }
+    if (err) {
+        LOG_WRN("[TXPWR] %s link: write %d dBm failed (%d)", l->name, want, err);
+        return;
+    }
+
+    /* controller 가 지원하는 가장 가까운 level 로 맞춘다 (같으면 조용히) */
+    if (eff != l->tx_dbm) {
+        LOG_INF("[TXPWR] %s link: rssi %d dBm, path loss %d dB, at peer %d dBm -> tx %d dBm (effective %d)",
+                l->name, l->rssi_q4 / 16, peer - l->rssi_q4 / 16, at_peer_q4 / 16, want, eff);
+        l->tx_dbm = eff;
+        l->changes++;
+    }
+}
+
+static void tx_power_work_handler(struct k_work *work)
+{
+    unsigned int active = 0;
+
+    bt_conn_foreach(BT_CONN_TYPE_LE, link_update, &active);
+
+    if (active) {
+        k_work_reschedule_for_queue(&relay_hci_workq, &tx_power_work,
+                                    K_MSEC(CONFIG_RELAY_TX_POWER_PERIOD_MS));
+    }
+}
+
+static void tx_power_connected(struct bt_conn *conn, uint8_t conn_err)
+{
+    uint8_t idx;
+
+    if (conn_err) {
+        return;
+    }
+
+    idx = bt_conn_index(conn);
+    atomic_set(&peer_tx_dbm[idx], TX_POWER_UNKNOWN);
+    atomic_set_bit(link_new, idx);
+
+    /* 이미 돌고 있으면 그 주기에 같이 */
+    k_work_schedule_for_queue(&relay_hci_workq, &tx_power_work,
+                              K_MSEC(CONFIG_RELAY_TX_POWER_PERIOD_MS));
+}
+
+static void tx_power_disconnected(struct bt_conn *conn, uint8_t reason)
+{
+    uint8_t idx = bt_conn_index(conn);
+    const struct tx_link *l = &links[idx];
+
+    /* link_new 이 아직 서 있으면 links[idx] 는 이전 연결의 것 */
+    if (!atomic_test_and_set_bit(link_new, idx) && l->ready) {
+        LOG_INF("[TXPWR] %s link closed at %d dBm after %u changes",
+                l->name, l->tx_dbm, l->changes);
+    }
+}
+
+#if defined(CONFIG_BT_USER_PHY_UPDATE)
+static void tx_power_le_phy_updated(struct bt_conn *conn, struct bt_conn_le_phy_info *param)
+{
+    /* 상대 TX power 는 PHY 별로 다를 수 있다 */
+    atomic_set_bit(peer_stale, bt_conn_index(conn));
+}
+#endif
+
+BT_CONN_CB_DEFINE(tx_power_conn_callbacks) = {
+    .connected = tx_power_connected,
+    .disconnected = tx_power_disconnected,
+#if defined(CONFIG_BT_USER_PHY_UPDATE)
+    .le_phy_updated = tx_power_le_phy_updated,
+#endif
+#if defined(CONFIG_BT_TRANSMIT_POWER_CONTROL)
+    .tx_power_report = tx_power_report,
+#endif
+};
+
+#endif /* CONFIG_RELAY_TX_POWER_CONTROL */
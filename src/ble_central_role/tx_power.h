@@ -0,0 +1,36 @@
+#ifndef _TX_POWER_H_
+#define _TX_POWER_H_
+
+#include <stdint.h>
+
+/** @brief TX power of the advertising set and of every connection.
+ *
+ * The vendor specific Write / Read TX Power Level commands take a handle
+ * type and a handle, so the same two helpers set the advertising power
+ * (BT_HCI_VS_LL_HANDLE_TYPE_ADV, set 0) and the power of one connection
+ * (BT_HCI_VS_LL_HANDLE_TYPE_CONN, connection handle). The controller picks
+ * the nearest level it supports, FEM gain included; read it back to get
+ * the effective level. Both commands are sync: call them from
+ * relay_hci_workq.
+ *
+ * With CONFIG_RELAY_TX_POWER_CONTROL every connection (hub, node and room
+ * devices) runs a closed loop on relay_hci_workq:
+ *  - RSSI of the link (HCI Read RSSI), averaged.
+ *  - Path loss = TX power of the peer - RSSI. The peer TX power comes from
+ *    LE Power Control when both sides support it
+ *    (CONFIG_BT_TRANSMIT_POWER_CONTROL), otherwise
+ *    CONFIG_RELAY_TX_POWER_PEER_DBM is assumed.
+ *  - RSSI at the peer = our TX power - path loss. Below
+ *    CONFIG_RELAY_TX_POWER_TARGET_LOW_DBM the relay raises its TX power to
+ *    the middle of the band at once; above
+ *    CONFIG_RELAY_TX_POWER_TARGET_HIGH_DBM it lowers it by
+ *    CONFIG_RELAY_TX_POWER_STEP_DB per period.
+ */
+
+/** @brief Write the TX power of one advertising set / connection. Sync HCI. */
+int tx_power_write(uint8_t handle_type, uint16_t handle, int8_t tx_dbm);
+
+/** @brief Read the effective TX power of one advertising set / connection. Sync HCI. */
+int tx_power_read(uint8_t handle_type, uint16_t handle, int8_t *out_dbm);
+
+#endif
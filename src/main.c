@@ -2,14 +2,22 @@
 #include <zephyr/logging/log.h>
 
 #include "ble_relay_control.h"
+#if defined(CONFIG_RELAY_FWD_BENCH)
+#include "relay_fwd_bench.h"
+#endif
 
 /* 위 파일의 프로토타입 */
 // int central_discovery_start(void);
 
 void main(void)
 {
+#if defined(CONFIG_RELAY_FWD_BENCH)
+    /* radio 없이 forward path 만 측정 */
+    relay_fwd_bench_run();
+#else
     printk("Relay Central discovery-subscribe start\n");
     ble_relay_control_start();
+#endif
 
     while (1) {
         k_sleep(K_MSEC(1000));